@@ -10,8 +10,10 @@ notExists() {
 
 # check number of input variables
 [ "$#" -ne 4 ] && echo "Please provide <queryFASTA> <targetFASTA>|<targetDB> <outFile> <tmp>" && exit 1;
-# check paths
-[ ! -f "$1" ] &&  echo "$1 not found!" && exit 1;
+# check paths, streamed queries can be read from stdin
+if [ -z "${STREAM_QUERIES}" ] || [ "$1" != "stdin" ]; then
+    [ ! -f "$1" ] &&  echo "$1 not found!" && exit 1;
+fi
 [ ! -f "$2" ] &&  echo "$2 not found!" && exit 1;
 [   -f "$3" ] &&  echo "$3 exists already!" && exit 1;
 [ ! -d "$4" ] &&  echo "tmp directory $4 not found!" && mkdir -p "$4";
@@ -21,12 +23,6 @@ TARGET="$2"
 RESULTS="$3"
 TMP_PATH="$4"
 
-if notExists "${TMP_PATH}/query"; then
-    # shellcheck disable=SC2086
-    "$MMSEQS" createdb "${INPUT}" "${TMP_PATH}/query" ${CREATEDB_PAR} \
-        || fail "query createdb died"
-fi
-
 if notExists "${TARGET}.dbtype"; then
     if notExists "${TMP_PATH}/target"; then
         # shellcheck disable=SC2086
@@ -36,8 +32,27 @@ if notExists "${TARGET}.dbtype"; then
     TARGET="${TMP_PATH}/target"
 fi
 
+# streamsearch only runs prefilter and align, nucleotide and profile targets need the search workflow
+if [ -n "${STREAM_QUERIES}" ] && [ "$("$MMSEQS" dbtype "${TARGET}")" != "Aminoacid" ]; then
+    echo "Queries can only be streamed against amino acid targets. They will be converted to a database first."
+    STREAM_QUERIES=""
+fi
+
+if [ -z "${STREAM_QUERIES}" ] && notExists "${TMP_PATH}/query"; then
+    # shellcheck disable=SC2086
+    "$MMSEQS" createdb "${INPUT}" "${TMP_PATH}/query" ${CREATEDB_PAR} \
+        || fail "query createdb died"
+fi
+
+if [ -n "${STREAM_QUERIES}" ]; then
+    # queries are read, searched and converted in batches without a query database
+    # shellcheck disable=SC2086
+    "$MMSEQS" streamsearch "${INPUT}" "${TARGET}" "${TMP_PATH}/alis" "${TMP_PATH}/stream_tmp" ${STREAMSEARCH_PAR} \
+        || fail "Stream search died"
+fi
+
 INTERMEDIATE="${TMP_PATH}/result"
-if notExists "${INTERMEDIATE}"; then
+if [ -z "${STREAM_QUERIES}" ] && notExists "${INTERMEDIATE}"; then
     # shellcheck disable=SC2086
     "$MMSEQS" search "${TMP_PATH}/query" "${TARGET}" "${INTERMEDIATE}" "${TMP_PATH}/search_tmp" ${SEARCH_PAR} \
         || fail "Search died"
@@ -77,5 +92,6 @@ if [ -n "${REMOVE_TMP}" ]; then
         rm -f "${TMP_PATH}/query" "${TMP_PATH}/query.index" "${TMP_PATH}/query_h" "${TMP_PATH}/query_h.index" "${TMP_PATH}/query.lookup" "${TMP_PATH}/query.dbtype"
     fi
     rm -rf "${TMP_PATH}/search_tmp"
+    rm -rf "${TMP_PATH}/stream_tmp"
     rm -f "${TMP_PATH}/easysearch.sh"
 fi
@@ -50,6 +50,18 @@
 #define SSE
 #endif
 
+// kernels that are compiled once per instruction set (see SimdDispatch.h)
+// live in a namespace named after the instruction set of the translation unit
+#if defined(AVX512)
+#define SIMD_NAMESPACE simd_avx512
+#elif defined(AVX2)
+#define SIMD_NAMESPACE simd_avx2
+#elif defined(NEON)
+#define SIMD_NAMESPACE simd_neon
+#else
+#define SIMD_NAMESPACE simd_sse41
+#endif
+
 #ifdef NEON
 #include "sse2neon.h"
 #else
@@ -57,7 +69,7 @@
 #endif
 
 #ifdef AVX512
-#include <zmmintrin.h.h> // AVX512
+#include <immintrin.h> // AVX512
 // double support
 #ifndef SIMD_DOUBLE
 #define SIMD_DOUBLE
@@ -112,18 +124,50 @@ typedef __m512  simd_float;
 #define SIMD_INT
 #define ALIGN_INT           AVX512_ALIGN_INT
 #define VECSIZE_INT         AVX512_VECSIZE_INT
+//function header
+static inline uint16_t simd_hmax16_avx512(const __m512i buffer);
+static inline uint8_t simd_hmax8_avx512(const __m512i buffer);
+
+// byte shift across the 128 bit lanes (AVX512BW)
+template  <unsigned int N> static inline __m512i _mm512_shift_left(__m512i a)
+{
+    // lanes: 0, a0, a1, a2
+    __m512i mask = _mm512_alignr_epi64(a, _mm512_setzero_si512(), 6);
+    return _mm512_alignr_epi8(a, mask, 16-N);
+}
+
+template  <unsigned int N> static inline __m512i _mm512_shift_right(__m512i a)
+{
+    // lanes: a1, a2, a3, 0
+    __m512i mask = _mm512_alignr_epi64(_mm512_setzero_si512(), a, 2);
+    return _mm512_alignr_epi8(mask, a, N);
+}
+
 typedef __m512i simd_int;
+// compare operations return vectors like SSE/AVX2 instead of AVX512 masks,
+// so the same kernel code can be used with simdi8_movemask
+typedef uint64_t simdi8_movemask_t;
+#define SIMDI8_MOVEMASK_ALL 0xffffffffffffffffULL
 #define simdi32_add(x,y)    _mm512_add_epi32(x,y)
 #define simdi16_add(x,y)    _mm512_add_epi16(x,y)
 #define simdi16_adds(x,y)   _mm512_adds_epi16(x,y)
-#define simdui8_adds(x,y)   NOT_YET_IMP()
+#define simdi8_add(x,y)     _mm512_add_epi8(x,y)
+#define simdui8_adds(x,y)   _mm512_adds_epu8(x,y)
 #define simdi32_sub(x,y)    _mm512_sub_epi32(x,y)
-#define simdui8_subs(x,y)   NOT_YET_IMP()
+#define simdui16_subs(x,y)  _mm512_subs_epu16(x,y)
+#define simdi8_sub(x,y)     _mm512_sub_epi8(x,y)
+#define simdui8_subs(x,y)   _mm512_subs_epu8(x,y)
 #define simdi32_mul(x,y)    _mm512_mullo_epi32(x,y)
-#define simdui8_max(x,y)    NOT_YET_IMP()
-#define simdi16_max(x,y)    _mm512_max_epi32(x,y)
+#define simdui8_max(x,y)    _mm512_max_epu8(x,y)
+#define simdui8_min(x,y)    _mm512_min_epu8(x,y)
+#define simdi8_max(x,y)     _mm512_max_epi8(x,y)
+#define simdi8_min(x,y)     _mm512_min_epi8(x,y)
+#define simdi16_max(x,y)    _mm512_max_epi16(x,y)
 #define simdi32_max(x,y)    _mm512_max_epi32(x,y)
+#define simdi16_hmax(x)     simd_hmax16_avx512(x)
+#define simdi8_hmax(x)      simd_hmax8_avx512(x)
 #define simdi_load(x)       _mm512_load_si512(x)
+#define simdi_loadu(x)      _mm512_loadu_si512(x)
 #define simdi_streamload(x) _mm512_stream_load_si512(x)
 #define simdi_store(x,y)    _mm512_store_si512(x,y)
 #define simdi_storeu(x,y)   _mm512_storeu_si512(x,y)
@@ -134,22 +178,25 @@ typedef __m512i simd_int;
 #define simdi16_shuffle(x,y) _mm512_shuffle_epi16(x,y)
 #define simdi8_shuffle(x,y)  _mm512_shuffle_epi8(x,y)
 #define simdi_setzero()     _mm512_setzero_si512()
-#define simdi32_gt(x,y)     _mm512_cmpgt_epi32(x,y)
-#define simdi8_gt(x,y)      NOT_YET_IMP()
-#define simdi16_gt(x,y)     NOT_YET_IMP()
-#define simdi8_eq(x,y)      NOT_YET_IMP()
-#define simdi32_lt(x,y)     _mm512_cmplt_epi32(x,y)
-#define simdi16_lt(x,y)     NOT_YET_IMP()
-#define simdi8_lt(x,y)      NOT_YET_IMP()
+#define simdi32_gt(x,y)     _mm512_movm_epi32(_mm512_cmpgt_epi32_mask(x,y))
+#define simdi8_gt(x,y)      _mm512_movm_epi8(_mm512_cmpgt_epi8_mask(x,y))
+#define simdi8_blendv(x,y,mask) _mm512_mask_blend_epi8(_mm512_movepi8_mask(mask),x,y) // mask ? y : x
+#define simdi16_gt(x,y)     _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(x,y))
+#define simdi8_eq(x,y)      _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(x,y))
+#define simdi16_eq(x,y)     _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(x,y))
+#define simdi32_eq(x,y)     _mm512_movm_epi32(_mm512_cmpeq_epi32_mask(x,y))
+#define simdi32_lt(x,y)     _mm512_movm_epi32(_mm512_cmplt_epi32_mask(x,y))
+#define simdi16_lt(x,y)     _mm512_movm_epi16(_mm512_cmplt_epi16_mask(x,y))
+#define simdi8_lt(x,y)      _mm512_movm_epi8(_mm512_cmplt_epi8_mask(x,y))
 
 #define simdi_or(x,y)       _mm512_or_si512(x,y)
 #define simdi_and(x,y)      _mm512_and_si512(x,y)
 #define simdi_andnot(x,y)   _mm512_andnot_si512(x,y)
 #define simdi_xor(x,y)      _mm512_xor_si512(x,y)
-#define simdi8_shiftl(x,y)  NOT_YET_IMP()
-#define simdi8_shiftr(x,y)  NOT_YET_IMP()
-#define simdi8_movemask(x)  NOT_YET_IMP()
-#define simdi16_extract(x,y) NOT_YET_IMP()
+#define simdi8_shiftl(x,y)  _mm512_shift_left<y>(x)
+#define simdi8_shiftr(x,y)  _mm512_shift_right<y>(x)
+#define simdi8_movemask(x)  _mm512_movepi8_mask(x)
+#define simdi16_extract(x,y) extract_epi16(x,y)
 #define simdi16_slli(x,y)	_mm512_slli_epi16(x,y) // shift integers in a left by y
 #define simdi16_srli(x,y)	_mm512_srli_epi16(x,y) // shift integers in a right by y
 #define simdi32_slli(x,y)	_mm512_slli_epi32(x,y) // shift integers in a left by y
@@ -168,28 +215,35 @@ typedef __m512i simd_int;
 #define ALIGN_INT           AVX2_ALIGN_INT
 #define VECSIZE_INT         AVX2_VECSIZE_INT
 //function header
-uint16_t simd_hmax16_avx(const __m256i buffer);
-uint8_t simd_hmax8_avx(const __m256i buffer);
+static inline uint16_t simd_hmax16_avx(const __m256i buffer);
+static inline uint8_t simd_hmax8_avx(const __m256i buffer);
 
-template  <unsigned int N> inline __m256i _mm256_shift_left(__m256i a)
+template  <unsigned int N> static inline __m256i _mm256_shift_left(__m256i a)
 {
     __m256i mask = _mm256_permute2x128_si256(a, a, _MM_SHUFFLE(0,0,3,0) );
     return _mm256_alignr_epi8(a,mask,16-N);
 }
 
 typedef __m256i simd_int;
+typedef uint32_t simdi8_movemask_t;
+#define SIMDI8_MOVEMASK_ALL 0xffffffff
 #define simdi32_add(x,y)    _mm256_add_epi32(x,y)
 #define simdi16_add(x,y)    _mm256_add_epi16(x,y)
 #define simdi16_adds(x,y)   _mm256_adds_epi16(x,y)
+#define simdi8_add(x,y)     _mm256_add_epi8(x,y)
 #define simdui8_adds(x,y)   _mm256_adds_epu8(x,y)
 #define simdi32_sub(x,y)    _mm256_sub_epi32(x,y)
 #define simdui16_subs(x,y)  _mm256_subs_epu16(x,y)
+#define simdi8_sub(x,y)     _mm256_sub_epi8(x,y)
 #define simdui8_subs(x,y)   _mm256_subs_epu8(x,y)
 #define simdi32_mul(x,y)    _mm256_mullo_epi32(x,y)
 #define simdi32_max(x,y)    _mm256_max_epi32(x,y)
 #define simdi16_max(x,y)    _mm256_max_epi16(x,y)
 #define simdi16_hmax(x)     simd_hmax16_avx(x)
 #define simdui8_max(x,y)    _mm256_max_epu8(x,y)
+#define simdui8_min(x,y)    _mm256_min_epu8(x,y)
+#define simdi8_max(x,y)     _mm256_max_epi8(x,y)
+#define simdi8_min(x,y)     _mm256_min_epi8(x,y)
 #define simdi8_hmax(x)      simd_hmax8_avx(x)
 #define simdi_load(x)       _mm256_load_si256(x)
 #define simdi_loadu(x)       _mm256_loadu_si256(x)
@@ -205,6 +259,7 @@ typedef __m256i simd_int;
 #define simdi_setzero()     _mm256_setzero_si256()
 #define simdi32_gt(x,y)     _mm256_cmpgt_epi32(x,y)
 #define simdi8_gt(x,y)      _mm256_cmpgt_epi8(x,y)
+#define simdi8_blendv(x,y,mask) _mm256_blendv_epi8(x,y,mask) // mask ? y : x
 #define simdi16_gt(x,y)     _mm256_cmpgt_epi16(x,y)
 #define simdi8_eq(x,y)      _mm256_cmpeq_epi8(x,y)
 #define simdi16_eq(x,y)     _mm256_cmpeq_epi16(x,y)
@@ -285,8 +340,8 @@ typedef __m256 simd_float;
 
 
 #ifdef SSE
-uint16_t simd_hmax16(const __m128i buffer);
-uint8_t simd_hmax8(const __m128i buffer);
+static inline uint16_t simd_hmax16(const __m128i buffer);
+static inline uint8_t simd_hmax8(const __m128i buffer);
 #ifndef NEON
 #include <smmintrin.h>  //SSE4.1
 // double support
@@ -346,18 +401,25 @@ typedef __m128  simd_float;
 #define ALIGN_INT           SSE_ALIGN_INT
 #define VECSIZE_INT         SSE_VECSIZE_INT
 typedef __m128i simd_int;
+typedef uint32_t simdi8_movemask_t;
+#define SIMDI8_MOVEMASK_ALL 0xffff
 #define simdi32_add(x,y)    _mm_add_epi32(x,y)
 #define simdi16_add(x,y)    _mm_add_epi16(x,y)
 #define simdi16_adds(x,y)   _mm_adds_epi16(x,y)
+#define simdi8_add(x,y)     _mm_add_epi8(x,y)
 #define simdui8_adds(x,y)   _mm_adds_epu8(x,y)
 #define simdi32_sub(x,y)    _mm_sub_epi32(x,y)
 #define simdui16_subs(x,y)  _mm_subs_epu16(x,y)
+#define simdi8_sub(x,y)     _mm_sub_epi8(x,y)
 #define simdui8_subs(x,y)   _mm_subs_epu8(x,y)
 #define simdi32_mul(x,y)    _mm_mullo_epi32(x,y) // SSE4.1
 #define simdi32_max(x,y)    _mm_max_epi32(x,y) // SSE4.1
 #define simdi16_max(x,y)    _mm_max_epi16(x,y)
 #define simdi16_hmax(x)     simd_hmax16(x)
 #define simdui8_max(x,y)    _mm_max_epu8(x,y)
+#define simdui8_min(x,y)    _mm_min_epu8(x,y)
+#define simdi8_max(x,y)     _mm_max_epi8(x,y) // SSE4.1
+#define simdi8_min(x,y)     _mm_min_epi8(x,y) // SSE4.1
 #define simdi8_hmax(x)      simd_hmax8(x)
 #define simdi_load(x)       _mm_load_si128(x)
 #define simdi_loadu(x)      _mm_loadu_si128(x)
@@ -373,6 +435,7 @@ typedef __m128i simd_int;
 #define simdi_setzero()     _mm_setzero_si128()
 #define simdi32_gt(x,y)     _mm_cmpgt_epi32(x,y)
 #define simdi8_gt(x,y)      _mm_cmpgt_epi8(x,y)
+#define simdi8_blendv(x,y,mask) _mm_blendv_epi8(x,y,mask) // mask ? y : x, SSE4.1
 #define simdi32_eq(x,y)     _mm_cmpeq_epi32(x,y)
 #define simdi16_eq(x,y)     _mm_cmpeq_epi16(x,y)
 #define simdi8_eq(x,y)      _mm_cmpeq_epi8(x,y)
@@ -398,7 +461,7 @@ typedef __m128i simd_int;
 #endif //SSE
 
 #ifdef NEON
-inline uint16_t simd_hmax16(const __m128i buffer) {
+static inline uint16_t simd_hmax16(const __m128i buffer) {
     uint16x4_t tmp;
     tmp = vmax_u16(vget_low_u16(vreinterpretq_u16_m128i(buffer)), vget_high_u16(vreinterpretq_u16_m128i(buffer)));
     tmp = vpmax_u16(tmp, tmp);
@@ -406,7 +469,7 @@ inline uint16_t simd_hmax16(const __m128i buffer) {
     return vget_lane_u16(tmp, 0);
 }
 
-inline uint8_t simd_hmax8(const __m128i buffer) {
+static inline uint8_t simd_hmax8(const __m128i buffer) {
     uint8x8_t tmp;
     tmp = vmax_u8(vget_low_u8(vreinterpretq_u8_m128i(buffer)), vget_high_u8(vreinterpretq_u8_m128i(buffer)));
     tmp = vpmax_u8(tmp, tmp);
@@ -416,27 +479,27 @@ inline uint8_t simd_hmax8(const __m128i buffer) {
 }
 #if 0
 template <typename F>
-inline F simd_hmax(const F * in, unsigned int n);
+static inline F simd_hmax(const F * in, unsigned int n);
 
-inline uint16_t simd_hmax16(const __m128i buffer) {
+static inline uint16_t simd_hmax16(const __m128i buffer) {
     SIMDVec* tmp = (SIMDVec*)&buffer;
     return simd_hmax<uint16_t>((uint16_t*)tmp->m128_u16, 8);
 }
 
-inline uint8_t simd_hmax8(const __m128i buffer) {
+static inline uint8_t simd_hmax8(const __m128i buffer) {
     SIMDVec* tmp = (SIMDVec*)&buffer;
     return simd_hmax<uint8_t>((uint8_t*)tmp->m128_u8, 16);
 }
 #endif
 #else
-inline uint16_t simd_hmax16(const __m128i buffer)
+static inline uint16_t simd_hmax16(const __m128i buffer)
 {
     __m128i tmp1 = _mm_subs_epu16(_mm_set1_epi16((short)65535), buffer);
     __m128i tmp3 = _mm_minpos_epu16(tmp1);
     return (65535 - _mm_cvtsi128_si32(tmp3));
 }
 
-inline uint8_t simd_hmax8(const __m128i buffer)
+static inline uint8_t simd_hmax8(const __m128i buffer)
 {
     __m128i tmp1 = _mm_subs_epu8(_mm_set1_epi8((char)255), buffer);
     __m128i tmp2 = _mm_min_epu8(tmp1, _mm_srli_epi16(tmp1, 8));
@@ -446,27 +509,48 @@ inline uint8_t simd_hmax8(const __m128i buffer)
 #endif
 
 #ifdef AVX2
-inline uint16_t simd_hmax16_avx(const __m256i buffer){
+static inline uint16_t simd_hmax16_avx(const __m256i buffer){
     const __m128i abcd = _mm256_castsi256_si128(buffer);
     const uint16_t first = simd_hmax16(abcd);
     const __m128i efgh = _mm256_extracti128_si256(buffer, 1);
     const uint16_t second = simd_hmax16(efgh);
-    return std::max(first,second);
+    return (first > second) ? first : second;
 }
 
-inline uint8_t simd_hmax8_avx(const __m256i buffer){
+static inline uint8_t simd_hmax8_avx(const __m256i buffer){
     const __m128i abcd = _mm256_castsi256_si128(buffer);
     const uint8_t first = simd_hmax8(abcd);
     const __m128i efgh = _mm256_extracti128_si256(buffer, 1);
     const uint8_t second = simd_hmax8(efgh);
-    return std::max(first,second);
+    return (first > second) ? first : second;
+}
+#endif
+
+#ifdef AVX512
+static inline uint16_t simd_hmax16_avx512(const __m512i buffer){
+    const __m256i low = _mm512_castsi512_si256(buffer);
+    const __m256i high = _mm512_extracti64x4_epi64(buffer, 1);
+    return simd_hmax16_avx(_mm256_max_epu16(low, high));
+}
+
+static inline uint8_t simd_hmax8_avx512(const __m512i buffer){
+    const __m256i low = _mm512_castsi512_si256(buffer);
+    const __m256i high = _mm512_extracti64x4_epi64(buffer, 1);
+    return simd_hmax8_avx(_mm256_max_epu8(low, high));
 }
 #endif
 
 
+#ifdef AVX512
+static inline unsigned short extract_epi16(__m512i v, int pos) {
+    uint16_t values[32] __attribute__((aligned(64)));
+    _mm512_store_si512(values, v);
+    return values[pos & 31];
+}
+#endif
 
 #ifdef AVX2
-inline unsigned short extract_epi16(__m256i v, int pos) {
+static inline unsigned short extract_epi16(__m256i v, int pos) {
     switch(pos){
         case 0: return _mm256_extract_epi16(v, 0);
         case 1: return _mm256_extract_epi16(v, 1);
@@ -489,7 +573,7 @@ inline unsigned short extract_epi16(__m256i v, int pos) {
 }
 #else
 #ifdef SSE
-inline unsigned short extract_epi16(__m128i v, int pos) {
+static inline unsigned short extract_epi16(__m128i v, int pos) {
     switch(pos){
         case 0: return _mm_extract_epi16(v, 0);
         case 1: return _mm_extract_epi16(v, 1);
@@ -508,11 +592,12 @@ inline unsigned short extract_epi16(__m128i v, int pos) {
 
 /* horizontal max */
 template <typename F>
-inline F simd_hmax(const F * in, unsigned int n)
+static inline F simd_hmax(const F * in, unsigned int n)
 {
     F current = std::numeric_limits<F>::min();
     do {
-        current = std::max(current, *in++);
+        current = (current > *in) ? current : *in;
+        in++;
     } while(--n);
 
     return current;
@@ -521,17 +606,18 @@ inline F simd_hmax(const F * in, unsigned int n)
 
 /* horizontal min */
 template <typename F>
-inline F simd_hmin(const F * in, unsigned int n)
+static inline F simd_hmin(const F * in, unsigned int n)
 {
     F current = std::numeric_limits<F>::max();
     do {
-        current = std::min(current, *in++);
+        current = (current < *in) ? current : *in;
+        in++;
     } while(--n);
 
     return current;
 }
 
-inline void *mem_align(size_t boundary, size_t size)
+static inline void *mem_align(size_t boundary, size_t size)
 {
     void *pointer;
     if (posix_memalign(&pointer,boundary,size) != 0)
@@ -542,26 +628,26 @@ inline void *mem_align(size_t boundary, size_t size)
     return pointer;
 }
 #ifdef SIMD_FLOAT
-inline simd_float * malloc_simd_float(const size_t size)
+static inline simd_float * malloc_simd_float(const size_t size)
 {
     return (simd_float *) mem_align(ALIGN_FLOAT,size);
 }
 #endif
 #ifdef SIMD_DOUBLE
-inline simd_double * malloc_simd_double(const size_t size)
+static inline simd_double * malloc_simd_double(const size_t size)
 {
     return (simd_double *) mem_align(ALIGN_DOUBLE,size);
 }
 #endif
 #ifdef SIMD_INT
-inline simd_int * malloc_simd_int(const size_t size)
+static inline simd_int * malloc_simd_int(const size_t size)
 {
     return (simd_int *) mem_align(ALIGN_INT,size);
 }
 #endif
 
 template <typename T>
-T** malloc_matrix(int dim1, int dim2) {
+static inline T** malloc_matrix(int dim1, int dim2) {
 #define ICEIL(x_int, fac_int) ((x_int + fac_int - 1) / fac_int) * fac_int
 
     // Compute mem sizes rounded up to nearest multiple of ALIGN_FLOAT
@@ -582,7 +668,7 @@ T** malloc_matrix(int dim1, int dim2) {
 }
 
 
-inline float ScalarProd20(const float* qi, const float* tj) {
+static inline float ScalarProd20(const float* qi, const float* tj) {
 
 //#ifdef AVX
 //  float __attribute__((aligned(ALIGN_FLOAT))) res;
@@ -19,6 +19,7 @@ extern int convertca3m(int argc, const char **argv, const Command& command);
 extern int convertkb(int argc, const char **argv, const Command& command);
 extern int convertmsa(int argc, const char **argv, const Command& command);
 extern int convertprofiledb(int argc, const char **argv, const Command& command);
+extern int createbinaryindex(int argc, const char **argv, const Command& command);
 extern int createdb(int argc, const char **argv, const Command& command);
 extern int createindex(int argc, const char **argv, const Command& command);
 extern int createseqfiledb(int argc, const char **argv, const Command& command);
@@ -64,14 +65,18 @@ extern int result2pp(int argc, const char **argv, const Command& command);
 extern int result2profile(int argc, const char **argv, const Command& command);
 extern int result2repseq(int argc, const char **argv, const Command& command);
 extern int result2stats(int argc, const char **argv, const Command& command);
+extern int result2text(int argc, const char **argv, const Command& command);
 extern int resultsbyset(int argc, const char **argv, const Command &command);
 extern int search(int argc, const char **argv, const Command& command);
+extern int searchclient(int argc, const char **argv, const Command& command);
+extern int searchserver(int argc, const char **argv, const Command& command);
 extern int sequence2profile(int argc, const char **argv, const Command& command);
 extern int shellcompletion(int argc, const char **argv, const Command& command);
 extern int shellcompletion(int argc, const char **argv, const Command& command);
 extern int sortresult(int argc, const char **argv, const Command& command);
 extern int splitdb(int argc, const char **argv, const Command& command);
 extern int splitsequence(int argc, const char **argv, const Command& command);
+extern int streamsearch(int argc, const char **argv, const Command& command);
 extern int subtractdbs(int argc, const char **argv, const Command& command);
 extern int suffixid(int argc, const char **argv, const Command& command);
 extern int summarizeheaders(int argc, const char **argv, const Command& command);
@@ -10,6 +10,7 @@
 #include "SubstitutionMatrix.h"
 #include "PrefilteringIndexReader.h"
 #include "FileUtil.h"
+#include "MemoryGovernor.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -23,11 +24,36 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &querySeqD
 
         covThr(par.covThr), canCovThr(par.covThr), covMode(par.covMode), seqIdMode(par.seqIdMode), evalThr(par.evalThr), seqIdThr(par.seqIdThr),
         includeIdentity(par.includeIdentity), addBacktrace(par.addBacktrace), realign(par.realign), scoreBias(par.scoreBias),
-        threads(static_cast<unsigned int>(par.threads)), outDB(outDB), outDBIndex(outDBIndex),
-        maxSeqLen(par.maxSeqLen), compBiasCorrection(par.compBiasCorrection), altAlignment(par.altAlignment), qdbr(NULL), qSeqLookup(NULL),
-        tdbr(NULL), tidxdbr(NULL), tSeqLookup(NULL), templateDBIsIndex(false) {
+        maxThreads(static_cast<unsigned int>(par.threads)), threads(static_cast<unsigned int>(par.threads)), outDB(outDB), outDBIndex(outDBIndex),
+        maxSeqLen(par.maxSeqLen), compBiasCorrection(par.compBiasCorrection), altAlignment(par.altAlignment), bandWidth(par.bandWidth), compressed(par.compressed), binaryResults(par.binaryResults), shardDirs(par.shardDirs), m(NULL), qdbr(NULL), qSeqLookup(NULL),
+        tdbr(NULL), tidxdbr(NULL), tSeqLookup(NULL), prefdbr(NULL), templateDBIsIndex(false) {
+    initTarget(targetSeqDB, targetSeqDBIndex, par);
+    setQuery(querySeqDB, querySeqDBIndex, prefDB, prefDBIndex, outDB, outDBIndex);
 
+    // make sure to touch target after query, so if there is not enough memory for the query, at least the targets
+    // might have had enough space left to be residung in the page cache
+    if (sameQTDB == false && templateDBIsIndex == false && par.preloadMode != Parameters::PRELOAD_MODE_MMAP) {
+        tdbr->readMmapedDataInMemory();
+    }
+
+    initMatrices(par);
+}
 
+Alignment::Alignment(const std::string &targetSeqDB, const std::string &targetSeqDBIndex,
+                     int querySeqType, const Parameters &par) :
+
+        covThr(par.covThr), canCovThr(par.covThr), covMode(par.covMode), seqIdMode(par.seqIdMode), evalThr(par.evalThr), seqIdThr(par.seqIdThr),
+        includeIdentity(par.includeIdentity), addBacktrace(par.addBacktrace), realign(par.realign), scoreBias(par.scoreBias),
+        maxThreads(static_cast<unsigned int>(par.threads)), threads(static_cast<unsigned int>(par.threads)),
+        maxSeqLen(par.maxSeqLen), compBiasCorrection(par.compBiasCorrection), altAlignment(par.altAlignment), bandWidth(par.bandWidth), compressed(par.compressed), binaryResults(par.binaryResults), shardDirs(par.shardDirs), m(NULL), qdbr(NULL), qSeqLookup(NULL),
+        tdbr(NULL), tidxdbr(NULL), tSeqLookup(NULL), prefdbr(NULL), templateDBIsIndex(false) {
+    initTarget(targetSeqDB, targetSeqDBIndex, par);
+    this->querySeqType = querySeqType;
+    checkSeqTypes();
+    initMatrices(par);
+}
+
+void Alignment::initTarget(const std::string &targetSeqDB, const std::string &targetSeqDBIndex, const Parameters &par) {
     unsigned int alignmentMode = par.alignmentMode;
     if (alignmentMode == Parameters::ALIGNMENT_MODE_UNGAPPED) {
         Debug(Debug::ERROR) << "Use rescorediagonal for ungapped alignment mode.\n";
@@ -49,10 +75,6 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &querySeqD
     }
 
     if (altAlignment > 0) {
-        if(querySeqType==Sequence::NUCLEOTIDES){
-            Debug(Debug::ERROR) << "Alternative alignments are not supported for nucleotides.\n";
-            EXIT(EXIT_FAILURE);
-        }
 //        if(realign==true){
 //            Debug(Debug::ERROR) << "Alternative alignments do not supported realignment.\n";
 //            EXIT(EXIT_FAILURE);
@@ -62,7 +84,7 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &querySeqD
 
     initSWMode(alignmentMode);
 
-    std::string scoringMatrixFile = par.scoringMatrixFile;
+    scoringMatrixFile = par.scoringMatrixFile;
     std::string indexDB = PrefilteringIndexReader::searchForIndex(targetSeqDB);
     if (indexDB.length() > 0) {
         Debug(Debug::INFO) << "Use index  " << indexDB << "\n";
@@ -98,17 +120,41 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &querySeqD
     if (templateDBIsIndex == false) {
         tdbr = new DBReader<unsigned int>(targetSeqDB.c_str(), targetSeqDBIndex.c_str());
         tdbr->open(DBReader<unsigned int>::NOSORT);
+        targetSeqType = tdbr->getDbtype();
+    }
+    this->targetSeqDB = targetSeqDB;
+}
+
+void Alignment::setQuery(const std::string &querySeqDB, const std::string &querySeqDBIndex,
+                         const std::string &prefDB, const std::string &prefDBIndex,
+                         const std::string &outDB, const std::string &outDBIndex) {
+    // the databases of the previous query
+    if (qdbr != NULL && qdbr != tdbr) {
+        qdbr->close();
+        delete qdbr;
+    }
+    if (prefdbr != NULL) {
+        prefdbr->close();
+        delete prefdbr;
     }
+    // matrices are only created once, later queries have to be of the same type
+    const bool hasMatrices = (m != NULL);
+    const int matrixSeqType = querySeqType;
 
+    this->outDB = outDB;
+    this->outDBIndex = outDBIndex;
+
+    int seqType;
     sameQTDB = (targetSeqDB.compare(querySeqDB) == 0);
     if (sameQTDB == true) {
         qdbr = tdbr;
         qSeqLookup = tSeqLookup;
-        querySeqType = targetSeqType;
+        seqType = targetSeqType;
     } else {
         // open the sequence, prefiltering and output databases
         qdbr = new DBReader<unsigned int>(querySeqDB.c_str(), querySeqDBIndex.c_str());
         qdbr->open(DBReader<unsigned int>::NOSORT);
+        qSeqLookup = NULL;
 
         //size_t freeSpace =  FileUtil::getFreeSpace(FileUtil::dirName(outDB).c_str());
         //size_t estimatedHDDMemory = estimateHDDMemoryConsumption(qdbr->getSize(),
@@ -120,24 +166,37 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &querySeqD
         //    EXIT(EXIT_FAILURE);
         //}
 
-        querySeqType = qdbr->getDbtype();
+        seqType = qdbr->getDbtype();
     }
 
     qdbr->readMmapedDataInMemory();
-    // make sure to touch target after query, so if there is not enough memory for the query, at least the targets
-    // might have had enough space left to be residung in the page cache
-    if (sameQTDB == false && templateDBIsIndex == false && par.preloadMode != Parameters::PRELOAD_MODE_MMAP) {
-        tdbr->readMmapedDataInMemory();
-    }
 
+    threads = maxThreads;
     if (qdbr->getSize() <= threads) {
         threads = qdbr->getSize();
     }
 
     if (templateDBIsIndex == false) {
-        querySeqType = qdbr->getDbtype();
-        targetSeqType = tdbr->getDbtype();
+        seqType = qdbr->getDbtype();
+    }
+    if (hasMatrices == true) {
+        if (seqType != matrixSeqType && (seqType != Sequence::HMM_PROFILE || matrixSeqType != Sequence::PROFILE_STATE_PROFILE)) {
+            Debug(Debug::ERROR) << "Query database type " << DBReader<unsigned int>::getDbTypeName(seqType)
+                                << " does not match " << DBReader<unsigned int>::getDbTypeName(matrixSeqType) << ".\n";
+            EXIT(EXIT_FAILURE);
+        }
     }
+    querySeqType = seqType;
+    checkSeqTypes();
+
+    prefdbr = new DBReader<unsigned int>(prefDB.c_str(), prefDBIndex.c_str());
+    prefdbr->setBinaryResultsReadable(true);
+    prefdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    prefdbr->setReadAhead(DBReader<unsigned int>::DEFAULT_READ_AHEAD);
+    prefDbType = prefdbr->getDbtype();
+}
+
+void Alignment::checkSeqTypes() {
     if (querySeqType == -1 || targetSeqType == -1) {
         Debug(Debug::ERROR) << "Please recreate your database or add a .dbtype file to your sequence/profile database.\n";
         EXIT(EXIT_FAILURE);
@@ -152,26 +211,35 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &querySeqD
     } else if (querySeqType == Sequence::HMM_PROFILE && targetSeqType == Sequence::PROFILE_STATE_SEQ) {
         querySeqType = Sequence::PROFILE_STATE_PROFILE;
     }
+    if (altAlignment > 0 && querySeqType == Sequence::NUCLEOTIDES) {
+        Debug(Debug::ERROR) << "Alternative alignments are not supported for nucleotides.\n";
+        EXIT(EXIT_FAILURE);
+    }
     Debug(Debug::INFO) << "Query database type: " << DBReader<unsigned int>::getDbTypeName(querySeqType) << "\n";
     Debug(Debug::INFO) << "Target database type: " << DBReader<unsigned int>::getDbTypeName(targetSeqType) << "\n";
+}
 
-    prefdbr = new DBReader<unsigned int>(prefDB.c_str(), prefDBIndex.c_str());
-    prefdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
-
+void Alignment::initMatrices(const Parameters &par) {
     if (querySeqType == Sequence::NUCLEOTIDES) {
         m = new NucleotideMatrix(par.scoringMatrixFile.c_str(), 1.0, scoreBias);
         gapOpen = 5;
         gapExtend = 2;
+        longGapOpen = par.longGapOpen;
+        longGapExtend = par.longGapExtend;
     } else if (querySeqType == Sequence::PROFILE_STATE_PROFILE){
         SubstitutionMatrix s(par.scoringMatrixFile.c_str(), 2.0, scoreBias);
         this->m = new SubstitutionMatrixProfileStates(s.matrixName, s.probMatrix, s.pBack, s.subMatrixPseudoCounts, 2.0, scoreBias, 255);
         gapOpen = par.gapOpen;
         gapExtend = par.gapExtend;
+        longGapOpen = 0;
+        longGapExtend = 0;
     } else {
         // keep score bias at 0.0 (improved ROC)
         m = new SubstitutionMatrix(scoringMatrixFile.c_str(), 2.0, scoreBias);
         gapOpen = par.gapOpen;
         gapExtend = par.gapExtend;
+        longGapOpen = 0;
+        longGapExtend = 0;
     }
 
     if (realign == true) {
@@ -235,13 +303,15 @@ Alignment::~Alignment() {
         delete tidxdbr;
     }
 
-    if (sameQTDB == false) {
+    if (qdbr != NULL && qdbr != tdbr) {
         qdbr->close();
         delete qdbr;
     }
 
-    prefdbr->close();
-    delete prefdbr;
+    if (prefdbr != NULL) {
+        prefdbr->close();
+        delete prefdbr;
+    }
 }
 
 void Alignment::run(const unsigned int mpiRank, const unsigned int mpiNumProc,
@@ -280,16 +350,23 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
                     const unsigned int maxAlnNum, const unsigned int maxRejected) {
     size_t alignmentsNum = 0;
     size_t totalPassedNum = 0;
-    DBWriter dbw(outDB.c_str(), outDBIndex.c_str(), threads);
+    DBWriter dbw(outDB.c_str(), outDBIndex.c_str(), threads,
+                 (shardDirs.empty() ? DBWriter::SHARED_FILE_MODE : DBWriter::SHARDED_MODE)
+                 | (compressed ? DBWriter::COMPRESSED_MODE : DBWriter::ASCII_MODE));
+    dbw.setShardDirectories(shardDirs);
     dbw.open();
 
     EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), this->m, gapOpen, gapExtend);
-    size_t totalMemory = Util::getTotalSystemMemory();
+    size_t totalMemory = MemoryGovernor::getAvailable();
     size_t flushSize = 1000000;
     if(totalMemory > prefdbr->getDataSize()){
         flushSize = dbSize;
     }
 
+    // queries of the current flush bucket, the most expensive ones first
+    std::vector<task_t> tasks;
+    std::vector<split_t> splits;
+
 #pragma omp parallel num_threads(threads)
     {
         unsigned int thread_idx = 0;
@@ -299,12 +376,24 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
         std::string alnResultsOutString;
         alnResultsOutString.reserve(1024*1024);
         char buffer[1024+32768];
+        // results and backtraces of the current query, they keep their memory from query to query
+        std::vector<Matcher::result_view_t> swResults;
+        std::vector<Matcher::result_view_t> swRealignResults;
+        std::vector<Matcher::result_view_t> altResults;
+        std::string backtraces;
+        backtraces.reserve(1024*1024);
         Sequence qSeq(maxSeqLen, querySeqType, m, 0, false, compBiasCorrection);
         Sequence dbSeq(maxSeqLen, targetSeqType, m, 0, false, compBiasCorrection);
-        Matcher matcher(querySeqType, maxSeqLen, m, &evaluer, compBiasCorrection, gapOpen, gapExtend);
+        Matcher matcher(querySeqType, maxSeqLen, m, &evaluer, compBiasCorrection, gapOpen, gapExtend, longGapOpen, longGapExtend);
+        matcher.setBandWidth(bandWidth);
+        const unsigned int batchSize = matcher.getBatchSize();
+        std::vector<SmithWaterman::alignment_end> batchEnds(2 * batchSize);
+        std::vector<char *> batchEntries;
+        batchEntries.reserve(batchSize);
         Matcher *realigner = NULL;
         if (realign ==  true) {
-            realigner = new Matcher(querySeqType, maxSeqLen, realign_m, &evaluer, compBiasCorrection, gapOpen, gapExtend);
+            realigner = new Matcher(querySeqType, maxSeqLen, realign_m, &evaluer, compBiasCorrection, gapOpen, gapExtend,
+                                    longGapOpen, longGapExtend);
         }
 
         size_t iterations = static_cast<size_t>(ceil(static_cast<double>(dbSize) / static_cast<double>(flushSize)));
@@ -312,49 +401,67 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
             size_t start = dbFrom + (i * flushSize);
             size_t bucketSize = std::min(dbSize - (i * flushSize), flushSize);
 
-#pragma omp for schedule(dynamic, 5) reduction(+: alignmentsNum, totalPassedNum)
-            for (size_t id = start; id < (start + bucketSize); id++) {
-                Debug::printProgress(id);
+#pragma omp single
+            scheduleQueries(start, bucketSize, maxAlnNum, maxRejected, tasks, splits);
 
-                // get the prefiltering list
-                char *data = prefdbr->getData(id);
+#pragma omp for schedule(dynamic, 1) reduction(+: alignmentsNum, totalPassedNum)
+            for (size_t taskIdx = 0; taskIdx < tasks.size(); taskIdx++) {
+                const task_t &task = tasks[taskIdx];
+                const size_t id = task.id;
+                if (task.begin == 0) {
+                    Debug::printProgress(id);
+                }
+
+                // get the prefiltering list or the part of it of this task
+                char *entry = prefdbr->getData(id);
+                char *data = entry + task.begin;
+                const char *dataEnd = (task.split == NO_SPLIT) ? entry + prefdbr->getSeqLens(id) - 1 : entry + task.end;
                 unsigned int queryDbKey = prefdbr->getDbKey(id);
                 setQuerySequence(qSeq, id, queryDbKey);
 
                 matcher.initQuery(&qSeq);
                 // parse the prefiltering list and calculate a Smith-Waterman alignment for each sequence in the list
-                std::vector<Matcher::result_t> swResults;
-                std::vector<Matcher::result_t> swRealignResults;
+                swResults.clear();
+                swRealignResults.clear();
+                altResults.clear();
+                backtraces.clear();
                 size_t passedNum = 0;
                 unsigned int rejected = 0;
 
-                while (*data != '\0' && passedNum < maxAlnNum && rejected < maxRejected) {
-                    // DB key of the db sequence
-                    char dbKeyBuffer[255 + 1];
-                    char * words[10];
-                    Util::parseKey(data, dbKeyBuffer);
-                    const unsigned int dbKey = (unsigned int) strtoul(dbKeyBuffer, NULL, 10);
-
-                    size_t elements = Util::getWordsOfLine(data, words, 10);
-                    int diagonal = INT_MAX;
-                    // Prefilter result (need to make this better)
-                    if(elements == 3){
-                        hit_t hit = QueryMatcher::parsePrefilterHit(data);
-                        diagonal = hit.diagonal;
+                // short queries align a batch of targets ahead of the loop, see alignBatch
+                bool useBatch = batchSize > 0 && qSeq.L <= BATCH_QUERY_LENGTH_PER_LANE * static_cast<int>(batchSize);
+                char *batchScanEnd = data;
+                size_t batchNext = 0;
+                batchEntries.clear();
+
+                while (hasHit(data, dataEnd) && passedNum < maxAlnNum && rejected < maxRejected) {
+                    if (useBatch && data >= batchScanEnd) {
+                        useBatch = alignBatch(data, dataEnd, batchScanEnd, queryDbKey, qSeq, dbSeq, matcher, batchEntries, batchEnds.data());
+                        batchNext = 0;
+                    }
+                    const SmithWaterman::alignment_end *forward = NULL;
+                    if (batchNext < batchEntries.size() && batchEntries[batchNext] == data) {
+                        forward = &batchEnds[2 * batchNext];
+                        batchNext++;
                     }
 
+                    // DB key of the db sequence
+                    int diagonal;
+                    const unsigned int dbKey = parseHit(data, diagonal);
+
                     setTargetSequence(dbSeq, dbKey);
                     // check if the sequences could pass the coverage threshold
                     if(Util::canBeCovered(canCovThr, covMode, static_cast<float>(qSeq.L), static_cast<float>(dbSeq.L)) == false )
                     {
                         rejected++;
-                        data = Util::skipLine(data);
+                        data = nextHit(data);
                         continue;
                     }
                     const bool isIdentity = (queryDbKey == dbKey && (includeIdentity || sameQTDB)) ? true : false;
 
                     // calculate Smith-Waterman alignment
-                    Matcher::result_t res = matcher.getSWResult(&dbSeq, diagonal, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity);
+                    Matcher::result_view_t res = matcher.getSWResultView(&dbSeq, diagonal, covMode, covThr, evalThr, swMode, seqIdMode,
+                                                                         isIdentity, backtraces, forward);
                     alignmentsNum++;
 
                     //set coverage and seqid if identity
@@ -364,32 +471,66 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
                         res.seqId = 1.0f;
                     }
                     if(checkCriteria(res, isIdentity, evalThr, seqIdThr, covMode, covThr)){
-                        swResults.emplace_back(res);
+                        swResults.push_back(res);
                         passedNum++;
                         totalPassedNum++;
                         rejected = 0;
+                        // the target is still mapped, without realignment its alternative alignments follow right away
+                        if (altAlignment > 0 && realign == false && isIdentity == false) {
+                            computeAlternativeAlignment(dbSeq, res, altResults, backtraces, matcher, evalThr, swMode);
+                        }
                     }else{
                         rejected++;
+                        // drop the backtrace of the rejected hit, it was appended last
+                        backtraces.resize(res.backtraceOffset);
                     }
 
-                    data = Util::skipLine(data);
+                    data = nextHit(data);
                 }
-                if(altAlignment > 0 && realign == false ){
-                    computeAlternativeAlignment(queryDbKey, dbSeq, swResults, matcher, evalThr, swMode);
+                if (task.split != NO_SPLIT) {
+                    split_t &split = splits[task.split];
+                    split.results[task.chunk] = swResults;
+                    split.altResults[task.chunk] = altResults;
+                    split.backtraces[task.chunk] = backtraces;
+                    // the thread aligning the last chunk finishes the query
+                    if (__sync_sub_and_fetch(&split.remaining, 1) != 0) {
+                        continue;
+                    }
+                    swResults.clear();
+                    altResults.clear();
+                    backtraces.clear();
+                    for (size_t chunk = 0; chunk < split.results.size(); chunk++) {
+                        const size_t offset = backtraces.size();
+                        backtraces.append(split.backtraces[chunk]);
+                        for (size_t j = 0; j < split.results[chunk].size(); j++) {
+                            swResults.push_back(split.results[chunk][j]);
+                            swResults.back().backtraceOffset += offset;
+                        }
+                        for (size_t j = 0; j < split.altResults[chunk].size(); j++) {
+                            altResults.push_back(split.altResults[chunk][j]);
+                            altResults.back().backtraceOffset += offset;
+                        }
+                    }
+                    std::vector<std::vector<Matcher::result_view_t> >().swap(split.results);
+                    std::vector<std::vector<Matcher::result_view_t> >().swap(split.altResults);
+                    std::vector<std::string>().swap(split.backtraces);
                 }
+                // alternative alignments follow all first alignments
+                swResults.insert(swResults.end(), altResults.begin(), altResults.end());
 
                 // write the results
-                std::sort(swResults.begin(), swResults.end(), Matcher::compareHits);
+                std::sort(swResults.begin(), swResults.end(), Matcher::compareHitViews);
                 if (realign == true) {
                     realigner->initQuery(&qSeq);
                     for (size_t result = 0; result < swResults.size(); result++) {
                         setTargetSequence(dbSeq, swResults[result].dbKey);
                         const bool isIdentity = (queryDbKey == swResults[result].dbKey && (includeIdentity || sameQTDB)) ? true : false;
-                        Matcher::result_t res = realigner->getSWResult(&dbSeq, INT_MAX, covMode, covThr, FLT_MAX,
-                                                                       Matcher::SCORE_COV_SEQID, seqIdMode, isIdentity);
+                        Matcher::result_view_t res = realigner->getSWResultView(&dbSeq, INT_MAX, covMode, covThr, FLT_MAX,
+                                                                                Matcher::SCORE_COV_SEQID, seqIdMode, isIdentity, backtraces);
                         const bool covOK = Util::hasCoverage(realignCov, covMode, res.qcov, res.dbcov);
                         if(covOK == true|| isIdentity){
-                            swResults[result].backtrace  = res.backtrace;
+                            swResults[result].backtraceOffset = res.backtraceOffset;
+                            swResults[result].backtraceLength = res.backtraceLength;
                             swResults[result].qStartPos  = res.qStartPos;
                             swResults[result].qEndPos    = res.qEndPos;
                             swResults[result].dbStartPos = res.dbStartPos;
@@ -399,17 +540,23 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
                             swResults[result].qcov       = res.qcov;
                             swResults[result].dbcov      = res.dbcov;
                             swRealignResults.push_back(swResults[result]);
+                            // reuse the mapped target for the alternative alignments to the realigned hit
+                            if (altAlignment > 0 && isIdentity == false) {
+                                computeAlternativeAlignment(dbSeq, swRealignResults.back(), altResults, backtraces,
+                                                            matcher, FLT_MAX, Matcher::SCORE_COV_SEQID);
+                            }
+                        } else {
+                            backtraces.resize(res.backtraceOffset);
                         }
                     }
-                    swResults = swRealignResults;
-                    if(altAlignment> 0 ){
-                        computeAlternativeAlignment(queryDbKey, dbSeq, swResults, matcher, FLT_MAX, Matcher::SCORE_COV_SEQID);
-                    }
+                    swResults.swap(swRealignResults);
+                    swResults.insert(swResults.end(), altResults.begin(), altResults.end());
                 }
 
                 // put the contents of the swResults list into a result DB
                 for (size_t result = 0; result < swResults.size(); result++) {
-                    size_t len = Matcher::resultToBuffer(buffer, swResults[result], addBacktrace);
+                    size_t len = binaryResults ? Matcher::resultToBinaryBuffer(buffer, swResults[result], backtraces, addBacktrace)
+                                               : Matcher::resultToBuffer(buffer, swResults[result], backtraces, addBacktrace);
                     alnResultsOutString.append(buffer, len);
                 }
                 dbw.writeData(alnResultsOutString.c_str(), alnResultsOutString.length(), qSeq.getDbKey(), thread_idx);
@@ -428,7 +575,7 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
         }
     }
 
-    dbw.close();
+    dbw.close(binaryResults ? Sequence::ALIGNMENT_RES_BINARY : -1);
 
     Debug(Debug::INFO) << "\nAll sequences processed.\n\n";
     Debug(Debug::INFO) << alignmentsNum << " alignments calculated.\n";
@@ -463,6 +610,162 @@ inline void Alignment::setQuerySequence(Sequence &seq, size_t id, unsigned int k
     }
 }
 
+bool Alignment::alignBatch(char *data, const char *end, char *&scanEnd, unsigned int queryDbKey, Sequence &qSeq, Sequence &dbSeq,
+                           Matcher &matcher, std::vector<char *> &batchEntries, SmithWaterman::alignment_end *ends) {
+    const unsigned int batchSize = matcher.getBatchSize();
+    batchEntries.clear();
+    unsigned int scanned = 0;
+    while (hasHit(data, end) && scanned < BATCH_SCAN_FACTOR * batchSize && batchEntries.size() < batchSize) {
+        int diagonal;
+        const unsigned int dbKey = parseHit(data, diagonal);
+        // identities and hits that can not be covered are not aligned by the striped kernel either
+        const bool isIdentity = (queryDbKey == dbKey && (includeIdentity || sameQTDB));
+        if (isIdentity == false) {
+            setTargetSequence(dbSeq, dbKey);
+            if (dbSeq.L <= BATCH_MAX_TARGET_LENGTH
+                && Util::canBeCovered(canCovThr, covMode, static_cast<float>(qSeq.L), static_cast<float>(dbSeq.L))) {
+                matcher.addBatchTarget(&dbSeq);
+                batchEntries.push_back(data);
+            }
+        }
+        scanned++;
+        data = nextHit(data);
+    }
+    scanEnd = data;
+
+    // a half empty batch is slower than the striped kernel
+    if (batchEntries.size() < batchSize / 2) {
+        matcher.clearBatch();
+        batchEntries.clear();
+        return true;
+    }
+    if (matcher.alignBatch(ends) == false) {
+        batchEntries.clear();
+        return false;
+    }
+    return true;
+}
+
+inline bool Alignment::hasHit(const char *data, const char *end) {
+    if (DBReader<unsigned int>::isBinaryResult(prefDbType)) {
+        return data < end;
+    }
+    return data < end && *data != '\0';
+}
+
+void Alignment::scheduleQueries(size_t start, size_t count, unsigned int maxAlnNum, unsigned int maxRejected,
+                                std::vector<task_t> &tasks, std::vector<split_t> &splits) {
+    tasks.clear();
+    splits.clear();
+    size_t totalCost = 0;
+    for (size_t id = start; id < start + count; id++) {
+        // the size of the prefilter list grows with the number of targets, the cost with the cells of their alignments
+        const size_t queryId = qdbr->getId(prefdbr->getDbKey(id));
+        const size_t queryLength = (queryId == UINT_MAX) ? 1 : qdbr->getSeqLens(queryId);
+        task_t task;
+        task.id = id;
+        task.begin = 0;
+        task.end = 0;
+        task.cost = prefdbr->getSeqLens(id) * queryLength;
+        task.split = NO_SPLIT;
+        task.chunk = 0;
+        tasks.push_back(task);
+        totalCost += task.cost;
+    }
+
+    // a query costing more than a part of the work of a thread is split into chunks of its targets
+    // a split query gives the same results only if maxAlnNum and maxRejected can not end it early
+    const size_t maxTaskCost = std::max(totalCost / (static_cast<size_t>(threads) * SPLIT_TASKS_PER_THREAD), static_cast<size_t>(1));
+    const size_t queryTasks = tasks.size();
+    for (size_t i = 0; threads > 1 && i < queryTasks; i++) {
+        if (tasks[i].cost <= maxTaskCost) {
+            continue;
+        }
+        const size_t id = tasks[i].id;
+        char *entry = prefdbr->getData(id);
+        const char *end = entry + prefdbr->getSeqLens(id) - 1;
+        std::vector<std::pair<size_t, size_t> > hits;
+        size_t totalCells = 0;
+        for (char *data = entry; hasHit(data, end); data = nextHit(data)) {
+            int diagonal;
+            const size_t targetId = tdbr->getId(parseHit(data, diagonal));
+            const size_t cells = (targetId == UINT_MAX) ? 1 : tdbr->getSeqLens(targetId);
+            hits.push_back(std::make_pair(static_cast<size_t>(data - entry), cells));
+            totalCells += cells;
+        }
+        const size_t chunks = std::min((tasks[i].cost + maxTaskCost - 1) / maxTaskCost, hits.size() / SPLIT_MIN_HITS);
+        if (chunks < 2 || hits.size() > maxAlnNum || hits.size() > maxRejected) {
+            continue;
+        }
+
+        split_t split;
+        split.remaining = static_cast<unsigned int>(chunks);
+        split.results.resize(chunks);
+        split.altResults.resize(chunks);
+        split.backtraces.resize(chunks);
+        splits.push_back(split);
+        task_t task = tasks[i];
+        task.split = splits.size() - 1;
+        task.cost = tasks[i].cost / chunks;
+        size_t cells = 0;
+        size_t hit = 0;
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            // cut after the chunk has its share of the cells, but leave at least one hit for each following chunk
+            const size_t first = hit;
+            while (hit < hits.size() - (chunks - chunk - 1)
+                   && (hit == first || chunk == chunks - 1 || cells < totalCells / chunks * (chunk + 1))) {
+                cells += hits[hit].second;
+                hit++;
+            }
+            task.begin = hits[first].first;
+            task.end = (hit < hits.size()) ? hits[hit].first : static_cast<size_t>(end - entry);
+            task.chunk = chunk;
+            if (chunk == 0) {
+                tasks[i] = task;
+            } else {
+                tasks.push_back(task);
+            }
+        }
+    }
+    std::stable_sort(tasks.begin(), tasks.end(), compareTaskCost);
+}
+
+inline char *Alignment::nextHit(char *data) {
+    if (prefDbType == Sequence::PREFILTER_RES_BINARY) {
+        return data + sizeof(hit_t);
+    } else if (prefDbType == Sequence::ALIGNMENT_RES_BINARY) {
+        Matcher::result_record_t record;
+        return (char *) Matcher::readBinaryRecord(data, record);
+    }
+    return Util::skipLine(data);
+}
+
+inline unsigned int Alignment::parseHit(char *data, int &diagonal) {
+    diagonal = INT_MAX;
+    if (prefDbType == Sequence::PREFILTER_RES_BINARY) {
+        hit_t hit = QueryMatcher::parseBinaryPrefilterHit(data);
+        diagonal = hit.diagonal;
+        return hit.seqId;
+    } else if (prefDbType == Sequence::ALIGNMENT_RES_BINARY) {
+        Matcher::result_record_t record;
+        Matcher::readBinaryRecord(data, record);
+        return record.dbKey;
+    }
+
+    char dbKeyBuffer[255 + 1];
+    char * words[10];
+    Util::parseKey(data, dbKeyBuffer);
+    const unsigned int dbKey = (unsigned int) strtoul(dbKeyBuffer, NULL, 10);
+
+    size_t elements = Util::getWordsOfLine(data, words, 10);
+    // Prefilter result (need to make this better)
+    if(elements == 3){
+        hit_t hit = QueryMatcher::parsePrefilterHit(data);
+        diagonal = hit.diagonal;
+    }
+    return dbKey;
+}
+
 inline void Alignment::setTargetSequence(Sequence &seq, unsigned int key) {
     if (tSeqLookup != NULL) {
         size_t id = tdbr->getId(key);
@@ -490,7 +793,9 @@ size_t Alignment::estimateHDDMemoryConsumption(int dbSize, int maxSeqs) {
 }
 
 
-bool Alignment::checkCriteria(Matcher::result_t &res, bool isIdentity, double evalThr, double seqIdThr, int covMode, float covThr) {
+// res is a Matcher::result_t or a Matcher::result_view_t
+template <typename T>
+static bool passesCriteria(const T &res, bool isIdentity, double evalThr, double seqIdThr, int covMode, float covThr) {
     const bool evalOk = (res.eval <= evalThr); // -e
     const bool seqIdOK = (res.seqId >= seqIdThr); // --min-seq-id
     const bool covOK = Util::hasCoverage(covThr, covMode, res.qcov, res.dbcov);
@@ -509,32 +814,33 @@ bool Alignment::checkCriteria(Matcher::result_t &res, bool isIdentity, double ev
     }
 }
 
-void Alignment::computeAlternativeAlignment(unsigned int queryDbKey, Sequence &dbSeq,
-                                            std::vector<Matcher::result_t> &swResults,
+bool Alignment::checkCriteria(Matcher::result_t &res, bool isIdentity, double evalThr, double seqIdThr, int covMode, float covThr) {
+    return passesCriteria(res, isIdentity, evalThr, seqIdThr, covMode, covThr);
+}
+
+bool Alignment::checkCriteria(const Matcher::result_view_t &res, bool isIdentity, double evalThr, double seqIdThr, int covMode, float covThr) {
+    return passesCriteria(res, isIdentity, evalThr, seqIdThr, covMode, covThr);
+}
+
+void Alignment::computeAlternativeAlignment(Sequence &dbSeq, const Matcher::result_view_t &result,
+                                            std::vector<Matcher::result_view_t> &altResults, std::string &backtraces,
                                             Matcher &matcher, float evalThr, int swMode) {
     int xIndex = m->aa2int[static_cast<int>('X')];
-    size_t firstItResSize = swResults.size();
-    for(size_t i = 0; i < firstItResSize; i++) {
-        const bool isIdentity = (queryDbKey == swResults[i].dbKey && (includeIdentity || sameQTDB))
-                                ? true : false;
-        if (isIdentity == true) {
-            continue;
-        }
-        setTargetSequence(dbSeq, swResults[i].dbKey);
-        for (int pos = swResults[i].dbStartPos; pos < swResults[i].dbEndPos; ++pos) {
-            dbSeq.int_sequence[pos] = xIndex;
-        }
-        bool nextAlignment = true;
-        for (int altAli = 0; altAli < altAlignment && nextAlignment; altAli++) {
-            Matcher::result_t res = matcher.getSWResult(&dbSeq, INT_MAX, covMode, covThr, evalThr, swMode,
-                                                        seqIdMode, isIdentity);
-            nextAlignment = checkCriteria(res, isIdentity, evalThr, seqIdThr, covMode, covThr);
-            if (nextAlignment == true) {
-                swResults.emplace_back(res);
-                for (int pos = res.dbStartPos; pos < res.dbEndPos; pos++) {
-                    dbSeq.int_sequence[pos] = xIndex;
-                }
+    for (int pos = result.dbStartPos; pos < result.dbEndPos; ++pos) {
+        dbSeq.int_sequence[pos] = xIndex;
+    }
+    bool nextAlignment = true;
+    for (int altAli = 0; altAli < altAlignment && nextAlignment; altAli++) {
+        Matcher::result_view_t res = matcher.getSWResultView(&dbSeq, INT_MAX, covMode, covThr, evalThr, swMode,
+                                                             seqIdMode, false, backtraces);
+        nextAlignment = checkCriteria(res, false, evalThr, seqIdThr, covMode, covThr);
+        if (nextAlignment == true) {
+            altResults.push_back(res);
+            for (int pos = res.dbStartPos; pos < res.dbEndPos; pos++) {
+                dbSeq.int_sequence[pos] = xIndex;
             }
+        } else {
+            backtraces.resize(res.backtraceOffset);
         }
     }
 }
@@ -1,8 +1,10 @@
 #ifndef ALIGNMENT_H
 #define ALIGNMENT_H
 
+#include <cstdint>
 #include <string>
 #include <list>
+#include <vector>
 
 
 #include "DBReader.h"
@@ -22,8 +24,17 @@ public:
               const std::string &outDB, const std::string &outDBIndex,
               const Parameters &par);
 
+    // keeps the target database and the matrices for queries of querySeqType, setQuery has to be called before run
+    Alignment(const std::string &targetSeqDB, const std::string &targetSeqDBIndex,
+              int querySeqType, const Parameters &par);
+
     ~Alignment();
 
+    // replaces the query, prefilter and output databases of the next run
+    void setQuery(const std::string &querySeqDB, const std::string &querySeqDBIndex,
+                  const std::string &prefDB, const std::string &prefDBIndex,
+                  const std::string &outDB, const std::string &outDBIndex);
+
     //None MPI
     void run(const unsigned int maxAlnNum, const unsigned int maxRejected);
 
@@ -38,6 +49,8 @@ public:
 
     static bool checkCriteria(Matcher::result_t &res, bool isIdentity, double evalThr, double seqIdThr, int covMode, float covThr);
 
+    static bool checkCriteria(const Matcher::result_view_t &res, bool isIdentity, double evalThr, double seqIdThr, int covMode, float covThr);
+
 
 private:
     // sequence coverage threshold
@@ -75,10 +88,12 @@ private:
 
     // keeps state of the SW alignment mode (ALIGNMENT_MODE_SCORE_ONLY, ALIGNMENT_MODE_SCORE_COV or ALIGNMENT_MODE_SCORE_COV_SEQID)
     unsigned int swMode;
+    // threads of par, threads is limited to the number of queries
+    const unsigned int maxThreads;
     unsigned int threads;
 
-    const std::string outDB;
-    const std::string outDBIndex;
+    std::string outDB;
+    std::string outDBIndex;
 
     size_t maxSeqLen;
     int querySeqType;
@@ -87,11 +102,28 @@ private:
 
     int altAlignment;
 
+    // half width of the band around the prefilter diagonal for protein alignments, 0 for full Smith-Waterman
+    const int bandWidth;
+
+    // write the alignment DB with DBWriter::COMPRESSED_MODE
+    const bool compressed;
+    // write Sequence::ALIGNMENT_RES_BINARY records
+    const bool binaryResults;
+    // write the alignment DB with DBWriter::SHARDED_MODE into these directories if not empty
+    const std::string shardDirs;
+
+    std::string targetSeqDB;
+    // substitution matrix of the target index or of par
+    std::string scoringMatrixFile;
+
     BaseMatrix *m;
     // costs to open a gap
     int gapOpen;
     // costs to extend a gap
     int gapExtend;
+    // second gap cost of nucleotide alignments, 0 if there is only one
+    int longGapOpen;
+    int longGapExtend;
 
 
     // needed for realignment
@@ -105,20 +137,88 @@ private:
     SequenceLookup *tSeqLookup;
 
     DBReader<unsigned int> *prefdbr;
+    // text or binary prefilter or alignment results
+    int prefDbType;
 
     bool templateDBIsIndex;
 
     void initSWMode(unsigned int alignmentMode);
 
+    void initTarget(const std::string &targetSeqDB, const std::string &targetSeqDBIndex, const Parameters &par);
+
+    void checkSeqTypes();
+
+    void initMatrices(const Parameters &par);
+
     void setQuerySequence(Sequence &seq, size_t id, unsigned int key);
 
     void setTargetSequence(Sequence &seq, unsigned int key);
 
+    // walk the hits of a prefilter list entry ending at end in any of the prefDbType formats
+    bool hasHit(const char *data, const char *end);
+
+    char *nextHit(char *data);
+
+    // the diagonal is INT_MAX if the list is not a prefilter result
+    unsigned int parseHit(char *data, int &diagonal);
+
     static size_t estimateHDDMemoryConsumption(int dbSize, int maxSeqs);
 
-    void computeAlternativeAlignment(unsigned int queryDbKey, Sequence &dbSeq,
-                                     std::vector<Matcher::result_t> &vector, Matcher &matcher,
-                                     float evalThr, int swMode);
+    // part of the prefilter list of a query, aligned by one thread of run
+    struct task_t {
+        size_t id;
+        // byte range of the hits in the prefilter entry, end is only set for chunks of a split query
+        size_t begin;
+        size_t end;
+        // estimated number of cells
+        size_t cost;
+        // index in the splits of the bucket or NO_SPLIT
+        size_t split;
+        size_t chunk;
+    };
+
+    // results of the chunks of a split query, merged in chunk order by the thread finishing the last chunk
+    struct split_t {
+        std::vector<std::vector<Matcher::result_view_t> > results;
+        std::vector<std::vector<Matcher::result_view_t> > altResults;
+        std::vector<std::string> backtraces;
+        unsigned int remaining;
+    };
+
+    static const size_t NO_SPLIT = SIZE_MAX;
+    // queries are split into chunks of about 1 / SPLIT_TASKS_PER_THREAD of the work of a thread
+    static const size_t SPLIT_TASKS_PER_THREAD = 4;
+    // chunks have at least this many hits
+    static const size_t SPLIT_MIN_HITS = 64;
+
+    static bool compareTaskCost(const task_t &first, const task_t &second) {
+        return first.cost > second.cost;
+    }
+
+    // orders the queries of a flush bucket by estimated cost (query length times prefilter list size),
+    // the most expensive first, so that no thread is left with an expensive query at the end.
+    // Queries that are too expensive for a single thread are split into chunks of their targets
+    void scheduleQueries(size_t start, size_t count, unsigned int maxAlnNum, unsigned int maxRejected,
+                         std::vector<task_t> &tasks, std::vector<split_t> &splits);
+
+    // masks the aligned part of the target, dbSeq has to hold the target of result, and appends
+    // up to altAlignment further alignments of the query to the rest of the target to altResults
+    void computeAlternativeAlignment(Sequence &dbSeq, const Matcher::result_view_t &result,
+                                     std::vector<Matcher::result_view_t> &altResults, std::string &backtraces,
+                                     Matcher &matcher, float evalThr, int swMode);
+
+    // queries up to BATCH_QUERY_LENGTH_PER_LANE * batch size residues are aligned
+    // with the inter-sequence kernel against several short targets at once
+    static const int BATCH_QUERY_LENGTH_PER_LANE = 8;
+    static const int BATCH_MAX_TARGET_LENGTH = 1024;
+    // look ahead at most BATCH_SCAN_FACTOR * batch size prefilter hits to fill a batch
+    static const unsigned int BATCH_SCAN_FACTOR = 4;
+
+    // aligns the next batch of short targets in the prefilter list starting at data
+    // batchEntries holds the prefilter lines of the aligned targets, scanEnd the line after the last scanned hit
+    // returns false if the query can not be aligned with the inter-sequence kernel
+    bool alignBatch(char *data, const char *end, char *&scanEnd, unsigned int queryDbKey, Sequence &qSeq, Sequence &dbSeq,
+                    Matcher &matcher, std::vector<char *> &batchEntries, SmithWaterman::alignment_end *ends);
 };
 
 #endif
@@ -15,9 +15,11 @@
 #include "StripedSmithWaterman.h"
 
 
-BandedNucleotideAligner::BandedNucleotideAligner(BaseMatrix * subMat, size_t maxSequenceLength, int gapo, int gape) :
+BandedNucleotideAligner::BandedNucleotideAligner(BaseMatrix * subMat, size_t maxSequenceLength, int gapo, int gape,
+                                                 int gapo2, int gape2) :
 fastMatrix(SubstitutionMatrix::createAsciiSubMat(*subMat))
 {
+    kernel = SIMD_KERNEL_AVX2(bandedNucleotideAlignerKernel);
 
     targetSeq =  new uint8_t[maxSequenceLength];
     targetSeqRev =  new uint8_t[maxSequenceLength];
@@ -31,6 +33,24 @@ fastMatrix(SubstitutionMatrix::createAsciiSubMat(*subMat))
     }
     this->gape = gape;
     this->gapo = gapo;
+    this->gape2 = gape2;
+    this->gapo2 = gapo2;
+    if ((gapo2 > 0) != (gape2 > 0)) {
+        Debug(Debug::ERROR) << "Long gap open and extension cost have to be set both.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // ksw2 keeps the score differences of adjacent cells in 8 bit
+    int maxScore = 0;
+    for (int i = 0; i < subMat->alphabetSize * subMat->alphabetSize; i++) {
+        maxScore = std::max(maxScore, static_cast<int>(mat[i]));
+    }
+    if (std::max(gapo + gape, gapo2 + gape2) + maxScore > INT8_MAX) {
+        Debug(Debug::ERROR) << "Gap costs of " << std::max(gapo + gape, gapo2 + gape2) << " are too large for nucleotide alignments.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // ksw2 grows the cigar with realloc
+    cigarCapacity = 16;
+    cigar = (uint32_t *) malloc(cigarCapacity * sizeof(uint32_t));
 }
 
 BandedNucleotideAligner::~BandedNucleotideAligner(){
@@ -41,6 +61,33 @@ BandedNucleotideAligner::~BandedNucleotideAligner(){
     delete [] fastMatrix.matrixData;
     delete [] fastMatrix.matrix;
     delete [] mat;
+    free(cigar);
+}
+
+void BandedNucleotideAligner::extend(int qlen, const uint8_t *query, int tlen, const uint8_t *target, int w, int flag,
+                                     ksw_extz_t *ez) {
+    if (gapo2 > 0 && gape2 > 0) {
+        kernel->extd2(0, qlen, query, tlen, target, 5, mat, gapo, gape, gapo2, gape2, w, ZDROP, flag, ez);
+    } else {
+        kernel->extz2(0, qlen, query, tlen, target, 5, mat, gapo, gape, w, ZDROP, flag, ez);
+    }
+}
+
+// distance of the alignment path in the cigar from the diagonal it starts on
+static int maxDiagonalDistance(const uint32_t *cigar, int cigarLen) {
+    int distance = 0;
+    int maxDistance = 0;
+    for (int i = 0; i < cigarLen; i++) {
+        const uint32_t op = cigar[i] & 0xf;
+        const int len = static_cast<int>(cigar[i] >> 4);
+        if (op == 1) {
+            distance -= len;
+        } else if (op == 2 || op == 3) {
+            distance += len;
+        }
+        maxDistance = std::max(maxDistance, std::abs(distance));
+    }
+    return maxDistance;
 }
 
 void BandedNucleotideAligner::initQuery(Sequence * query){
@@ -90,10 +137,8 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj, short diagonal,
     if(qUngappedStartPos == 0 && qUngappedEndPos == querySeqObj->L -1
        && dbUngappedStartPos == 0 && dbUngappedEndPos == targetSeqObj->L - 1){
         s_align result;
-        uint32_t * retCigar = new uint32_t[1];
-        retCigar[0] = 0;
-        retCigar[0] = querySeqObj->L << 4;
-        result.cigar = retCigar;
+        cigar[0] = querySeqObj->L << 4;
+        result.cigar = cigar;
         result.cigarLen = 1;
         result.score1 = alignment.score;
         result.qStartPos1 = qUngappedStartPos;
@@ -111,11 +156,22 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj, short diagonal,
     int qStartRev = (querySeqObj->L  - qUngappedEndPos) - 1;
     int tStartRev = (targetSeqObj->L - dbUngappedEndPos) - 1;
 
+    // the band is widened while the alignment reaches close to its border, a wide enough band covers the whole matrix
+    const int maxBandWidth = std::max(querySeqObj->L, targetSeqObj->L);
+    int bandWidth = BAND_MIN_WIDTH;
     ksw_extz_t ez;
     int flag = 0;
     flag |= KSW_EZ_SCORE_ONLY;
     flag |= KSW_EZ_EXTZ_ONLY;
-    ksw_extz2_sse(0, querySeqObj->L - qStartRev, querySeqRev + qStartRev, targetSeqObj->L - tStartRev, targetSeqRev + tStartRev, 5, mat, gapo, gape, 64, 40, flag, &ez);
+    while (true) {
+        extend(querySeqObj->L - qStartRev, querySeqRev + qStartRev, targetSeqObj->L - tStartRev, targetSeqRev + tStartRev,
+               bandWidth, flag, &ez);
+        // the score only extension has no path, only its end is checked
+        if (bandWidth >= maxBandWidth || std::abs(ez.max_q - ez.max_t) + BAND_BORDER <= bandWidth) {
+            break;
+        }
+        bandWidth *= 2;
+    }
 
     int qStartPos = querySeqObj->L  - ( qStartRev + ez.max_q ) -1 ;
     int tStartPos = targetSeqObj->L - ( tStartRev + ez.max_t ) -1;
@@ -124,19 +180,23 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj, short diagonal,
     alignFlag |= KSW_EZ_EXTZ_ONLY;
 
     ksw_extz_t ezAlign;
-//    ezAlign.cigar = cigar;
 //    printf("%d %d\n", qStartPos, tStartPos);
     memset(&ezAlign, 0, sizeof(ksw_extz_t));
-    ksw_extz2_sse(0, querySeqObj->L-qStartPos, querySeq+qStartPos, targetSeqObj->L-tStartPos, targetSeq+tStartPos, 5,
-                  mat, gapo, gape, 64, 40, alignFlag, &ezAlign);
-
-    std::string letterCode = "MID";
-    uint32_t * retCigar = new uint32_t[ezAlign.n_cigar];
-    for(int i = 0; i < ezAlign.n_cigar; i++){
-        retCigar[i]=ezAlign.cigar[i];
+    while (true) {
+        ezAlign.cigar = cigar;
+        ezAlign.m_cigar = cigarCapacity;
+        extend(querySeqObj->L - qStartPos, querySeq + qStartPos, targetSeqObj->L - tStartPos, targetSeq + tStartPos,
+               bandWidth, alignFlag, &ezAlign);
+        cigar = ezAlign.cigar;
+        cigarCapacity = ezAlign.m_cigar;
+        if (bandWidth >= maxBandWidth || maxDiagonalDistance(cigar, ezAlign.n_cigar) + BAND_BORDER <= bandWidth) {
+            break;
+        }
+        bandWidth *= 2;
     }
+
     s_align result;
-    result.cigar = retCigar;
+    result.cigar = cigar;
     result.cigarLen = ezAlign.n_cigar;
     result.score1 = ezAlign.max;
     result.qStartPos1 = qStartPos;
@@ -146,7 +206,6 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj, short diagonal,
     result.qCov = SmithWaterman::computeCov(result.qStartPos1, result.qEndPos1, querySeqObj->L);
     result.tCov = SmithWaterman::computeCov(result.dbStartPos1, result.dbEndPos1, targetSeqObj->L);
     result.evalue = evaluer->computeEvalue(result.score1, querySeqObj->L);
-    free(ezAlign.cigar);
     return result;
 //        std::cout << static_cast<float>(aaIds)/ static_cast<float>(alignment.len) << std::endl;
 
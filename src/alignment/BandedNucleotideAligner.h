@@ -5,18 +5,22 @@
 // Local banded nucleotide aligner
 //
 #include <Parameters.h>
+#include <ksw2/ksw2.h>
 #include "StripedSmithWaterman.h"
 
 #include "Util.h"
 #include "SubstitutionMatrix.h"
 #include "Debug.h"
+#include "SimdDispatch.h"
 
 
 class BandedNucleotideAligner {
 public:
 
 
-    BandedNucleotideAligner(BaseMatrix *subMat, size_t maxSequenceLength, int gapo, int gape);
+    // gapo2 and gape2 > 0 add a second affine gap cost, a gap of length l then costs
+    // min(gapo + l * gape, gapo2 + l * gape2), so that long gaps are cheaper
+    BandedNucleotideAligner(BaseMatrix *subMat, size_t maxSequenceLength, int gapo, int gape, int gapo2 = 0, int gape2 = 0);
 
     ~BandedNucleotideAligner();
 
@@ -24,7 +28,36 @@ public:
 
     s_align align(Sequence * targetSeqObj, short diagonal, EvalueComputation * evaluer);
 
+    // instruction set specific part of the alignment (BandedNucleotideAlignerKernel.cpp),
+    // the parameters are the ones of ksw_extz2_sse and ksw_extd2_sse in ksw2.h
+    struct kernel_t {
+        // number of 8 bit elements in a vector
+        unsigned int vectorSize;
+
+        // extension with one affine gap cost
+        void (*extz2)(void *km, int qlen, const uint8_t *query, int tlen, const uint8_t *target, int8_t m,
+                      const int8_t *mat, int8_t q, int8_t e, int w, int zdrop, int flag, ksw_extz_t *ez);
+
+        // extension with two affine gap costs
+        void (*extd2)(void *km, int qlen, const uint8_t *query, int tlen, const uint8_t *target, int8_t m,
+                      const int8_t *mat, int8_t q, int8_t e, int8_t q2, int8_t e2, int w, int zdrop, int flag,
+                      ksw_extz_t *ez);
+    };
+
+    // the extension starts in a band of BAND_MIN_WIDTH around the diagonal of the ungapped alignment, which also covers
+    // hits whose prefilter diagonal is off. The band is doubled as long as the alignment comes closer than BAND_BORDER
+    // to its border
+    static const int BAND_MIN_WIDTH = 64;
+    static const int BAND_BORDER = 4;
+    static const int ZDROP = 40;
+
 private:
+    // kernel for the instruction set selected at construction
+    const kernel_t *kernel;
+
+    void extend(int qlen, const uint8_t *query, int tlen, const uint8_t *target, int w, int flag, ksw_extz_t *ez);
+
+
     SubstitutionMatrix::FastMatrix fastMatrix;
     uint8_t * targetSeq;
     uint8_t * targetSeqRev;
@@ -32,7 +65,13 @@ private:
     uint8_t * querySeqRev;
     Sequence * querySeqObj;
     int8_t * mat;
-//    uint32_t * cigar;
+    // cigar of the last alignment, returned in s_align and reused by ksw2
+    uint32_t * cigar;
+    int cigarCapacity;
     int gapo;
     int gape;
+    int gapo2;
+    int gape2;
 };
+
+SIMD_KERNEL_DECLARE(BandedNucleotideAligner::kernel_t, bandedNucleotideAlignerKernel)
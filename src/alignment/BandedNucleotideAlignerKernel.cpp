@@ -0,0 +1,640 @@
+// Instruction set specific part of the banded nucleotide aligner: the ksw2 extension with one
+// (ksw_extz2_sse) and two affine gap costs (ksw_extd2_sse) by Heng Li, MIT license, see lib/ksw2.
+// This file is compiled once per instruction set (see SimdDispatch.h).
+// The anti-diagonals are processed in blocks of 16 cells like in the SSE version, a vector covers one or more
+// blocks. Only the blocks the SSE version computes are stored and the maximum of an anti-diagonal is tracked like
+// in four SSE lanes, so that all instruction sets give the same alignments, also next to the band border.
+// Everything except the kernel table has internal linkage, so that the linker
+// can not mix up functions compiled for different instruction sets.
+#include "BandedNucleotideAligner.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace SIMD_NAMESPACE {
+namespace {
+
+const int BLOCK_SIZE = 16;
+const int VECTOR_SIZE = VECSIZE_INT * 4;
+const int VECTOR_BLOCKS = VECTOR_SIZE / BLOCK_SIZE;
+
+// [last byte of prev, cur without its last byte]
+inline simd_int shiftInByte(simd_int cur, simd_int prev) {
+#ifdef AVX2
+    return _mm256_alignr_epi8(cur, _mm256_permute2x128_si256(prev, cur, 0x21), 15);
+#else
+    return simdi_or(simdi8_shiftl(cur, 1), simdi8_shiftr(prev, 15));
+#endif
+}
+
+// vector whose last byte is value, it is shifted into the first vector of an anti-diagonal
+inline simd_int setLastByte(int8_t value) {
+#ifdef AVX2
+    return _mm256_insert_epi8(simdi_setzero(), value, 31);
+#else
+    return _mm_insert_epi8(simdi_setzero(), value, 15);
+#endif
+}
+
+// firstBlockOnly stores only the first block of the vector, the SSE version does not compute the next one
+inline void storeBlocks(uint8_t *dst, simd_int value, bool firstBlockOnly) {
+#ifdef AVX2
+    if (firstBlockOnly) {
+        _mm_storeu_si128((__m128i *) dst, _mm256_castsi256_si128(value));
+        return;
+    }
+#else
+    (void) firstBlockOnly;
+#endif
+    simdi_storeu((simd_int *) dst, value);
+}
+
+inline simd_int loadBlocks(const uint8_t *src) {
+    return simdi_loadu((const simd_int *) src);
+}
+
+// VECSIZE_INT bytes extended to 32 bit
+inline simd_int loadUnsigned32(const uint8_t *src) {
+#ifdef AVX2
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) src));
+#else
+    int32_t bytes;
+    memcpy(&bytes, src, sizeof(int32_t));
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+#endif
+}
+
+inline simd_int loadSigned32(const int8_t *src) {
+#ifdef AVX2
+    return _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *) src));
+#else
+    int32_t bytes;
+    memcpy(&bytes, src, sizeof(int32_t));
+    return _mm_cvtepi8_epi32(_mm_cvtsi32_si128(bytes));
+#endif
+}
+
+// the only call of the static inline ksw_backtrack, so that it is not inlined into the four call sites of the kernels
+__attribute__((noinline)) void backtrack(void *km, int rev_cigar, const uint8_t *p, const int *off, const int *off_end,
+                                         int n_col, int i0, int j0, ksw_extz_t *ez) {
+    ksw_backtrack(km, 1, rev_cigar, 0, p, off, off_end, n_col, i0, j0, &ez->m_cigar, &ez->n_cigar, &ez->cigar);
+}
+
+// Maximum of H[st0..en0] of an anti-diagonal after adding the score differences v8 to H.
+// maxH and maxT hold H[en0] and en0 on entry. The SSE version keeps the first maximum of the cells st0 + i + 4k in
+// lane i and takes the lanes in order if they exceed H[en0], the wider vectors merge their lanes into these four.
+template <typename T, bool isSigned>
+inline void updateMaxH(int32_t *H, const T *v8, int32_t st0, int32_t en0, int32_t qe, int32_t &maxH, int32_t &maxT) {
+    const int32_t en1 = st0 + (en0 - st0) / 4 * 4;
+    int32_t laneH[4];
+    int32_t laneT[4];
+    for (int i = 0; i < 4; ++i) {
+        laneH[i] = maxH;
+        laneT[i] = -1;
+    }
+    simd_int maxH_ = simdi32_set(maxH);
+    simd_int maxT_ = simdi32_set(-1);
+    const simd_int qe_ = simdi32_set(qe);
+    int32_t t;
+    for (t = st0; t + VECSIZE_INT <= en1; t += VECSIZE_INT) { // H[t] += v8[t] - qe; if (H[t] > maxH) maxH = H[t], maxT = t;
+        simd_int H1 = simdi_loadu((simd_int *) &H[t]);
+        H1 = simdi32_add(H1, isSigned ? loadSigned32((const int8_t *) &v8[t]) : loadUnsigned32((const uint8_t *) &v8[t]));
+        H1 = simdi32_sub(H1, qe_);
+        simdi_storeu((simd_int *) &H[t], H1);
+        const simd_int gt = simdi32_gt(H1, maxH_);
+        maxH_ = simdi8_blendv(maxH_, H1, gt);
+        maxT_ = simdi8_blendv(maxT_, simdi32_set(t), gt);
+    }
+    int32_t HH[VECSIZE_INT];
+    int32_t TT[VECSIZE_INT];
+    simdi_storeu((simd_int *) HH, maxH_);
+    simdi_storeu((simd_int *) TT, maxT_);
+    for (int i = 0; i < VECSIZE_INT; ++i) {
+        if (TT[i] < 0) {
+            continue;
+        }
+        const int lane = i % 4;
+        const int32_t cell = TT[i] + i;
+        if (HH[i] > laneH[lane] || (HH[i] == laneH[lane] && cell < laneT[lane])) {
+            laneH[lane] = HH[i];
+            laneT[lane] = cell;
+        }
+    }
+    for (; t < en1; ++t) { // cells of the last SSE vectors that do not fill a wider vector
+        H[t] += (int32_t) v8[t] - qe;
+        const int lane = (t - st0) % 4;
+        if (H[t] > laneH[lane]) {
+            laneH[lane] = H[t];
+            laneT[lane] = t;
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        if (maxH < laneH[i]) {
+            maxH = laneH[i];
+            maxT = laneT[i];
+        }
+    }
+    for (; t < en0; ++t) {
+        H[t] += (int32_t) v8[t] - qe;
+        if (H[t] > maxH) {
+            maxH = H[t];
+            maxT = t;
+        }
+    }
+}
+
+void extz2(void *km, int qlen, const uint8_t *query, int tlen, const uint8_t *target, int8_t m, const int8_t *mat,
+           int8_t q, int8_t e, int w, int zdrop, int flag, ksw_extz_t *ez) {
+    int r, t, qe = q + e, n_col_, *off = 0, *off_end = 0, tlen_, qlen_, last_st, last_en, wl, wr, max_sc, min_sc;
+    int with_cigar = !(flag & KSW_EZ_SCORE_ONLY), approx_max = !!(flag & KSW_EZ_APPROX_MAX);
+    int32_t *H = 0, H0 = 0, last_H0_t = 0;
+    uint8_t *qr, *sf, *mem, *mem2 = 0;
+    uint8_t *u, *v, *x, *y, *s, *p = 0;
+
+    ksw_reset_extz(ez);
+    if (m <= 0 || qlen <= 0 || tlen <= 0) return;
+
+    const simd_int zero_   = simdi_setzero();
+    const simd_int q_      = simdi8_set(q);
+    const simd_int qe2_    = simdi8_set((q + e) * 2);
+    const simd_int flag1_  = simdi8_set(1);
+    const simd_int flag2_  = simdi8_set(2);
+    const simd_int flag8_  = simdi8_set(0x08);
+    const simd_int flag16_ = simdi8_set(0x10);
+    const simd_int sc_mch_ = simdi8_set(mat[0]);
+    const simd_int sc_mis_ = simdi8_set(mat[1]);
+    const simd_int m1_     = simdi8_set(m - 1); // wildcard
+    const simd_int max_sc_ = simdi8_set(mat[0] + (q + e) * 2);
+
+    if (w < 0) w = tlen > qlen ? tlen : qlen;
+    wl = wr = w;
+    tlen_ = (tlen + 15) / 16;
+    n_col_ = qlen < tlen ? qlen : tlen;
+    n_col_ = ((n_col_ < w + 1 ? n_col_ : w + 1) + 15) / 16 + 1;
+    qlen_ = (qlen + 15) / 16;
+    for (t = 1, max_sc = mat[0], min_sc = mat[1]; t < m * m; ++t) {
+        max_sc = max_sc > mat[t] ? max_sc : mat[t];
+        min_sc = min_sc < mat[t] ? min_sc : mat[t];
+    }
+    if (-min_sc > 2 * (q + e)) return; // otherwise, we won't see any mismatches
+
+    // a vector may read one vector past the last block of an array
+    mem = (uint8_t *) kcalloc(km, (tlen_ * 6 + qlen_ + 1) * 16 + VECTOR_SIZE, 1);
+    u = (uint8_t *) (((size_t) mem + 15) >> 4 << 4); // 16-byte aligned
+    v = u + tlen_ * 16, x = v + tlen_ * 16, y = x + tlen_ * 16, s = y + tlen_ * 16, sf = s + tlen_ * 16, qr = sf + tlen_ * 16;
+    if (!approx_max) {
+        H = (int32_t *) kmalloc(km, tlen_ * 16 * 4);
+        for (t = 0; t < tlen_ * 16; ++t) H[t] = KSW_NEG_INF;
+    }
+    if (with_cigar) {
+        mem2 = (uint8_t *) kmalloc(km, ((qlen + tlen - 1) * n_col_ + 1) * 16);
+        p = (uint8_t *) (((size_t) mem2 + 15) >> 4 << 4);
+        off = (int *) kmalloc(km, (qlen + tlen - 1) * sizeof(int) * 2);
+        off_end = off + qlen + tlen - 1;
+    }
+
+    for (t = 0; t < qlen; ++t) qr[t] = query[qlen - 1 - t];
+    memcpy(sf, target, tlen);
+
+    for (r = 0, last_st = last_en = -1; r < qlen + tlen - 1; ++r) {
+        int st = 0, en = tlen - 1, st0, en0, st_, en_;
+        int8_t x1, v1;
+        uint8_t *qrr = qr + (qlen - 1 - r), *u8 = u, *v8 = v;
+        simd_int x1_, v1_;
+        // find the boundaries
+        if (st < r - qlen + 1) st = r - qlen + 1;
+        if (en > r) en = r;
+        if (st < (r - wr + 1) >> 1) st = (r - wr + 1) >> 1; // take the ceil
+        if (en > (r + wl) >> 1) en = (r + wl) >> 1; // take the floor
+        if (st > en) {
+            ez->zdropped = 1;
+            break;
+        }
+        st0 = st, en0 = en;
+        st = st / 16 * 16, en = (en + 16) / 16 * 16 - 1;
+        // set boundary conditions
+        if (st > 0) {
+            if (st - 1 >= last_st && st - 1 <= last_en)
+                x1 = x[st - 1], v1 = v8[st - 1]; // (r-1,s-1) calculated in the last round
+            else x1 = v1 = 0; // not calculated; set to zeros
+        } else x1 = 0, v1 = r ? q : 0;
+        if (en >= r) y[r] = 0, u8[r] = r ? q : 0;
+        // loop fission: set scores first
+        if (!(flag & KSW_EZ_GENERIC_SC)) {
+            for (t = st0; t <= en0; t += VECTOR_SIZE) {
+                simd_int sq, st, tmp, mask;
+                sq = loadBlocks(&sf[t]);
+                st = loadBlocks(&qrr[t]);
+                mask = simdi_or(simdi8_eq(sq, m1_), simdi8_eq(st, m1_));
+                tmp = simdi8_blendv(sc_mis_, sc_mch_, simdi8_eq(sq, st));
+                tmp = simdi_andnot(mask, tmp);
+                storeBlocks(s + t, tmp, t + BLOCK_SIZE > en0);
+            }
+        } else {
+            for (t = st0; t <= en0; ++t)
+                s[t] = mat[sf[t] * m + qrr[t]];
+        }
+        // core loop, t counts blocks
+        x1_ = setLastByte(x1);
+        v1_ = setLastByte(v1);
+        st_ = st / 16, en_ = en / 16;
+        assert(en_ - st_ + 1 <= n_col_);
+        uint8_t *pr = with_cigar ? p + ((size_t) r * n_col_ - st_) * 16 : NULL;
+        if (with_cigar) {
+            off[r] = st, off_end[r] = en;
+        }
+        for (t = st_; t <= en_; t += VECTOR_BLOCKS) {
+            const bool firstBlockOnly = t + VECTOR_BLOCKS - 1 > en_;
+            const size_t pos = (size_t) t * 16;
+            simd_int z, a, b, xt, xt1, vt, vt1, ut, tmp;
+            z = simdi8_add(loadBlocks(s + pos), qe2_);
+            xt = loadBlocks(x + pos);                   // xt <- x[r-1][t..t+n-1]
+            xt1 = shiftInByte(xt, x1_);                 // xt1 <- x[r-1][t-1..t+n-2]
+            x1_ = xt;
+            vt = loadBlocks(v + pos);                   // vt <- v[r-1][t..t+n-1]
+            vt1 = shiftInByte(vt, v1_);                 // vt1 <- v[r-1][t-1..t+n-2]
+            v1_ = vt;
+            a = simdi8_add(xt1, vt1);                   // a <- x[r-1][t-1..t+n-2] + v[r-1][t-1..t+n-2]
+            ut = loadBlocks(u + pos);                   // ut <- u[t..t+n-1]
+            b = simdi8_add(loadBlocks(y + pos), ut);    // b <- y[r-1][t..t+n-1] + u[r-1][t..t+n-1]
+            if (!with_cigar) { // score only
+                z = simdi8_max(z, a);
+                z = simdui8_max(z, b);                  // both are non-negative
+                z = simdui8_min(z, max_sc_);
+                storeBlocks(u + pos, simdi8_sub(z, vt1), firstBlockOnly);
+                storeBlocks(v + pos, simdi8_sub(z, ut), firstBlockOnly);
+                z = simdi8_sub(z, q_);
+                a = simdi8_sub(a, z);
+                b = simdi8_sub(b, z);
+                storeBlocks(x + pos, simdi8_max(a, zero_), firstBlockOnly);
+                storeBlocks(y + pos, simdi8_max(b, zero_), firstBlockOnly);
+            } else if (!(flag & KSW_EZ_RIGHT)) { // gap left-alignment
+                simd_int d = simdi_and(simdi8_gt(a, z), flag1_); // d = a > z? 1 : 0
+                z = simdi8_max(z, a);
+                d = simdi8_blendv(d, flag2_, simdi8_gt(b, z));    // d = b > z? 2 : d
+                z = simdui8_max(z, b);
+                z = simdui8_min(z, max_sc_);
+                storeBlocks(u + pos, simdi8_sub(z, vt1), firstBlockOnly);
+                storeBlocks(v + pos, simdi8_sub(z, ut), firstBlockOnly);
+                z = simdi8_sub(z, q_);
+                a = simdi8_sub(a, z);
+                b = simdi8_sub(b, z);
+                tmp = simdi8_gt(a, zero_);
+                storeBlocks(x + pos, simdi_and(tmp, a), firstBlockOnly);
+                d = simdi_or(d, simdi_and(tmp, flag8_));         // d = a > 0? 0x08 : 0
+                tmp = simdi8_gt(b, zero_);
+                storeBlocks(y + pos, simdi_and(tmp, b), firstBlockOnly);
+                d = simdi_or(d, simdi_and(tmp, flag16_));        // d = b > 0? 0x10 : 0
+                storeBlocks(pr + pos, d, firstBlockOnly);
+            } else { // gap right-alignment
+                simd_int d = simdi_andnot(simdi8_gt(z, a), flag1_); // d = z > a? 0 : 1
+                z = simdi8_max(z, a);
+                d = simdi8_blendv(flag2_, d, simdi8_gt(z, b));       // d = z > b? d : 2
+                z = simdui8_max(z, b);
+                z = simdui8_min(z, max_sc_);
+                storeBlocks(u + pos, simdi8_sub(z, vt1), firstBlockOnly);
+                storeBlocks(v + pos, simdi8_sub(z, ut), firstBlockOnly);
+                z = simdi8_sub(z, q_);
+                a = simdi8_sub(a, z);
+                b = simdi8_sub(b, z);
+                tmp = simdi8_gt(zero_, a);
+                storeBlocks(x + pos, simdi_andnot(tmp, a), firstBlockOnly);
+                d = simdi_or(d, simdi_andnot(tmp, flag8_));         // d = 0 > a? 0 : 0x08
+                tmp = simdi8_gt(zero_, b);
+                storeBlocks(y + pos, simdi_andnot(tmp, b), firstBlockOnly);
+                d = simdi_or(d, simdi_andnot(tmp, flag16_));        // d = 0 > b? 0 : 0x10
+                storeBlocks(pr + pos, d, firstBlockOnly);
+            }
+        }
+        if (!approx_max) { // find the exact max with a 32-bit score array
+            int32_t max_H, max_t;
+            // compute H[], max_H and max_t
+            if (r > 0) {
+                max_H = H[en0] = en0 > 0 ? H[en0 - 1] + u8[en0] - qe : H[en0] + v8[en0] - qe; // special casing the last element
+                max_t = en0;
+                updateMaxH<uint8_t, false>(H, v8, st0, en0, qe, max_H, max_t);
+            } else H[0] = v8[0] - qe - qe, max_H = H[0], max_t = 0; // special casing r==0
+            // update ez
+            if (en0 == tlen - 1 && H[en0] > ez->mte)
+                ez->mte = H[en0], ez->mte_q = r - en;
+            if (r - st0 == qlen - 1 && H[st0] > ez->mqe)
+                ez->mqe = H[st0], ez->mqe_t = st0;
+            if (ksw_apply_zdrop(ez, 1, max_H, r, max_t, zdrop, e)) break;
+            if (r == qlen + tlen - 2 && en0 == tlen - 1)
+                ez->score = H[tlen - 1];
+        } else { // find approximate max; Z-drop might be inaccurate, too.
+            if (r > 0) {
+                if (last_H0_t >= st0 && last_H0_t <= en0 && last_H0_t + 1 >= st0 && last_H0_t + 1 <= en0) {
+                    int32_t d0 = v8[last_H0_t] - qe;
+                    int32_t d1 = u8[last_H0_t + 1] - qe;
+                    if (d0 > d1) H0 += d0;
+                    else H0 += d1, ++last_H0_t;
+                } else if (last_H0_t >= st0 && last_H0_t <= en0) {
+                    H0 += v8[last_H0_t] - qe;
+                } else {
+                    ++last_H0_t, H0 += u8[last_H0_t] - qe;
+                }
+                if ((flag & KSW_EZ_APPROX_DROP) && ksw_apply_zdrop(ez, 1, H0, r, last_H0_t, zdrop, e)) break;
+            } else H0 = v8[0] - qe - qe, last_H0_t = 0;
+            if (r == qlen + tlen - 2 && en0 == tlen - 1)
+                ez->score = H0;
+        }
+        last_st = st, last_en = en;
+    }
+    kfree(km, mem);
+    if (!approx_max) kfree(km, H);
+    if (with_cigar) { // backtrack
+        int rev_cigar = !!(flag & KSW_EZ_REV_CIGAR);
+        if (!ez->zdropped && !(flag & KSW_EZ_EXTZ_ONLY))
+            backtrack(km, rev_cigar, p, off, off_end, n_col_ * 16, tlen - 1, qlen - 1, ez);
+        else if (ez->max_t >= 0 && ez->max_q >= 0)
+            backtrack(km, rev_cigar, p, off, off_end, n_col_ * 16, ez->max_t, ez->max_q, ez);
+        kfree(km, mem2);
+        kfree(km, off);
+    }
+}
+
+// a gap of length l costs min(q + l * e, q2 + l * e2), the scores are differences to the neighbouring cells
+// without the offset of extz2
+void extd2(void *km, int qlen, const uint8_t *query, int tlen, const uint8_t *target, int8_t m, const int8_t *mat,
+           int8_t q, int8_t e, int8_t q2, int8_t e2, int w, int zdrop, int flag, ksw_extz_t *ez) {
+    int r, t, n_col_, *off = 0, *off_end = 0, tlen_, qlen_, last_st, last_en, wl, wr, max_sc, min_sc, long_thres, long_diff;
+    int with_cigar = !(flag & KSW_EZ_SCORE_ONLY), approx_max = !!(flag & KSW_EZ_APPROX_MAX);
+    int32_t *H = 0, H0 = 0, last_H0_t = 0;
+    uint8_t *qr, *sf, *mem, *mem2 = 0;
+    uint8_t *u, *v, *x, *y, *x2, *y2, *s, *p = 0;
+
+    ksw_reset_extz(ez);
+    if (m <= 1 || qlen <= 0 || tlen <= 0) return;
+
+    if (q2 + e2 < q + e) { // make sure q + e is no larger than q2 + e2
+        int8_t tmp = q;
+        q = q2, q2 = tmp;
+        tmp = e;
+        e = e2, e2 = tmp;
+    }
+
+    const simd_int zero_   = simdi_setzero();
+    const simd_int q_      = simdi8_set(q);
+    const simd_int q2_     = simdi8_set(q2);
+    const simd_int qe_     = simdi8_set(q + e);
+    const simd_int qe2_    = simdi8_set(q2 + e2);
+    const simd_int flag1_  = simdi8_set(1);
+    const simd_int flag2_  = simdi8_set(2);
+    const simd_int flag3_  = simdi8_set(3);
+    const simd_int flag4_  = simdi8_set(4);
+    const simd_int flag8_  = simdi8_set(0x08);
+    const simd_int flag16_ = simdi8_set(0x10);
+    const simd_int flag32_ = simdi8_set(0x20);
+    const simd_int flag64_ = simdi8_set(0x40);
+    const simd_int sc_mch_ = simdi8_set(mat[0]);
+    const simd_int sc_mis_ = simdi8_set(mat[1]);
+    const simd_int sc_N_   = mat[m * m - 1] == 0 ? simdi8_set(-e2) : simdi8_set(mat[m * m - 1]);
+    const simd_int m1_     = simdi8_set(m - 1); // wildcard
+
+    if (w < 0) w = tlen > qlen ? tlen : qlen;
+    wl = wr = w;
+    tlen_ = (tlen + 15) / 16;
+    n_col_ = qlen < tlen ? qlen : tlen;
+    n_col_ = ((n_col_ < w + 1 ? n_col_ : w + 1) + 15) / 16 + 1;
+    qlen_ = (qlen + 15) / 16;
+    for (t = 1, max_sc = mat[0], min_sc = mat[1]; t < m * m; ++t) {
+        max_sc = max_sc > mat[t] ? max_sc : mat[t];
+        min_sc = min_sc < mat[t] ? min_sc : mat[t];
+    }
+    if (-min_sc > 2 * (q + e)) return; // otherwise, we won't see any mismatches
+
+    // gaps longer than long_thres are cheaper with the second gap cost
+    long_thres = e != e2 ? (q2 - q) / (e - e2) - 1 : 0;
+    if (q2 + e2 + long_thres * e2 > q + e + long_thres * e)
+        ++long_thres;
+    long_diff = long_thres * (e - e2) - (q2 - q) - e2;
+
+    mem = (uint8_t *) kcalloc(km, (tlen_ * 8 + qlen_ + 1) * 16 + VECTOR_SIZE, 1);
+    u = (uint8_t *) (((size_t) mem + 15) >> 4 << 4); // 16-byte aligned
+    v = u + tlen_ * 16, x = v + tlen_ * 16, y = x + tlen_ * 16, x2 = y + tlen_ * 16, y2 = x2 + tlen_ * 16;
+    s = y2 + tlen_ * 16, sf = s + tlen_ * 16, qr = sf + tlen_ * 16;
+    memset(u, -q - e, tlen_ * 16);
+    memset(v, -q - e, tlen_ * 16);
+    memset(x, -q - e, tlen_ * 16);
+    memset(y, -q - e, tlen_ * 16);
+    memset(x2, -q2 - e2, tlen_ * 16);
+    memset(y2, -q2 - e2, tlen_ * 16);
+    if (!approx_max) {
+        H = (int32_t *) kmalloc(km, tlen_ * 16 * 4);
+        for (t = 0; t < tlen_ * 16; ++t) H[t] = KSW_NEG_INF;
+    }
+    if (with_cigar) {
+        mem2 = (uint8_t *) kmalloc(km, ((size_t) (qlen + tlen - 1) * n_col_ + 1) * 16);
+        p = (uint8_t *) (((size_t) mem2 + 15) >> 4 << 4);
+        off = (int *) kmalloc(km, (qlen + tlen - 1) * sizeof(int) * 2);
+        off_end = off + qlen + tlen - 1;
+    }
+
+    for (t = 0; t < qlen; ++t) qr[t] = query[qlen - 1 - t];
+    memcpy(sf, target, tlen);
+
+    for (r = 0, last_st = last_en = -1; r < qlen + tlen - 1; ++r) {
+        int st = 0, en = tlen - 1, st0, en0, st_, en_;
+        int8_t x1, x21, v1;
+        uint8_t *qrr = qr + (qlen - 1 - r);
+        int8_t *u8 = (int8_t *) u, *v8 = (int8_t *) v, *x8 = (int8_t *) x, *x28 = (int8_t *) x2;
+        simd_int x1_, x21_, v1_;
+        // find the boundaries
+        if (st < r - qlen + 1) st = r - qlen + 1;
+        if (en > r) en = r;
+        if (st < (r - wr + 1) >> 1) st = (r - wr + 1) >> 1; // take the ceil
+        if (en > (r + wl) >> 1) en = (r + wl) >> 1; // take the floor
+        if (st > en) {
+            ez->zdropped = 1;
+            break;
+        }
+        st0 = st, en0 = en;
+        st = st / 16 * 16, en = (en + 16) / 16 * 16 - 1;
+        // set boundary conditions
+        if (st > 0) {
+            if (st - 1 >= last_st && st - 1 <= last_en) {
+                x1 = x8[st - 1], x21 = x28[st - 1], v1 = v8[st - 1]; // (r-1,s-1) calculated in the last round
+            } else {
+                x1 = -q - e, x21 = -q2 - e2;
+                v1 = -q - e;
+            }
+        } else {
+            x1 = -q - e, x21 = -q2 - e2;
+            v1 = r == 0 ? -q - e : r < long_thres ? -e : r == long_thres ? long_diff : -e2;
+        }
+        if (en >= r) {
+            ((int8_t *) y)[r] = -q - e, ((int8_t *) y2)[r] = -q2 - e2;
+            u8[r] = r == 0 ? -q - e : r < long_thres ? -e : r == long_thres ? long_diff : -e2;
+        }
+        // loop fission: set scores first
+        if (!(flag & KSW_EZ_GENERIC_SC)) {
+            for (t = st0; t <= en0; t += VECTOR_SIZE) {
+                simd_int sq, st, tmp, mask;
+                sq = loadBlocks(&sf[t]);
+                st = loadBlocks(&qrr[t]);
+                mask = simdi_or(simdi8_eq(sq, m1_), simdi8_eq(st, m1_));
+                tmp = simdi8_blendv(sc_mis_, sc_mch_, simdi8_eq(sq, st));
+                tmp = simdi8_blendv(tmp, sc_N_, mask);
+                storeBlocks(s + t, tmp, t + BLOCK_SIZE > en0);
+            }
+        } else {
+            for (t = st0; t <= en0; ++t)
+                s[t] = mat[sf[t] * m + qrr[t]];
+        }
+        // core loop, t counts blocks
+        x1_ = setLastByte(x1);
+        x21_ = setLastByte(x21);
+        v1_ = setLastByte(v1);
+        st_ = st / 16, en_ = en / 16;
+        assert(en_ - st_ + 1 <= n_col_);
+        uint8_t *pr = with_cigar ? p + ((size_t) r * n_col_ - st_) * 16 : NULL;
+        if (with_cigar) {
+            off[r] = st, off_end[r] = en;
+        }
+        for (t = st_; t <= en_; t += VECTOR_BLOCKS) {
+            const bool firstBlockOnly = t + VECTOR_BLOCKS - 1 > en_;
+            const size_t pos = (size_t) t * 16;
+            simd_int z, a, b, a2, b2, xt, xt1, x2t, x2t1, vt, vt1, ut, tmp, d;
+            z = loadBlocks(s + pos);
+            xt = loadBlocks(x + pos);                   // xt <- x[r-1][t..t+n-1]
+            xt1 = shiftInByte(xt, x1_);                 // xt1 <- x[r-1][t-1..t+n-2]
+            x1_ = xt;
+            vt = loadBlocks(v + pos);                   // vt <- v[r-1][t..t+n-1]
+            vt1 = shiftInByte(vt, v1_);                 // vt1 <- v[r-1][t-1..t+n-2]
+            v1_ = vt;
+            a = simdi8_add(xt1, vt1);                   // a <- x[r-1][t-1..t+n-2] + v[r-1][t-1..t+n-2]
+            ut = loadBlocks(u + pos);                   // ut <- u[t..t+n-1]
+            b = simdi8_add(loadBlocks(y + pos), ut);    // b <- y[r-1][t..t+n-1] + u[r-1][t..t+n-1]
+            x2t = loadBlocks(x2 + pos);
+            x2t1 = shiftInByte(x2t, x21_);
+            x21_ = x2t;
+            a2 = simdi8_add(x2t1, vt1);
+            b2 = simdi8_add(loadBlocks(y2 + pos), ut);
+            if (!with_cigar) { // score only
+                z = simdi8_max(z, a);
+                z = simdi8_max(z, b);
+                z = simdi8_max(z, a2);
+                z = simdi8_max(z, b2);
+                z = simdi8_min(z, sc_mch_);
+            } else if (!(flag & KSW_EZ_RIGHT)) { // gap left-alignment
+                d = simdi_and(simdi8_gt(a, z), flag1_);      // d = a  > z? 1 : 0
+                z = simdi8_max(z, a);
+                d = simdi8_blendv(d, flag2_, simdi8_gt(b, z));  // d = b  > z? 2 : d
+                z = simdi8_max(z, b);
+                d = simdi8_blendv(d, flag3_, simdi8_gt(a2, z)); // d = a2 > z? 3 : d
+                z = simdi8_max(z, a2);
+                d = simdi8_blendv(d, flag4_, simdi8_gt(b2, z)); // d = b2 > z? 4 : d
+                z = simdi8_max(z, b2);
+                z = simdi8_min(z, sc_mch_);
+            } else { // gap right-alignment
+                d = simdi_andnot(simdi8_gt(z, a), flag1_);       // d = z > a?  0 : 1
+                z = simdi8_max(z, a);
+                d = simdi8_blendv(flag2_, d, simdi8_gt(z, b));   // d = z > b?  d : 2
+                z = simdi8_max(z, b);
+                d = simdi8_blendv(flag3_, d, simdi8_gt(z, a2));  // d = z > a2? d : 3
+                z = simdi8_max(z, a2);
+                d = simdi8_blendv(flag4_, d, simdi8_gt(z, b2));  // d = z > b2? d : 4
+                z = simdi8_max(z, b2);
+                z = simdi8_min(z, sc_mch_);
+            }
+            storeBlocks(u + pos, simdi8_sub(z, vt1), firstBlockOnly); // u[r][t..t+n-1] <- z - v[r-1][t-1..t+n-2]
+            storeBlocks(v + pos, simdi8_sub(z, ut), firstBlockOnly);  // v[r][t..t+n-1] <- z - u[r-1][t..t+n-1]
+            tmp = simdi8_sub(z, q_);
+            a = simdi8_sub(a, tmp);
+            b = simdi8_sub(b, tmp);
+            tmp = simdi8_sub(z, q2_);
+            a2 = simdi8_sub(a2, tmp);
+            b2 = simdi8_sub(b2, tmp);
+            if (!with_cigar) {
+                storeBlocks(x + pos, simdi8_sub(simdi8_max(a, zero_), qe_), firstBlockOnly);
+                storeBlocks(y + pos, simdi8_sub(simdi8_max(b, zero_), qe_), firstBlockOnly);
+                storeBlocks(x2 + pos, simdi8_sub(simdi8_max(a2, zero_), qe2_), firstBlockOnly);
+                storeBlocks(y2 + pos, simdi8_sub(simdi8_max(b2, zero_), qe2_), firstBlockOnly);
+            } else if (!(flag & KSW_EZ_RIGHT)) {
+                tmp = simdi8_gt(a, zero_);
+                storeBlocks(x + pos, simdi8_sub(simdi_and(tmp, a), qe_), firstBlockOnly);
+                d = simdi_or(d, simdi_and(tmp, flag8_));   // d = a  > 0? 0x08 : 0
+                tmp = simdi8_gt(b, zero_);
+                storeBlocks(y + pos, simdi8_sub(simdi_and(tmp, b), qe_), firstBlockOnly);
+                d = simdi_or(d, simdi_and(tmp, flag16_));  // d = b  > 0? 0x10 : 0
+                tmp = simdi8_gt(a2, zero_);
+                storeBlocks(x2 + pos, simdi8_sub(simdi_and(tmp, a2), qe2_), firstBlockOnly);
+                d = simdi_or(d, simdi_and(tmp, flag32_));  // d = a2 > 0? 0x20 : 0
+                tmp = simdi8_gt(b2, zero_);
+                storeBlocks(y2 + pos, simdi8_sub(simdi_and(tmp, b2), qe2_), firstBlockOnly);
+                d = simdi_or(d, simdi_and(tmp, flag64_));  // d = b2 > 0? 0x40 : 0
+                storeBlocks(pr + pos, d, firstBlockOnly);
+            } else {
+                tmp = simdi8_gt(zero_, a);
+                storeBlocks(x + pos, simdi8_sub(simdi_andnot(tmp, a), qe_), firstBlockOnly);
+                d = simdi_or(d, simdi_andnot(tmp, flag8_));   // d = 0 > a  ? 0 : 0x08
+                tmp = simdi8_gt(zero_, b);
+                storeBlocks(y + pos, simdi8_sub(simdi_andnot(tmp, b), qe_), firstBlockOnly);
+                d = simdi_or(d, simdi_andnot(tmp, flag16_));  // d = 0 > b  ? 0 : 0x10
+                tmp = simdi8_gt(zero_, a2);
+                storeBlocks(x2 + pos, simdi8_sub(simdi_andnot(tmp, a2), qe2_), firstBlockOnly);
+                d = simdi_or(d, simdi_andnot(tmp, flag32_));  // d = 0 > a2 ? 0 : 0x20
+                tmp = simdi8_gt(zero_, b2);
+                storeBlocks(y2 + pos, simdi8_sub(simdi_andnot(tmp, b2), qe2_), firstBlockOnly);
+                d = simdi_or(d, simdi_andnot(tmp, flag64_));  // d = 0 > b2 ? 0 : 0x40
+                storeBlocks(pr + pos, d, firstBlockOnly);
+            }
+        }
+        if (!approx_max) { // find the exact max with a 32-bit score array
+            int32_t max_H, max_t;
+            // compute H[], max_H and max_t
+            if (r > 0) {
+                max_H = H[en0] = en0 > 0 ? H[en0 - 1] + u8[en0] : H[en0] + v8[en0]; // special casing the last element
+                max_t = en0;
+                updateMaxH<int8_t, true>(H, v8, st0, en0, 0, max_H, max_t);
+            } else H[0] = v8[0] - q - e, max_H = H[0], max_t = 0; // special casing r==0
+            // update ez
+            if (en0 == tlen - 1 && H[en0] > ez->mte)
+                ez->mte = H[en0], ez->mte_q = r - en;
+            if (r - st0 == qlen - 1 && H[st0] > ez->mqe)
+                ez->mqe = H[st0], ez->mqe_t = st0;
+            if (ksw_apply_zdrop(ez, 1, max_H, r, max_t, zdrop, e2)) break;
+            if (r == qlen + tlen - 2 && en0 == tlen - 1)
+                ez->score = H[tlen - 1];
+        } else { // find approximate max; Z-drop might be inaccurate, too.
+            if (r > 0) {
+                if (last_H0_t >= st0 && last_H0_t <= en0 && last_H0_t + 1 >= st0 && last_H0_t + 1 <= en0) {
+                    int32_t d0 = v8[last_H0_t];
+                    int32_t d1 = u8[last_H0_t + 1];
+                    if (d0 > d1) H0 += d0;
+                    else H0 += d1, ++last_H0_t;
+                } else if (last_H0_t >= st0 && last_H0_t <= en0) {
+                    H0 += v8[last_H0_t];
+                } else {
+                    ++last_H0_t, H0 += u8[last_H0_t];
+                }
+            } else H0 = v8[0] - q - e, last_H0_t = 0;
+            if ((flag & KSW_EZ_APPROX_DROP) && ksw_apply_zdrop(ez, 1, H0, r, last_H0_t, zdrop, e2)) break;
+            if (r == qlen + tlen - 2 && en0 == tlen - 1)
+                ez->score = H0;
+        }
+        last_st = st, last_en = en;
+    }
+    kfree(km, mem);
+    if (!approx_max) kfree(km, H);
+    if (with_cigar) { // backtrack
+        int rev_cigar = !!(flag & KSW_EZ_REV_CIGAR);
+        if (!ez->zdropped && !(flag & KSW_EZ_EXTZ_ONLY))
+            backtrack(km, rev_cigar, p, off, off_end, n_col_ * 16, tlen - 1, qlen - 1, ez);
+        else if (ez->max_t >= 0 && ez->max_q >= 0)
+            backtrack(km, rev_cigar, p, off, off_end, n_col_ * 16, ez->max_t, ez->max_q, ez);
+        kfree(km, mem2);
+        kfree(km, off);
+    }
+}
+
+}
+
+extern const BandedNucleotideAligner::kernel_t bandedNucleotideAlignerKernel = {
+    VECSIZE_INT * 4,
+    extz2,
+    extd2
+};
+
+}
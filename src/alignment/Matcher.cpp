@@ -7,7 +7,7 @@
 
 
 Matcher::Matcher(int querySeqType, int maxSeqLen, BaseMatrix *m, EvalueComputation * evaluer,
-                 bool aaBiasCorrection, int gapOpen, int gapExtend){
+                 bool aaBiasCorrection, int gapOpen, int gapExtend, int longGapOpen, int longGapExtend){
     this->m = m;
     this->tinySubMat = NULL;
     this->gapOpen = gapOpen;
@@ -17,10 +17,11 @@ Matcher::Matcher(int querySeqType, int maxSeqLen, BaseMatrix *m, EvalueComputati
     }
 
     this->maxSeqLen = maxSeqLen;
+    this->bandWidth = 0;
     nuclaligner=NULL;
     aligner=NULL;
     if(querySeqType==Sequence::NUCLEOTIDES){
-        nuclaligner = new  BandedNucleotideAligner(m, maxSeqLen, gapOpen, gapExtend);
+        nuclaligner = new  BandedNucleotideAligner(m, maxSeqLen, gapOpen, gapExtend, longGapOpen, longGapExtend);
     }else{
         aligner = new SmithWaterman(maxSeqLen, m->alphabetSize, aaBiasCorrection);
     }
@@ -65,7 +66,24 @@ void Matcher::initQuery(Sequence* query){
 
 Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, const int covMode, const float covThr,
                                        const double evalThr, unsigned int alignmentMode, unsigned int seqIdMode,
-                                       bool isIdentity){
+                                       bool isIdentity, const SmithWaterman::alignment_end *forward){
+    std::string backtrace;
+    result_view_t view = getSWResultView(dbSeq, diagonal, covMode, covThr, evalThr, alignmentMode, seqIdMode,
+                                         isIdentity, backtrace, forward);
+    return result_t(view.dbKey, view.score, view.qcov, view.dbcov, view.seqId, view.eval, view.alnLength,
+                    view.qStartPos, view.qEndPos, view.qLen, view.dbStartPos, view.dbEndPos, view.dbLen, backtrace);
+}
+
+Matcher::result_t Matcher::viewToResult(const result_view_t &view, const std::string &backtraces) {
+    return result_t(view.dbKey, view.score, view.qcov, view.dbcov, view.seqId, view.eval, view.alnLength,
+                    view.qStartPos, view.qEndPos, view.qLen, view.dbStartPos, view.dbEndPos, view.dbLen,
+                    backtraces.substr(view.backtraceOffset, view.backtraceLength));
+}
+
+Matcher::result_view_t Matcher::getSWResultView(Sequence* dbSeq, const int diagonal, const int covMode, const float covThr,
+                                                const double evalThr, unsigned int alignmentMode, unsigned int seqIdMode,
+                                                bool isIdentity, std::string &backtraces,
+                                                const SmithWaterman::alignment_end *forward){
     // calculation of the score and traceback of the alignment
     int32_t maskLen = currentQuery->L / 2;
 
@@ -88,7 +106,24 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, cons
         alignment = nuclaligner->align(dbSeq,diagonal,evaluer);
         alignmentMode = Matcher::SCORE_COV_SEQID;
     }else if(isIdentity==false){
-        alignment = aligner->ssw_align(dbSeq->int_sequence, dbSeq->L, gapOpen, gapExtend, alignmentMode, evalThr, evaluer, covMode, covThr, maskLen);
+        SmithWaterman::alignment_end banded;
+        if (forward == NULL && bandWidth > 0 && diagonal != INT_MAX) {
+            // the prefilter stores the diagonal in 16 bit, long sequences need the one inside of the matrix
+            int queryDiagonal = static_cast<short>(diagonal);
+            if (queryDiagonal < -(dbSeq->L - 1)) {
+                queryDiagonal += USHRT_MAX + 1;
+            } else if (queryDiagonal > currentQuery->L - 1) {
+                queryDiagonal -= USHRT_MAX + 1;
+            }
+            if (queryDiagonal >= -(dbSeq->L - 1) && queryDiagonal <= currentQuery->L - 1
+                && aligner->ssw_banded_forward(dbSeq->int_sequence, dbSeq->L, queryDiagonal, bandWidth, gapOpen, gapExtend,
+                                             static_cast<int32_t>(BAND_XDROP_BITS * m->getBitFactor()), &banded)) {
+                forward = &banded;
+                // the band does not give the suboptimal alignment, which is not used here anyway
+                maskLen = 0;
+            }
+        }
+        alignment = aligner->ssw_align(dbSeq->int_sequence, dbSeq->L, gapOpen, gapExtend, alignmentMode, evalThr, evaluer, covMode, covThr, maskLen, forward);
     }else{
         alignment = aligner->scoreIdentical(dbSeq->int_sequence, dbSeq->L, evaluer, alignmentMode);
     }
@@ -98,7 +133,7 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, cons
     float dbcov = 0.0;
     float seqId = 0.0;
     // compute sequence identity
-    std::string backtrace;
+    const size_t backtraceOffset = backtraces.size();
 
     int aaIds = 0;
     if(alignmentMode == Matcher::SCORE_COV_SEQID){
@@ -108,36 +143,29 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, cons
                 for (int32_t c = 0; c < alignment.cigarLen; ++c) {
                     char letter = SmithWaterman::cigar_int_to_op(alignment.cigar[c]);
                     uint32_t length = SmithWaterman::cigar_int_to_len(alignment.cigar[c]);
-                    backtrace.reserve(length);
-
-                    for (uint32_t i = 0; i < length; ++i){
-                        if (letter == 'M') {
+                    if (letter == 'M') {
+                        for (uint32_t i = 0; i < length; ++i){
                             if (dbSeq->int_sequence[targetPos] == currentQuery->int_sequence[queryPos]){
                                 aaIds++;
                             }
                             ++queryPos;
                             ++targetPos;
-                            backtrace.append("M");
-                        } else {
-                            if (letter == 'I') {
-                                ++queryPos;
-                                backtrace.append("I");
-                            }
-                            else{
-                                ++targetPos;
-                                backtrace.append("D");
-                            }
                         }
+                    } else if (letter == 'I') {
+                        queryPos += length;
+                    } else {
+                        letter = 'D';
+                        targetPos += length;
                     }
+                    backtraces.append(length, letter);
                 }
             }
         } else {
-            for (int32_t c = 0; c < currentQuery->L; ++c) {
-                aaIds++;
-                backtrace.append("M");
-            }
+            aaIds += currentQuery->L;
+            backtraces.append(currentQuery->L, 'M');
         }
     }
+    const size_t backtraceLength = backtraces.size() - backtraceOffset;
 
     const unsigned int qStartPos = alignment.qStartPos1;
     const unsigned int dbStartPos = alignment.dbStartPos1;
@@ -156,7 +184,7 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, cons
         // compute sequence id
         if(alignment.cigar){
             // OVERWRITE alnLength with gapped value
-            alnLength = backtrace.size();
+            alnLength = backtraceLength;
         }
         seqId = Util::computeSeqId(seqIdMode, aaIds, currentQuery->L, dbSeq->L, alnLength);
 
@@ -178,11 +206,43 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, cons
     double evalue = alignment.evalue;
     int bitScore = static_cast<short>(evaluer->computeBitScore(alignment.score1)+0.5);
 
-    result_t result(dbSeq->getDbKey(), bitScore, qcov, dbcov, seqId, evalue, alnLength, qStartPos, qEndPos, currentQuery->L, dbStartPos, dbEndPos, dbSeq->L, backtrace);
-    delete [] alignment.cigar;
+    result_view_t result;
+    result.dbKey = dbSeq->getDbKey();
+    result.score = bitScore;
+    result.qcov = qcov;
+    result.dbcov = dbcov;
+    result.seqId = seqId;
+    result.eval = evalue;
+    result.alnLength = alnLength;
+    result.qStartPos = qStartPos;
+    result.qEndPos = qEndPos;
+    result.qLen = currentQuery->L;
+    result.dbStartPos = dbStartPos;
+    result.dbEndPos = dbEndPos;
+    result.dbLen = dbSeq->L;
+    result.backtraceOffset = backtraceOffset;
+    result.backtraceLength = backtraceLength;
     return result;
 }
 
+unsigned int Matcher::getBatchSize() {
+    if (aligner == NULL) {
+        return 0;
+    }
+    return aligner->getBatchSize();
+}
+
+void Matcher::addBatchTarget(Sequence *dbSeq) {
+    aligner->ssw_batch_add(dbSeq->int_sequence, dbSeq->L);
+}
+
+bool Matcher::alignBatch(SmithWaterman::alignment_end *ends) {
+    return aligner->ssw_batch_align(gapOpen, gapExtend, currentQuery->L / 2, ends);
+}
+
+void Matcher::clearBatch() {
+    aligner->ssw_batch_clear();
+}
 
 void Matcher::readAlignmentResults(std::vector<result_t> &result, char *data, bool readCompressed) {
     if(data == NULL) {
@@ -195,6 +255,20 @@ void Matcher::readAlignmentResults(std::vector<result_t> &result, char *data, bo
     }
 }
 
+void Matcher::readAlignmentResults(std::vector<result_t> &result, char *data, size_t dataSize, bool binary,
+                                   bool readCompressed) {
+    if (binary == false) {
+        readAlignmentResults(result, data, readCompressed);
+        return;
+    }
+    const char *end = data + dataSize;
+    while (data < end) {
+        result.emplace_back(parseBinaryAlignmentRecord(data, readCompressed));
+        result_record_t record;
+        data = (char *) readBinaryRecord(data, record);
+    }
+}
+
 size_t Matcher::computeAlnLength(size_t qStart, size_t qEnd, size_t dbStart, size_t dbEnd) {
     return std::max(qEnd - qStart, dbEnd - dbStart) + 1;
 }
@@ -207,22 +281,28 @@ float Matcher::estimateSeqIdByScorePerCol(uint16_t score, unsigned int qLen, uns
 
 
 std::string Matcher::compressAlignment(const std::string& bt) {
-    std::string ret;
+    std::string ret(2 * bt.size() + 2, '\0');
+    ret.resize(compressAlignment(bt.c_str(), bt.size(), &ret[0]));
+    return ret;
+}
+
+size_t Matcher::compressAlignment(const char *bt, size_t length, char *buffer) {
+    char *pos = buffer;
     char state = 'M';
-    size_t counter = 0;
-    for(size_t i = 0; i < bt.size(); i++){
+    uint32_t counter = 0;
+    for(size_t i = 0; i < length; i++){
         if(bt[i] != state){
-            ret.append(std::to_string(counter));
-            ret.push_back(state);
+            pos = Itoa::u32toa_sse2(counter, pos);
+            *(pos-1) = state;
             state = bt[i];
             counter = 1;
         }else{
             counter++;
         }
     }
-    ret.append(std::to_string(counter));
-    ret.push_back(state);
-    return ret;
+    pos = Itoa::u32toa_sse2(counter, pos);
+    *(pos-1) = state;
+    return pos - buffer;
 }
 
 std::string Matcher::uncompressAlignment(const std::string &cbt) {
@@ -291,7 +371,69 @@ Matcher::result_t Matcher::parseAlignmentRecord(char *data, bool readCompressed)
 }
 
 
-size_t Matcher::resultToBuffer(char * buff1, const result_t &result, bool addBacktrace, bool compress) {
+Matcher::result_t Matcher::parseBinaryAlignmentRecord(const char *data, bool readCompressed) {
+    result_record_t record;
+    readBinaryRecord(data, record);
+    // the same derived values as for text records
+    int adjustQstart = (record.qStartPos == -1) ? 0 : record.qStartPos;
+    int adjustDBstart = (record.dbStartPos == -1) ? 0 : record.dbStartPos;
+    double qCov = SmithWaterman::computeCov(adjustQstart, record.qEndPos, record.qLen);
+    double dbCov = SmithWaterman::computeCov(adjustDBstart, record.dbEndPos, record.dbLen);
+    size_t alnLength = Matcher::computeAlnLength(adjustQstart, record.qEndPos, adjustDBstart, record.dbEndPos);
+
+    std::string backtrace(data + sizeof(result_record_t), record.backtraceLength);
+    if (readCompressed == false && record.backtraceLength > 0) {
+        backtrace = uncompressAlignment(backtrace);
+    }
+    return Matcher::result_t(record.dbKey, record.score, qCov, dbCov, record.seqId, record.eval,
+                             alnLength, record.qStartPos, record.qEndPos, record.qLen,
+                             record.dbStartPos, record.dbEndPos, record.dbLen, backtrace);
+}
+
+size_t Matcher::countBinaryRecords(const char *data, size_t dataSize) {
+    const char *end = data + dataSize;
+    size_t count = 0;
+    result_record_t record;
+    while (data < end) {
+        data = readBinaryRecord(data, record);
+        count++;
+    }
+    return count;
+}
+
+// result is a result_t or a result_view_t, backtrace points to its uncompressed backtrace
+template <typename T>
+static size_t writeBinaryResult(char *buffer, const T &result, const char *backtrace, size_t backtraceLength, bool addBacktrace) {
+    Matcher::result_record_t record;
+    record.dbKey = result.dbKey;
+    record.score = result.score;
+    record.seqId = result.seqId;
+    record.qStartPos = result.qStartPos;
+    record.qEndPos = result.qEndPos;
+    record.qLen = result.qLen;
+    record.dbStartPos = result.dbStartPos;
+    record.dbEndPos = result.dbEndPos;
+    record.dbLen = result.dbLen;
+    record.eval = result.eval;
+    record.backtraceLength = 0;
+    if (addBacktrace == true) {
+        record.backtraceLength = Matcher::compressAlignment(backtrace, backtraceLength, buffer + sizeof(Matcher::result_record_t));
+    }
+    memcpy(buffer, &record, sizeof(Matcher::result_record_t));
+    return sizeof(Matcher::result_record_t) + record.backtraceLength;
+}
+
+size_t Matcher::resultToBinaryBuffer(char *buffer, const result_t &result, bool addBacktrace) {
+    return writeBinaryResult(buffer, result, result.backtrace.c_str(), result.backtrace.size(), addBacktrace);
+}
+
+size_t Matcher::resultToBinaryBuffer(char *buffer, const result_view_t &result, const std::string &backtraces, bool addBacktrace) {
+    return writeBinaryResult(buffer, result, backtraces.c_str() + result.backtraceOffset, result.backtraceLength, addBacktrace);
+}
+
+template <typename T>
+static size_t writeResult(char * buff1, const T &result, const char *backtrace, size_t backtraceLength,
+                          bool addBacktrace, bool compress) {
     char * basePos = buff1;
     char * tmpBuff = Itoa::u32toa_sse2((uint32_t) result.dbKey, buff1);
     *(tmpBuff-1) = '\t';
@@ -349,13 +491,11 @@ size_t Matcher::resultToBuffer(char * buff1, const result_t &result, bool addBac
         tmpBuff = Itoa::i32toa_sse2(result.dbLen, tmpBuff);
         if(compress){
             *(tmpBuff-1) = '\t';
-            std::string compressedCigar = Matcher::compressAlignment(result.backtrace);
-            tmpBuff = strncpy(tmpBuff, compressedCigar.c_str(), compressedCigar.length());
-            tmpBuff+= compressedCigar.length()+1;
+            tmpBuff += Matcher::compressAlignment(backtrace, backtraceLength, tmpBuff) + 1;
         }else{
             *(tmpBuff-1) = '\t';
-            tmpBuff = strncpy(tmpBuff, result.backtrace.c_str(), result.backtrace.length());
-            tmpBuff+= result.backtrace.length()+1;
+            memcpy(tmpBuff, backtrace, backtraceLength);
+            tmpBuff+= backtraceLength+1;
         }
     }else{
         *(tmpBuff-1) = '\t';
@@ -367,4 +507,14 @@ size_t Matcher::resultToBuffer(char * buff1, const result_t &result, bool addBac
     return tmpBuff - basePos;
 }
 
+size_t Matcher::resultToBuffer(char * buff1, const result_t &result, bool addBacktrace, bool compress) {
+    return writeResult(buff1, result, result.backtrace.c_str(), result.backtrace.size(), addBacktrace, compress);
+}
+
+size_t Matcher::resultToBuffer(char * buff1, const result_view_t &result, const std::string &backtraces,
+                               bool addBacktrace, bool compress) {
+    return writeResult(buff1, result, backtraces.c_str() + result.backtraceOffset, result.backtraceLength,
+                       addBacktrace, compress);
+}
+
 
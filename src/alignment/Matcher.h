@@ -8,6 +8,7 @@
 //
 
 #include <cfloat>
+#include <cstring>
 #include <algorithm>
 #include <vector>
 
@@ -60,15 +61,78 @@ public:
         result_t(){};
     };
 
+    // result_t without a backtrace of its own: the backtrace is stored at backtraceOffset in a string shared
+    // by all results of a query (see getSWResultView), so that aligning a target does not allocate memory
+    struct result_view_t {
+        unsigned int dbKey;
+        int score;
+        float qcov;
+        float dbcov;
+        float seqId;
+        double eval;
+        unsigned int alnLength;
+        int qStartPos;
+        int qEndPos;
+        unsigned int qLen;
+        int dbStartPos;
+        int dbEndPos;
+        unsigned int dbLen;
+        size_t backtraceOffset;
+        size_t backtraceLength;
+    };
+
+    // binary alignment result record, followed by backtraceLength byte of the compressed backtrace,
+    // see Sequence::ALIGNMENT_RES_BINARY
+    struct result_record_t {
+        unsigned int dbKey;
+        int score;
+        float seqId;
+        int qStartPos;
+        int qEndPos;
+        unsigned int qLen;
+        int dbStartPos;
+        int dbEndPos;
+        unsigned int dbLen;
+        unsigned int backtraceLength;
+        double eval;
+    };
+
     Matcher(int querySeqType, int maxSeqLen, BaseMatrix *m,
             EvalueComputation * evaluer, bool aaBiasCorrection,
-            int gapOpen, int gapExtend);
+            int gapOpen, int gapExtend, int longGapOpen = 0, int longGapExtend = 0);
 
     ~Matcher();
 
     // run SSE2 parallelized Smith-Waterman alignment calculation and traceback
+    // forward: score and end position computed by alignBatch, skips the first striped alignment pass
     result_t getSWResult(Sequence* dbSeq, const int diagonal, const int covMode, const float covThr, const double evalThr,
-                         unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentical);
+                         unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentical,
+                         const SmithWaterman::alignment_end *forward = NULL);
+
+    // same as getSWResult, the backtrace is appended to backtraces
+    result_view_t getSWResultView(Sequence* dbSeq, const int diagonal, const int covMode, const float covThr, const double evalThr,
+                                  unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentical, std::string &backtraces,
+                                  const SmithWaterman::alignment_end *forward = NULL);
+
+    static result_t viewToResult(const result_view_t &view, const std::string &backtraces);
+
+    // protein alignments start with a banded forward pass of this half width around the prefilter diagonal
+    // 0: always run the full striped forward pass
+    void setBandWidth(int bandWidth) {
+        this->bandWidth = bandWidth;
+    }
+
+    // inter-sequence alignment of short targets against the current query, one target per SIMD lane
+    // returns 0 if the query type has no inter-sequence kernel
+    unsigned int getBatchSize();
+
+    void addBatchTarget(Sequence *dbSeq);
+
+    // ends needs 2 * getBatchSize() entries (see SmithWaterman::ssw_batch_align),
+    // returns false if the current query can not be aligned in batches
+    bool alignBatch(SmithWaterman::alignment_end *ends);
+
+    void clearBatch();
 
     // need for sorting the results
     static bool compareHits (const result_t &first, const result_t &second){
@@ -84,6 +148,18 @@ public:
         return false;
     }
 
+    static bool compareHitViews(const result_view_t &first, const result_view_t &second){
+        if(first.eval < second.eval )
+            return true;
+        if(second.eval < first.eval )
+            return false;
+        if(first.score > second.score )
+            return true;
+        if(second.score > first.score )
+            return false;
+        return false;
+    }
+
     // map new query into memory (create queryProfile, ...)
     void initQuery(Sequence* query);
 
@@ -95,11 +171,36 @@ public:
 
     static std::string compressAlignment(const std::string &bt);
 
+    // writes the compressed backtrace to buffer (at most 2 * length + 2 byte), returns its length
+    static size_t compressAlignment(const char *bt, size_t length, char *buffer);
+
     static std::string uncompressAlignment(const std::string &cbt);
 
 
     static size_t resultToBuffer(char * buffer, const result_t &result, bool addBacktrace, bool compress  = true);
 
+    static size_t resultToBinaryBuffer(char * buffer, const result_t &result, bool addBacktrace);
+
+    static size_t resultToBuffer(char * buffer, const result_view_t &result, const std::string &backtraces,
+                                 bool addBacktrace, bool compress = true);
+
+    static size_t resultToBinaryBuffer(char * buffer, const result_view_t &result, const std::string &backtraces,
+                                       bool addBacktrace);
+
+    // records are not aligned within an entry, returns the position of the next record
+    static const char *readBinaryRecord(const char *data, result_record_t &record) {
+        memcpy(&record, data, sizeof(result_record_t));
+        return data + sizeof(result_record_t) + record.backtraceLength;
+    }
+
+    static result_t parseBinaryAlignmentRecord(const char *data, bool readCompressed = false);
+
+    static size_t countBinaryRecords(const char *data, size_t dataSize);
+
+    // reads a text or binary entry of dataSize byte (without the null byte)
+    static void readAlignmentResults(std::vector<result_t> &result, char *data, size_t dataSize, bool binary,
+                                     bool readCompressed = false);
+
     static size_t computeAlnLength(size_t anEnd, size_t start, size_t dbEnd, size_t dbStart);
 
 
@@ -113,6 +214,11 @@ private:
     // calculate the query queryProfile for SIMD registers processing 8 elements
     int maxSeqLen;
 
+    // half width of the band around the prefilter diagonal, 0 for no band
+    int bandWidth;
+    // alignments leaving the band with a score this many bits below the best one in the band are dropped
+    static const int BAND_XDROP_BITS = 25;
+
     // holds values of the current active query
     Sequence * currentQuery;
 
@@ -34,16 +34,18 @@
 SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCorrection) {
 	maxSequenceLength += 1;
 	this->aaBiasCorrection = aaBiasCorrection;
-	const int segSize = (maxSequenceLength+7)/8;
-	vHStore = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-	vHLoad  = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-	vE      = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-	vHmax   = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
+	kernel = SIMD_KERNEL(smithWatermanKernel);
+	// one segment row holds 8 or 16 bit scores for the whole query in the widest vector unit we might dispatch to
+	const size_t segBytes = ((maxSequenceLength + (MAX_VECSIZE_INT * 2) - 1) / (MAX_VECSIZE_INT * 2)) * MAX_ALIGN_INT;
+	workspace.vHStore = mem_align(MAX_ALIGN_INT, segBytes);
+	workspace.vHLoad  = mem_align(MAX_ALIGN_INT, segBytes);
+	workspace.vE      = mem_align(MAX_ALIGN_INT, segBytes);
+	workspace.vHmax   = mem_align(MAX_ALIGN_INT, segBytes);
 	profile = new s_profile();
-	profile->profile_byte = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
-	profile->profile_word = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
-	profile->profile_rev_byte = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
-	profile->profile_rev_word = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
+	profile->profile_byte = (int8_t*)mem_align(MAX_ALIGN_INT, aaSize * segBytes);
+	profile->profile_word = (int16_t*)mem_align(MAX_ALIGN_INT, aaSize * segBytes);
+	profile->profile_rev_byte = (int8_t*)mem_align(MAX_ALIGN_INT, aaSize * segBytes);
+	profile->profile_rev_word = (int16_t*)mem_align(MAX_ALIGN_INT, aaSize * segBytes);
 	profile->query_rev_sequence = new int8_t[maxSequenceLength];
 	profile->query_sequence     = new int8_t[maxSequenceLength];
 	profile->composition_bias   = new int8_t[maxSequenceLength];
@@ -54,21 +56,47 @@ SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCo
 	profile->mat                = new int8_t[maxSequenceLength * aaSize * 2];
 	tmp_composition_bias   = new float[maxSequenceLength];
 	/* array to record the largest score of each reference position */
-	maxColumn = new uint8_t[maxSequenceLength*sizeof(uint16_t)];
-	memset(maxColumn, 0, maxSequenceLength*sizeof(uint16_t));
+	workspace.maxColumn = new uint8_t[maxSequenceLength*sizeof(uint16_t)];
+	memset(workspace.maxColumn, 0, maxSequenceLength*sizeof(uint16_t));
+	workspace.bests = new alignment_end[2];
 
 	memset(profile->query_sequence, 0, maxSequenceLength * sizeof(int8_t));
 	memset(profile->query_rev_sequence, 0, maxSequenceLength * sizeof(int8_t));
 	memset(profile->mat_rev, 0, maxSequenceLength * aaSize);
 	memset(profile->composition_bias, 0, maxSequenceLength * sizeof(int8_t));
 	memset(profile->composition_bias_rev, 0, maxSequenceLength * sizeof(int8_t));
+
+	this->maxSequenceLength = maxSequenceLength;
+	batchScoreRows = NULL;
+	batchScoreRowsReady = false;
+	batchSupported = false;
+	batchH = NULL;
+	batchE = NULL;
+	batchMaxColumns = NULL;
+	batchMaxColumnsLength = 0;
+	batchResidues = NULL;
+	batchResiduesLength = 0;
+	batchCount = 0;
+	batchMaxLength = 0;
+	bandH = NULL;
+	bandF = NULL;
+	bandCapacity = 0;
+	// initial sizes of banded_sw, the cigar buffer holds at least the identical alignment of scoreIdentical
+	tracebackRowCapacity = 8;
+	tracebackHB = (int32_t*) malloc(tracebackRowCapacity * sizeof(int32_t));
+	tracebackEB = (int32_t*) malloc(tracebackRowCapacity * sizeof(int32_t));
+	tracebackHC = (int32_t*) malloc(tracebackRowCapacity * sizeof(int32_t));
+	tracebackDirectionCapacity = 1024;
+	tracebackDirection = (int8_t*) malloc(tracebackDirectionCapacity * sizeof(int8_t));
+	cigarCapacity = std::max(static_cast<int32_t>(maxSequenceLength), static_cast<int32_t>(16));
+	cigarBuffer = (uint32_t*) malloc(cigarCapacity * sizeof(uint32_t));
 }
 
 SmithWaterman::~SmithWaterman(){
-	free(vHStore);
-	free(vHLoad);
-	free(vE);
-	free(vHmax);
+	free(workspace.vHStore);
+	free(workspace.vHLoad);
+	free(workspace.vE);
+	free(workspace.vHmax);
 	free(profile->profile_byte);
 	free(profile->profile_word);
 	free(profile->profile_rev_byte);
@@ -82,47 +110,21 @@ SmithWaterman::~SmithWaterman(){
 	delete [] profile->mat_rev;
 	delete [] profile->mat;
 	delete [] tmp_composition_bias;
-	delete [] maxColumn;
+	delete [] workspace.maxColumn;
+	delete [] workspace.bests;
 	delete profile;
-}
-
-
-/* Generate query profile rearrange query sequence & calculate the weight of match/mismatch. */
-template <typename T, size_t Elements, const unsigned int type>
-void SmithWaterman::createQueryProfile(simd_int *profile, const int8_t *query_sequence, const int8_t * composition_bias, const int8_t *mat,
-									   const int32_t query_length, const int32_t aaSize, uint8_t bias,
-									   const int32_t offset, const int32_t entryLength) {
-
-	const int32_t segLen = (query_length+Elements-1)/Elements;
-	T* t = (T*)profile;
-
-	/* Generate query profile rearrange query sequence & calculate the weight of match/mismatch */
-	for (int32_t nt = 0; LIKELY(nt < aaSize); nt++) {
-//		printf("{");
-		for (int32_t i = 0; i < segLen; i ++) {
-			int32_t  j = i;
-//			printf("(");
-			for (size_t segNum = 0; LIKELY(segNum < Elements) ; segNum ++) {
-				// if will be optmized out by compiler
-				if(type == SUBSTITUTIONMATRIX) {     // substitution score for query_seq constrained by nt
-					// query_sequence starts from 1 to n
-					*t++ = ( j >= query_length) ? bias : mat[nt * aaSize + query_sequence[j + offset ]] + composition_bias[j + offset] + bias; // mat[nt][q[j]] mat eq 20*20
-//					printf("(%1d, %1d) ", query_sequence[j ], *(t-1));
-
-				} if(type == PROFILE) {
-					// profile starts by 0
-					*t++ = ( j >= query_length) ? bias : mat[nt * entryLength  + (j + (offset - 1) )] + bias; //mat eq L*20  // mat[nt][j]
-//					printf("(%1d, %1d) ", j , *(t-1));
-				}
-				j += segLen;
-			}
-//			printf(")");
-		}
-//		printf("}\n");
-	}
-//	printf("\n");
-//	std::flush(std::cout);
-
+	free(batchScoreRows);
+	free(batchH);
+	free(batchE);
+	free(batchMaxColumns);
+	free(batchResidues);
+	free(bandH);
+	free(bandF);
+	free(tracebackHB);
+	free(tracebackEB);
+	free(tracebackHC);
+	free(tracebackDirection);
+	free(cigarBuffer);
 }
 
 
@@ -135,12 +137,13 @@ s_align SmithWaterman::ssw_align (
 		const double  evalueThr,
 		EvalueComputation * evaluer,
 		const int covMode, const float covThr,
-		const int32_t maskLen) {
+		const int32_t maskLen,
+		const alignment_end *forward) {
 
 	alignment_end* bests = 0, *bests_reverse = 0;
 	int32_t word = 0, query_length = profile->query_length;
 	int32_t band_width = 0;
-	cigar* path;
+	int32_t cigarLen = 0;
 	s_align r;
 	r.dbStartPos1 = -1;
 	r.qStartPos1 = -1;
@@ -151,35 +154,48 @@ s_align SmithWaterman::ssw_align (
 	//}
 
 	// Find the alignment scores and ending positions
-	if (profile->profile_byte) {
-		bests = sw_sse2_byte(db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_byte, -1, profile->bias, maskLen);
-
-		if (profile->profile_word && bests[0].score == 255) {
-			free(bests);
-			bests = sw_sse2_word(db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_word, -1, maskLen);
+	if (forward != NULL && forward->score < INT16_MAX) {
+		// computed by the inter-sequence kernel, the striped kernels continue with the byte or word profile
+		word = (forward->score + profile->bias >= 255) ? 1 : 0;
+		r.score1 = forward->score;
+		r.dbEndPos1 = forward->ref;
+		r.qEndPos1 = forward->read;
+		if (maskLen >= 15) {
+			r.score2 = forward[1].score;
+			r.ref_end2 = forward[1].ref;
+		} else {
+			r.score2 = 0;
+			r.ref_end2 = -1;
+		}
+	} else {
+		if (profile->profile_byte) {
+			bests = kernel->swByte(workspace, db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_byte, -1, profile->bias, maskLen);
+
+			if (profile->profile_word && bests[0].score == 255) {
+				bests = kernel->swWord(workspace, db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_word, -1, maskLen);
+				word = 1;
+			} else if (bests[0].score == 255) {
+				fprintf(stderr, "Please set 2 to the score_size parameter of the function ssw_init, otherwise the alignment results will be incorrect.\n");
+				EXIT(EXIT_FAILURE);
+			}
+		}else if (profile->profile_word) {
+			bests = kernel->swWord(workspace, db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_word, -1, maskLen);
 			word = 1;
-		} else if (bests[0].score == 255) {
-			fprintf(stderr, "Please set 2 to the score_size parameter of the function ssw_init, otherwise the alignment results will be incorrect.\n");
+		}else {
+			fprintf(stderr, "Please call the function ssw_init before ssw_align.\n");
 			EXIT(EXIT_FAILURE);
 		}
-	}else if (profile->profile_word) {
-		bests = sw_sse2_word(db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_word, -1, maskLen);
-		word = 1;
-	}else {
-		fprintf(stderr, "Please call the function ssw_init before ssw_align.\n");
-		EXIT(EXIT_FAILURE);
-	}
-	r.score1 = bests[0].score;
-	r.dbEndPos1 = bests[0].ref;
-	r.qEndPos1 = bests[0].read;
-	if (maskLen >= 15) {
-		r.score2 = bests[1].score;
-		r.ref_end2 = bests[1].ref;
-	} else {
-		r.score2 = 0;
-		r.ref_end2 = -1;
+		r.score1 = bests[0].score;
+		r.dbEndPos1 = bests[0].ref;
+		r.qEndPos1 = bests[0].read;
+		if (maskLen >= 15) {
+			r.score2 = bests[1].score;
+			r.ref_end2 = bests[1].ref;
+		} else {
+			r.score2 = 0;
+			r.ref_end2 = -1;
+		}
 	}
-	free(bests);
 	int32_t queryOffset = query_length - r.qEndPos1;
 	r.evalue = evaluer->computeEvalue(r.score1, query_length);
 	bool hasLowerEvalue = r.evalue > evalueThr;
@@ -194,27 +210,32 @@ s_align SmithWaterman::ssw_align (
 	// Find the beginning position of the best alignment.
 	if (word == 0) {
 		if(profile->sequence_type == Sequence::HMM_PROFILE || profile->sequence_type == Sequence::PROFILE_STATE_PROFILE) {
-			createQueryProfile<int8_t, VECSIZE_INT * 4, PROFILE>(profile->profile_rev_byte, profile->query_rev_sequence, NULL, profile->mat_rev,
-																 r.qEndPos1 + 1, profile->alphabetSize, profile->bias, queryOffset, profile->query_length);
+			kernel->createQueryProfileByte(profile->profile_rev_byte, profile->query_rev_sequence, NULL, profile->mat_rev,
+			                               r.qEndPos1 + 1, profile->alphabetSize, profile->bias, queryOffset, profile->query_length, true);
 		}else{
-			createQueryProfile<int8_t, VECSIZE_INT * 4, SUBSTITUTIONMATRIX>(profile->profile_rev_byte, profile->query_rev_sequence, profile->composition_bias_rev, profile->mat,
-																			r.qEndPos1 + 1, profile->alphabetSize, profile->bias, queryOffset, 0);
+			kernel->createQueryProfileByte(profile->profile_rev_byte, profile->query_rev_sequence, profile->composition_bias_rev, profile->mat,
+			                               r.qEndPos1 + 1, profile->alphabetSize, profile->bias, queryOffset, 0, false);
 		}
-		bests_reverse = sw_sse2_byte(db_sequence, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, gap_open, gap_extend, profile->profile_rev_byte,
+		bests_reverse = kernel->swByte(workspace, db_sequence, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, gap_open, gap_extend, profile->profile_rev_byte,
 									 r.score1, profile->bias, maskLen);
 	} else {
 		if(profile->sequence_type == Sequence::HMM_PROFILE || profile->sequence_type == Sequence::PROFILE_STATE_PROFILE) {
-			createQueryProfile<int16_t, VECSIZE_INT * 2, PROFILE>(profile->profile_rev_word, profile->query_rev_sequence, NULL, profile->mat_rev,
-																  r.qEndPos1 + 1, profile->alphabetSize, 0, queryOffset, profile->query_length);
+			kernel->createQueryProfileWord(profile->profile_rev_word, profile->query_rev_sequence, NULL, profile->mat_rev,
+			                               r.qEndPos1 + 1, profile->alphabetSize, 0, queryOffset, profile->query_length, true);
 
 		}else{
-			createQueryProfile<int16_t, VECSIZE_INT * 2, SUBSTITUTIONMATRIX>(profile->profile_rev_word, profile->query_rev_sequence, profile->composition_bias_rev, profile->mat,
-																			 r.qEndPos1 + 1, profile->alphabetSize, 0, queryOffset, 0);
+			kernel->createQueryProfileWord(profile->profile_rev_word, profile->query_rev_sequence, profile->composition_bias_rev, profile->mat,
+			                               r.qEndPos1 + 1, profile->alphabetSize, 0, queryOffset, 0, false);
 		}
-		bests_reverse = sw_sse2_word(db_sequence, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, gap_open, gap_extend, profile->profile_rev_word,
+		bests_reverse = kernel->swWord(workspace, db_sequence, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, gap_open, gap_extend, profile->profile_rev_word,
 									 r.score1, maskLen);
 	}
 	if(bests_reverse->score != r.score1){
+		if (forward != NULL) {
+			// the inter-sequence kernel allows a deletion next to an insertion, the striped kernel does not
+			// repeat the alignment with the striped forward pass
+			return ssw_align(db_sequence, db_length, gap_open, gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, maskLen, NULL);
+		}
 		fprintf(stderr, "Score of forward/backward SW differ. This should not happen.\n");
 		EXIT(EXIT_FAILURE);
 	}
@@ -224,7 +245,6 @@ s_align SmithWaterman::ssw_align (
 	r.qCov = computeCov(r.qStartPos1, r.qEndPos1, query_length);
 	r.tCov = computeCov(r.dbStartPos1, r.dbEndPos1, db_length);
 	hasLowerCoverage = !(Util::hasCoverage(covThr, covMode, r.qCov, r.tCov));
-	free(bests_reverse);
 	if (alignmentMode == 1 || hasLowerCoverage) // just start and end point are needed
 		goto end;
 
@@ -234,25 +254,22 @@ s_align SmithWaterman::ssw_align (
 	band_width = abs(db_length - query_length) + 1;
 
 	if(profile->sequence_type == Sequence::HMM_PROFILE || profile->sequence_type == Sequence::PROFILE_STATE_PROFILE) {
-		path = banded_sw<PROFILE>(db_sequence + r.dbStartPos1, profile->query_sequence + r.qStartPos1,
+		cigarLen = banded_sw<PROFILE>(db_sequence + r.dbStartPos1, profile->query_sequence + r.qStartPos1,
 				NULL, db_length, query_length,
 				r.qStartPos1, r.score1, gap_open, gap_extend, band_width,
 				profile->mat, profile->query_length);
 	}else {
-		path = banded_sw<SUBSTITUTIONMATRIX>(db_sequence + r.dbStartPos1,
+		cigarLen = banded_sw<SUBSTITUTIONMATRIX>(db_sequence + r.dbStartPos1,
 				profile->query_sequence + r.qStartPos1,
 				profile->composition_bias + r.qStartPos1,
 				db_length, query_length, r.qStartPos1, r.score1,
 				gap_open, gap_extend, band_width,
 				profile->mat, profile->alphabetSize);
 	}
-	if (path == 0) {
-		;
+	if (cigarLen > 0) {
+		r.cigar = cigarBuffer;
+		r.cigarLen = cigarLen;
 	}
-	else {
-		r.cigar = path->seq;
-		r.cigarLen = path->length;
-	}	delete(path);
 
 
 	end:
@@ -261,6 +278,79 @@ s_align SmithWaterman::ssw_align (
 
 
 
+bool SmithWaterman::ssw_banded_forward(const int *db_sequence, int32_t db_length, int32_t diagonal, int32_t band_width,
+									   const uint8_t gap_open, const uint8_t gap_extend, int32_t xdrop, alignment_end *end) {
+	const int32_t query_length = profile->query_length;
+	const int32_t minusInf = -(INT16_MAX + gap_open);
+	while (true) {
+		// the striped pass computes a vector of query positions per target position
+		const int64_t width = 2 * static_cast<int64_t>(band_width) + 1;
+		if (width * BAND_CELL_COST * kernel->vectorSize > db_length) {
+			return false;
+		}
+		if (width + 1 > bandCapacity) {
+			bandCapacity = static_cast<int32_t>(width + 1);
+			bandH = (int32_t*) realloc(bandH, bandCapacity * sizeof(int32_t));
+			bandF = (int32_t*) realloc(bandF, bandCapacity * sizeof(int32_t));
+			Util::checkAllocation(bandH, "Can not allocate bandH memory in SmithWaterman::ssw_banded_forward");
+			Util::checkAllocation(bandF, "Can not allocate bandF memory in SmithWaterman::ssw_banded_forward");
+		}
+		// bandH[k] and bandF[k] hold the cell (i, i - diagonal - band_width + k), the last element stays outside of the band
+		for (int32_t k = 0; k <= width; k++) {
+			bandH[k] = 0;
+			bandF[k] = minusInf;
+		}
+		const int32_t last = static_cast<int32_t>(width - 1);
+		int32_t best = 0;
+		int32_t bestQuery = 0;
+		int32_t bestDb = 0;
+		// best score on the border of the band
+		int32_t border = 0;
+		const int32_t queryStart = std::max(0, diagonal - band_width);
+		const int32_t queryEnd = std::min(query_length - 1, db_length - 1 + diagonal + band_width);
+		for (int32_t i = queryStart; i <= queryEnd; i++) {
+			const int32_t dbOffset = i - diagonal - band_width;
+			const int32_t kStart = std::max(0, -dbOffset);
+			const int32_t kEnd = std::min(last, db_length - 1 - dbOffset);
+			// cells of the band outside of the matrix
+			for (int32_t k = 0; k < kStart; k++) {
+				bandH[k] = 0;
+				bandF[k] = minusInf;
+			}
+			for (int32_t k = kEnd + 1; k <= last; k++) {
+				bandH[k] = 0;
+				bandF[k] = minusInf;
+			}
+			int32_t h = 0;
+			int32_t e = minusInf;
+			for (int32_t k = kStart; k <= kEnd; k++) {
+				const int32_t j = dbOffset + k;
+				e = std::max(h - gap_open, e - gap_extend);
+				const int32_t f = std::max(bandH[k + 1] - gap_open, bandF[k + 1] - gap_extend);
+				h = bandH[k] + profile->profile_word_linear[db_sequence[j]][i];
+				h = std::max(std::max(h, 0), std::max(e, f));
+				bandH[k] = h;
+				bandF[k] = f;
+				// same ending position as the striped pass: first target position, then first query position
+				if (h > best || (h == best && (j < bestDb || (j == bestDb && i < bestQuery)))) {
+					best = h;
+					bestQuery = i;
+					bestDb = j;
+				}
+			}
+			border = std::max(border, std::max(bandH[kStart] * (kStart == 0), bandH[kEnd] * (kEnd == last)));
+		}
+		// alignments leaving the band are lost, unless they dropped more than xdrop below the best score
+		if (best > 0 && border + xdrop <= best) {
+			end->score = static_cast<uint16_t>(std::min(best, static_cast<int32_t>(UINT16_MAX)));
+			end->ref = bestDb;
+			end->read = bestQuery;
+			return true;
+		}
+		band_width *= 2;
+	}
+}
+
 char SmithWaterman::cigar_int_to_op (uint32_t cigar_int)
 {
 	uint8_t letter_code = cigar_int & 0xfU;
@@ -289,407 +379,6 @@ uint32_t SmithWaterman::cigar_int_to_len (uint32_t cigar_int)
 	return res;
 }
 
-SmithWaterman::alignment_end* SmithWaterman::sw_sse2_byte (const int* db_sequence,
-														   int8_t ref_dir,	// 0: forward ref; 1: reverse ref
-														   int32_t db_length,
-														   int32_t query_length,
-														   const uint8_t gap_open, /* will be used as - */
-														   const uint8_t gap_extend, /* will be used as - */
-														   const simd_int* query_profile_byte,
-														   uint8_t terminate,	/* the best alignment score: used to terminate
-                                                         the matrix calculation when locating the
-                                                         alignment beginning point. If this score
-                                                         is set to 0, it will not be used */
-														   uint8_t bias,  /* Shift 0 point to a positive value. */
-														   int32_t maskLen) {
-#define max16(m, vm) ((m) = simdi8_hmax((vm)));
-
-	uint8_t max = 0;		                     /* the max alignment score */
-	int32_t end_query = query_length - 1;
-	int32_t end_db = -1; /* 0_based best alignment ending point; Initialized as isn't aligned -1. */
-	const int SIMD_SIZE = VECSIZE_INT * 4;
-	int32_t segLen = (query_length + SIMD_SIZE-1) / SIMD_SIZE; /* number of segment */
-	/* array to record the largest score of each reference position */
-	memset(this->maxColumn, 0, db_length * sizeof(uint8_t));
-	uint8_t * maxColumn = (uint8_t *) this->maxColumn;
-
-	/* Define 16 byte 0 vector. */
-	simd_int vZero = simdi32_set(0);
-	simd_int* pvHStore = vHStore;
-	simd_int* pvHLoad = vHLoad;
-	simd_int* pvE = vE;
-	simd_int* pvHmax = vHmax;
-	memset(pvHStore,0,segLen*sizeof(simd_int));
-	memset(pvHLoad,0,segLen*sizeof(simd_int));
-	memset(pvE,0,segLen*sizeof(simd_int));
-	memset(pvHmax,0,segLen*sizeof(simd_int));
-
-	int32_t i, j;
-	/* 16 byte insertion begin vector */
-	simd_int vGapO = simdi8_set(gap_open);
-
-	/* 16 byte insertion extension vector */
-	simd_int vGapE = simdi8_set(gap_extend);
-
-	/* 16 byte bias vector */
-	simd_int vBias = simdi8_set(bias);
-
-	simd_int vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
-	simd_int vMaxMark = vZero; /* Trace the highest score till the previous column. */
-	simd_int vTemp;
-	int32_t edge, begin = 0, end = db_length, step = 1;
-	//	int32_t distance = query_length * 2 / 3;
-	//	int32_t distance = query_length / 2;
-	//	int32_t distance = query_length;
-
-	/* outer loop to process the reference sequence */
-	if (ref_dir == 1) {
-		begin = db_length - 1;
-		end = -1;
-		step = -1;
-	}
-	for (i = begin; LIKELY(i != end); i += step) {
-		simd_int e, vF = vZero, vMaxColumn = vZero; /* Initialize F value to 0.
-                                                    Any errors to vH values will be corrected in the Lazy_F loop.
-                                                    */
-		//		max16(maxColumn[i], vMaxColumn);
-		//		fprintf(stderr, "middle[%d]: %d\n", i, maxColumn[i]);
-
-		simd_int vH = pvHStore[segLen - 1];
-		vH = simdi8_shiftl (vH, 1); /* Shift the 128-bit value in vH left by 1 byte. */
-		const simd_int* vP = query_profile_byte + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
-		//	int8_t* t;
-		//	int32_t ti;
-		//        fprintf(stderr, "i: %d of %d:\t ", i,segLen);
-		//for (t = (int8_t*)vP, ti = 0; ti < segLen; ++ti) fprintf(stderr, "%d\t", *t++);
-		//fprintf(stderr, "\n");
-
-		/* Swap the 2 H buffers. */
-		simd_int* pv = pvHLoad;
-		pvHLoad = pvHStore;
-		pvHStore = pv;
-
-		/* inner loop to process the query sequence */
-		for (j = 0; LIKELY(j < segLen); ++j) {
-			vH = simdui8_adds(vH, simdi_load(vP + j));
-			vH = simdui8_subs(vH, vBias); /* vH will be always > 0 */
-			//	max16(maxColumn[i], vH);
-			//	fprintf(stderr, "H[%d]: %d\n", i, maxColumn[i]);
-			//	int8_t* t;
-			//	int32_t ti;
-			//for (t = (int8_t*)&vH, ti = 0; ti < 16; ++ti) fprintf(stderr, "%d\t", *t++);
-
-			/* Get max from vH, vE and vF. */
-			e = simdi_load(pvE + j);
-			vH = simdui8_max(vH, e);
-			vH = simdui8_max(vH, vF);
-			vMaxColumn = simdui8_max(vMaxColumn, vH);
-
-			//	max16(maxColumn[i], vMaxColumn);
-			//	fprintf(stderr, "middle[%d]: %d\n", i, maxColumn[i]);
-			//	for (t = (int8_t*)&vMaxColumn, ti = 0; ti < 16; ++ti) fprintf(stderr, "%d\t", *t++);
-
-			/* Save vH values. */
-			simdi_store(pvHStore + j, vH);
-
-			/* Update vE value. */
-			vH = simdui8_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
-			e = simdui8_subs(e, vGapE);
-			e = simdui8_max(e, vH);
-			simdi_store(pvE + j, e);
-
-			/* Update vF value. */
-			vF = simdui8_subs(vF, vGapE);
-			vF = simdui8_max(vF, vH);
-
-			/* Load the next vH. */
-			vH = simdi_load(pvHLoad + j);
-		}
-
-		/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
-		/* reset pointers to the start of the saved data */
-		j = 0;
-		vH = simdi_load (pvHStore + j);
-
-		/*  the computed vF value is for the given column.  since */
-		/*  we are at the end, we need to shift the vF value over */
-		/*  to the next column. */
-		vF = simdi8_shiftl (vF, 1);
-		vTemp = simdui8_subs (vH, vGapO);
-		vTemp = simdui8_subs (vF, vTemp);
-		vTemp = simdi8_eq (vTemp, vZero);
-		uint32_t cmp = simdi8_movemask (vTemp);
-#ifdef AVX2
-		while (cmp != 0xffffffff)
-#else
-			while (cmp != 0xffff)
-#endif
-		{
-			vH = simdui8_max (vH, vF);
-			vMaxColumn = simdui8_max(vMaxColumn, vH);
-			simdi_store (pvHStore + j, vH);
-			vF = simdui8_subs (vF, vGapE);
-			j++;
-			if (j >= segLen)
-			{
-				j = 0;
-				vF = simdi8_shiftl (vF, 1);
-			}
-			vH = simdi_load (pvHStore + j);
-
-			vTemp = simdui8_subs (vH, vGapO);
-			vTemp = simdui8_subs (vF, vTemp);
-			vTemp = simdi8_eq (vTemp, vZero);
-			cmp  = simdi8_movemask (vTemp);
-		}
-
-		vMaxScore = simdui8_max(vMaxScore, vMaxColumn);
-		vTemp = simdi8_eq(vMaxMark, vMaxScore);
-		cmp = simdi8_movemask(vTemp);
-#ifdef AVX2
-		if (cmp != 0xffffffff)
-#else
-			if (cmp != 0xffff)
-#endif
-		{
-			uint8_t temp;
-			vMaxMark = vMaxScore;
-			max16(temp, vMaxScore);
-			vMaxScore = vMaxMark;
-
-			if (LIKELY(temp > max)) {
-				max = temp;
-				if (max + bias >= 255) break;	//overflow
-				end_db = i;
-
-				/* Store the column with the highest alignment score in order to trace the alignment ending position on read. */
-				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
-			}
-		}
-
-		/* Record the max score of current column. */
-		max16(maxColumn[i], vMaxColumn);
-		//		fprintf(stderr, "maxColumn[%d]: %d\n", i, maxColumn[i]);
-		if (maxColumn[i] == terminate) break;
-	}
-
-	/* Trace the alignment ending position on read. */
-	uint8_t *t = (uint8_t*)pvHmax;
-	int32_t column_len = segLen * SIMD_SIZE;
-	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
-		int32_t temp;
-		if (*t == max) {
-			temp = i / SIMD_SIZE + i % SIMD_SIZE * segLen;
-			if (temp < end_query) end_query = temp;
-		}
-	}
-
-	/* Find the most possible 2nd best alignment. */
-	alignment_end* bests = (alignment_end*) calloc(2, sizeof(alignment_end));
-	bests[0].score = max + bias >= 255 ? 255 : max;
-	bests[0].ref = end_db;
-	bests[0].read = end_query;
-
-	bests[1].score = 0;
-	bests[1].ref = 0;
-	bests[1].read = 0;
-
-	edge = (end_db - maskLen) > 0 ? (end_db - maskLen) : 0;
-	for (i = 0; i < edge; i ++) {
-		//			fprintf (stderr, "maxColumn[%d]: %d\n", i, maxColumn[i]);
-		if (maxColumn[i] > bests[1].score) {
-			bests[1].score = maxColumn[i];
-			bests[1].ref = i;
-		}
-	}
-	edge = (end_db + maskLen) > db_length ? db_length : (end_db + maskLen);
-	for (i = edge + 1; i < db_length; i ++) {
-		//			fprintf (stderr, "db_length: %d\tmaxColumn[%d]: %d\n", db_length, i, maxColumn[i]);
-		if (maxColumn[i] > bests[1].score) {
-			bests[1].score = maxColumn[i];
-			bests[1].ref = i;
-		}
-	}
-
-	return bests;
-#undef max16
-}
-
-
-SmithWaterman::alignment_end* SmithWaterman::sw_sse2_word (const int* db_sequence,
-														   int8_t ref_dir,	// 0: forward ref; 1: reverse ref
-														   int32_t db_length,
-														   int32_t query_lenght,
-														   const uint8_t gap_open, /* will be used as - */
-														   const uint8_t gap_extend, /* will be used as - */
-														   const simd_int*query_profile_word,
-														   uint16_t terminate,
-														   int32_t maskLen) {
-
-#define max8(m, vm) ((m) = simdi16_hmax((vm)));
-
-	uint16_t max = 0;		                     /* the max alignment score */
-	int32_t end_read = query_lenght - 1;
-	int32_t end_ref = 0; /* 1_based best alignment ending point; Initialized as isn't aligned - 0. */
-	const unsigned int SIMD_SIZE = VECSIZE_INT * 2;
-	int32_t segLen = (query_lenght + SIMD_SIZE-1) / SIMD_SIZE; /* number of segment */
-	/* array to record the alignment read ending position of the largest score of each reference position */
-	memset(this->maxColumn, 0, db_length * sizeof(uint16_t));
-	uint16_t * maxColumn = (uint16_t *) this->maxColumn;
-
-	/* Define 16 byte 0 vector. */
-	simd_int vZero = simdi32_set(0);
-	simd_int* pvHStore = vHStore;
-	simd_int* pvHLoad = vHLoad;
-	simd_int* pvE = vE;
-	simd_int* pvHmax = vHmax;
-	memset(pvHStore,0,segLen*sizeof(simd_int));
-	memset(pvHLoad,0, segLen*sizeof(simd_int));
-	memset(pvE,0,     segLen*sizeof(simd_int));
-	memset(pvHmax,0,  segLen*sizeof(simd_int));
-
-	int32_t i, j, k;
-	/* 16 byte insertion begin vector */
-	simd_int vGapO = simdi16_set(gap_open);
-
-	/* 16 byte insertion extension vector */
-	simd_int vGapE = simdi16_set(gap_extend);
-
-	simd_int vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
-	simd_int vMaxMark = vZero; /* Trace the highest score till the previous column. */
-	simd_int vTemp;
-	int32_t edge, begin = 0, end = db_length, step = 1;
-
-	/* outer loop to process the reference sequence */
-	if (ref_dir == 1) {
-		begin = db_length - 1;
-		end = -1;
-		step = -1;
-	}
-	for (i = begin; LIKELY(i != end); i += step) {
-		simd_int e, vF = vZero; /* Initialize F value to 0.
-                                Any errors to vH values will be corrected in the Lazy_F loop.
-                                */
-		simd_int vH = pvHStore[segLen - 1];
-		vH = simdi8_shiftl (vH, 2); /* Shift the 128-bit value in vH left by 2 byte. */
-
-		/* Swap the 2 H buffers. */
-		simd_int* pv = pvHLoad;
-
-		simd_int vMaxColumn = vZero; /* vMaxColumn is used to record the max values of column i. */
-
-		const simd_int* vP = query_profile_word + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
-		pvHLoad = pvHStore;
-		pvHStore = pv;
-
-		/* inner loop to process the query sequence */
-		for (j = 0; LIKELY(j < segLen); j ++) {
-			vH = simdi16_adds(vH, simdi_load(vP + j));
-
-			/* Get max from vH, vE and vF. */
-			e = simdi_load(pvE + j);
-			vH = simdi16_max(vH, e);
-			vH = simdi16_max(vH, vF);
-			vMaxColumn = simdi16_max(vMaxColumn, vH);
-
-			/* Save vH values. */
-			simdi_store(pvHStore + j, vH);
-
-			/* Update vE value. */
-			vH = simdui16_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
-			e = simdui16_subs(e, vGapE);
-			e = simdi16_max(e, vH);
-			simdi_store(pvE + j, e);
-
-			/* Update vF value. */
-			vF = simdui16_subs(vF, vGapE);
-			vF = simdi16_max(vF, vH);
-
-			/* Load the next vH. */
-			vH = simdi_load(pvHLoad + j);
-		}
-
-		/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
-		for (k = 0; LIKELY(k < (int32_t) SIMD_SIZE); ++k) {
-			vF = simdi8_shiftl (vF, 2);
-			for (j = 0; LIKELY(j < segLen); ++j) {
-				vH = simdi_load(pvHStore + j);
-				vH = simdi16_max(vH, vF);
-                                vMaxColumn = simdi16_max(vMaxColumn, vH); //newly added line
-				simdi_store(pvHStore + j, vH);
-				vH = simdui16_subs(vH, vGapO);
-				vF = simdui16_subs(vF, vGapE);
-				if (UNLIKELY(! simdi8_movemask(simdi16_gt(vF, vH)))) goto end;
-			}
-		}
-
-		end:
-		vMaxScore = simdi16_max(vMaxScore, vMaxColumn);
-		vTemp = simdi16_eq(vMaxMark, vMaxScore);
-		int32_t cmp = simdi8_movemask(vTemp);
-#ifdef AVX2
-		if (cmp != (int32_t)0xffffffff)
-#else
-			if (cmp != 0xffff)
-#endif
-		{
-			uint16_t temp;
-			vMaxMark = vMaxScore;
-			max8(temp, vMaxScore);
-			vMaxScore = vMaxMark;
-
-			if (LIKELY(temp > max)) {
-				max = temp;
-				end_ref = i;
-				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
-			}
-		}
-
-		/* Record the max score of current column. */
-		max8(maxColumn[i], vMaxColumn);
-		if (maxColumn[i] == terminate) break;
-	}
-
-	/* Trace the alignment ending position on read. */
-	uint16_t *t = (uint16_t*)pvHmax;
-	int32_t column_len = segLen * SIMD_SIZE;
-	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
-		int32_t temp;
-		if (*t == max) {
-			temp = i / SIMD_SIZE + i % SIMD_SIZE * segLen;
-			if (temp < end_read) end_read = temp;
-		}
-	}
-
-	/* Find the most possible 2nd best alignment. */
-	SmithWaterman::alignment_end* bests = (alignment_end*) calloc(2, sizeof(alignment_end));
-	bests[0].score = max;
-	bests[0].ref = end_ref;
-	bests[0].read = end_read;
-
-	bests[1].score = 0;
-	bests[1].ref = 0;
-	bests[1].read = 0;
-
-	edge = (end_ref - maskLen) > 0 ? (end_ref - maskLen) : 0;
-	for (i = 0; i < edge; i ++) {
-		if (maxColumn[i] > bests[1].score) {
-			bests[1].score = maxColumn[i];
-			bests[1].ref = i;
-		}
-	}
-	edge = (end_ref + maskLen) > db_length ? db_length : (end_ref + maskLen);
-	for (i = edge; i < db_length; i ++) {
-		if (maxColumn[i] > bests[1].score) {
-			bests[1].score = maxColumn[i];
-			bests[1].ref = i;
-		}
-	}
-
-	return bests;
-#undef max8
-}
-
 void SmithWaterman::ssw_init (const Sequence* q,
 							  const int8_t* mat,
 							  const BaseMatrix *m,
@@ -743,14 +432,14 @@ void SmithWaterman::ssw_init (const Sequence* q,
 		bias = abs(bias) + abs(compositionBias);
 		profile->bias = bias;
 		if(q->getSequenceType() == Sequence::HMM_PROFILE || q->getSequenceType() == Sequence::PROFILE_STATE_PROFILE){
-			createQueryProfile<int8_t, VECSIZE_INT * 4, PROFILE>(profile->profile_byte, profile->query_sequence, NULL, profile->mat, q->L, alphabetSize, bias, 1, q->L);
+			kernel->createQueryProfileByte(profile->profile_byte, profile->query_sequence, NULL, profile->mat, q->L, alphabetSize, bias, 1, q->L, true);
 		}else{
-			createQueryProfile<int8_t, VECSIZE_INT * 4, SUBSTITUTIONMATRIX>(profile->profile_byte, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, bias, 0, 0);
+			kernel->createQueryProfileByte(profile->profile_byte, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, bias, 0, 0, false);
 		}
 	}
 	if (score_size == 1 || score_size == 2) {
 		if(q->getSequenceType() == Sequence::HMM_PROFILE || q->getSequenceType() == Sequence::PROFILE_STATE_PROFILE){
-			createQueryProfile<int16_t, VECSIZE_INT * 2, PROFILE>(profile->profile_word, profile->query_sequence, NULL, profile->mat, q->L, alphabetSize, 0, 1, q->L);
+			kernel->createQueryProfileWord(profile->profile_word, profile->query_sequence, NULL, profile->mat, q->L, alphabetSize, 0, 1, q->L, true);
 			for(int32_t i = 0; i< alphabetSize; i++) {
 				profile->profile_word_linear[i] = &profile_word_linear_data[i*q->L];
 				for (int j = 0; j < q->L; j++) {
@@ -759,7 +448,7 @@ void SmithWaterman::ssw_init (const Sequence* q,
 				}
 			}
 		}else{
-			createQueryProfile<int16_t, VECSIZE_INT * 2, SUBSTITUTIONMATRIX>(profile->profile_word, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, 0, 0, 0);
+			kernel->createQueryProfileWord(profile->profile_word, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, 0, 0, 0, false);
 			for(int32_t i = 0; i< alphabetSize; i++) {
 				profile->profile_word_linear[i] = &profile_word_linear_data[i*q->L];
 				for (int j = 0; j < q->L; j++) {
@@ -783,9 +472,10 @@ void SmithWaterman::ssw_init (const Sequence* q,
 	}
 	profile->query_length = q->L;
 	profile->alphabetSize = alphabetSize;
+	batchScoreRowsReady = false;
 }
 template <const unsigned int type>
-SmithWaterman::cigar * SmithWaterman::banded_sw(const int *db_sequence, const int8_t *query_sequence, const int8_t * compositionBias,
+int32_t SmithWaterman::banded_sw(const int *db_sequence, const int8_t *query_sequence, const int8_t * compositionBias,
 												int32_t db_length, int32_t query_length, int32_t queryStart,
 												int32_t score, const uint32_t gap_open,
 												const uint32_t gap_extend, int32_t band_width, const int8_t *mat, int32_t n) {
@@ -802,18 +492,16 @@ SmithWaterman::cigar * SmithWaterman::banded_sw(const int *db_sequence, const in
 	/* Convert the coordinate in the direction matrix into the coordinate in one line of the band. */
 #define set_d(u, w, i, j, p) { int x=(i)-(w); x=x>0?x:0; x=(j)-x; (u)=x*3+p; }
 
-	uint32_t *c = (uint32_t*)malloc(16 * sizeof(uint32_t)), *c1;
-	int32_t i, j, e, f, temp1, temp2, s = 16, s1 = 8, l, max = 0;
-	int64_t s2 = 1024;
+	// the buffers are members, so they only grow for the longest alignment so far
+	uint32_t *&c = cigarBuffer;
+	int32_t &s = cigarCapacity, &s1 = tracebackRowCapacity;
+	int64_t &s2 = tracebackDirectionCapacity;
+	int32_t *&h_b = tracebackHB, *&e_b = tracebackEB, *&h_c = tracebackHC;
+	int8_t *&direction = tracebackDirection;
+	int32_t i, j, e, f, temp1, temp2, l, max = 0;
 	char op, prev_op;
 	int64_t width, width_d;
-	int32_t *h_b, *e_b, *h_c;
-	int8_t *direction, *direction_line;
-	cigar* result = new cigar();
-	h_b = (int32_t*)malloc(s1 * sizeof(int32_t));
-	e_b = (int32_t*)malloc(s1 * sizeof(int32_t));
-	h_c = (int32_t*)malloc(s1 * sizeof(int32_t));
-	direction = (int8_t*)malloc(s2 * sizeof(int8_t));
+	int8_t *direction_line;
 
 	do {
 		width = band_width * 2 + 3, width_d = band_width * 2 + 1;
@@ -926,12 +614,6 @@ SmithWaterman::cigar * SmithWaterman::banded_sw(const int *db_sequence, const in
 				break;
 			default:
 				fprintf(stderr, "Trace back error: %d.\n", direction_line[temp1 - 1]);
-				free(direction);
-				free(h_c);
-				free(e_b);
-				free(h_b);
-				free(c);
-				delete result;
 				return 0;
 		}
 		if (op == prev_op) ++e;
@@ -967,24 +649,8 @@ SmithWaterman::cigar * SmithWaterman::banded_sw(const int *db_sequence, const in
 	}
 
 	// reverse cigar
-	c1 = (uint32_t*)new uint32_t[l * sizeof(uint32_t)];
-	s = 0;
-	e = l - 1;
-	while (LIKELY(s <= e)) {
-		c1[s] = c[e];
-		c1[e] = c[s];
-		++ s;
-		-- e;
-	}
-	result->seq = c1;
-	result->length = l;
-
-	free(direction);
-	free(h_c);
-	free(e_b);
-	free(h_b);
-	free(c);
-	return result;
+	std::reverse(c, c + l);
+	return l;
 #undef kroundup32
 #undef set_u
 #undef set_d
@@ -1086,7 +752,12 @@ s_align SmithWaterman::scoreIdentical(int *dbSeq, int L, EvalueComputation * eva
 	r.cigarLen = L;
 	r.qCov =  1.0;
 	r.tCov = 1.0;
-	r.cigar = new uint32_t[L];
+	if (L > cigarCapacity) {
+		cigarCapacity = L;
+		cigarBuffer = (uint32_t*) realloc(cigarBuffer, cigarCapacity * sizeof(uint32_t));
+		Util::checkAllocation(cigarBuffer, "Can not allocate cigarBuffer memory in SmithWaterman::scoreIdentical");
+	}
+	r.cigar = cigarBuffer;
 	short score = 0;
 	for(int pos = 0; pos < L; pos++){
 		int currScore = profile->profile_word_linear[dbSeq[pos]][pos];
@@ -1100,62 +771,82 @@ s_align SmithWaterman::scoreIdentical(int *dbSeq, int L, EvalueComputation * eva
 }
 
 int SmithWaterman::ungapped_alignment(const int *db_sequence, int32_t db_length) {
-#define SWAP(tmp, arg1, arg2) tmp = arg1; arg1 = arg2; arg2 = tmp;
-
-	int i; // position in query bands (0,..,W-1)
-	int j; // position in db sequence (0,..,dbseq_length-1)
-	int element_count = (VECSIZE_INT * 4);
-	const int W = (profile->query_length + (element_count - 1)) / element_count; // width of bands in query and score matrix = hochgerundetes LQ/16
-
-	simd_int *p;
-	simd_int S;              // 16 unsigned bytes holding S(b*W+i,j) (b=0,..,15)
-	simd_int Smax = simdi_setzero();
-	simd_int Soffset; // all scores in query profile are shifted up by Soffset to obtain pos values
-	simd_int *s_prev, *s_curr; // pointers to Score(i-1,j-1) and Score(i,j), resp.
-	simd_int *qji;             // query profile score in row j (for residue x_j)
-	simd_int *s_prev_it, *s_curr_it;
-	simd_int *query_profile_it = (simd_int *) profile->profile_byte;
-
-	// Load the score offset to all 16 unsigned byte elements of Soffset
-	Soffset = simdi8_set(profile->bias);
-	s_curr = vHStore;
-	s_prev = vHLoad;
-
-	memset(vHStore,0,W*sizeof(simd_int));
-	memset(vHLoad,0,W*sizeof(simd_int));
-
-	for (j = 0; j < db_length; ++j) // loop over db sequence positions
-	{
-
-		// Get address of query scores for row j
-		qji = query_profile_it + db_sequence[j] * W;
-
-		// Load the next S value
-		S = simdi_load(s_curr + W - 1);
-		S = simdi8_shiftl(S, 1);
+	return kernel->ungappedAlignment(workspace, db_sequence, db_length, profile->profile_byte, profile->query_length, profile->bias);
+}
 
-		// Swap s_prev and s_curr, smax_prev and smax_curr
-		SWAP(p, s_prev, s_curr);
+void SmithWaterman::ssw_batch_add(const int *db_sequence, int32_t db_length) {
+	const unsigned int batchSize = kernel->batchSize;
+	if (db_length > batchResiduesLength) {
+		batchResidues = (uint8_t*) realloc(batchResidues, static_cast<size_t>(db_length) * batchSize * sizeof(uint8_t));
+		Util::checkAllocation(batchResidues, "Can not allocate batchResidues memory in SmithWaterman::ssw_batch_add");
+		batchResiduesLength = db_length;
+	}
+	for (int32_t i = 0; i < db_length; i++) {
+		batchResidues[i * batchSize + batchCount] = static_cast<uint8_t>(db_sequence[i]);
+	}
+	batchLengths[batchCount] = static_cast<int16_t>(db_length);
+	batchMaxLength = std::max(batchMaxLength, db_length);
+	batchCount++;
+}
 
-		s_curr_it = s_curr;
-		s_prev_it = s_prev;
+bool SmithWaterman::initBatchScoreRows() {
+	const int32_t query_length = profile->query_length;
+	const int32_t alphabetSize = profile->alphabetSize;
+	if (query_length >= INT16_MAX || alphabetSize > BATCH_ROW_SIZE) {
+		return false;
+	}
+	if (batchScoreRows == NULL) {
+		batchScoreRows = (int8_t*) mem_align(MAX_ALIGN_INT, maxSequenceLength * BATCH_ROW_SIZE);
+		// H and E hold one vector per query position
+		batchH = mem_align(MAX_ALIGN_INT, maxSequenceLength * MAX_ALIGN_INT);
+		batchE = mem_align(MAX_ALIGN_INT, maxSequenceLength * MAX_ALIGN_INT);
+	}
+	const bool isProfile = profile->sequence_type == Sequence::HMM_PROFILE || profile->sequence_type == Sequence::PROFILE_STATE_PROFILE;
+	for (int32_t j = 0; j < query_length; j++) {
+		int8_t *row = batchScoreRows + j * BATCH_ROW_SIZE;
+		memset(row, 0, BATCH_ROW_SIZE);
+		for (int32_t aa = 0; aa < alphabetSize; aa++) {
+			// same scores as the word profile of createQueryProfile
+			const int32_t score = (isProfile)
+			                      ? profile->mat[aa * query_length + j]
+			                      : profile->mat[aa * alphabetSize + profile->query_sequence[j]] + profile->composition_bias[j];
+			if (score < INT8_MIN || score > INT8_MAX) {
+				return false;
+			}
+			row[aa] = static_cast<int8_t>(score);
+		}
+	}
+	return true;
+}
 
-		for (i = 0; i < W; ++i) // loop over query band positions
-		{
-			// Saturated addition and subtraction to score S(i,j)
-			S = simdui8_adds(S, *(qji++)); // S(i,j) = S(i-1,j-1) + (q(i,x_j) + Soffset)
-			S = simdui8_subs(S, Soffset);       // S(i,j) = max(0, S(i,j) - Soffset)
-			simdi_store(s_curr_it++, S);       // store S to s_curr[i]
-			Smax = simdui8_max(Smax, S);       // Smax(i,j) = max(Smax(i,j), S(i,j))
+bool SmithWaterman::ssw_batch_align(const uint8_t gap_open, const uint8_t gap_extend, const int32_t maskLen, alignment_end *ends) {
+	const unsigned int count = batchCount;
+	const int32_t maxLength = batchMaxLength;
+	ssw_batch_clear();
+	if (batchScoreRowsReady == false) {
+		batchSupported = initBatchScoreRows();
+		batchScoreRowsReady = true;
+	}
+	if (batchSupported == false) {
+		return false;
+	}
 
-			// Load the next S and Smax values
-			S = simdi_load(s_prev_it++);
+	const unsigned int batchSize = kernel->batchSize;
+	for (unsigned int lane = count; lane < batchSize; lane++) {
+		batchLengths[lane] = 0;
+	}
+	// padding of shorter targets is never scored, but should not read uninitialized memory
+	for (unsigned int lane = 0; lane < batchSize; lane++) {
+		for (int32_t i = batchLengths[lane]; i < maxLength; i++) {
+			batchResidues[i * batchSize + lane] = 0;
 		}
 	}
-	int score = simd_hmax((unsigned char *) &Smax, element_count);
-
-	/* return largest score */
-	return score;
-#undef SWAP
+	if (maxLength > batchMaxColumnsLength) {
+		free(batchMaxColumns);
+		batchMaxColumns = mem_align(MAX_ALIGN_INT, static_cast<size_t>(maxLength) * MAX_ALIGN_INT);
+		batchMaxColumnsLength = maxLength;
+	}
+	kernel->swBatch(batchH, batchE, batchMaxColumns, batchResidues, batchLengths, maxLength, batchScoreRows, profile->query_length,
+	                gap_open, gap_extend, maskLen, ends);
+	return true;
 }
-
@@ -42,6 +42,7 @@
 #endif
 
 #include "simd.h"
+#include "SimdDispatch.h"
 #include "BaseMatrix.h"
 
 #include "Sequence.h"
@@ -65,6 +66,7 @@ typedef struct {
     int32_t ref_end2;
     float qCov;
     float tCov;
+    // owned by the aligner, valid until its next alignment
     uint32_t* cigar;
     int32_t cigarLen;
     double evalue;
@@ -72,6 +74,11 @@ typedef struct {
 
 class SmithWaterman{
 public:
+    typedef struct {
+        uint16_t score;
+        int32_t ref;	 //0-based position
+        int32_t read;    //alignment ending position on read, 0-based
+    } alignment_end;
 
     SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCorrection);
     ~SmithWaterman();
@@ -125,6 +132,10 @@ public:
      reference loci nearby (mask length = maskLen) the best alignment ending position and locates the second largest
      score from the unmasked elements.
 
+     @param	forward	the ends of a forward pass computed before, NULL to run the striped forward pass.
+     forward[0] is the best end, forward[1] the suboptimal end for maskLen as returned by ssw_batch_align.
+     forward[1] is only read if maskLen >= 15.
+
      @return	pointer to the alignment result structure
 
      @note	Whatever the parameter flag is setted, this function will at least return the optimal and sub-optimal alignment score,
@@ -140,7 +151,48 @@ public:
                         const double filters,
                         EvalueComputation * filterd,
                         const int covMode, const float covThr,
-                        const int32_t maskLen);
+                        const int32_t maskLen,
+                        const alignment_end *forward = NULL);
+
+    // number of targets aligned at once by ssw_batch_align
+    unsigned int getBatchSize() const {
+        return kernel->batchSize;
+    }
+
+    /*!	@function	Banded forward pass: computes the score and ending positions of the best alignment within band_width
+     diagonals on both sides of diagonal (query position - target position), e.g. the diagonal of the prefilter hit.
+     The band is doubled as long as a cell on its border scores less than xdrop below the best alignment,
+     since an alignment leaving the band there might end up better (X-drop criterion).
+     The ends can be passed to ssw_align as forward, it repeats the striped forward pass if the reverse pass
+     finds a better alignment. The band does not give the suboptimal alignment, ssw_align has to be called
+     with maskLen < 15 then.
+
+     @return	false if the band grew as expensive as the striped forward pass, end is not set then
+     */
+    bool ssw_banded_forward(const int *db_sequence, int32_t db_length, int32_t diagonal, int32_t band_width,
+                            const uint8_t gap_open, const uint8_t gap_extend, int32_t xdrop, alignment_end *end);
+
+    // db_length has to be smaller than INT16_MAX
+    void ssw_batch_add(const int *db_sequence, int32_t db_length);
+
+    /*!	@function	Inter-sequence alignment: computes the forward pass of ssw_align (score and ending positions)
+     for up to getBatchSize() targets at once, one target per 16 bit SIMD lane.
+     Targets are collected with ssw_batch_add and the batch is cleared by ssw_batch_align.
+     ends needs 2 * getBatchSize() entries, the best and suboptimal end (see maskLen of ssw_align) of each target
+     in the order the targets were added.
+     &ends[2 * i] can be passed to ssw_align as forward to skip the striped forward pass of target i.
+     This pays off for short queries, where the striped kernel can not fill its lanes.
+
+     @return	false if the current query can not be aligned with the inter-sequence kernel
+     (too long, alphabet larger than 32 or scores outside of 8 bit), ends are not set then
+     */
+    bool ssw_batch_align(const uint8_t gap_open, const uint8_t gap_extend, const int32_t maskLen, alignment_end *ends);
+
+    // drops the collected targets without aligning them
+    void ssw_batch_clear() {
+        batchCount = 0;
+        batchMaxLength = 0;
+    }
 
 
     /*!	@function computed ungapped alignment score
@@ -197,13 +249,106 @@ public:
     }
 
 
+    // scratch memory of the striped kernels
+    // the buffers are sized for the widest vector unit, so every kernel can use them
+    struct workspace_t {
+        void* vHStore;
+        void* vHLoad;
+        void* vE;
+        void* vHmax;
+        uint8_t * maxColumn;
+        // the two best alignment ends returned by swByte and swWord
+        alignment_end* bests;
+    };
+
+    // instruction set specific part of the alignment (StripedSmithWatermanKernel.cpp)
+    struct kernel_t {
+        // number of 8 bit elements in a vector
+        unsigned int vectorSize;
+
+        // Generate query profile rearrange query sequence & calculate the weight of match/mismatch.
+        // isProfile: mat is a L * AA profile, otherwise a AA * AA substitution matrix
+        void (*createQueryProfileByte)(int8_t *profile, const int8_t *query_sequence, const int8_t * composition_bias,
+                                       const int8_t *mat, const int32_t query_length, const int32_t aaSize, uint8_t bias,
+                                       const int32_t offset, const int32_t entryLength, bool isProfile);
+
+        void (*createQueryProfileWord)(int16_t *profile, const int8_t *query_sequence, const int8_t * composition_bias,
+                                       const int8_t *mat, const int32_t query_length, const int32_t aaSize, uint8_t bias,
+                                       const int32_t offset, const int32_t entryLength, bool isProfile);
+
+        /* Striped Smith-Waterman
+         Record the highest score of each reference position.
+         Return the alignment score and ending position of the best alignment, 2nd best alignment, etc.
+         Gap begin and gap extension are different.
+         wight_match > 0, all other weights < 0.
+         The returned positions are 0-based.
+         */
+        alignment_end* (*swByte)(const workspace_t &workspace,
+                                 const int*db_sequence,
+                                 int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+                                 int32_t db_length,
+                                 int32_t query_length,
+                                 const uint8_t gap_open, /* will be used as - */
+                                 const uint8_t gap_extend, /* will be used as - */
+                                 const int8_t* query_profile_byte,
+                                 uint8_t terminate,	/* the best alignment score: used to terminate
+                                                     the matrix calculation when locating the
+                                                     alignment beginning point. If this score
+                                                     is set to 0, it will not be used */
+                                 uint8_t bias,  /* Shift 0 point to a positive value. */
+                                 int32_t maskLen);
+
+        alignment_end* (*swWord)(const workspace_t &workspace,
+                                 const int* db_sequence,
+                                 int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+                                 int32_t db_length,
+                                 int32_t query_lenght,
+                                 const uint8_t gap_open, /* will be used as - */
+                                 const uint8_t gap_extend, /* will be used as - */
+                                 const int16_t* query_profile_word,
+                                 uint16_t terminate,
+                                 int32_t maskLen);
+
+        int (*ungappedAlignment)(const workspace_t &workspace,
+                                 const int *db_sequence,
+                                 int32_t db_length,
+                                 const int8_t *query_profile_byte,
+                                 int32_t query_length,
+                                 uint8_t bias);
+
+        // number of targets aligned at once by swBatch
+        unsigned int batchSize;
+
+        /* Inter-sequence Smith-Waterman (one target per 16 bit lane)
+         db_batch holds the residues interleaved (db_batch[i * batchSize + lane]), unused lanes have length 0.
+         score_rows holds BATCH_ROW_SIZE scores per query position, indexed by residue.
+         vMaxColumns holds one vector per target position.
+         Returns the same best and 2nd best ends as the forward pass of swByte/swWord, two ends per lane,
+         scores >= INT16_MAX overflowed.
+         */
+        void (*swBatch)(void *vH, void *vE, void *vMaxColumns,
+                        const uint8_t *db_batch,
+                        const int16_t *db_lengths,
+                        int32_t db_max_length,
+                        const int8_t *score_rows,
+                        int32_t query_length,
+                        const uint8_t gap_open,
+                        const uint8_t gap_extend,
+                        int32_t maskLen,
+                        alignment_end *ends);
+    };
+
+    // scores per query position in the inter-sequence kernel (alphabet size is at most 32)
+    static const int32_t BATCH_ROW_SIZE = 32;
+
+
 private:
 
     struct s_profile{
-        simd_int* profile_byte;	// 0: none
-        simd_int* profile_word;	// 0: none
-        simd_int* profile_rev_byte;	// 0: none
-        simd_int* profile_rev_word;	// 0: none
+        int8_t* profile_byte;	// 0: none
+        int16_t* profile_word;	// 0: none
+        int8_t* profile_rev_byte;	// 0: none
+        int16_t* profile_rev_word;	// 0: none
         int8_t* query_sequence;
         int8_t* query_rev_sequence;
         int8_t* composition_bias;
@@ -228,57 +373,14 @@ private:
         uint8_t bias;
         short ** profile_word_linear;
     };
-    simd_int* vHStore;
-    simd_int* vHLoad;
-    simd_int* vE;
-    simd_int* vHmax;
-    uint8_t * maxColumn;
-
-    typedef struct {
-        uint16_t score;
-        int32_t ref;	 //0-based position
-        int32_t read;    //alignment ending position on read, 0-based
-    } alignment_end;
-
-
-    typedef struct {
-        uint32_t* seq;
-        int32_t length;
-    } cigar;
-
-    /* Striped Smith-Waterman
-     Record the highest score of each reference position.
-     Return the alignment score and ending position of the best alignment, 2nd best alignment, etc.
-     Gap begin and gap extension are different.
-     wight_match > 0, all other weights < 0.
-     The returned positions are 0-based.
-     */
-    alignment_end* sw_sse2_byte (const int*db_sequence,
-                                 int8_t ref_dir,	// 0: forward ref; 1: reverse ref
-                                 int32_t db_length,
-                                 int32_t query_length,
-                                 const uint8_t gap_open, /* will be used as - */
-                                 const uint8_t gap_extend, /* will be used as - */
-                                 const simd_int* query_profile_byte,
-                                 uint8_t terminate,	/* the best alignment score: used to terminate
-                                                     the matrix calculation when locating the
-                                                     alignment beginning point. If this score
-                                                     is set to 0, it will not be used */
-                                 uint8_t bias,  /* Shift 0 point to a positive value. */
-                                 int32_t maskLen);
+    workspace_t workspace;
 
-    alignment_end* sw_sse2_word (const int* db_sequence,
-                                 int8_t ref_dir,	// 0: forward ref; 1: reverse ref
-                                 int32_t db_length,
-                                 int32_t query_lenght,
-                                 const uint8_t gap_open, /* will be used as - */
-                                 const uint8_t gap_extend, /* will be used as - */
-                                 const simd_int*query_profile_byte,
-                                 uint16_t terminate,
-                                 int32_t maskLen);
+    // kernels for the instruction set selected at construction
+    const kernel_t* kernel;
 
+    // returns the length of the cigar written to cigarBuffer, 0 if the traceback failed
     template <const unsigned int type>
-    SmithWaterman::cigar *banded_sw(const int *db_sequence, const int8_t *query_sequence, const int8_t * compositionBias, int32_t db_length, int32_t query_length, int32_t queryStart, int32_t score, const uint32_t gap_open, const uint32_t gap_extend, int32_t band_width, const int8_t *mat, int32_t n);
+    int32_t banded_sw(const int *db_sequence, const int8_t *query_sequence, const int8_t * compositionBias, int32_t db_length, int32_t query_length, int32_t queryStart, int32_t score, const uint32_t gap_open, const uint32_t gap_extend, int32_t band_width, const int8_t *mat, int32_t n);
 
     /*!	@function		Produce CIGAR 32-bit unsigned integer from CIGAR operation and CIGAR length
      @param	length		length of CIGAR
@@ -293,11 +395,46 @@ private:
     const static unsigned int SUBSTITUTIONMATRIX = 1;
     const static unsigned int PROFILE = 2;
 
-    template <typename T, size_t Elements, const unsigned int type>
-    void createQueryProfile(simd_int *profile, const int8_t *query_sequence, const int8_t * composition_bias, const int8_t *mat, const int32_t query_length, const int32_t aaSize, uint8_t bias, const int32_t offset, const int32_t entryLength);
-
     float *tmp_composition_bias;
     short * profile_word_linear_data;
     bool aaBiasCorrection;
+
+    // inter-sequence kernel buffers, allocated on first use
+    size_t maxSequenceLength;
+    int8_t *batchScoreRows;
+    bool batchScoreRowsReady;
+    bool batchSupported;
+    void *batchH;
+    void *batchE;
+    void *batchMaxColumns;
+    int32_t batchMaxColumnsLength;
+    uint8_t *batchResidues;
+    int32_t batchResiduesLength;
+    int16_t batchLengths[MAX_VECSIZE_INT * 2];
+    unsigned int batchCount;
+    int32_t batchMaxLength;
+
+    bool initBatchScoreRows();
+
+    // a scalar cell of the banded pass costs about as much as BAND_CELL_COST cells of a striped vector
+    static const int32_t BAND_CELL_COST = 2;
+    // rows of the banded pass, grown on demand
+    int32_t *bandH;
+    int32_t *bandF;
+    int32_t bandCapacity;
+
+    // scratch memory of banded_sw, grown on demand and kept between alignments
+    int32_t *tracebackHB;
+    int32_t *tracebackEB;
+    int32_t *tracebackHC;
+    int32_t tracebackRowCapacity;
+    int8_t *tracebackDirection;
+    int64_t tracebackDirectionCapacity;
+    // cigar of the last alignment, returned in s_align
+    uint32_t *cigarBuffer;
+    int32_t cigarCapacity;
 };
+
+SIMD_KERNEL_DECLARE(SmithWaterman::kernel_t, smithWatermanKernel)
+
 #endif /* SMITH_WATERMAN_SSE2_H */
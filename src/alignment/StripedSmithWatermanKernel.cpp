@@ -0,0 +1,710 @@
+/* The MIT License
+   Copyright (c) 2012-1015 Boston College.
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+   BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+/*
+   Written by Michael Farrar, 2006 (alignment), Mengyao Zhao (SSW Library) and Martin Steinegger (change structure add aa composition, profile and AVX2 support).
+   Please send bug reports and/or suggestions to martin.steinegger@mpibpc.mpg.de.
+*/
+
+// Instruction set specific part of the striped Smith-Waterman.
+// This file is compiled once per instruction set (see SimdDispatch.h).
+// Everything except the kernel table has internal linkage, so that the linker
+// can not mix up functions compiled for different instruction sets.
+#include "StripedSmithWaterman.h"
+
+namespace SIMD_NAMESPACE {
+namespace {
+
+typedef SmithWaterman::alignment_end alignment_end;
+typedef SmithWaterman::workspace_t workspace_t;
+
+/* Generate query profile rearrange query sequence & calculate the weight of match/mismatch. */
+template <typename T, size_t Elements, bool isProfile>
+void createQueryProfile(T *profile, const int8_t *query_sequence, const int8_t * composition_bias, const int8_t *mat,
+                        const int32_t query_length, const int32_t aaSize, uint8_t bias,
+                        const int32_t offset, const int32_t entryLength) {
+
+	const int32_t segLen = (query_length+Elements-1)/Elements;
+	T* t = profile;
+
+	/* Generate query profile rearrange query sequence & calculate the weight of match/mismatch */
+	for (int32_t nt = 0; LIKELY(nt < aaSize); nt++) {
+		for (int32_t i = 0; i < segLen; i ++) {
+			int32_t  j = i;
+			for (size_t segNum = 0; LIKELY(segNum < Elements) ; segNum ++) {
+				// if will be optmized out by compiler
+				if(isProfile == false) {     // substitution score for query_seq constrained by nt
+					// query_sequence starts from 1 to n
+					*t++ = ( j >= query_length) ? bias : mat[nt * aaSize + query_sequence[j + offset ]] + composition_bias[j + offset] + bias; // mat[nt][q[j]] mat eq 20*20
+				} else {
+					// profile starts by 0
+					*t++ = ( j >= query_length) ? bias : mat[nt * entryLength  + (j + (offset - 1) )] + bias; //mat eq L*20  // mat[nt][j]
+				}
+				j += segLen;
+			}
+		}
+	}
+}
+
+void createQueryProfileByte(int8_t *profile, const int8_t *query_sequence, const int8_t * composition_bias, const int8_t *mat,
+                            const int32_t query_length, const int32_t aaSize, uint8_t bias,
+                            const int32_t offset, const int32_t entryLength, bool isProfile) {
+	if (isProfile) {
+		createQueryProfile<int8_t, VECSIZE_INT * 4, true>(profile, query_sequence, composition_bias, mat, query_length, aaSize, bias, offset, entryLength);
+	} else {
+		createQueryProfile<int8_t, VECSIZE_INT * 4, false>(profile, query_sequence, composition_bias, mat, query_length, aaSize, bias, offset, entryLength);
+	}
+}
+
+void createQueryProfileWord(int16_t *profile, const int8_t *query_sequence, const int8_t * composition_bias, const int8_t *mat,
+                            const int32_t query_length, const int32_t aaSize, uint8_t bias,
+                            const int32_t offset, const int32_t entryLength, bool isProfile) {
+	if (isProfile) {
+		createQueryProfile<int16_t, VECSIZE_INT * 2, true>(profile, query_sequence, composition_bias, mat, query_length, aaSize, bias, offset, entryLength);
+	} else {
+		createQueryProfile<int16_t, VECSIZE_INT * 2, false>(profile, query_sequence, composition_bias, mat, query_length, aaSize, bias, offset, entryLength);
+	}
+}
+
+alignment_end* sw_sse2_byte (const workspace_t &workspace,
+                             const int* db_sequence,
+                             int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+                             int32_t db_length,
+                             int32_t query_length,
+                             const uint8_t gap_open, /* will be used as - */
+                             const uint8_t gap_extend, /* will be used as - */
+                             const int8_t* query_profile_byte,
+                             uint8_t terminate,	/* the best alignment score: used to terminate
+                                                 the matrix calculation when locating the
+                                                 alignment beginning point. If this score
+                                                 is set to 0, it will not be used */
+                             uint8_t bias,  /* Shift 0 point to a positive value. */
+                             int32_t maskLen) {
+#define max16(m, vm) ((m) = simdi8_hmax((vm)));
+
+	uint8_t max = 0;		                     /* the max alignment score */
+	int32_t end_query = query_length - 1;
+	int32_t end_db = -1; /* 0_based best alignment ending point; Initialized as isn't aligned -1. */
+	const int SIMD_SIZE = VECSIZE_INT * 4;
+	int32_t segLen = (query_length + SIMD_SIZE-1) / SIMD_SIZE; /* number of segment */
+	/* array to record the largest score of each reference position */
+	memset(workspace.maxColumn, 0, db_length * sizeof(uint8_t));
+	uint8_t * maxColumn = (uint8_t *) workspace.maxColumn;
+
+	/* Define 16 byte 0 vector. */
+	simd_int vZero = simdi32_set(0);
+	simd_int* pvHStore = (simd_int*) workspace.vHStore;
+	simd_int* pvHLoad = (simd_int*) workspace.vHLoad;
+	simd_int* pvE = (simd_int*) workspace.vE;
+	simd_int* pvHmax = (simd_int*) workspace.vHmax;
+	memset(pvHStore,0,segLen*sizeof(simd_int));
+	memset(pvHLoad,0,segLen*sizeof(simd_int));
+	memset(pvE,0,segLen*sizeof(simd_int));
+	memset(pvHmax,0,segLen*sizeof(simd_int));
+
+	int32_t i, j;
+	/* 16 byte insertion begin vector */
+	simd_int vGapO = simdi8_set(gap_open);
+
+	/* 16 byte insertion extension vector */
+	simd_int vGapE = simdi8_set(gap_extend);
+
+	/* 16 byte bias vector */
+	simd_int vBias = simdi8_set(bias);
+
+	simd_int vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
+	simd_int vMaxMark = vZero; /* Trace the highest score till the previous column. */
+	simd_int vTemp;
+	int32_t edge, begin = 0, end = db_length, step = 1;
+
+	/* outer loop to process the reference sequence */
+	if (ref_dir == 1) {
+		begin = db_length - 1;
+		end = -1;
+		step = -1;
+	}
+	for (i = begin; LIKELY(i != end); i += step) {
+		simd_int e, vF = vZero, vMaxColumn = vZero; /* Initialize F value to 0.
+                                                    Any errors to vH values will be corrected in the Lazy_F loop.
+                                                    */
+
+		simd_int vH = pvHStore[segLen - 1];
+		vH = simdi8_shiftl (vH, 1); /* Shift the 128-bit value in vH left by 1 byte. */
+		const simd_int* vP = (const simd_int*) query_profile_byte + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
+
+		/* Swap the 2 H buffers. */
+		simd_int* pv = pvHLoad;
+		pvHLoad = pvHStore;
+		pvHStore = pv;
+
+		/* inner loop to process the query sequence */
+		for (j = 0; LIKELY(j < segLen); ++j) {
+			vH = simdui8_adds(vH, simdi_load(vP + j));
+			vH = simdui8_subs(vH, vBias); /* vH will be always > 0 */
+
+			/* Get max from vH, vE and vF. */
+			e = simdi_load(pvE + j);
+			vH = simdui8_max(vH, e);
+			vH = simdui8_max(vH, vF);
+			vMaxColumn = simdui8_max(vMaxColumn, vH);
+
+			/* Save vH values. */
+			simdi_store(pvHStore + j, vH);
+
+			/* Update vE value. */
+			vH = simdui8_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
+			e = simdui8_subs(e, vGapE);
+			e = simdui8_max(e, vH);
+			simdi_store(pvE + j, e);
+
+			/* Update vF value. */
+			vF = simdui8_subs(vF, vGapE);
+			vF = simdui8_max(vF, vH);
+
+			/* Load the next vH. */
+			vH = simdi_load(pvHLoad + j);
+		}
+
+		/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
+		/* reset pointers to the start of the saved data */
+		j = 0;
+		vH = simdi_load (pvHStore + j);
+
+		/*  the computed vF value is for the given column.  since */
+		/*  we are at the end, we need to shift the vF value over */
+		/*  to the next column. */
+		vF = simdi8_shiftl (vF, 1);
+		vTemp = simdui8_subs (vH, vGapO);
+		vTemp = simdui8_subs (vF, vTemp);
+		vTemp = simdi8_eq (vTemp, vZero);
+		simdi8_movemask_t cmp = simdi8_movemask (vTemp);
+		while (cmp != SIMDI8_MOVEMASK_ALL)
+		{
+			vH = simdui8_max (vH, vF);
+			vMaxColumn = simdui8_max(vMaxColumn, vH);
+			simdi_store (pvHStore + j, vH);
+			vF = simdui8_subs (vF, vGapE);
+			j++;
+			if (j >= segLen)
+			{
+				j = 0;
+				vF = simdi8_shiftl (vF, 1);
+			}
+			vH = simdi_load (pvHStore + j);
+
+			vTemp = simdui8_subs (vH, vGapO);
+			vTemp = simdui8_subs (vF, vTemp);
+			vTemp = simdi8_eq (vTemp, vZero);
+			cmp  = simdi8_movemask (vTemp);
+		}
+
+		vMaxScore = simdui8_max(vMaxScore, vMaxColumn);
+		vTemp = simdi8_eq(vMaxMark, vMaxScore);
+		cmp = simdi8_movemask(vTemp);
+		if (cmp != SIMDI8_MOVEMASK_ALL)
+		{
+			uint8_t temp;
+			vMaxMark = vMaxScore;
+			max16(temp, vMaxScore);
+			vMaxScore = vMaxMark;
+
+			if (LIKELY(temp > max)) {
+				max = temp;
+				if (max + bias >= 255) break;	//overflow
+				end_db = i;
+
+				/* Store the column with the highest alignment score in order to trace the alignment ending position on read. */
+				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+			}
+		}
+
+		/* Record the max score of current column. */
+		max16(maxColumn[i], vMaxColumn);
+		if (maxColumn[i] == terminate) break;
+	}
+
+	/* Trace the alignment ending position on read. */
+	uint8_t *t = (uint8_t*)pvHmax;
+	int32_t column_len = segLen * SIMD_SIZE;
+	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
+		int32_t temp;
+		if (*t == max) {
+			temp = i / SIMD_SIZE + i % SIMD_SIZE * segLen;
+			if (temp < end_query) end_query = temp;
+		}
+	}
+
+	/* Find the most possible 2nd best alignment. */
+	alignment_end* bests = workspace.bests;
+	bests[0].score = max + bias >= 255 ? 255 : max;
+	bests[0].ref = end_db;
+	bests[0].read = end_query;
+
+	bests[1].score = 0;
+	bests[1].ref = 0;
+	bests[1].read = 0;
+
+	edge = (end_db - maskLen) > 0 ? (end_db - maskLen) : 0;
+	for (i = 0; i < edge; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+	edge = (end_db + maskLen) > db_length ? db_length : (end_db + maskLen);
+	for (i = edge + 1; i < db_length; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+
+	return bests;
+#undef max16
+}
+
+
+alignment_end* sw_sse2_word (const workspace_t &workspace,
+                             const int* db_sequence,
+                             int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+                             int32_t db_length,
+                             int32_t query_lenght,
+                             const uint8_t gap_open, /* will be used as - */
+                             const uint8_t gap_extend, /* will be used as - */
+                             const int16_t* query_profile_word,
+                             uint16_t terminate,
+                             int32_t maskLen) {
+
+#define max8(m, vm) ((m) = simdi16_hmax((vm)));
+
+	uint16_t max = 0;		                     /* the max alignment score */
+	int32_t end_read = query_lenght - 1;
+	int32_t end_ref = 0; /* 1_based best alignment ending point; Initialized as isn't aligned - 0. */
+	const unsigned int SIMD_SIZE = VECSIZE_INT * 2;
+	int32_t segLen = (query_lenght + SIMD_SIZE-1) / SIMD_SIZE; /* number of segment */
+	/* array to record the alignment read ending position of the largest score of each reference position */
+	memset(workspace.maxColumn, 0, db_length * sizeof(uint16_t));
+	uint16_t * maxColumn = (uint16_t *) workspace.maxColumn;
+
+	/* Define 16 byte 0 vector. */
+	simd_int vZero = simdi32_set(0);
+	simd_int* pvHStore = (simd_int*) workspace.vHStore;
+	simd_int* pvHLoad = (simd_int*) workspace.vHLoad;
+	simd_int* pvE = (simd_int*) workspace.vE;
+	simd_int* pvHmax = (simd_int*) workspace.vHmax;
+	memset(pvHStore,0,segLen*sizeof(simd_int));
+	memset(pvHLoad,0, segLen*sizeof(simd_int));
+	memset(pvE,0,     segLen*sizeof(simd_int));
+	memset(pvHmax,0,  segLen*sizeof(simd_int));
+
+	int32_t i, j, k;
+	/* 16 byte insertion begin vector */
+	simd_int vGapO = simdi16_set(gap_open);
+
+	/* 16 byte insertion extension vector */
+	simd_int vGapE = simdi16_set(gap_extend);
+
+	simd_int vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
+	simd_int vMaxMark = vZero; /* Trace the highest score till the previous column. */
+	simd_int vTemp;
+	int32_t edge, begin = 0, end = db_length, step = 1;
+
+	/* outer loop to process the reference sequence */
+	if (ref_dir == 1) {
+		begin = db_length - 1;
+		end = -1;
+		step = -1;
+	}
+	for (i = begin; LIKELY(i != end); i += step) {
+		simd_int e, vF = vZero; /* Initialize F value to 0.
+                                Any errors to vH values will be corrected in the Lazy_F loop.
+                                */
+		simd_int vH = pvHStore[segLen - 1];
+		vH = simdi8_shiftl (vH, 2); /* Shift the 128-bit value in vH left by 2 byte. */
+
+		/* Swap the 2 H buffers. */
+		simd_int* pv = pvHLoad;
+
+		simd_int vMaxColumn = vZero; /* vMaxColumn is used to record the max values of column i. */
+
+		const simd_int* vP = (const simd_int*) query_profile_word + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
+		pvHLoad = pvHStore;
+		pvHStore = pv;
+
+		/* inner loop to process the query sequence */
+		for (j = 0; LIKELY(j < segLen); j ++) {
+			vH = simdi16_adds(vH, simdi_load(vP + j));
+
+			/* Get max from vH, vE and vF. */
+			e = simdi_load(pvE + j);
+			vH = simdi16_max(vH, e);
+			vH = simdi16_max(vH, vF);
+			vMaxColumn = simdi16_max(vMaxColumn, vH);
+
+			/* Save vH values. */
+			simdi_store(pvHStore + j, vH);
+
+			/* Update vE value. */
+			vH = simdui16_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
+			e = simdui16_subs(e, vGapE);
+			e = simdi16_max(e, vH);
+			simdi_store(pvE + j, e);
+
+			/* Update vF value. */
+			vF = simdui16_subs(vF, vGapE);
+			vF = simdi16_max(vF, vH);
+
+			/* Load the next vH. */
+			vH = simdi_load(pvHLoad + j);
+		}
+
+		/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
+		for (k = 0; LIKELY(k < (int32_t) SIMD_SIZE); ++k) {
+			vF = simdi8_shiftl (vF, 2);
+			for (j = 0; LIKELY(j < segLen); ++j) {
+				vH = simdi_load(pvHStore + j);
+				vH = simdi16_max(vH, vF);
+				vMaxColumn = simdi16_max(vMaxColumn, vH); //newly added line
+				simdi_store(pvHStore + j, vH);
+				vH = simdui16_subs(vH, vGapO);
+				vF = simdui16_subs(vF, vGapE);
+				if (UNLIKELY(! simdi8_movemask(simdi16_gt(vF, vH)))) goto end;
+			}
+		}
+
+		end:
+		vMaxScore = simdi16_max(vMaxScore, vMaxColumn);
+		vTemp = simdi16_eq(vMaxMark, vMaxScore);
+		simdi8_movemask_t cmp = simdi8_movemask(vTemp);
+		if (cmp != SIMDI8_MOVEMASK_ALL)
+		{
+			uint16_t temp;
+			vMaxMark = vMaxScore;
+			max8(temp, vMaxScore);
+			vMaxScore = vMaxMark;
+
+			if (LIKELY(temp > max)) {
+				max = temp;
+				end_ref = i;
+				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+			}
+		}
+
+		/* Record the max score of current column. */
+		max8(maxColumn[i], vMaxColumn);
+		if (maxColumn[i] == terminate) break;
+	}
+
+	/* Trace the alignment ending position on read. */
+	uint16_t *t = (uint16_t*)pvHmax;
+	int32_t column_len = segLen * SIMD_SIZE;
+	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
+		int32_t temp;
+		if (*t == max) {
+			temp = i / SIMD_SIZE + i % SIMD_SIZE * segLen;
+			if (temp < end_read) end_read = temp;
+		}
+	}
+
+	/* Find the most possible 2nd best alignment. */
+	alignment_end* bests = workspace.bests;
+	bests[0].score = max;
+	bests[0].ref = end_ref;
+	bests[0].read = end_read;
+
+	bests[1].score = 0;
+	bests[1].ref = 0;
+	bests[1].read = 0;
+
+	edge = (end_ref - maskLen) > 0 ? (end_ref - maskLen) : 0;
+	for (i = 0; i < edge; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+	edge = (end_ref + maskLen) > db_length ? db_length : (end_ref + maskLen);
+	for (i = edge; i < db_length; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+
+	return bests;
+#undef max8
+}
+
+int ungapped_alignment(const workspace_t &workspace, const int *db_sequence, int32_t db_length,
+                       const int8_t *query_profile_byte, int32_t query_length, uint8_t bias) {
+#define SWAP(tmp, arg1, arg2) tmp = arg1; arg1 = arg2; arg2 = tmp;
+
+	int i; // position in query bands (0,..,W-1)
+	int j; // position in db sequence (0,..,dbseq_length-1)
+	int element_count = (VECSIZE_INT * 4);
+	const int W = (query_length + (element_count - 1)) / element_count; // width of bands in query and score matrix = hochgerundetes LQ/16
+
+	simd_int *p;
+	simd_int S;              // 16 unsigned bytes holding S(b*W+i,j) (b=0,..,15)
+	simd_int Smax = simdi_setzero();
+	simd_int Soffset; // all scores in query profile are shifted up by Soffset to obtain pos values
+	simd_int *s_prev, *s_curr; // pointers to Score(i-1,j-1) and Score(i,j), resp.
+	const simd_int *qji;             // query profile score in row j (for residue x_j)
+	simd_int *s_prev_it, *s_curr_it;
+	const simd_int *query_profile_it = (const simd_int *) query_profile_byte;
+
+	// Load the score offset to all 16 unsigned byte elements of Soffset
+	Soffset = simdi8_set(bias);
+	s_curr = (simd_int*) workspace.vHStore;
+	s_prev = (simd_int*) workspace.vHLoad;
+
+	memset(s_curr,0,W*sizeof(simd_int));
+	memset(s_prev,0,W*sizeof(simd_int));
+
+	for (j = 0; j < db_length; ++j) // loop over db sequence positions
+	{
+
+		// Get address of query scores for row j
+		qji = query_profile_it + db_sequence[j] * W;
+
+		// Load the next S value
+		S = simdi_load(s_curr + W - 1);
+		S = simdi8_shiftl(S, 1);
+
+		// Swap s_prev and s_curr, smax_prev and smax_curr
+		SWAP(p, s_prev, s_curr);
+
+		s_curr_it = s_curr;
+		s_prev_it = s_prev;
+
+		for (i = 0; i < W; ++i) // loop over query band positions
+		{
+			// Saturated addition and subtraction to score S(i,j)
+			S = simdui8_adds(S, *(qji++)); // S(i,j) = S(i-1,j-1) + (q(i,x_j) + Soffset)
+			S = simdui8_subs(S, Soffset);       // S(i,j) = max(0, S(i,j) - Soffset)
+			simdi_store(s_curr_it++, S);       // store S to s_curr[i]
+			Smax = simdui8_max(Smax, S);       // Smax(i,j) = max(Smax(i,j), S(i,j))
+
+			// Load the next S and Smax values
+			S = simdi_load(s_prev_it++);
+		}
+	}
+	int score = simd_hmax((unsigned char *) &Smax, element_count);
+
+	/* return largest score */
+	return score;
+#undef SWAP
+}
+
+/* Score lookup of the inter-sequence kernel: every query position has a row of 32 scores,
+   indexed with the residue of the target in each lane. The bytes are widened to 16 bit lanes. */
+#if defined(AVX512)
+struct batch_index_t {
+	__m256i lo; // residue, high bit set for residues >= 16
+	__m256i hi; // residue - 16, high bit set for residues < 16
+};
+
+inline batch_index_t loadBatchIndex(const uint8_t *residues) {
+	const __m256i idx = _mm256_loadu_si256((const __m256i *) residues);
+	const __m256i highBit = _mm256_and_si256(_mm256_cmpgt_epi8(idx, _mm256_set1_epi8(15)), _mm256_set1_epi8((char) 0x80));
+	batch_index_t index;
+	index.lo = _mm256_or_si256(idx, highBit);
+	index.hi = _mm256_sub_epi8(idx, _mm256_set1_epi8(16));
+	return index;
+}
+
+inline simd_int lookupBatchScores(const int8_t *row, const batch_index_t &index) {
+	const __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *) row));
+	const __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *) (row + 16)));
+	const __m256i score = _mm256_or_si256(_mm256_shuffle_epi8(lo, index.lo), _mm256_shuffle_epi8(hi, index.hi));
+	return _mm512_cvtepi8_epi16(score);
+}
+#elif defined(NEON)
+struct batch_index_t {
+	uint8x8_t idx;
+};
+
+inline batch_index_t loadBatchIndex(const uint8_t *residues) {
+	batch_index_t index;
+	index.idx = vld1_u8(residues);
+	return index;
+}
+
+inline simd_int lookupBatchScores(const int8_t *row, const batch_index_t &index) {
+	int8x16x2_t table;
+	table.val[0] = vld1q_s8(row);
+	table.val[1] = vld1q_s8(row + 16);
+	return vreinterpretq_m128i_s16(vmovl_s8(vqtbl2_s8(table, index.idx)));
+}
+#else
+struct batch_index_t {
+	__m128i lo; // residue, high bit set for residues >= 16
+	__m128i hi; // residue - 16, high bit set for residues < 16
+};
+
+inline batch_index_t loadBatchIndex(const uint8_t *residues) {
+#ifdef AVX2
+	const __m128i idx = _mm_loadu_si128((const __m128i *) residues);
+#else
+	const __m128i idx = _mm_loadl_epi64((const __m128i *) residues);
+#endif
+	const __m128i highBit = _mm_and_si128(_mm_cmpgt_epi8(idx, _mm_set1_epi8(15)), _mm_set1_epi8((char) 0x80));
+	batch_index_t index;
+	index.lo = _mm_or_si128(idx, highBit);
+	index.hi = _mm_sub_epi8(idx, _mm_set1_epi8(16));
+	return index;
+}
+
+inline simd_int lookupBatchScores(const int8_t *row, const batch_index_t &index) {
+	const __m128i lo = _mm_load_si128((const __m128i *) row);
+	const __m128i hi = _mm_load_si128((const __m128i *) (row + 16));
+	const __m128i score = _mm_or_si128(_mm_shuffle_epi8(lo, index.lo), _mm_shuffle_epi8(hi, index.hi));
+#ifdef AVX2
+	return _mm256_cvtepi8_epi16(score);
+#else
+	return _mm_cvtepi8_epi16(score);
+#endif
+}
+#endif
+
+/* Inter-sequence Smith-Waterman with 16 bit scores, one target per lane (Rognes, SWIPE).
+   The query runs along the inner loop, so the kernel fills all lanes also for very short queries. */
+void sw_batch_word(void *vH, void *vE, void *vMaxColumns,
+                   const uint8_t *db_batch,
+                   const int16_t *db_lengths,
+                   int32_t db_max_length,
+                   const int8_t *score_rows,
+                   int32_t query_length,
+                   const uint8_t gap_open,
+                   const uint8_t gap_extend,
+                   int32_t maskLen,
+                   alignment_end *ends) {
+	const unsigned int LANES = VECSIZE_INT * 2;
+	const int32_t ROW_SIZE = SmithWaterman::BATCH_ROW_SIZE;
+	simd_int* pvH = (simd_int*) vH; // H of the previous target position for every query position
+	simd_int* pvE = (simd_int*) vE;
+	simd_int* pvMaxColumns = (simd_int*) vMaxColumns; // column maxima for the 2nd best alignment
+	memset(pvH, 0, query_length * sizeof(simd_int));
+	memset(pvE, 0, query_length * sizeof(simd_int));
+
+	const simd_int vZero = simdi_setzero();
+	const simd_int vOne = simdi16_set(1);
+	const simd_int vGapO = simdi16_set(gap_open);
+	const simd_int vGapE = simdi16_set(gap_extend);
+	const simd_int vLength = simdi_loadu((const simd_int*) db_lengths);
+
+	simd_int vMaxScore = vZero;
+	simd_int vEndRef = simdi16_set(-1);
+	simd_int vEndRead = vZero;
+	simd_int vI = vZero;
+	for (int32_t i = 0; LIKELY(i < db_max_length); i++) {
+		const batch_index_t index = loadBatchIndex(db_batch + i * LANES);
+		simd_int vHDiag = vZero;
+		simd_int vF = vZero;
+		simd_int vMaxColumn = vZero;
+		simd_int vMaxColumnRead = vZero; // first query position of the column maximum
+		simd_int vJ = vZero;
+		const int8_t *row = score_rows;
+		for (int32_t j = 0; LIKELY(j < query_length); j++) {
+			simd_int vHCur = simdi16_adds(vHDiag, lookupBatchScores(row, index));
+			simd_int e = simdi_load(pvE + j);
+			vHCur = simdi16_max(vHCur, e);
+			vHCur = simdi16_max(vHCur, vF);
+			vHCur = simdi16_max(vHCur, vZero);
+
+			// query positions only grow, so the first position of a new maximum survives the max
+			vMaxColumnRead = simdi16_max(vMaxColumnRead, simdi_and(simdi16_gt(vHCur, vMaxColumn), vJ));
+			vMaxColumn = simdi16_max(vMaxColumn, vHCur);
+
+			vHDiag = simdi_load(pvH + j);
+			simdi_store(pvH + j, vHCur);
+
+			vHCur = simdui16_subs(vHCur, vGapO);
+			e = simdi16_max(simdui16_subs(e, vGapE), vHCur);
+			simdi_store(pvE + j, e);
+			vF = simdi16_max(simdui16_subs(vF, vGapE), vHCur);
+
+			vJ = simdi16_add(vJ, vOne);
+			row += ROW_SIZE;
+		}
+
+		simdi_store(pvMaxColumns + i, vMaxColumn);
+		// record a new best score only for lanes whose target is not finished
+		const simd_int vBetter = simdi_and(simdi16_gt(vMaxColumn, vMaxScore), simdi16_gt(vLength, vI));
+		vMaxScore = simdi16_max(vMaxScore, simdi_and(vBetter, vMaxColumn));
+		vEndRef = simdi_or(simdi_and(vBetter, vI), simdi_andnot(vBetter, vEndRef));
+		vEndRead = simdi_or(simdi_and(vBetter, vMaxColumnRead), simdi_andnot(vBetter, vEndRead));
+		vI = simdi16_add(vI, vOne);
+	}
+
+	int16_t score[LANES] __attribute__((aligned(ALIGN_INT)));
+	int16_t ref[LANES] __attribute__((aligned(ALIGN_INT)));
+	int16_t read[LANES] __attribute__((aligned(ALIGN_INT)));
+	simdi_store((simd_int*) score, vMaxScore);
+	simdi_store((simd_int*) ref, vEndRef);
+	simdi_store((simd_int*) read, vEndRead);
+	const int16_t *maxColumns = (const int16_t*) pvMaxColumns;
+	for (unsigned int lane = 0; lane < LANES; lane++) {
+		alignment_end *bests = ends + 2 * lane;
+		bests[0].score = static_cast<uint16_t>(score[lane]);
+		bests[0].ref = ref[lane];
+		bests[0].read = read[lane];
+
+		// same as the striped kernels: the best column maximum at least maskLen away from the best ending
+		bests[1].score = 0;
+		bests[1].ref = 0;
+		bests[1].read = 0;
+		if (maskLen < 15) {
+			continue;
+		}
+		const int32_t length = db_lengths[lane];
+		const int32_t end_db = bests[0].ref;
+		int32_t edge = (end_db - maskLen) > 0 ? (end_db - maskLen) : 0;
+		for (int32_t i = 0; i < edge; i++) {
+			if (maxColumns[i * LANES + lane] > bests[1].score) {
+				bests[1].score = maxColumns[i * LANES + lane];
+				bests[1].ref = i;
+			}
+		}
+		edge = (end_db + maskLen) > length ? length : (end_db + maskLen);
+		for (int32_t i = edge + 1; i < length; i++) {
+			if (maxColumns[i * LANES + lane] > bests[1].score) {
+				bests[1].score = maxColumns[i * LANES + lane];
+				bests[1].ref = i;
+			}
+		}
+	}
+}
+
+}
+
+extern const SmithWaterman::kernel_t smithWatermanKernel = {
+	VECSIZE_INT * 4,
+	createQueryProfileByte,
+	createQueryProfileWord,
+	sw_sse2_byte,
+	sw_sse2_word,
+	ungapped_alignment,
+	VECSIZE_INT * 2,
+	sw_batch_word
+};
+
+}
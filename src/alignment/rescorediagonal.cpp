@@ -10,6 +10,7 @@
 #include "CovSeqidQscPercMinDiagTargetCov.out.h"
 #include "QueryMatcher.h"
 #include "NucleotideMatrix.h"
+#include "MemoryGovernor.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -96,7 +97,7 @@ int doRescorediagonal(Parameters &par,
     }
 
     Debug(Debug::INFO) << "Result database: " << par.db4 << "\n";
-    size_t totalMemory = Util::getTotalSystemMemory();
+    size_t totalMemory = MemoryGovernor::getAvailable();
     size_t flushSize = 100000000;
     if (totalMemory > resultReader.getDataSize()) {
         flushSize = resultReader.getSize();
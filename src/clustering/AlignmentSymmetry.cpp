@@ -8,6 +8,7 @@
 #include "Parameters.h"
 #include "Util.h"
 #include "Debug.h"
+#include "Matcher.h"
 
 #include <cmath>
 
@@ -21,6 +22,7 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
                                    unsigned int **elementLookupTable, unsigned short **elementScoreTable,
                                    int scoretype, size_t *offsets) {
     const size_t dbSize = seqDbr->getSize();
+    const bool binary = alnDbr->getDbtype() == Sequence::ALIGNMENT_RES_BINARY;
     const size_t flushSize = 1000000;
     size_t iterations = static_cast<int>(ceil(static_cast<double>(dbSize)/static_cast<double>(flushSize)));
     for(size_t it = 0; it < iterations; it++) {
@@ -32,9 +34,11 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
             // seqDbr is descending sorted by length
             // the assumption is that clustering is B -> B (not A -> B)
             const unsigned int clusterId = seqDbr->getDbKey(i);
-            char *data = alnDbr->getDataByDBKey(clusterId);
+            const size_t alnId = alnDbr->getId(clusterId);
+            char *data = alnDbr->getData(alnId);
+            const char *end = data + alnDbr->getSeqLens(alnId) - 1;
 
-            if (*data == '\0') { // check if file contains entry
+            if (hasElement(data, end, binary) == false) { // check if file contains entry
                 Debug(Debug::ERROR) << "ERROR: Sequence " << i
                                     << " does not contain any sequence for key " << clusterId
                                     << "!\n";
@@ -42,7 +46,7 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
             }
             size_t setSize = LEN(offsets, i);
             size_t writePos = 0;
-            while (*data != '\0') {
+            while (hasElement(data, end, binary)) {
                 if (writePos >= setSize) {
                     Debug(Debug::ERROR) << "ERROR: Set " << i
                                         << " has more elements than allocated (" << setSize
@@ -50,11 +54,18 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
                     continue;
                 }
                 char similarity[255 + 1];
-                char dbKey[255 + 1];
-                Util::parseKey(data, dbKey);
-                const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
+                unsigned int key;
+                char *next = parseElement(data, binary, key);
                 const size_t currElement = seqDbr->getId(key);
-                if (elementScoreTable != NULL) {
+                if (elementScoreTable != NULL && binary) {
+                    Matcher::result_record_t record;
+                    Matcher::readBinaryRecord(data, record);
+                    if (scoretype == Parameters::APC_ALIGNMENTSCORE) {
+                        elementScoreTable[i][writePos] = (unsigned short) record.score;
+                    } else {
+                        elementScoreTable[i][writePos] = (unsigned short) (record.seqId * 1000.0f);
+                    }
+                } else if (elementScoreTable != NULL) {
                     if (scoretype == Parameters::APC_ALIGNMENTSCORE) {
                         //column 1 = alignment score
                         Util::parseByColumnNumber(data, similarity, 1);
@@ -66,19 +77,41 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
                     }
                 }
                 if (currElement == UINT_MAX || currElement > seqDbr->getSize()) {
-                    Debug(Debug::ERROR) << "ERROR: Element " << dbKey
+                    Debug(Debug::ERROR) << "ERROR: Element " << key
                                         << " contained in some alignment list, but not contained in the sequence database!\n";
                     EXIT(EXIT_FAILURE);
                 }
                 elementLookupTable[i][writePos] = currElement;
                 writePos++;
-                data = Util::skipLine(data);
+                data = next;
             }
         }
         alnDbr->remapData();
     }
 }
 
+size_t AlignmentSymmetry::countElements(DBReader<unsigned int> *alnDbr, size_t id) {
+    char *data = alnDbr->getData(id);
+    const size_t dataSize = alnDbr->getSeqLens(id);
+    if (alnDbr->getDbtype() != Sequence::ALIGNMENT_RES_BINARY) {
+        return Util::countLines(data, dataSize);
+    }
+    return Matcher::countBinaryRecords(data, dataSize - 1);
+}
+
+char *AlignmentSymmetry::parseElement(char *data, bool binary, unsigned int &key) {
+    if (binary) {
+        Matcher::result_record_t record;
+        char *next = (char *) Matcher::readBinaryRecord(data, record);
+        key = record.dbKey;
+        return next;
+    }
+    char dbKey[255 + 1];
+    Util::parseKey(data, dbKey);
+    key = (unsigned int) strtoul(dbKey, NULL, 10);
+    return Util::skipLine(data);
+}
+
 size_t AlignmentSymmetry::findMissingLinks(unsigned int ** elementLookupTable, size_t * offsetTable, size_t dbSize, int threads) {
     // init memory for parallel merge
     unsigned int * tmpSize = new(std::nothrow) unsigned int[threads * dbSize];
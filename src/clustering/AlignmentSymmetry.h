@@ -14,6 +14,13 @@
 class AlignmentSymmetry {
 public:
     static void readInData(DBReader<unsigned int>*pReader, DBReader<unsigned int>*pDBReader, unsigned int **pInt,unsigned short**elementScoreTable, int scoretype, size_t *offsets);
+    // result lists are text lines or Sequence::ALIGNMENT_RES_BINARY records
+    static size_t countElements(DBReader<unsigned int> *alnDbr, size_t id);
+    static bool hasElement(const char *data, const char *end, bool binary) {
+        return binary ? (data < end) : (*data != '\0');
+    }
+    // returns the position of the next result
+    static char *parseElement(char *data, bool binary, unsigned int &key);
     template<typename T>
     static void computeOffsetFromCounts(T* elementSizes, size_t dbSize)  {
         size_t prevElementLength = elementSizes[0];
@@ -9,9 +9,10 @@
 Clustering::Clustering(const std::string &seqDB, const std::string &seqDBIndex,
                        const std::string &alnDB, const std::string &alnDBIndex,
                        const std::string &outDB, const std::string &outDBIndex,
-                       unsigned int maxIteration, int similarityScoreType, int threads) : maxIteration(maxIteration),
+                       unsigned int maxIteration, int similarityScoreType, int threads, bool compressed) : maxIteration(maxIteration),
                                                                similarityScoreType(similarityScoreType),
                                                                threads(threads),
+                                                               compressed(compressed),
                                                                outDB(outDB),
                                                                outDBIndex(outDBIndex) {
     Debug(Debug::INFO) << "Init...\n";
@@ -21,7 +22,12 @@ Clustering::Clustering(const std::string &seqDB, const std::string &seqDBIndex,
 
     Debug(Debug::INFO) << "Opening alignment database...\n";
     alnDbr = new DBReader<unsigned int>(alnDB.c_str(), alnDBIndex.c_str());
+    alnDbr->setBinaryResultsReadable(true);
     alnDbr->open(DBReader<unsigned int>::NOSORT);
+    if (alnDbr->getDbtype() == Sequence::PREFILTER_RES_BINARY) {
+        Debug(Debug::ERROR) << "Binary prefilter results can not be clustered, use an alignment result database.\n";
+        EXIT(EXIT_FAILURE);
+    }
 
     Debug(Debug::INFO) << "done.\n";
 }
@@ -35,7 +41,7 @@ Clustering::~Clustering() {
 void Clustering::run(int mode) {
     Timer timer;
 
-    DBWriter *dbw = new DBWriter(outDB.c_str(), outDBIndex.c_str(), 1);
+    DBWriter *dbw = new DBWriter(outDB.c_str(), outDBIndex.c_str(), 1, compressed ? DBWriter::COMPRESSED_MODE : DBWriter::ASCII_MODE);
     dbw->open();
 
     std::unordered_map<unsigned int, std::vector<unsigned int>> ret;
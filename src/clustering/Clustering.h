@@ -14,7 +14,7 @@ public:
     Clustering(const std::string &seqDB, const std::string &seqDBIndex,
                const std::string &alnResultsDB, const std::string &alnResultsDBIndex,
                const std::string &outDB, const std::string &outDBIndex,
-               unsigned int maxIteration, int similarityScoreType, int threads);
+               unsigned int maxIteration, int similarityScoreType, int threads, bool compressed);
 
     void run(int mode);
 
@@ -33,6 +33,7 @@ private:
     int similarityScoreType;
 
     int threads;
+    bool compressed;
     std::string outDB;
     std::string outDBIndex;
 };
@@ -17,6 +17,7 @@ ClusteringAlgorithms::ClusteringAlgorithms(DBReader<unsigned int>* seqDbr, DBRea
         EXIT(EXIT_FAILURE);
     }
     this->alnDbr=alnDbr;
+    this->binary = alnDbr->getDbtype() == Sequence::ALIGNMENT_RES_BINARY;
     this->dbSize=alnDbr->getSize();
     this->threads=threads;
     this->scoretype=scoretype;
@@ -43,7 +44,15 @@ std::unordered_map<unsigned int, std::vector<unsigned int>>  ClusteringAlgorithm
     if (mode==4) {
         greedyIncrementalLowMem(assignedcluster);
     }else {
-        const size_t elementCount = Util::countLines(data, dataSize);
+        size_t elementCount = 0;
+        if (alnDbr->isCompressed() || binary) {
+            // the raw data file does not contain the lines
+            for (size_t i = 0; i < dbSize; i++) {
+                elementCount += AlignmentSymmetry::countElements(alnDbr, i);
+            }
+        } else {
+            elementCount = Util::countLines(data, dataSize);
+        }
         unsigned int * elements = new(std::nothrow) unsigned int[elementCount];
         Util::checkAllocation(elements, "Could not allocate elements memory in ClusteringAlgorithms::execute");
         unsigned int ** elementLookupTable = new(std::nothrow) unsigned int*[dbSize];
@@ -282,11 +291,11 @@ void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluste
 
         const size_t alnId = alnDbr->getId(clusterKey);
         char *data = alnDbr->getData(alnId);
+        const char *end = data + alnDbr->getSeqLens(alnId) - 1;
 
-        while (*data != '\0') {
-            char dbKey[255 + 1];
-            Util::parseKey(data, dbKey);
-            const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
+        while (AlignmentSymmetry::hasElement(data, end, binary)) {
+            unsigned int key;
+            char *next = AlignmentSymmetry::parseElement(data, binary, key);
             unsigned int currElement = seqDbr->getId(key);
             unsigned int targetId;
 
@@ -296,11 +305,11 @@ void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluste
             } while (!__atomic_compare_exchange(&assignedcluster[currElement],  &targetId,  &clusterId , false,  __ATOMIC_RELAXED, __ATOMIC_RELAXED));
 
             if (currElement == UINT_MAX || currElement > seqDbr->getSize()) {
-                Debug(Debug::ERROR) << "ERROR: Element " << dbKey
+                Debug(Debug::ERROR) << "ERROR: Element " << key
                                     << " contained in some alignment list, but not contained in the sequence database!\n";
                 EXIT(EXIT_FAILURE);
             }
-            data = Util::skipLine(data);
+            data = next;
         }
     }
 
@@ -311,11 +320,11 @@ void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluste
 
         const size_t alnId = alnDbr->getId(clusterKey);
         char *data = alnDbr->getData(alnId);
+        const char *end = data + alnDbr->getSeqLens(alnId) - 1;
 
-        while (*data != '\0') {
-            char dbKey[255 + 1];
-            Util::parseKey(data, dbKey);
-            const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
+        while (AlignmentSymmetry::hasElement(data, end, binary)) {
+            unsigned int key;
+            char *next = AlignmentSymmetry::parseElement(data, binary, key);
             unsigned int currElement = seqDbr->getId(key);
             unsigned int targetId;
 
@@ -325,11 +334,11 @@ void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluste
             } while (!__atomic_compare_exchange(&assignedcluster[currElement],  &targetId,  &clusterId , false,  __ATOMIC_RELAXED, __ATOMIC_RELAXED));
 
             if (currElement == UINT_MAX || currElement > seqDbr->getSize()) {
-                Debug(Debug::ERROR) << "ERROR: Element " << dbKey
+                Debug(Debug::ERROR) << "ERROR: Element " << key
                                     << " contained in some alignment list, but not contained in the sequence database!\n";
                 EXIT(EXIT_FAILURE);
             }
-            data = Util::skipLine(data);
+            data = next;
         }
     }
 
@@ -372,9 +381,7 @@ void ClusteringAlgorithms::readInClusterData(unsigned int **elementLookupTable,
     for(size_t i = 0; i < dbSize; i++) {
         const unsigned int clusterId = seqDbr->getDbKey(i);
         const size_t alnId = alnDbr->getId(clusterId);
-        const char *data = alnDbr->getData(alnId);
-        const size_t dataSize = alnDbr->getSeqLens(alnId);
-        elementOffsets[i] = Util::countLines(data, dataSize);
+        elementOffsets[i] = AlignmentSymmetry::countElements(alnDbr, alnId);
     }
 
     // make offset table
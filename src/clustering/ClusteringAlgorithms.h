@@ -22,7 +22,8 @@ private:
     DBReader<unsigned int>* seqDbr;
 
     DBReader<unsigned int>* alnDbr;
-
+    // alnDbr contains Sequence::ALIGNMENT_RES_BINARY records
+    bool binary;
 
     int threads;
     int scoretype;
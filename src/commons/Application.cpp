@@ -28,13 +28,13 @@ void checkCpu() {
         Debug(Debug::ERROR) << "64 bit system is required to run MMseqs.\n";
         EXIT(EXIT_FAILURE);
     }
-#ifdef SEE
+#ifdef SSE
     if(info.HW_SSE41 == false) {
         Debug(Debug::ERROR) << "SSE4.1 is required to run MMseqs.\n";
         EXIT(EXIT_FAILURE);
     }
 #endif
-#ifdef AVX2
+#if defined(AVX2) && !defined(RUNTIME_DISPATCH)
     if(info.HW_AVX2 == false){
         Debug(Debug::ERROR) << "Your machine does not support AVX2.\n";
         if(info.HW_SSE41 == true) {
@@ -14,6 +14,8 @@
 #include <algorithm>
 #include <fcntl.h>
 #include <limits.h>
+#include <errno.h>
+#include <vector>
 
 #include "Debug.h"
 #include "Util.h"
@@ -144,6 +146,90 @@ public:
     }
 
 
+    // chunks of the input files are copied independently by all threads
+    static const size_t PARALLEL_CHUNK_SIZE = 32 * 1024 * 1024;
+
+    /* Copy LENGTH bytes at IN_OFFSET of INPUT_DESC to OUT_OFFSET of OUT_DESC
+       without moving the file positions. The kernel copies the data if
+       copy_file_range is available, otherwise it goes through BUF. */
+    static void copyRange(int input_desc, off_t in_offset, int out_desc, off_t out_offset, size_t length,
+                          char *buf, size_t bufsize) {
+#ifdef HAVE_COPY_FILE_RANGE
+        while (length > 0) {
+            loff_t in = in_offset;
+            loff_t out = out_offset;
+            ssize_t n_copied = copy_file_range(input_desc, &in, out_desc, &out, std::min(length, (size_t) INT_MAX), 0);
+            if (n_copied < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n_copied <= 0) {
+                // e.g. not supported between these file systems, copy the rest through the buffer
+                break;
+            }
+            in_offset += n_copied;
+            out_offset += n_copied;
+            length -= n_copied;
+        }
+#endif
+        while (length > 0) {
+            ssize_t n_read = pread(input_desc, buf, std::min(length, bufsize), in_offset);
+            if (n_read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n_read <= 0) {
+                Debug(Debug::ERROR) << "read error nr: " << errno << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            ssize_t n_written = 0;
+            while (n_written < n_read) {
+                ssize_t result = pwrite(out_desc, buf + n_written, n_read - n_written, out_offset + n_written);
+                if (result < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (result <= 0) {
+                    Debug(Debug::ERROR) << "write error\n";
+                    EXIT(EXIT_FAILURE);
+                }
+                n_written += result;
+            }
+            in_offset += n_read;
+            out_offset += n_read;
+            length -= n_read;
+        }
+    }
+
+    /* Concatenate the N input files of SIZES byte into OUT_DESC. The output
+       is sized first and each thread copies chunks to their final offset. */
+    static void concatFilesParallel(const int *input_descs, const size_t *sizes, size_t n, int out_desc) {
+        // (file, offset in file, offset in output)
+        std::vector<std::pair<size_t, std::pair<size_t, size_t> > > chunks;
+        size_t out_offset = 0;
+        for (size_t fileIdx = 0; fileIdx < n; fileIdx++) {
+            for (size_t offset = 0; offset < sizes[fileIdx]; offset += PARALLEL_CHUNK_SIZE) {
+                chunks.push_back(std::make_pair(fileIdx, std::make_pair(offset, out_offset + offset)));
+            }
+            out_offset += sizes[fileIdx];
+        }
+        if (ftruncate(out_desc, out_offset) != 0) {
+            Debug(Debug::ERROR) << "Could not resize output file to " << out_offset << " byte\n";
+            EXIT(EXIT_FAILURE);
+        }
+
+#pragma omp parallel
+        {
+            const size_t bufsize = 1024 * 1024;
+            char *buf = (char *) mem_align(getpagesize(), bufsize);
+#pragma omp for schedule(dynamic, 1)
+            for (size_t i = 0; i < chunks.size(); i++) {
+                const size_t fileIdx = chunks[i].first;
+                const size_t offset = chunks[i].second.first;
+                const size_t length = std::min(PARALLEL_CHUNK_SIZE, sizes[fileIdx] - offset);
+                copyRange(input_descs[fileIdx], offset, out_desc, chunks[i].second.second, length, buf, bufsize);
+            }
+            free(buf);
+        }
+    }
+
     static bool doConcat(int input_desc, int out_desc, const char *buf, size_t bufsize) {
         while (true) {
             /* Read a block of input.  */
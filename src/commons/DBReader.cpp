@@ -4,10 +4,14 @@
 #include <fstream>
 #include <algorithm>
 #include <climits>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
 #include <cstddef>
 #include <random>
 
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <omptl/omptl_algorithm>
@@ -16,13 +20,24 @@
 #include "Debug.h"
 #include "Util.h"
 #include "FileUtil.h"
+#include "MemoryGovernor.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 template <typename T>
 DBReader<T>::DBReader(const char* dataFileName_, const char* indexFileName_, int dataMode) :
         data(NULL), dataMode(dataMode), dataFileName(strdup(dataFileName_)),
         indexFileName(strdup(indexFileName_)), size(0), dataSize(0), aaDbSize(0), lastKey(T()), closed(1), dbtype(-1),
         index(NULL), seqLens(NULL), id2local(NULL), local2id(NULL),
-        dataMapped(false), accessType(0), externalData(false), didMlock(false)
+        dataMapped(false), accessType(0), externalData(false), binaryIndexData(NULL), binaryIndexDataSize(0),
+        didMlock(false), binaryResultsReadable(false), compressed(false), decompressTable(NULL),
+        readAheadSize(0), readAheadEnd(0), readAheadBytes(0), readAheadStalls(0), reservedMemory(0)
 {}
 
 template <typename T>
@@ -30,7 +45,9 @@ DBReader<T>::DBReader(DBReader<T>::Index *index, unsigned int *seqLens, size_t s
         data(NULL), dataMode(USE_INDEX), dataFileName(NULL), indexFileName(NULL),
         size(size), dataSize(0), aaDbSize(aaDbSize), lastKey(lastKey), closed(1), dbtype(dbType),
         index(index), seqLens(seqLens), id2local(NULL), local2id(NULL),
-        dataMapped(false), accessType(NOSORT), externalData(true), didMlock(false)
+        dataMapped(false), accessType(NOSORT), externalData(true), binaryIndexData(NULL), binaryIndexDataSize(0),
+        didMlock(false), binaryResultsReadable(false), compressed(false), decompressTable(NULL),
+        readAheadSize(0), readAheadEnd(0), readAheadBytes(0), readAheadStalls(0), reservedMemory(0)
 {}
 
 template <typename T>
@@ -50,6 +67,7 @@ void DBReader<T>::readMmapedDataInMemory(){
     if ((dataMode & USE_DATA) && (dataMode & USE_FREAD) == 0) {
         Debug(Debug::INFO) << "Touch data file " << dataFileName << " ... ";
         magicBytes = Util::touchMemory(data, dataSize);
+        reserveData();
         Debug(Debug::INFO) << "Done.\n";
     }
 }
@@ -60,6 +78,7 @@ void DBReader<T>::mlock(){
         if (didMlock == false) {
             ::mlock(data, dataSize);
             didMlock = true;
+            reserveData();
         }
     }
 }
@@ -88,14 +107,24 @@ template <typename T> bool DBReader<T>::open(int accessType){
     }
 
     if (dataMode & USE_DATA) {
-        FILE* dataFile = fopen(dataFileName, "r");
-        if (dataFile == NULL) {
-            Debug(Debug::ERROR) << "Could not open data file " << dataFileName << "!\n";
+        if (isBinaryResult(dbtype) && binaryResultsReadable == false) {
+            Debug(Debug::ERROR) << "Database " << dataFileName << " contains binary results, which can not be read by this module.\n"
+                                << "Convert it with result2text first.\n";
             EXIT(EXIT_FAILURE);
         }
-        data = mmapData(dataFile, &dataSize);
-        fclose(dataFile);
-        dataMapped = true;
+        mapDataFile();
+
+        uint64_t magic = 0;
+        if (dataSize >= sizeof(uint64_t)) {
+            memcpy(&magic, data, sizeof(uint64_t));
+        }
+        compressed = (magic == CompressedEntryHeader::MAGIC);
+        if (compressed) {
+#ifndef HAVE_ZLIB
+            Debug(Debug::ERROR) << "Data file " << dataFileName << " is compressed, but MMseqs2 was compiled without zlib!\n";
+            EXIT(EXIT_FAILURE);
+#endif
+        }
     }
 
     bool isSortedById = false;
@@ -104,20 +133,28 @@ template <typename T> bool DBReader<T>::open(int accessType){
             Debug(Debug::ERROR) << "Could not open index file " << indexFileName << "!\n";
             EXIT(EXIT_FAILURE);
         }
-        size = FileUtil::countLines(indexFileName);
-        index = new Index[this->size];
-        seqLens = new unsigned int[size];
-
-        isSortedById = readIndex(indexFileName, index, seqLens);
-        if (accessType != HARDNOSORT) {
+        // the binary index is sorted by id, it does not know the line order SORT_BY_LINE maps to
+        // and HARDNOSORT keeps
+        if (accessType != SORT_BY_LINE && accessType != HARDNOSORT && openBinaryIndex()) {
+            // entries are sorted by id and aaDbSize does not depend on the order
+            isSortedById = true;
             sortIndex(isSortedById);
-        }
+        } else {
+            size = FileUtil::countLines(indexFileName);
+            index = new Index[this->size];
+            seqLens = new unsigned int[size];
 
-        // init seq lens array and dbKey mapping
-        aaDbSize = 0;
-        for (size_t i = 0; i < size; i++){
-            unsigned int size = seqLens[i];
-            aaDbSize += size;
+            isSortedById = readIndex(indexFileName, index, seqLens);
+            if (accessType != HARDNOSORT) {
+                sortIndex(isSortedById);
+            }
+
+            // init seq lens array and dbKey mapping
+            aaDbSize = 0;
+            for (size_t i = 0; i < size; i++){
+                unsigned int size = seqLens[i];
+                aaDbSize += size;
+            }
         }
     }
 
@@ -330,26 +367,131 @@ template <typename T> char* DBReader<T>::mmapData(FILE * file, size_t *dataSize)
     return ret;
 }
 
-template <typename T> void DBReader<T>::remapData(){
-    if ((dataMode & USE_DATA) && (dataMode & USE_FREAD) == 0) {
-        unmapData();
+template <typename T> char* DBReader<T>::mmapShards(const std::vector<ShardManifest::Shard> &shards, size_t *dataSize) {
+    *dataSize = shards.empty() ? 0 : shards.back().offset + shards.back().size;
+    char *ret;
+    if ((dataMode & USE_FREAD) == 0) {
+        const int mode = (dataMode & USE_WRITABLE) ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        // the gaps between the shards read as zeros
+        ret = static_cast<char*>(mmap(NULL, *dataSize, mode, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+        if (ret == MAP_FAILED) {
+            int errsv = errno;
+            Debug(Debug::ERROR) << "Failed to mmap memory dataSize=" << *dataSize << " File=" << dataFileName << ". Error " << errsv << ".\n";
+            EXIT(EXIT_FAILURE);
+        }
+        const size_t pageSize = Util::getPageSize();
+        for (size_t i = 0; i < shards.size(); i++) {
+            const ShardManifest::Shard &shard = shards[i];
+            if (shard.offset % pageSize != 0) {
+                Debug(Debug::ERROR) << "Shard " << shard.path << " of " << dataFileName << " is not aligned to the page size " << pageSize << "!\n";
+                EXIT(EXIT_FAILURE);
+            }
+            int fd = ::open(shard.path.c_str(), O_RDONLY);
+            struct stat sb;
+            if (fd < 0 || fstat(fd, &sb) < 0 || (size_t) sb.st_size != shard.size) {
+                Debug(Debug::ERROR) << "Shard " << shard.path << " of " << dataFileName << " is missing or was changed!\n";
+                EXIT(EXIT_FAILURE);
+            }
+            // the shard replaces its part of the anonymous mapping, its pages are only read when they are accessed
+            if (shard.size > 0 && mmap(ret + shard.offset, shard.size, mode, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+                int errsv = errno;
+                Debug(Debug::ERROR) << "Failed to mmap shard " << shard.path << " of " << dataFileName << ". Error " << errsv << ".\n";
+                EXIT(EXIT_FAILURE);
+            }
+            ::close(fd);
+        }
+    } else {
+        ret = static_cast<char*>(calloc(*dataSize, sizeof(char)));
+        Util::checkAllocation(ret, "Not enough system memory to read in the whole data file.");
+        for (size_t i = 0; i < shards.size(); i++) {
+            const ShardManifest::Shard &shard = shards[i];
+            FILE *file = fopen(shard.path.c_str(), "r");
+            if (file == NULL || fread(ret + shard.offset, 1, shard.size, file) != shard.size || fgetc(file) != EOF) {
+                Debug(Debug::ERROR) << "Failed to read in shard " << shard.path << " of " << dataFileName << ". Error " << errno << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            fclose(file);
+        }
+    }
+    return ret;
+}
+
+template <typename T> void DBReader<T>::reserveData() {
+    // data that is touched and locked is only counted once
+    if (reservedMemory == 0) {
+        reservedMemory = dataSize;
+        MemoryGovernor::reserve(reservedMemory);
+    }
+}
+
+template <typename T> void DBReader<T>::mapDataFile() {
+    std::vector<ShardManifest::Shard> shards;
+    if (ShardManifest::read(dataFileName, shards)) {
+        data = mmapShards(shards, &dataSize);
+    } else {
         FILE* dataFile = fopen(dataFileName, "r");
+        if (dataFile == NULL) {
+            Debug(Debug::ERROR) << "Could not open data file " << dataFileName << "!\n";
+            EXIT(EXIT_FAILURE);
+        }
         data = mmapData(dataFile, &dataSize);
         fclose(dataFile);
-        dataMapped = true;
+    }
+    dataMapped = true;
+    if (dataMode & USE_FREAD) {
+        reserveData();
+    }
+}
+
+template <typename T> void DBReader<T>::remapData(){
+    if ((dataMode & USE_DATA) && (dataMode & USE_FREAD) == 0) {
+        unmapData();
+        mapDataFile();
     }
 }
 
 template <typename T> void DBReader<T>::close(){
+    if (readAheadSize > 0) {
+        Debug(Debug::INFO) << "Read ahead " << readAheadBytes << " byte of " << dataFileName << ", "
+                           << readAheadStalls << " entries were requested before they were read ahead\n";
+        readAheadSize = 0;
+    }
     if(dataMode & USE_DATA){
         unmapData();
     }
+    if (decompressTable != NULL) {
+        for (size_t i = 0; i < decompressTable->count; i++) {
+            DecompressBuffer *buffer = decompressTable->buffers[i];
+            if (buffer == NULL) {
+                continue;
+            }
+            free(buffer->data);
+#ifdef HAVE_ZLIB
+            z_stream *stream = (z_stream *) buffer->stream;
+            if (stream != NULL) {
+                inflateEnd(stream);
+                delete stream;
+            }
+#endif
+            delete buffer;
+        }
+        retiredDecompressTables.push_back(decompressTable);
+        decompressTable = NULL;
+    }
+    for (size_t i = 0; i < retiredDecompressTables.size(); i++) {
+        delete[] retiredDecompressTables[i]->buffers;
+        delete retiredDecompressTables[i];
+    }
+    retiredDecompressTables.clear();
     if(accessType == SORT_BY_LENGTH || accessType == LINEAR_ACCCESS || accessType == SORT_BY_LINE || accessType == SHUFFLE){
         delete [] id2local;
         delete [] local2id;
     }
 
-    if(externalData == false) {
+    if (binaryIndexData != NULL) {
+        munmap(binaryIndexData, binaryIndexDataSize);
+        binaryIndexData = NULL;
+    } else if(externalData == false) {
         delete[] index;
         delete[] seqLens;
     }
@@ -383,15 +525,148 @@ template <typename T> char* DBReader<T>::getData(size_t id){
         EXIT(EXIT_FAILURE);
     }
     if(accessType == SORT_BY_LENGTH || accessType == LINEAR_ACCCESS || accessType == SORT_BY_LINE || accessType == SHUFFLE){
-        return data + index[local2id[id]].offset;
-    }else{
-        return data + index[id].offset;
+        id = local2id[id];
+    }
+    if (readAheadSize > 0) {
+        readAhead(index[id].offset);
+    }
+    if (compressed) {
+        return decompressEntry(index[id].offset);
+    }
+    return data + index[id].offset;
+}
+
+template <typename T>
+void DBReader<T>::setReadAhead(size_t readAheadSize) {
+    if ((dataMode & USE_DATA) == 0 || (dataMode & USE_FREAD) != 0 || accessType != LINEAR_ACCCESS) {
+        return;
+    }
+    // the prefetched pages compete with the memory of the caller
+    this->readAheadSize = std::min(readAheadSize, MemoryGovernor::getAvailable() / 16);
+    readAheadEnd = 0;
+    readAheadBytes = 0;
+    readAheadStalls = 0;
+    if (this->readAheadSize > 0 && size > 0) {
+        readAhead(index[local2id[0]].offset);
+        // the first entry was not read yet
+        readAheadStalls = 0;
+    }
+}
+
+template <typename T>
+void DBReader<T>::readAhead(size_t offset) {
+    size_t end = readAheadEnd;
+    if (offset >= end) {
+        __sync_fetch_and_add(&readAheadStalls, 1);
+    } else if (offset + readAheadSize / 2 < end || end == dataSize) {
+        return;
     }
+    const size_t start = std::max(offset, end);
+    const size_t newEnd = std::min(offset + readAheadSize, dataSize);
+    if (newEnd <= start || __sync_bool_compare_and_swap(&readAheadEnd, end, newEnd) == false) {
+        // another thread moved the window already
+        return;
+    }
+    // only starts reading the pages, the kernel does not wait for them
+    const size_t pageSize = Util::getPageSize();
+    const size_t pageStart = (start / pageSize) * pageSize;
+    if (madvise(data + pageStart, newEnd - pageStart, MADV_WILLNEED) == 0) {
+        __sync_fetch_and_add(&readAheadBytes, newEnd - start);
+    }
+}
+
+template <typename T>
+char* DBReader<T>::decompressEntry(size_t offset) {
+    CompressedEntryHeader header;
+    memcpy(&header, data + offset, sizeof(CompressedEntryHeader));
+    const char *entry = data + offset + sizeof(CompressedEntryHeader);
+    if (offset + sizeof(CompressedEntryHeader) + header.storedSize > dataSize) {
+        Debug(Debug::ERROR) << "Compressed entry at offset " << offset << " exceeds data file " << dataFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    DecompressBuffer &buffer = *getDecompressBuffer();
+    if (buffer.size < header.rawSize) {
+        buffer.size = std::max((size_t) header.rawSize, (size_t) (buffer.size * 1.5));
+        buffer.data = (char*) realloc(buffer.data, buffer.size);
+        Util::checkAllocation(buffer.data, "Could not allocate decompression buffer");
+    }
+
+    if (header.isStored()) {
+        memcpy(buffer.data, entry, header.rawSize);
+        return buffer.data;
+    }
+#ifdef HAVE_ZLIB
+    z_stream *stream = (z_stream *) buffer.stream;
+    if (stream == NULL) {
+        stream = new z_stream;
+        memset(stream, 0, sizeof(z_stream));
+        if (inflateInit2(stream, -MAX_WBITS) != Z_OK) {
+            Debug(Debug::ERROR) << "Could not initialize zlib for " << dataFileName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        buffer.stream = stream;
+    } else {
+        inflateReset(stream);
+    }
+    stream->next_in = (Bytef*) entry;
+    stream->avail_in = header.storedSize;
+    stream->next_out = (Bytef*) buffer.data;
+    stream->avail_out = header.rawSize;
+    if (inflate(stream, Z_FINISH) != Z_STREAM_END || stream->total_out != header.rawSize) {
+        Debug(Debug::ERROR) << "Could not decompress entry at offset " << offset << " of " << dataFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+#endif
+    return buffer.data;
+}
+
+template <typename T>
+typename DBReader<T>::DecompressBuffer *DBReader<T>::getDecompressBuffer() {
+    size_t thread_idx = 0;
+#ifdef OPENMP
+    thread_idx = static_cast<size_t>(omp_get_thread_num());
+#endif
+    // only the thread itself creates its buffer, so it can be read without a lock once it exists
+    DecompressTable *table = __atomic_load_n(&decompressTable, __ATOMIC_ACQUIRE);
+    if (table != NULL && thread_idx < table->count && table->buffers[thread_idx] != NULL) {
+        return table->buffers[thread_idx];
+    }
+
+    DecompressBuffer *buffer;
+#pragma omp critical(DBReaderDecompressTable)
+    {
+        table = decompressTable;
+        if (table == NULL || thread_idx >= table->count) {
+            DecompressTable *grown = new DecompressTable;
+            size_t threads = 1;
+#ifdef OPENMP
+            threads = static_cast<size_t>(omp_get_max_threads());
+#endif
+            grown->count = std::max(thread_idx + 1, std::max(threads, (table == NULL) ? 0 : 2 * table->count));
+            grown->buffers = new DecompressBuffer*[grown->count];
+            std::fill(grown->buffers, grown->buffers + grown->count, (DecompressBuffer*) NULL);
+            if (table != NULL) {
+                std::copy(table->buffers, table->buffers + table->count, grown->buffers);
+                // threads might still read the old table
+                retiredDecompressTables.push_back(table);
+            }
+            __atomic_store_n(&decompressTable, grown, __ATOMIC_RELEASE);
+            table = grown;
+        }
+        buffer = new DecompressBuffer;
+        buffer->data = NULL;
+        buffer->size = 0;
+        buffer->stream = NULL;
+        table->buffers[thread_idx] = buffer;
+    }
+    return buffer;
 }
 
 template <typename T>
 void DBReader<T>::touchData(size_t id) {
-    if((dataMode & USE_DATA) && (dataMode & USE_FREAD) == 0) {
+    // touching a decompressed copy would not keep anything resident
+    if((dataMode & USE_DATA) && (dataMode & USE_FREAD) == 0 && compressed == false) {
         char *data = getData(id);
         size_t size = getSeqLens(id);
         magicBytes = Util::touchMemory(data, size);
@@ -400,7 +675,10 @@ void DBReader<T>::touchData(size_t id) {
 
 template <typename T> char* DBReader<T>::getDataByDBKey(T dbKey) {
     size_t id = getId(dbKey);
-    return (id != UINT_MAX) ? data + index[id].offset : NULL;
+    if (id == UINT_MAX) {
+        return NULL;
+    }
+    return compressed ? decompressEntry(index[id].offset) : data + index[id].offset;
 }
 
 template <typename T> size_t DBReader<T>::getSize (){
@@ -446,6 +724,15 @@ template <typename T> size_t DBReader<T>::maxCount(char c) {
     checkClosed();
 
     size_t max = 0;
+    if (compressed) {
+        for (size_t id = 0; id < size; id++) {
+            const char *entry = getData(id);
+            const size_t length = getSeqLens(id);
+            max = std::max(max, (size_t) std::count(entry, entry + length, c));
+        }
+        return max;
+    }
+
     size_t count = 0;
     for (size_t i = 0; i < dataSize; ++i) {
         if (data[i] == c) {
@@ -505,6 +792,168 @@ bool DBReader<T>::readIndex(char *indexFileName, Index *index, unsigned int *ent
     return isSorted;
 }
 
+void BinaryIndexHeader::setTextIndex(const char *fileName, const struct stat &sb) {
+    textIndexSize = sb.st_size;
+#ifdef __APPLE__
+    textIndexMtimeSec = sb.st_mtimespec.tv_sec;
+    textIndexMtimeNsec = sb.st_mtimespec.tv_nsec;
+#else
+    textIndexMtimeSec = sb.st_mtim.tv_sec;
+    textIndexMtimeNsec = sb.st_mtim.tv_nsec;
+#endif
+    textIndexChecksum = checksum(fileName);
+}
+
+bool BinaryIndexHeader::matchesTextIndex(const char *fileName, const struct stat &sb) const {
+    BinaryIndexHeader current;
+    // the checksum reads the whole text index, it is only computed if size and modification time match
+    current.setTextIndex(NULL, sb);
+    return textIndexSize == current.textIndexSize
+           && textIndexMtimeSec == current.textIndexMtimeSec
+           && textIndexMtimeNsec == current.textIndexMtimeNsec
+           && textIndexChecksum == checksum(fileName);
+}
+
+uint64_t BinaryIndexHeader::checksum(const char *fileName) {
+    if (fileName == NULL) {
+        return 0;
+    }
+    FILE *file = fopen(fileName, "r");
+    if (file == NULL) {
+        return 0;
+    }
+    // hashes 8 byte words, which is much faster than parsing the text index
+    const size_t bufferWords = 128 * 1024;
+    uint64_t *buffer = new uint64_t[bufferWords];
+    uint64_t hash = 14695981039346656037ULL;
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, bufferWords * sizeof(uint64_t), file)) > 0) {
+        const size_t words = (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        memset(reinterpret_cast<char*>(buffer) + bytes, 0, words * sizeof(uint64_t) - bytes);
+        for (size_t i = 0; i < words; i++) {
+            hash = (hash ^ buffer[i]) * 1099511628211ULL;
+        }
+    }
+    delete[] buffer;
+    fclose(file);
+    return hash;
+}
+
+static const char SHARD_MANIFEST_MAGIC[] = "MMSHARDS\t1\n";
+
+bool ShardManifest::read(const char *fileName, std::vector<Shard> &shards) {
+    // only the magic is read from data files, which can be large and binary
+    std::ifstream file(fileName, std::ios::binary);
+    char magic[sizeof(SHARD_MANIFEST_MAGIC) - 1];
+    if (file.read(magic, sizeof(magic)).fail() || memcmp(magic, SHARD_MANIFEST_MAGIC, sizeof(magic)) != 0) {
+        return false;
+    }
+    std::string line;
+    shards.clear();
+    while (std::getline(file, line)) {
+        char *end;
+        Shard shard;
+        shard.offset = strtoull(line.c_str(), &end, 10);
+        if (*end == '\t') {
+            shard.size = strtoull(end + 1, &end, 10);
+        }
+        if (*end != '\t' || (shards.empty() == false && shard.offset < shards.back().offset + shards.back().size)) {
+            Debug(Debug::ERROR) << "Invalid shard manifest " << fileName << "!\n";
+            EXIT(EXIT_FAILURE);
+        }
+        shard.path = end + 1;
+        shards.push_back(shard);
+    }
+    return true;
+}
+
+void ShardManifest::write(const char *fileName, const std::vector<Shard> &shards) {
+    std::vector<Shard> previousShards;
+    read(fileName, previousShards);
+
+    // a reader might still use the shards of the current manifest, so it is replaced instead of overwritten
+    std::string tmpFileName = std::string(fileName) + ".tmp";
+    FILE *file = fopen(tmpFileName.c_str(), "w");
+    if (file == NULL) {
+        Debug(Debug::ERROR) << "Could not open shard manifest " << tmpFileName << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    fputs(SHARD_MANIFEST_MAGIC, file);
+    for (size_t i = 0; i < shards.size(); i++) {
+        fprintf(file, "%zu\t%zu\t%s\n", shards[i].offset, shards[i].size, shards[i].path.c_str());
+    }
+    if (fclose(file) != 0 || std::rename(tmpFileName.c_str(), fileName) != 0) {
+        Debug(Debug::ERROR) << "Could not move " << tmpFileName << " to " << fileName << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // mapped shards stay readable after they are removed
+    removeShards(previousShards, shards);
+}
+
+void ShardManifest::removeShards(const std::vector<Shard> &shards, const std::vector<Shard> &keep) {
+    for (size_t i = 0; i < shards.size(); i++) {
+        bool kept = false;
+        for (size_t j = 0; j < keep.size() && kept == false; j++) {
+            kept = (shards[i].path == keep[j].path);
+        }
+        if (kept == false && std::remove(shards[i].path.c_str()) != 0 && errno != ENOENT) {
+            Debug(Debug::WARNING) << "Could not remove shard " << shards[i].path << "\n";
+        }
+    }
+}
+
+template<typename T>
+bool DBReader<T>::openBinaryIndex() {
+    // only numeric keys have a fixed width
+    return false;
+}
+
+template<>
+bool DBReader<unsigned int>::openBinaryIndex() {
+    std::string binaryIndexFileName = getBinaryIndexFileName(indexFileName);
+    FILE *file = fopen(binaryIndexFileName.c_str(), "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    BinaryIndexHeader header;
+    struct stat sb;
+    struct stat textSb;
+    if (fread(&header, sizeof(BinaryIndexHeader), 1, file) != 1
+        || header.magic != BinaryIndexHeader::MAGIC || header.version != BinaryIndexHeader::VERSION
+        || fstat(fileno(file), &sb) < 0
+        || (size_t) sb.st_size != sizeof(BinaryIndexHeader) + header.size * (sizeof(Index) + sizeof(unsigned int))) {
+        Debug(Debug::WARNING) << "Binary index " << binaryIndexFileName << " is invalid. Reading " << indexFileName << " instead.\n";
+        fclose(file);
+        return false;
+    }
+    if (stat(indexFileName, &textSb) < 0 || header.matchesTextIndex(indexFileName, textSb) == false) {
+        Debug(Debug::WARNING) << "Binary index " << binaryIndexFileName << " is out of date. Reading " << indexFileName << " instead.\n";
+        fclose(file);
+        return false;
+    }
+
+    // private writable mapping, sorting modes and callers that modify the index only touch their copy of the pages
+    char *map = static_cast<char*>(mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0));
+    fclose(file);
+    if (map == MAP_FAILED) {
+        Debug(Debug::WARNING) << "Could not mmap binary index " << binaryIndexFileName << ". Error " << errno << ".\n";
+        return false;
+    }
+    binaryIndexData = map;
+    binaryIndexDataSize = sb.st_size;
+
+    size = header.size;
+    aaDbSize = header.aaDbSize;
+    lastKey = header.lastKey;
+    if (dbtype == -1) {
+        dbtype = header.dbType;
+    }
+    index = reinterpret_cast<Index*>(map + sizeof(BinaryIndexHeader));
+    seqLens = reinterpret_cast<unsigned int*>(map + sizeof(BinaryIndexHeader) + size * sizeof(Index));
+    return true;
+}
+
 template<typename T> T DBReader<T>::getLastKey() {
     return lastKey;
 }
@@ -534,6 +983,8 @@ template <typename T> void DBReader<T>::unmapData() {
         } else {
             free(data);
         }
+        MemoryGovernor::release(reservedMemory);
+        reservedMemory = 0;
         dataMapped = false;
     }
 }
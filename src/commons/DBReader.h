@@ -7,10 +7,86 @@
 //
 
 #include <cstddef>
+#include <cstdint>
 #include <utility>
 #include <string>
+#include <vector>
 #include "Sequence.h"
 
+struct stat;
+
+// Header of the binary index <index>.bin. It is followed by the Index entries sorted by id
+// and by their lengths, so that DBReader can mmap both arrays without parsing the text index.
+// The size, modification time and a checksum of the text index are recorded to detect a stale binary index.
+// The checksum catches text indices that were replaced while keeping size and modification time (e.g. cp -p).
+struct BinaryIndexHeader {
+    uint64_t magic;
+    unsigned int version;
+    int dbType;
+    size_t size;
+    size_t aaDbSize;
+    unsigned int lastKey;
+    unsigned int reserved;
+    size_t textIndexSize;
+    int64_t textIndexMtimeSec;
+    int64_t textIndexMtimeNsec;
+    uint64_t textIndexChecksum;
+
+    // "MMSIDX01"
+    static const uint64_t MAGIC = 0x3130584449534d4dULL;
+    static const unsigned int VERSION = 2;
+
+    // sb is the stat of the text index fileName
+    void setTextIndex(const char *fileName, const struct stat &sb);
+    bool matchesTextIndex(const char *fileName, const struct stat &sb) const;
+
+    // checksum of the content of fileName, 0 if it can not be read
+    static uint64_t checksum(const char *fileName);
+};
+
+// Data files written with DBWriter::COMPRESSED_MODE start with MAGIC. Each entry (including its null byte)
+// is stored as this header followed by storedSize byte of raw deflate data, or the raw entry if compressing did not
+// make it smaller. The index keeps the uncompressed entry length.
+struct CompressedEntryHeader {
+    unsigned int rawSize;
+    unsigned int storedSize;
+
+    // "\xffMMSZ01\0"
+    static const uint64_t MAGIC = 0x0031305a534d4dffULL;
+
+    bool isStored() const {
+        return storedSize >= rawSize;
+    }
+};
+
+// The data file of a sharded database (see DBWriter::SHARDED_MODE) is a text manifest starting with MAGIC
+// followed by a line "<offset>\t<size>\t<path>" per shard data file. The index offsets address the shards as if
+// they were concatenated at their offsets. Offsets are multiples of ALIGNMENT, so that DBReader can map the shards
+// next to each other and the data of the database stays one contiguous array.
+struct ShardManifest {
+    struct Shard {
+        size_t offset;
+        size_t size;
+        std::string path;
+    };
+
+    // a multiple of the page size of all supported systems
+    static const size_t ALIGNMENT = 64 * 1024;
+
+    static size_t alignOffset(size_t offset) {
+        return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    // returns false if fileName is not a manifest
+    static bool read(const char *fileName, std::vector<Shard> &shards);
+
+    // replaces the manifest fileName, shards of the previous manifest that are not in shards are removed
+    static void write(const char *fileName, const std::vector<Shard> &shards);
+
+    // removes the shard files that are not in keep
+    static void removeShards(const std::vector<Shard> &shards, const std::vector<Shard> &keep);
+};
+
 template <typename T>
 class DBReader {
 
@@ -60,6 +136,38 @@ public:
 
     size_t bsearch(const Index * index, size_t size, T value);
 
+    // entries of binary result databases are not null terminated text, so opening their data fails
+    // unless the caller can read them (see Sequence::PREFILTER_RES_BINARY), must be called before open
+    void setBinaryResultsReadable(bool readable) {
+        binaryResultsReadable = readable;
+    }
+
+    static bool isBinaryResult(int dbtype) {
+        return dbtype == Sequence::PREFILTER_RES_BINARY || dbtype == Sequence::ALIGNMENT_RES_BINARY;
+    }
+
+    // entries of a compressed data file are decompressed into a buffer of the calling thread,
+    // which stays valid until the thread reads the next entry of this reader
+    bool isCompressed() {
+        return compressed;
+    }
+
+    // LINEAR_ACCCESS: getData asks the kernel to read up to readAheadSize byte of the data file ahead of the
+    // current entry in the background, so that threads scanning a data file that is not cached do not stall
+    // on page faults. Has to be called after open, 0 disables it
+    void setReadAhead(size_t readAheadSize);
+
+    static const size_t DEFAULT_READ_AHEAD = 256 * 1024 * 1024;
+
+    size_t getReadAheadBytes() {
+        return readAheadBytes;
+    }
+
+    // number of entries that were read before they were requested from the kernel
+    size_t getReadAheadStalls() {
+        return readAheadStalls;
+    }
+
     // does a binary search in the ffindex and returns index of the entry with dbKey
     // returns UINT_MAX if the key is not contained in index
     size_t getId (T dbKey);
@@ -87,10 +195,22 @@ public:
         return dataSize;
     }
 
+    // byte of the data registered with the MemoryGovernor because they were read, touched or locked in memory
+    size_t getReservedMemory(){
+        return reservedMemory;
+    }
+
     char *mmapData(FILE *file, size_t *dataSize);
 
     bool readIndex(char *indexFileName, Index *index, unsigned int *entryLength);
 
+    // maps <index>.bin if it exists and belongs to the current text index
+    bool openBinaryIndex();
+
+    static std::string getBinaryIndexFileName(const char *indexFileName) {
+        return std::string(indexFileName) + ".bin";
+    }
+
     void readIndexId(T* id, char * line, char** cols);
 
     void readMmapedDataInMemory();
@@ -140,6 +260,8 @@ public:
             case Sequence::HMM_PROFILE: return "Profile";
             case Sequence::PROFILE_STATE_SEQ: return "Profile state";
             case Sequence::PROFILE_STATE_PROFILE: return "Profile profile";
+            case Sequence::PREFILTER_RES_BINARY: return "Binary prefilter result";
+            case Sequence::ALIGNMENT_RES_BINARY: return "Binary alignment result";
             default: return "Unknown";
         }
     }
@@ -203,6 +325,17 @@ private:
 
     void checkClosed();
 
+    char* decompressEntry(size_t offset);
+
+    void readAhead(size_t offset);
+
+    // maps the data file, or all shards of a sharded database into one range
+    void mapDataFile();
+
+    char *mmapShards(const std::vector<ShardManifest::Shard> &shards, size_t *dataSize);
+
+    void reserveData();
+
     char* data;
 
     int dataMode;
@@ -235,8 +368,41 @@ private:
 
     bool externalData;
 
+    // mapping of the binary index, index and seqLens point into it
+    char *binaryIndexData;
+    size_t binaryIndexDataSize;
+
     bool didMlock;
 
+    bool binaryResultsReadable;
+
+    bool compressed;
+    // buffer and z_stream of a thread for decompressed entries
+    struct DecompressBuffer {
+        char *data;
+        size_t size;
+        void *stream;
+    };
+    // buffers by thread number, created by the first decompression of each thread. The table is replaced by a
+    // larger one if a thread with a higher number decompresses, replaced tables are freed on close
+    struct DecompressTable {
+        size_t count;
+        DecompressBuffer **buffers;
+    };
+    DecompressTable *decompressTable;
+    std::vector<DecompressTable*> retiredDecompressTables;
+
+    DecompressBuffer *getDecompressBuffer();
+
+    // read ahead window ends at readAheadEnd, it is moved forward once an entry is in its second half
+    size_t readAheadSize;
+    size_t readAheadEnd;
+    size_t readAheadBytes;
+    size_t readAheadStalls;
+
+    // byte of the data registered with MemoryGovernor, because they were read or touched or locked in memory
+    size_t reservedMemory;
+
     // needed to prevent the compiler from optimizing away the loop
     char magicBytes;
 
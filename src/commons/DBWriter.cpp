@@ -3,21 +3,34 @@
 #include "Debug.h"
 #include "Util.h"
 #include "FileUtil.h"
+#include "MemoryGovernor.h"
 #include "Concat.h"
 #include "itoa.h"
 #include "Timer.h"
 
+#include <omptl/omptl_algorithm>
+
+#include <algorithm>
+#include <climits>
 #include <cstdlib>
 #include <cstdio>
+#include <functional>
+#include <queue>
 #include <sstream>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #ifdef OPENMP
 #include <omp.h>
 #endif
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 DBWriter::DBWriter(const char *dataFileName_, const char *indexFileName_, unsigned int threads, size_t mode)
-        : threads(threads), mode(mode) {
+        : threads(threads), mode((mode & SHARDED_MODE) != 0 ? (mode & ~SHARED_FILE_MODE) : mode) {
     dataFileName = strdup(dataFileName_);
     indexFileName = strdup(indexFileName_);
 
@@ -34,11 +47,27 @@ DBWriter::DBWriter(const char *dataFileName_, const char *indexFileName_, unsign
     offsets = new size_t[threads];
     std::fill(offsets, offsets + threads, 0);
 
-    if ((mode & BINARY_MODE) != 0) {
+    if ((mode & BINARY_MODE) != 0 || (mode & COMPRESSED_MODE) != 0) {
         datafileMode = "wb";
     } else {
         datafileMode = "w";
     }
+#ifndef HAVE_ZLIB
+    if ((mode & COMPRESSED_MODE) != 0) {
+        Debug(Debug::ERROR) << "Could not write compressed " << dataFileName << ", MMseqs2 was compiled without zlib!\n";
+        EXIT(EXIT_FAILURE);
+    }
+#endif
+
+    pendingEntries = NULL;
+    compressBuffers = NULL;
+    compressStreams = NULL;
+
+    sharedDataFile = -1;
+    sharedDataOffset = 0;
+    blockBuffers = NULL;
+    blockStarts = NULL;
+    reservedMemory = 0;
 
     closed = true;
 }
@@ -125,30 +154,62 @@ char* makeResultFilename(const char* name, size_t split) {
     return strdup(s.c_str());
 }
 
-void DBWriter::open(size_t bufferSize) {
-    for (unsigned int i = 0; i < threads; i++) {
-        dataFileNames[i] = makeResultFilename(dataFileName, i);
-        indexFileNames[i] = makeResultFilename(indexFileName, i);
-
-        dataFiles[i] = fopen(dataFileNames[i], datafileMode.c_str());
-        if (dataFiles[i] == NULL) {
-            Debug(Debug::ERROR) << "Could not open " << dataFileNames[i] << " for writing!\n";
+void DBWriter::setShardDirectories(const std::string &directories) {
+    shardDirectories.clear();
+    if (directories.empty() == false) {
+        shardDirectories = Util::split(directories, ",");
+    }
+    for (size_t i = 0; i < shardDirectories.size(); i++) {
+        if (FileUtil::directoryExists(shardDirectories[i].c_str()) == false) {
+            Debug(Debug::ERROR) << "Shard directory " << shardDirectories[i] << " does not exist!\n";
             EXIT(EXIT_FAILURE);
         }
+    }
+}
 
-        int fd = fileno(dataFiles[i]);
-        int flags;
-        if ((flags = fcntl(fd, F_GETFL, 0)) < 0 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1) {
-            Debug(Debug::ERROR) << "Could not set mode for " << dataFileNames[i] << "!\n";
-            EXIT(EXIT_FAILURE);
+std::string DBWriter::makeShardFilename(unsigned int thrIdx) {
+    // databases with the same name in different folders may share the shard directories
+    const std::string path = FileUtil::getRealPath(FileUtil::dirName(dataFileName)) + "/" + FileUtil::baseName(dataFileName);
+    std::ostringstream ss;
+    ss << shardDirectories[thrIdx % shardDirectories.size()] << "/" << FileUtil::baseName(dataFileName)
+       << "." << std::hex << (std::hash<std::string>()(path) & 0xffffffff) << std::dec << "." << thrIdx;
+    return ss.str();
+}
+
+void DBWriter::open(size_t bufferSize) {
+    for (unsigned int i = 0; i < threads; i++) {
+        if ((mode & SHARDED_MODE) != 0 && shardDirectories.empty() == false) {
+            dataFileNames[i] = strdup(makeShardFilename(i).c_str());
+        } else {
+            dataFileNames[i] = makeResultFilename(dataFileName, i);
         }
+        indexFileNames[i] = makeResultFilename(indexFileName, i);
 
-        dataFilesBuffer[i] = new char[bufferSize];
         this->bufferSize = bufferSize;
+        int flags;
+        if ((mode & SHARED_FILE_MODE) == 0) {
+            dataFiles[i] = fopen(dataFileNames[i], datafileMode.c_str());
+            if (dataFiles[i] == NULL) {
+                Debug(Debug::ERROR) << "Could not open " << dataFileNames[i] << " for writing!\n";
+                EXIT(EXIT_FAILURE);
+            }
 
-        // set buffer to 64
-        if (setvbuf(dataFiles[i], dataFilesBuffer[i], _IOFBF, bufferSize) != 0) {
-            Debug(Debug::WARNING) << "Write buffer could not be allocated (bufferSize=" << bufferSize << ")\n";
+            int fd = fileno(dataFiles[i]);
+            if ((flags = fcntl(fd, F_GETFL, 0)) < 0 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1) {
+                Debug(Debug::ERROR) << "Could not set mode for " << dataFileNames[i] << "!\n";
+                EXIT(EXIT_FAILURE);
+            }
+
+            dataFilesBuffer[i] = new char[bufferSize];
+
+            // set buffer to 64
+            if (setvbuf(dataFiles[i], dataFilesBuffer[i], _IOFBF, bufferSize) != 0) {
+                Debug(Debug::WARNING) << "Write buffer could not be allocated (bufferSize=" << bufferSize << ")\n";
+            }
+        } else {
+            // the blocks of the thread replace the file buffer
+            dataFiles[i] = NULL;
+            dataFilesBuffer[i] = NULL;
         }
 
         indexFiles[i] = fopen(indexFileNames[i], "w");
@@ -157,7 +218,7 @@ void DBWriter::open(size_t bufferSize) {
             EXIT(EXIT_FAILURE);
         }
 
-        fd = fileno(indexFiles[i]);
+        int fd = fileno(indexFiles[i]);
         if ((flags = fcntl(fd, F_GETFL, 0)) < 0 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1) {
             Debug(Debug::ERROR) << "Could not set mode for " << indexFileNames[i] << "!\n";
             EXIT(EXIT_FAILURE);
@@ -167,51 +228,134 @@ void DBWriter::open(size_t bufferSize) {
             Debug(Debug::WARNING) << "Write buffer could not be allocated (bufferSize=" << bufferSize << ")\n";
         }
 
-        if (dataFiles[i] == NULL) {
-            perror(dataFileNames[i]);
+        if (indexFiles[i] == NULL) {
+            perror(indexFileNames[i]);
             EXIT(EXIT_FAILURE);
         }
 
-        if (indexFiles[i] == NULL) {
-            perror(indexFileNames[i]);
+        if ((mode & COMPRESSED_MODE) != 0 && (mode & SHARED_FILE_MODE) == 0) {
+            const uint64_t magic = CompressedEntryHeader::MAGIC;
+            if (fwrite(&magic, sizeof(uint64_t), 1, dataFiles[i]) != 1) {
+                Debug(Debug::ERROR) << "Could not write to data file " << dataFileNames[i] << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            offsets[i] = sizeof(uint64_t);
+        }
+    }
+
+    if ((mode & SHARED_FILE_MODE) != 0) {
+        // the file of the first thread is moved to the final location in close, as with a single thread
+        sharedDataFile = ::open(dataFileNames[0], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (sharedDataFile < 0) {
+            Debug(Debug::ERROR) << "Could not open " << dataFileNames[0] << " for writing!\n";
             EXIT(EXIT_FAILURE);
         }
+        sharedDataOffset = 0;
+        if ((mode & COMPRESSED_MODE) != 0) {
+            const uint64_t magic = CompressedEntryHeader::MAGIC;
+            if (pwrite(sharedDataFile, &magic, sizeof(uint64_t), 0) != sizeof(uint64_t)) {
+                Debug(Debug::ERROR) << "Could not write to data file " << dataFileNames[0] << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            sharedDataOffset = sizeof(uint64_t);
+        }
+        blockBuffers = new std::string[threads];
+        blockStarts = new size_t[threads];
+        std::fill(blockStarts, blockStarts + threads, 0);
+        dataBlocks.assign(threads, DataBlocks());
     }
 
+    // the data buffer or block and the index file buffer of each thread
+    reservedMemory = 2 * threads * bufferSize;
+    MemoryGovernor::reserve(reservedMemory);
+
+#ifdef HAVE_ZLIB
+    if ((mode & COMPRESSED_MODE) != 0) {
+        pendingEntries = new std::string[threads];
+        compressBuffers = new std::pair<char*, size_t>[threads];
+        compressStreams = new void*[threads];
+        for (unsigned int i = 0; i < threads; i++) {
+            compressBuffers[i] = std::make_pair((char*) NULL, (size_t) 0);
+            z_stream *stream = new z_stream;
+            memset(stream, 0, sizeof(z_stream));
+            // raw deflate without zlib header and checksum, which would be a large overhead on small entries
+            if (deflateInit2(stream, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                Debug(Debug::ERROR) << "Could not initialize zlib for " << dataFileName << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            compressStreams[i] = stream;
+        }
+    }
+#endif
+
     closed = false;
 }
 
-void DBWriter::close(int dbType) {
+void DBWriter::close(int dbType, bool binaryIndex) {
     // close all datafiles
     for (unsigned int i = 0; i < threads; i++) {
-        fclose(dataFiles[i]);
+        if ((mode & SHARED_FILE_MODE) != 0) {
+            flushBlock(i, blockBuffers[i].size());
+        } else {
+            fclose(dataFiles[i]);
+        }
         fclose(indexFiles[i]);
     }
 
     if (dbType > -1){
-        std::string dataFile = dataFileName;
-        std::string dbTypeFile = (dataFile+".dbtype").c_str();
-        FILE * dbtypeDataFile = fopen(dbTypeFile.c_str(), "wb");
-        if (dbtypeDataFile == NULL) {
-            Debug(Debug::ERROR) << "Could not open data file " << dbTypeFile << "!\n";
-            EXIT(EXIT_FAILURE);
-        }
-        size_t written = fwrite(&dbType, sizeof(int), 1, dbtypeDataFile);
-        if (written != 1) {
-            Debug(Debug::ERROR) << "Could not write to data file " << dbTypeFile << "\n";
+        writeDbtypeFile(dataFileName, dbType);
+    } else if (DBReader<unsigned int>::isBinaryResult(DBReader<unsigned int>::parseDbType(dataFileName))) {
+        // text results replace binary results of an earlier run
+        FileUtil::deleteFile(std::string(dataFileName) + ".dbtype");
+    }
+
+    if ((mode & SHARED_FILE_MODE) != 0) {
+        Timer timer;
+        // a plain database replacing a sharded one would leave its shards behind
+        std::vector<ShardManifest::Shard> previousShards;
+        ShardManifest::read(dataFileName, previousShards);
+        if (::close(sharedDataFile) != 0 || std::rename(dataFileNames[0], dataFileName) != 0) {
+            Debug(Debug::ERROR) << "Could not move result " << dataFileNames[0] << " to final location " << dataFileName << "!\n";
             EXIT(EXIT_FAILURE);
         }
-        fclose(dbtypeDataFile);
+        ShardManifest::removeShards(previousShards, std::vector<ShardManifest::Shard>());
+        writeMergedIndex(indexFileName, (const char **) dataFileNames, (const char **) indexFileNames, threads,
+                         dataBlocks, ((mode & LEXICOGRAPHIC_MODE) != 0), binaryIndex, dbType);
+        delete[] blockBuffers;
+        delete[] blockStarts;
+        blockBuffers = NULL;
+        blockStarts = NULL;
+        sharedDataFile = -1;
+        Debug(Debug::INFO) << "Time for merging files: " << timer.lap() << "\n";
+    } else {
+        mergeResults(dataFileName, indexFileName,
+                     (const char **) dataFileNames, (const char **) indexFileNames, threads, ((mode & LEXICOGRAPHIC_MODE) != 0),
+                     binaryIndex, dbType, ((mode & SHARDED_MODE) != 0));
     }
 
-    mergeResults(dataFileName, indexFileName,
-                 (const char **) dataFileNames, (const char **) indexFileNames, threads, ((mode & LEXICOGRAPHIC_MODE) != 0));
-
     for (unsigned int i = 0; i < threads; i++) {
         delete [] dataFilesBuffer[i];
         free(dataFileNames[i]);
         free(indexFileNames[i]);
     }
+#ifdef HAVE_ZLIB
+    if (compressStreams != NULL) {
+        for (unsigned int i = 0; i < threads; i++) {
+            z_stream *stream = (z_stream *) compressStreams[i];
+            deflateEnd(stream);
+            delete stream;
+            free(compressBuffers[i].first);
+        }
+        delete[] compressStreams;
+        delete[] compressBuffers;
+        delete[] pendingEntries;
+        compressStreams = NULL;
+        compressBuffers = NULL;
+        pendingEntries = NULL;
+    }
+#endif
+    MemoryGovernor::release(reservedMemory);
+    reservedMemory = 0;
     closed = true;
 }
 
@@ -232,28 +376,68 @@ void DBWriter::writeAdd(const char* data, size_t dataSize, unsigned int thrIdx)
         EXIT(EXIT_FAILURE);
     }
 
-    size_t written = fwrite(data, sizeof(char), dataSize, dataFiles[thrIdx]);
-    if (written != dataSize) {
+    if ((mode & COMPRESSED_MODE) != 0) {
+        pendingEntries[thrIdx].append(data, dataSize);
+        return;
+    }
+
+    writeToDataFile(data, dataSize, thrIdx);
+}
+
+void DBWriter::writeToDataFile(const char *data, size_t dataSize, unsigned int thrIdx) {
+    if ((mode & SHARED_FILE_MODE) != 0) {
+        std::string &block = blockBuffers[thrIdx];
+        if (block.size() + dataSize > bufferSize) {
+            // only complete entries are moved to the data file, the current one has to stay consecutive
+            flushBlock(thrIdx, std::max(starts[thrIdx], blockStarts[thrIdx]) - blockStarts[thrIdx]);
+        }
+        // a single entry larger than the buffer grows the block
+        block.append(data, dataSize);
+    } else if (fwrite(data, sizeof(char), dataSize, dataFiles[thrIdx]) != dataSize) {
         Debug(Debug::ERROR) << "Could not write to data file " << dataFileNames[thrIdx] << "\n";
         EXIT(EXIT_FAILURE);
     }
-    offsets[thrIdx] += written;
+    offsets[thrIdx] += dataSize;
 }
 
-void DBWriter::writeEnd(unsigned int key, unsigned int thrIdx, bool addNullByte) {
-    size_t written;
-    // entries are always separated by a null byte
-    if(addNullByte == true){
-        char nullByte = '\0';
-        written = fwrite(&nullByte, sizeof(char), 1, dataFiles[thrIdx]);
-        if (written != 1) {
-            Debug(Debug::ERROR) << "Could not write to data file " << dataFileNames[thrIdx] << "\n";
+void DBWriter::flushBlock(unsigned int thrIdx, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    std::string &block = blockBuffers[thrIdx];
+    const size_t fileOffset = __sync_fetch_and_add(&sharedDataOffset, length);
+    size_t written = 0;
+    while (written < length) {
+        ssize_t result = pwrite(sharedDataFile, block.data() + written, length - written, fileOffset + written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            Debug(Debug::ERROR) << "Could not write to data file " << dataFileNames[0] << "\n";
             EXIT(EXIT_FAILURE);
         }
-        offsets[thrIdx] += 1;
+        written += result;
     }
+    dataBlocks[thrIdx].push_back(std::make_pair(blockStarts[thrIdx], fileOffset));
+    block.erase(0, length);
+    blockStarts[thrIdx] += length;
+}
 
-    size_t length = offsets[thrIdx] - starts[thrIdx];
+void DBWriter::writeEnd(unsigned int key, unsigned int thrIdx, bool addNullByte) {
+    size_t written;
+    size_t length;
+    if ((mode & COMPRESSED_MODE) != 0) {
+        length = writeCompressedEntry(pendingEntries[thrIdx].c_str(), pendingEntries[thrIdx].length(), addNullByte, thrIdx);
+        pendingEntries[thrIdx].clear();
+    } else {
+        // entries are always separated by a null byte
+        if(addNullByte == true){
+            char nullByte = '\0';
+            writeToDataFile(&nullByte, 1, thrIdx);
+        }
+
+        length = offsets[thrIdx] - starts[thrIdx];
+    }
 
     char buffer[1024];
     size_t len = indexToBuffer(buffer, key, starts[thrIdx], length );
@@ -264,6 +448,62 @@ void DBWriter::writeEnd(unsigned int key, unsigned int thrIdx, bool addNullByte)
     }
 }
 
+size_t DBWriter::writeCompressedEntry(const char *data, size_t dataSize, bool addNullByte, unsigned int thrIdx) {
+    CompressedEntryHeader header;
+    const size_t rawSize = dataSize + (addNullByte ? 1 : 0);
+    if (rawSize > UINT_MAX) {
+        Debug(Debug::ERROR) << "Entry of " << rawSize << " byte is too large to be compressed\n";
+        EXIT(EXIT_FAILURE);
+    }
+    header.rawSize = rawSize;
+    header.storedSize = rawSize;
+
+    std::pair<char*, size_t> &buffer = compressBuffers[thrIdx];
+#ifdef HAVE_ZLIB
+    z_stream *stream = (z_stream *) compressStreams[thrIdx];
+    const size_t bound = deflateBound(stream, rawSize);
+    if (buffer.second < bound) {
+        buffer.second = std::max(bound, (size_t) (buffer.second * 1.5));
+        buffer.first = (char *) realloc(buffer.first, buffer.second);
+        Util::checkAllocation(buffer.first, "Could not allocate compression buffer");
+    }
+    deflateReset(stream);
+    stream->next_out = (Bytef *) buffer.first;
+    stream->avail_out = bound;
+    stream->next_in = (Bytef *) data;
+    stream->avail_in = dataSize;
+    int status = Z_OK;
+    // deflate fails without any progress, so an empty entry only gets its null byte
+    if (dataSize > 0 || addNullByte == false) {
+        status = deflate(stream, addNullByte ? Z_NO_FLUSH : Z_FINISH);
+    }
+    char nullByte = '\0';
+    if (addNullByte && status == Z_OK) {
+        stream->next_in = (Bytef *) &nullByte;
+        stream->avail_in = 1;
+        status = deflate(stream, Z_FINISH);
+    }
+    if (status != Z_STREAM_END) {
+        Debug(Debug::ERROR) << "Could not compress entry for " << dataFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // entries that do not get smaller are stored as they are
+    header.storedSize = std::min((size_t) stream->total_out, rawSize);
+#endif
+
+    writeToDataFile((const char *) &header, sizeof(CompressedEntryHeader), thrIdx);
+    if (header.isStored()) {
+        const char nullByte = '\0';
+        writeToDataFile(data, dataSize, thrIdx);
+        if (addNullByte) {
+            writeToDataFile(&nullByte, 1, thrIdx);
+        }
+    } else {
+        writeToDataFile(buffer.first, header.storedSize, thrIdx);
+    }
+    return rawSize;
+}
+
 void DBWriter::writeIndexEntry(unsigned int key, size_t offset, size_t length, unsigned int thrIdx){
     char buffer[1024];
     size_t len = indexToBuffer(buffer, key, offset, length );
@@ -277,6 +517,12 @@ void DBWriter::writeIndexEntry(unsigned int key, size_t offset, size_t length, u
 
 void DBWriter::writeData(const char *data, size_t dataSize, unsigned int key, unsigned int thrIdx, bool addNullByte) {
     writeStart(thrIdx);
+    if ((mode & COMPRESSED_MODE) != 0) {
+        // compress directly instead of collecting the entry first
+        size_t length = writeCompressedEntry(data, dataSize, addNullByte, thrIdx);
+        writeIndexEntry(key, starts[thrIdx], length, thrIdx);
+        return;
+    }
     writeAdd(data, dataSize, thrIdx);
     writeEnd(key, thrIdx, addNullByte);
 }
@@ -294,6 +540,10 @@ size_t DBWriter::indexToBuffer(char *buff1, unsigned int key, size_t offsetStart
 }
 
 void DBWriter::alignToPageSize() {
+    if ((mode & COMPRESSED_MODE) != 0) {
+        Debug(Debug::ERROR) << "Data file of a compressed database can not be aligned.\n";
+        EXIT(EXIT_FAILURE);
+    }
     if (threads > 1) {
         Debug(Debug::ERROR) << "Data file can only be aligned in single threaded mode.\n";
         EXIT(EXIT_FAILURE);
@@ -304,13 +554,8 @@ void DBWriter::alignToPageSize() {
     size_t newOffset = ((pageSize - 1) & currentOffset) ? ((currentOffset + pageSize) & ~(pageSize - 1)) : currentOffset;
     char nullByte = '\0';
     for (size_t i = currentOffset; i < newOffset; ++i) {
-        size_t written = fwrite(&nullByte, sizeof(char), 1, dataFiles[0]);
-        if (written != 1) {
-            Debug(Debug::ERROR) << "Could not write to data file " << dataFileNames[0] << "\n";
-            EXIT(EXIT_FAILURE);
-        }
+        writeToDataFile(&nullByte, 1, 0);
     }
-    offsets[0] = newOffset;
 }
 
 
@@ -324,6 +569,7 @@ void DBWriter::checkClosed() {
 void DBWriter::mergeResults(const std::string &outFileName, const std::string &outFileNameIndex,
                             const std::vector<std::pair<std::string, std::string >> &files,
                             const  bool lexicographicOrder) {
+    const int dbType = DBReader<unsigned int>::parseDbType(files[0].first.c_str());
     const char **datafilesNames = new const char *[files.size()];
     const char **indexFilesNames = new const char *[files.size()];
     for (size_t i = 0; i < files.size(); i++) {
@@ -334,6 +580,30 @@ void DBWriter::mergeResults(const std::string &outFileName, const std::string &o
     delete[] datafilesNames;
     delete[] indexFilesNames;
 
+    for (size_t i = 0; i < files.size(); i++) {
+        std::string dbTypeFile = files[i].first + ".dbtype";
+        if (FileUtil::fileExists(dbTypeFile.c_str())) {
+            FileUtil::deleteFile(dbTypeFile);
+        }
+    }
+    if (dbType > -1) {
+        writeDbtypeFile(outFileName.c_str(), dbType);
+    }
+}
+
+void DBWriter::writeDbtypeFile(const char *dataFileName, int dbType) {
+    std::string dbTypeFile = std::string(dataFileName) + ".dbtype";
+    FILE * dbtypeDataFile = fopen(dbTypeFile.c_str(), "wb");
+    if (dbtypeDataFile == NULL) {
+        Debug(Debug::ERROR) << "Could not open data file " << dbTypeFile << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size_t written = fwrite(&dbType, sizeof(int), 1, dbtypeDataFile);
+    if (written != 1) {
+        Debug(Debug::ERROR) << "Could not write to data file " << dbTypeFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    fclose(dbtypeDataFile);
 }
 
 template <>
@@ -373,103 +643,301 @@ void DBWriter::writeIndex(FILE *outFile, size_t indexSize, DBReader<std::string>
     }
 }
 
+void DBWriter::mergeIndex(const char **dataFileNames, const char **indexFileNames, const unsigned long fileCount,
+                          const std::vector<DataBlocks> &dataBlocks, const bool sortById,
+                          std::vector<DBReader<unsigned int>::Index> &index, std::vector<unsigned int> &seqLens) {
+    std::vector<std::vector<DBReader<unsigned int>::Index> > threadIndex(fileCount);
+    std::vector<std::vector<unsigned int> > threadSeqLens(fileCount);
+    std::vector<char> threadIndexSorted(fileCount, true);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t fileIdx = 0; fileIdx < fileCount; fileIdx++) {
+        DBReader<unsigned int> reader(dataFileNames[fileIdx], indexFileNames[fileIdx], DBReader<unsigned int>::USE_INDEX);
+        reader.open(DBReader<unsigned int>::HARDNOSORT);
+        DBReader<unsigned int>::Index *readerIndex = reader.getIndex();
+        threadIndex[fileIdx].assign(readerIndex, readerIndex + reader.getSize());
+        threadSeqLens[fileIdx].assign(reader.getSeqLens(), reader.getSeqLens() + reader.getSize());
+        const DataBlocks &blocks = dataBlocks[fileIdx];
+        for (size_t i = 0; i < reader.getSize(); i++) {
+            // entries do not span blocks, so the block starting last before the entry contains it
+            const size_t offset = threadIndex[fileIdx][i].offset;
+            DataBlocks::const_iterator block = std::upper_bound(blocks.begin(), blocks.end(),
+                                                                std::make_pair(offset, SIZE_MAX));
+            if (block != blocks.begin()) {
+                --block;
+                threadIndex[fileIdx][i].offset = block->second + (offset - block->first);
+            }
+            if (i > 0 && readerIndex[i].id < readerIndex[i - 1].id) {
+                threadIndexSorted[fileIdx] = false;
+            }
+        }
+        reader.close();
+    }
+
+    size_t indexSize = 0;
+    bool allSorted = true;
+    for (size_t fileIdx = 0; fileIdx < fileCount; fileIdx++) {
+        indexSize += threadIndex[fileIdx].size();
+        allSorted = allSorted && threadIndexSorted[fileIdx];
+    }
+    index.reserve(indexSize);
+    seqLens.reserve(indexSize);
+
+    if (sortById && allSorted) {
+        // every thread writes its entries in order in most modules, so a k-way merge of the thread indices
+        // replaces sorting the whole index
+        typedef std::pair<unsigned int, size_t> QueueEntry;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > queue;
+        std::vector<size_t> positions(fileCount, 0);
+        for (size_t fileIdx = 0; fileIdx < fileCount; fileIdx++) {
+            if (threadIndex[fileIdx].empty() == false) {
+                queue.push(std::make_pair(threadIndex[fileIdx][0].id, fileIdx));
+            }
+        }
+        while (queue.empty() == false) {
+            const size_t fileIdx = queue.top().second;
+            queue.pop();
+            const size_t pos = positions[fileIdx]++;
+            index.push_back(threadIndex[fileIdx][pos]);
+            seqLens.push_back(threadSeqLens[fileIdx][pos]);
+            if (pos + 1 < threadIndex[fileIdx].size()) {
+                queue.push(std::make_pair(threadIndex[fileIdx][pos + 1].id, fileIdx));
+            }
+        }
+        return;
+    }
+
+    for (size_t fileIdx = 0; fileIdx < fileCount; fileIdx++) {
+        index.insert(index.end(), threadIndex[fileIdx].begin(), threadIndex[fileIdx].end());
+        seqLens.insert(seqLens.end(), threadSeqLens[fileIdx].begin(), threadSeqLens[fileIdx].end());
+        std::vector<DBReader<unsigned int>::Index>().swap(threadIndex[fileIdx]);
+        std::vector<unsigned int>().swap(threadSeqLens[fileIdx]);
+    }
+    if (sortById) {
+        std::vector<std::pair<DBReader<unsigned int>::Index, unsigned int> > sortArray(indexSize);
+        for (size_t i = 0; i < indexSize; i++) {
+            sortArray[i] = std::make_pair(index[i], seqLens[i]);
+        }
+        omptl::sort(sortArray.begin(), sortArray.end(), DBReader<unsigned int>::compareIndexLengthPairById());
+        for (size_t i = 0; i < indexSize; i++) {
+            index[i] = sortArray[i].first;
+            seqLens[i] = sortArray[i].second;
+        }
+    }
+}
+
+void DBWriter::writeMergedIndex(const char *outFileNameIndex, const char **dataFileNames, const char **indexFileNames,
+                                const unsigned long fileCount, const std::vector<DataBlocks> &dataBlocks,
+                                const bool lexicographicOrder, const bool binaryIndex, const int dbType) {
+    std::vector<DBReader<unsigned int>::Index> index;
+    std::vector<unsigned int> seqLens;
+    mergeIndex(dataFileNames, indexFileNames, fileCount, dataBlocks, lexicographicOrder == false, index, seqLens);
+    for (unsigned int fileIdx = 1; fileIdx < fileCount; fileIdx++) {
+        if (std::remove(indexFileNames[fileIdx]) != 0) {
+            Debug(Debug::WARNING) << "Could not remove file " << indexFileNames[fileIdx] << "\n";
+        }
+    }
+
+    if (lexicographicOrder == false) {
+        FILE *index_file  = fopen(outFileNameIndex, "w");
+        if (index_file == NULL) {
+            perror(outFileNameIndex);
+            EXIT(EXIT_FAILURE);
+        }
+        writeIndex(index_file, index.size(), index.data(), seqLens.data());
+        fclose(index_file);
+        if (binaryIndex) {
+            writeBinaryIndex(outFileNameIndex, index.size(), index.data(), seqLens.data(), dbType);
+        }
+    } else {
+        // the keys are sorted as strings by DBReader<std::string>
+        FILE *index_file = fopen(indexFileNames[0], "w");
+        if (index_file == NULL) {
+            perror(indexFileNames[0]);
+            EXIT(EXIT_FAILURE);
+        }
+        writeIndex(index_file, index.size(), index.data(), seqLens.data());
+        fclose(index_file);
+        std::vector<DBReader<unsigned int>::Index>().swap(index);
+        std::vector<unsigned int>().swap(seqLens);
+
+        DBReader<std::string> indexReader(dataFileNames[0], indexFileNames[0], DBReader<std::string>::USE_INDEX);
+        indexReader.open(DBReader<std::string>::SORT_BY_ID);
+        DBReader<std::string>::Index *stringIndex = indexReader.getIndex();
+        index_file  = fopen(outFileNameIndex, "w");
+        writeIndex(index_file, indexReader.getSize(), stringIndex, indexReader.getSeqLens());
+        fclose(index_file);
+        indexReader.close();
+    }
+
+    if (std::remove(indexFileNames[0]) != 0) {
+        Debug(Debug::WARNING) << "Could not remove file " << indexFileNames[0] << "\n";
+    }
+    // a binary index of a previous database at the same location is out of date now
+    std::string binaryIndexFileName = DBReader<unsigned int>::getBinaryIndexFileName(outFileNameIndex);
+    if ((binaryIndex == false || lexicographicOrder == true) && FileUtil::fileExists(binaryIndexFileName.c_str())) {
+        FileUtil::deleteFile(binaryIndexFileName);
+    }
+}
+
 void DBWriter::mergeResults(const char *outFileName, const char *outFileNameIndex,
                             const char **dataFileNames, const char **indexFileNames,
-                            const unsigned long fileCount, const bool lexicographicOrder) {
+                            const unsigned long fileCount, const bool lexicographicOrder,
+                            const bool binaryIndex, const int dbType, bool sharded) {
     Timer timer;
-    // merge results from each thread into one result file
-    if (fileCount > 1) {
-        FILE *outFile = fopen(outFileName, "w");
-        FILE **infiles = new FILE *[fileCount];
+    // each thread data file is one block at its offset in the merged data file
+    std::vector<DataBlocks> dataBlocks(fileCount, DataBlocks(1, std::make_pair(0, 0)));
+    std::vector<std::vector<ShardManifest::Shard> > fileShards(fileCount);
+    std::vector<char> isManifest(fileCount, false);
+    for (unsigned int i = 0; i < fileCount; i++) {
+        isManifest[i] = ShardManifest::read(dataFileNames[i], fileShards[i]);
+        sharded = sharded || isManifest[i];
+    }
+    // a plain database replacing a sharded one would leave its shards behind, ShardManifest::write removes them otherwise
+    std::vector<ShardManifest::Shard> previousShards;
+    if (sharded == false) {
+        ShardManifest::read(outFileName, previousShards);
+    }
+    if (sharded) {
+        // the data files stay where they are as shards, only their offsets in the merged data change
+        std::vector<ShardManifest::Shard> shards;
+        size_t dataSize = 0;
+        for (unsigned int i = 0; i < fileCount; i++) {
+            const size_t base = ShardManifest::alignOffset(dataSize);
+            dataBlocks[i][0].second = base;
+            if (isManifest[i]) {
+                for (size_t j = 0; j < fileShards[i].size(); j++) {
+                    ShardManifest::Shard shard = fileShards[i][j];
+                    shard.offset += base;
+                    shards.push_back(shard);
+                    dataSize = shard.offset + shard.size;
+                }
+                if (std::remove(dataFileNames[i]) != 0) {
+                    Debug(Debug::WARNING) << "Could not remove file " << dataFileNames[i] << "\n";
+                }
+                continue;
+            }
+            ShardManifest::Shard shard;
+            shard.offset = base;
+            shard.size = FileUtil::getFileSize(dataFileNames[i]);
+            if (shard.size == 0) {
+                // threads without entries do not need a shard
+                if (std::remove(dataFileNames[i]) != 0) {
+                    Debug(Debug::WARNING) << "Could not remove file " << dataFileNames[i] << "\n";
+                }
+                continue;
+            }
+            shard.path = FileUtil::getRealPath(dataFileNames[i]);
+            shards.push_back(shard);
+            dataSize = shard.offset + shard.size;
+        }
+        ShardManifest::write(outFileName, shards);
+    } else if (fileCount > 1) {
+        int outFile = ::open(outFileName, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (outFile < 0) {
+            Debug(Debug::ERROR) << "Could not open result file " << outFileName << "!\n";
+            EXIT(EXIT_FAILURE);
+        }
+        int *infiles = new int[fileCount];
         std::vector<size_t> threadDataFileSizes;
-
         for (unsigned int i = 0; i < fileCount; i++) {
-            infiles[i] = fopen(dataFileNames[i], "r");
-            if (infiles[i] == NULL) {
+            infiles[i] = ::open(dataFileNames[i], O_RDONLY);
+            if (infiles[i] < 0) {
                 Debug(Debug::ERROR) << "Could not open result file " << dataFileNames[i] << "!\n";
                 EXIT(EXIT_FAILURE);
             }
 
             struct stat sb;
-            if (fstat(fileno(infiles[i]), &sb) < 0) {
+            if (fstat(infiles[i], &sb) < 0) {
                 int errsv = errno;
                 Debug(Debug::ERROR) << "Failed to fstat file " << dataFileNames[i] << ". Error " << errsv << ".\n";
                 EXIT(EXIT_FAILURE);
             }
             threadDataFileSizes.push_back(sb.st_size);
+            if (i > 0) {
+                dataBlocks[i][0].second = dataBlocks[i - 1][0].second + threadDataFileSizes[i - 1];
+            }
         }
-        Concat::concatFiles(infiles, fileCount, outFile);
+        Concat::concatFilesParallel(infiles, threadDataFileSizes.data(), fileCount, outFile);
         for (unsigned int i = 0; i < fileCount; i++) {
-            fclose(infiles[i]);
+            ::close(infiles[i]);
             if (std::remove(dataFileNames[i]) != 0) {
                 Debug(Debug::WARNING) << "Could not remove file " << dataFileNames[i] << "\n";
             }
         }
         delete[] infiles;
-        fclose(outFile);
-
-        // merge index
-        FILE *index_file = fopen(indexFileNames[0], "a");
-        if (index_file == NULL) {
-            perror(outFileNameIndex);
+        if (::close(outFile) != 0) {
+            Debug(Debug::ERROR) << "Could not write result file " << outFileName << "!\n";
             EXIT(EXIT_FAILURE);
         }
-        size_t globalOffset = threadDataFileSizes[0];
-        for (unsigned int fileIdx = 1; fileIdx < fileCount; fileIdx++) {
-            DBReader<unsigned int> reader(dataFileNames[fileIdx], indexFileNames[fileIdx], DBReader<unsigned int>::USE_INDEX);
-            reader.open(DBReader<unsigned int>::HARDNOSORT);
-            if (reader.getSize() > 0) {
-                DBReader<unsigned int>::Index * index = reader.getIndex();
-                for (size_t i = 0; i < reader.getSize()-1; i++) {
-                    size_t currOffset = index[i].offset;
-                    index[i].offset = globalOffset + currOffset;
-                }
-                size_t currOffset = index[reader.getSize()-1].offset;
-                index[reader.getSize()-1].offset = globalOffset + currOffset;
-                writeIndex(index_file, reader.getSize(), index, reader.getSeqLens());
-            }
-            reader.close();
-            if (std::remove(indexFileNames[fileIdx]) != 0) {
-                Debug(Debug::WARNING) << "Could not remove file " << indexFileNames[fileIdx] << "\n";
-            }
-
-            globalOffset += threadDataFileSizes[fileIdx];
-        }
-        fclose(index_file);
     } else {
         if (std::rename(dataFileNames[0], outFileName) != 0) {
             Debug(Debug::ERROR) << "Could not move result " << dataFileNames[0] << " to final location " << outFileName << "!\n";
             EXIT(EXIT_FAILURE);
         }
     }
+    ShardManifest::removeShards(previousShards, std::vector<ShardManifest::Shard>());
 
-    if (lexicographicOrder == false) {
-        // sort the index
-        DBReader<unsigned int> indexReader(dataFileNames[0], indexFileNames[0], DBReader<unsigned int>::USE_INDEX);
-        indexReader.open(DBReader<unsigned int>::NOSORT);
-        DBReader<unsigned int>::Index *index = indexReader.getIndex();
-        FILE *index_file  = fopen(outFileNameIndex, "w");
-        writeIndex(index_file, indexReader.getSize(), index, indexReader.getSeqLens());
-        fclose(index_file);
-        indexReader.close();
+    writeMergedIndex(outFileNameIndex, dataFileNames, indexFileNames, fileCount, dataBlocks, lexicographicOrder,
+                     binaryIndex, dbType);
+    Debug(Debug::INFO) << "Time for merging files: " << timer.lap() << "\n";
+}
 
-    } else {
-        DBReader<std::string> indexReader(dataFileNames[0], indexFileNames[0], DBReader<std::string>::USE_INDEX);
-        indexReader.open(DBReader<std::string>::SORT_BY_ID);
-        DBReader<std::string>::Index *index = indexReader.getIndex();
-        FILE *index_file  = fopen(outFileNameIndex, "w");
-        writeIndex(index_file, indexReader.getSize(), index, indexReader.getSeqLens());
-        fclose(index_file);
-        indexReader.close();
+void DBWriter::writeBinaryIndex(const char *indexFileName, size_t indexSize, DBReader<unsigned int>::Index *index,
+                                unsigned int *seqLen, int dbType) {
+    BinaryIndexHeader header;
+    memset(&header, 0, sizeof(BinaryIndexHeader));
+    header.magic = BinaryIndexHeader::MAGIC;
+    header.version = BinaryIndexHeader::VERSION;
+    header.dbType = dbType;
+    header.size = indexSize;
+    for (size_t i = 0; i < indexSize; i++) {
+        if (i > 0 && index[i].id < index[i - 1].id) {
+            Debug(Debug::ERROR) << "Index " << indexFileName << " has to be sorted by id to write a binary index!\n";
+            EXIT(EXIT_FAILURE);
+        }
+        header.aaDbSize += seqLen[i];
+        header.lastKey = std::max(header.lastKey, index[i].id);
     }
-
-    if (std::remove(indexFileNames[0]) != 0) {
-        Debug(Debug::WARNING) << "Could not remove file " << indexFileNames[0] << "\n";
+    struct stat sb;
+    if (stat(indexFileName, &sb) < 0) {
+        Debug(Debug::ERROR) << "Could not stat index file " << indexFileName << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    header.setTextIndex(indexFileName, sb);
+
+    // a reader might have the current binary index mapped, so it is replaced instead of overwritten
+    std::string binaryIndexFileName = DBReader<unsigned int>::getBinaryIndexFileName(indexFileName);
+    std::string tmpFileName = binaryIndexFileName + ".tmp";
+    FILE *file = fopen(tmpFileName.c_str(), "wb");
+    if (file == NULL) {
+        Debug(Debug::ERROR) << "Could not open binary index file " << tmpFileName << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fwrite(&header, sizeof(BinaryIndexHeader), 1, file) != 1
+        || fwrite(index, sizeof(DBReader<unsigned int>::Index), indexSize, file) != indexSize
+        || fwrite(seqLen, sizeof(unsigned int), indexSize, file) != indexSize) {
+        Debug(Debug::ERROR) << "Could not write to binary index file " << tmpFileName << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fclose(file) != 0 || std::rename(tmpFileName.c_str(), binaryIndexFileName.c_str()) != 0) {
+        Debug(Debug::ERROR) << "Could not move " << tmpFileName << " to " << binaryIndexFileName << "!\n";
+        EXIT(EXIT_FAILURE);
     }
-    Debug(Debug::INFO) << "Time for merging files: " << timer.lap() << "\n";
 }
 
 void DBWriter::mergeFilePair(const std::vector<std::pair<std::string, std::string>> fileNames) {
+    // concatenates the raw entries of the input files
+    if ((mode & COMPRESSED_MODE) != 0 || (mode & SHARED_FILE_MODE) != 0) {
+        Debug(Debug::ERROR) << "Files can not be merged into a compressed or shared file database.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    std::vector<ShardManifest::Shard> shards;
+    for (size_t i = 0; i < fileNames.size(); i++) {
+        if (ShardManifest::read(fileNames[i].first.c_str(), shards)) {
+            Debug(Debug::ERROR) << "Sharded database " << fileNames[i].first << " can not be merged.\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
     FILE ** files = new FILE*[fileNames.size()];
     for (size_t i = 0; i < fileNames.size();i++) {
         files[i] = FileUtil::openFileOrDie(fileNames[i].first.c_str(), "r", true);
@@ -19,6 +19,14 @@ public:
     static const size_t ASCII_MODE = 0;
     static const size_t BINARY_MODE = 1;
     static const size_t LEXICOGRAPHIC_MODE = 2;
+    // compresses each entry with zlib, DBReader decompresses them transparently
+    static const size_t COMPRESSED_MODE = 4;
+    // all threads write blocks of entries into one data file instead of a file per thread,
+    // so the data file does not have to be copied together in close
+    static const size_t SHARED_FILE_MODE = 8;
+    // the data file of each thread stays where it was written as a shard of the database and the data file becomes
+    // a manifest of the shards (see ShardManifest), so nothing is copied in close. Replaces SHARED_FILE_MODE
+    static const size_t SHARDED_MODE = 16;
 
 
     DBWriter(const char* dataFileName, const char* indexFileName, unsigned int threads = 1, size_t mode = ASCII_MODE);
@@ -27,7 +35,12 @@ public:
 
     void open(size_t bufferSize = 64 * 1024 * 1024);
 
-    void close(int dbType = -1);
+    // SHARDED_MODE: comma separated directories, for example on different disks, the thread shards are
+    // distributed over. Shards are written next to the database if empty. Has to be called before open
+    void setShardDirectories(const std::string &directories);
+
+    // binaryIndex additionally writes <index>.bin, which DBReader maps instead of parsing the text index
+    void close(int dbType = -1, bool binaryIndex = false);
 
     char* getDataFileName() { return dataFileName; }
 
@@ -49,18 +62,30 @@ public:
 
     void sortDatafileByIdOrder(DBReader<unsigned int>& qdbr);
 
+    // the merged database has the type of the first file
     static void mergeResults(const std::string &outFileName, const std::string &outFileNameIndex,
                              const std::vector<std::pair<std::string, std::string>> &files,
                              bool lexicographicOrder = false);
 
+    // the data files become shards of a sharded database instead of being copied if sharded is set
+    // or if one of them is sharded already
     static void mergeResults(const char *outFileName, const char *outFileNameIndex,
                              const char **dataFileNames, const char **indexFileNames,
-                             unsigned long fileCount, bool lexicographicOrder = false);
+                             unsigned long fileCount, bool lexicographicOrder = false,
+                             bool binaryIndex = false, int dbType = -1, bool sharded = false);
+
+    static void writeDbtypeFile(const char *dataFileName, int dbType);
+
+    // writes the binary index for the text index indexFileName, which has to exist already
+    // index has to be sorted by id
+    static void writeBinaryIndex(const char *indexFileName, size_t indexSize, DBReader<unsigned int>::Index *index,
+                                 unsigned int *seqLen, int dbType);
 
     void mergeFilePair(const std::vector<std::pair<std::string, std::string>> fileNames);
 
     void writeIndexEntry(unsigned int key, size_t offset, size_t length, unsigned int thrIdx);
 
+    // in SHARED_FILE_MODE this is the offset in the data written by the thread, not in the data file
     size_t getOffset(unsigned int threadIdx){
         return offsets[threadIdx];
     }
@@ -68,8 +93,32 @@ private:
     template <typename T>
     static void writeIndex(FILE *outFile, size_t indexSize, T *index, unsigned int *seqLen);
 
+    // (offset in the thread data, offset in the data file) of each consecutive block of thread data
+    typedef std::vector<std::pair<size_t, size_t> > DataBlocks;
+
+    // reads the thread indices with their data file offsets into one index, sorted by id if sortById
+    static void mergeIndex(const char **dataFileNames, const char **indexFileNames, unsigned long fileCount,
+                           const std::vector<DataBlocks> &dataBlocks, bool sortById,
+                           std::vector<DBReader<unsigned int>::Index> &index, std::vector<unsigned int> &seqLens);
+
+    // writes the index of the merged data file and removes the thread indices
+    static void writeMergedIndex(const char *outFileNameIndex, const char **dataFileNames, const char **indexFileNames,
+                                 unsigned long fileCount, const std::vector<DataBlocks> &dataBlocks,
+                                 bool lexicographicOrder, bool binaryIndex, int dbType);
+
+    void writeToDataFile(const char *data, size_t dataSize, unsigned int thrIdx);
+
+    // SHARDED_MODE: data file of the thread in one of the shard directories
+    std::string makeShardFilename(unsigned int thrIdx);
+
+    // SHARED_FILE_MODE: moves the first length byte of the thread block into the data file
+    void flushBlock(unsigned int thrIdx, size_t length);
+
     void checkClosed();
 
+    // returns the uncompressed length of the entry for the index
+    size_t writeCompressedEntry(const char *data, size_t dataSize, bool addNullByte, unsigned int thrIdx);
+
     char* dataFileName;
     char* indexFileName;
 
@@ -91,6 +140,24 @@ private:
 
     std::string datafileMode;
 
+    // COMPRESSED_MODE: entries written with writeAdd are collected until writeEnd
+    std::string *pendingEntries;
+    std::pair<char*, size_t> *compressBuffers;
+    // z_stream per thread, kept to avoid setting up zlib for every entry
+    void **compressStreams;
+
+    // SHARED_FILE_MODE: the data file and the next free offset in it
+    int sharedDataFile;
+    size_t sharedDataOffset;
+    // the current block of each thread, which starts at blockStarts in the thread data
+    std::string *blockBuffers;
+    size_t *blockStarts;
+    std::vector<DataBlocks> dataBlocks;
+
+    std::vector<std::string> shardDirectories;
+
+    // byte of the buffers registered with MemoryGovernor
+    size_t reservedMemory;
 
 };
 
@@ -2,6 +2,7 @@
 #include "Util.h"
 #include "Debug.h"
 #include "MemoryMapped.h"
+#include "DBReader.h"
 #include <sys/stat.h>
 #include <stdio.h>
 #include <fstream>
@@ -77,9 +78,14 @@ size_t FileUtil::countLines(const char* name) {
 }
 
 void FileUtil::deleteFile(const std::string &file) {
+    // the data file of a sharded database is a manifest, its shards are deleted with it
+    std::vector<ShardManifest::Shard> shards;
+    ShardManifest::read(file.c_str(), shards);
     if (remove(file.c_str()) != 0) {
         Debug(Debug::WARNING) << "Error deleting file " << file << "\n";
+        return;
     }
+    ShardManifest::removeShards(shards, std::vector<ShardManifest::Shard>());
 }
 
 void FileUtil::deleteTempFiles(const std::list<std::string> &tmpFiles) {
@@ -122,6 +128,17 @@ std::string FileUtil::baseName(const std::string &file) {
            : file.substr(pos+1, file.length());
 }
 
+std::string FileUtil::getRealPath(const std::string &path) {
+    char *p = realpath(path.c_str(), NULL);
+    if (p == NULL) {
+        Debug(Debug::ERROR) << "Could not get realpath of " << path << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    std::string realPath(p);
+    free(p);
+    return realPath;
+}
+
 size_t FileUtil::getFreeSpace(const char *path) {
         struct statvfs stat;
         if (statvfs(path, &stat) != 0) {
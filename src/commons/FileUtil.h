@@ -30,6 +30,9 @@ public:
 
     static std::string baseName(const std::string &file);
 
+    // absolute path of an existing file or directory
+    static std::string getRealPath(const std::string &path);
+
     static size_t getFreeSpace(const char *dir);
 
     static void symlinkAlias(const std::string &file, const std::string &alias);
@@ -4,13 +4,21 @@
 #include "Util.h"
 #include "Debug.h"
 #include <unistd.h>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 
 namespace KSEQFILE {
     KSEQ_INIT(int, read)
 }
 
 KSeqFile::KSeqFile(const char* fileName) {
-    file = FileUtil::openFileOrDie(fileName, "r", true);
+    if (KSeqWrapper::isStdin(fileName)) {
+        file = stdin;
+    } else {
+        file = FileUtil::openFileOrDie(fileName, "r", true);
+    }
     seq = (void*) KSEQFILE::kseq_init(fileno(file));
 }
 
@@ -30,7 +38,9 @@ bool KSeqFile::ReadEntry() {
 
 KSeqFile::~KSeqFile() {
     kseq_destroy((KSEQFILE::kseq_t*)seq);
-    fclose(file);
+    if (file != stdin) {
+        fclose(file);
+    }
 }
 
 #ifdef HAVE_ZLIB
@@ -71,6 +81,189 @@ KSeqGzip::~KSeqGzip() {
     kseq_destroy((KSEQGZIP::kseq_t*)seq);
     gzclose(file);
 }
+
+struct KSeqBgzf::Stream {
+    FILE* file;
+    // the raw deflate data of the blocks of the current batch, without gzip header and trailer
+    std::vector<unsigned char> compressed;
+    std::vector<size_t> blockOffsets;
+    std::vector<size_t> blockLengths;
+    std::vector<uint32_t> blockCrcs;
+    // start of each block in data, the last element is the size of data
+    std::vector<size_t> dataOffsets;
+    std::vector<char> data;
+    size_t position;
+};
+
+// gzip header up to and including XLEN
+static const size_t BGZF_HEADER_SIZE = 12;
+// blocks decompressed together, at most 16MB of data
+static const size_t BGZF_BATCH_BLOCKS = 256;
+
+static uint16_t readUInt16(const unsigned char* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static uint32_t readUInt32(const unsigned char* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+static bool isBgzfHeader(const unsigned char* header) {
+    return header[0] == 31 && header[1] == 139 && header[2] == 8 && (header[3] & 4) != 0;
+}
+
+// appends the next block of the file to the batch, returns false at the end of the file
+static bool readBgzfBlock(KSeqBgzf::Stream* s) {
+    unsigned char header[BGZF_HEADER_SIZE];
+    const size_t read = fread(header, sizeof(unsigned char), BGZF_HEADER_SIZE, s->file);
+    if (read == 0 && feof(s->file)) {
+        return false;
+    }
+    if (read != BGZF_HEADER_SIZE || isBgzfHeader(header) == false) {
+        Debug(Debug::ERROR) << "Invalid BGZF block header.\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    const size_t start = s->compressed.size();
+    const size_t extraLength = readUInt16(header + 10);
+    s->compressed.resize(start + extraLength);
+    if (fread(s->compressed.data() + start, sizeof(unsigned char), extraLength, s->file) != extraLength) {
+        Debug(Debug::ERROR) << "Truncated BGZF block header.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size_t blockSize = 0;
+    for (size_t pos = 0; pos + 4 <= extraLength; ) {
+        const unsigned char* field = s->compressed.data() + start + pos;
+        const size_t fieldLength = readUInt16(field + 2);
+        if (field[0] == 'B' && field[1] == 'C' && fieldLength == 2 && pos + 6 <= extraLength) {
+            blockSize = readUInt16(field + 4) + 1;
+        }
+        pos += 4 + fieldLength;
+    }
+    // deflate data followed by CRC32 and ISIZE
+    if (blockSize < BGZF_HEADER_SIZE + extraLength + 8) {
+        Debug(Debug::ERROR) << "Invalid BGZF block size.\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    const size_t remaining = blockSize - BGZF_HEADER_SIZE - extraLength;
+    s->compressed.resize(start + remaining);
+    if (fread(s->compressed.data() + start, sizeof(unsigned char), remaining, s->file) != remaining) {
+        Debug(Debug::ERROR) << "Truncated BGZF block.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const unsigned char* trailer = s->compressed.data() + start + remaining - 8;
+    s->blockOffsets.push_back(start);
+    s->blockLengths.push_back(remaining - 8);
+    s->blockCrcs.push_back(readUInt32(trailer));
+    s->dataOffsets.push_back(s->dataOffsets.back() + readUInt32(trailer + 4));
+    return true;
+}
+
+static bool inflateBgzfBlock(const unsigned char* in, size_t inLength, char* out, size_t outLength, uint32_t crc) {
+    z_stream strm;
+    memset(&strm, 0, sizeof(z_stream));
+    if (inflateInit2(&strm, -15) != Z_OK) {
+        return false;
+    }
+    strm.next_in = (Bytef*) in;
+    strm.avail_in = inLength;
+    strm.next_out = (Bytef*) out;
+    strm.avail_out = outLength;
+    const int result = inflate(&strm, Z_FINISH);
+    const size_t written = strm.total_out;
+    inflateEnd(&strm);
+    return result == Z_STREAM_END && written == outLength
+           && crc32(crc32(0L, Z_NULL, 0), (const Bytef*) out, outLength) == crc;
+}
+
+// reads the next batch of blocks and decompresses them, returns false at the end of the file
+static bool refillBgzf(KSeqBgzf::Stream* s) {
+    s->compressed.clear();
+    s->blockOffsets.clear();
+    s->blockLengths.clear();
+    s->blockCrcs.clear();
+    s->dataOffsets.assign(1, 0);
+    size_t blocks = 0;
+    while (blocks < BGZF_BATCH_BLOCKS && readBgzfBlock(s)) {
+        blocks++;
+    }
+    s->data.resize(s->dataOffsets.back());
+    s->position = 0;
+
+    int failed = 0;
+#pragma omp taskloop shared(failed)
+    for (size_t i = 0; i < blocks; i++) {
+        if (inflateBgzfBlock(s->compressed.data() + s->blockOffsets[i], s->blockLengths[i],
+                             s->data.data() + s->dataOffsets[i], s->dataOffsets[i + 1] - s->dataOffsets[i],
+                             s->blockCrcs[i]) == false) {
+#pragma omp atomic
+            failed++;
+        }
+    }
+    if (failed > 0) {
+        Debug(Debug::ERROR) << "Could not decompress " << failed << " BGZF blocks.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    return blocks > 0;
+}
+
+static int bgzfRead(KSeqBgzf::Stream* s, void* buffer, int length) {
+    // the end of file block is empty
+    while (s->position == s->data.size()) {
+        if (refillBgzf(s) == false) {
+            return 0;
+        }
+    }
+    const size_t count = std::min(static_cast<size_t>(length), s->data.size() - s->position);
+    memcpy(buffer, s->data.data() + s->position, count);
+    s->position += count;
+    return count;
+}
+
+namespace KSEQBGZF {
+    KSEQ_INIT(KSeqBgzf::Stream*, bgzfRead)
+}
+
+bool KSeqBgzf::isBgzf(const char* fileName) {
+    FILE* file = fopen(fileName, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    unsigned char header[BGZF_HEADER_SIZE + 4];
+    const bool isBgzf = fread(header, sizeof(unsigned char), sizeof(header), file) == sizeof(header)
+                        && isBgzfHeader(header) && readUInt16(header + 10) >= 6
+                        && header[12] == 'B' && header[13] == 'C';
+    fclose(file);
+    return isBgzf;
+}
+
+KSeqBgzf::KSeqBgzf(const char* fileName) {
+    stream = new Stream;
+    stream->file = FileUtil::openFileOrDie(fileName, "rb", true);
+    stream->position = 0;
+    seq = (void*) KSEQBGZF::kseq_init(stream);
+}
+
+bool KSeqBgzf::ReadEntry() {
+    KSEQBGZF::kseq_t* s = (KSEQBGZF::kseq_t*) seq;
+    int result = KSEQBGZF::kseq_read(s);
+    if (result < 0)
+        return false;
+
+    entry.name = s->name;
+    entry.comment = s->comment;
+    entry.sequence = s->seq;
+    entry.qual = s->qual;
+
+    return true;
+}
+
+KSeqBgzf::~KSeqBgzf() {
+    kseq_destroy((KSEQBGZF::kseq_t*)seq);
+    fclose(stream->file);
+    delete stream;
+}
 #endif
 
 
@@ -116,14 +309,25 @@ KSeqBzip::~KSeqBzip() {
 }
 #endif
 
+bool KSeqWrapper::isStdin(const char* file) {
+    return strcmp(file, "stdin") == 0;
+}
+
 KSeqWrapper* KSeqFactory(const char* file) {
     KSeqWrapper* kseq = NULL;
-    if(Util::endsWith(".gz", file) == false && Util::endsWith(".bz2", file) == false ) {
+    if(KSeqWrapper::isStdin(file) == true) {
+        // compressed input has to be decompressed before it is piped in
+        kseq = new KSeqFile(file);
+    } else if(Util::endsWith(".gz", file) == false && Util::endsWith(".bz2", file) == false ) {
         kseq = new KSeqFile(file);
     }
 #ifdef HAVE_ZLIB
     else if(Util::endsWith(".gz", file) == true) {
-        kseq = new KSeqGzip(file);
+        if (KSeqBgzf::isBgzf(file)) {
+            kseq = new KSeqBgzf(file);
+        } else {
+            kseq = new KSeqGzip(file);
+        }
     }
 #else
     else if(Util::endsWith(".gz", file) == true) {
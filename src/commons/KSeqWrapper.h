@@ -16,6 +16,9 @@ public:
     virtual bool ReadEntry() = 0;
     virtual ~KSeqWrapper() {};
 
+    // the file name "stdin" reads from the standard input
+    static bool isStdin(const char* file);
+
 protected:
     void* seq;
 };
@@ -40,6 +43,21 @@ public:
 private:
     gzFile file;
 };
+
+// BGZF files (written by bgzip) are a series of independent gzip blocks of at most 64KB,
+// which are decompressed in parallel by the OpenMP tasks of the enclosing parallel region
+class KSeqBgzf : public KSeqWrapper {
+public:
+    KSeqBgzf(const char* file);
+    bool ReadEntry();
+    ~KSeqBgzf();
+
+    static bool isBgzf(const char* file);
+
+    struct Stream;
+private:
+    Stream* stream;
+};
 #endif
 
 #ifdef HAVE_BZLIB
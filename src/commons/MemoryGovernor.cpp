@@ -0,0 +1,117 @@
+#include "MemoryGovernor.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+static size_t userLimit = 0;
+static size_t reserved = 0;
+
+// SIZE_MAX if the file does not exist or does not contain a limit ("max" in cgroup v2)
+static size_t readLimitFile(const std::string &fileName) {
+    std::ifstream file(fileName.c_str());
+    std::string value;
+    if ((file >> value).fail()) {
+        return SIZE_MAX;
+    }
+    char *end;
+    const unsigned long long limit = strtoull(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0') {
+        return SIZE_MAX;
+    }
+    return static_cast<size_t>(limit);
+}
+
+size_t MemoryGovernor::getCgroupLimit(const std::string &procCgroup, const std::string &cgroupRoot) {
+    size_t limit = SIZE_MAX;
+    std::istringstream lines(procCgroup);
+    std::string line;
+    while (std::getline(lines, line)) {
+        // hierarchy-ID:controller-list:cgroup-path
+        const size_t first = line.find(':');
+        const size_t second = (first == std::string::npos) ? std::string::npos : line.find(':', first + 1);
+        if (second == std::string::npos) {
+            continue;
+        }
+        const std::string controllers = line.substr(first + 1, second - first - 1);
+        std::string dir;
+        std::string fileName;
+        if (controllers.empty()) {
+            dir = cgroupRoot;
+            fileName = "memory.max";
+        } else if (("," + controllers + ",").find(",memory,") != std::string::npos) {
+            dir = cgroupRoot + "/memory";
+            fileName = "memory.limit_in_bytes";
+        } else {
+            continue;
+        }
+        std::string path = line.substr(second + 1);
+        if (path.empty() == false && path[path.size() - 1] == '/') {
+            path.erase(path.size() - 1);
+        }
+        // the limits of the parent cgroups apply as well. Inside a container only the part of the
+        // hierarchy below the cgroup of the container is mounted, its limit is found at the mount point
+        while (true) {
+            limit = std::min(limit, readLimitFile(dir + path + "/" + fileName));
+            if (path.empty()) {
+                break;
+            }
+            const size_t pos = path.find_last_of('/');
+            path.erase((pos == std::string::npos) ? 0 : pos);
+        }
+    }
+    return limit;
+}
+
+size_t MemoryGovernor::getCgroupLimit() {
+    std::ifstream file("/proc/self/cgroup");
+    if (file.fail()) {
+        return SIZE_MAX;
+    }
+    std::stringstream procCgroup;
+    procCgroup << file.rdbuf();
+    return getCgroupLimit(procCgroup.str(), "/sys/fs/cgroup");
+}
+
+static size_t getSystemLimit() {
+    static const size_t systemLimit = std::min(Util::getTotalSystemMemory(), MemoryGovernor::getCgroupLimit());
+    return systemLimit;
+}
+
+void MemoryGovernor::setUserLimit(size_t limit) {
+    if (limit > getSystemLimit()) {
+        Debug(Debug::WARNING) << "Memory limit of " << limit << " byte exceeds the " << getSystemLimit()
+                              << " byte of memory available to the process\n";
+    }
+    userLimit = limit;
+}
+
+size_t MemoryGovernor::getBudget() {
+    if (userLimit > 0) {
+        return std::min(userLimit, getSystemLimit());
+    }
+    return static_cast<size_t>(getSystemLimit() * 0.9);
+}
+
+size_t MemoryGovernor::getAvailable() {
+    const size_t budget = getBudget();
+    const size_t used = getReserved();
+    return (budget > used) ? (budget - used) : 0;
+}
+
+size_t MemoryGovernor::getReserved() {
+    return __sync_fetch_and_add(&reserved, 0);
+}
+
+void MemoryGovernor::reserve(size_t bytes) {
+    __sync_fetch_and_add(&reserved, bytes);
+}
+
+void MemoryGovernor::release(size_t bytes) {
+    __sync_fetch_and_sub(&reserved, bytes);
+}
@@ -0,0 +1,38 @@
+#ifndef MMSEQS_MEMORYGOVERNOR_H
+#define MMSEQS_MEMORYGOVERNOR_H
+
+// Process-wide memory budget. The budget is --split-memory-limit if it is set, otherwise 90% of the physical memory.
+// It never exceeds the memory limit of the cgroup (v1 or v2) of the process, since the kernel kills the process
+// instead of swapping when the cgroup runs out of memory.
+// Large allocations and resident mappings register themselves with reserve and release: the prefilter index copies
+// (MemoryPlacement), DBReader data read with fread or touched or locked in memory, the QueryMatcher buffers of each
+// thread and the DBWriter buffers. Split and thread count selection use what is left of the budget.
+
+#include <cstddef>
+#include <string>
+
+class MemoryGovernor {
+public:
+    // limit of --split-memory-limit in byte, 0 for no limit. Called by Parameters::parseParameters
+    static void setUserLimit(size_t limit);
+
+    // byte the process may use in total
+    static size_t getBudget();
+
+    // budget minus the current reservations
+    static size_t getAvailable();
+
+    static size_t getReserved();
+
+    static void reserve(size_t bytes);
+
+    static void release(size_t bytes);
+
+    // memory limit of the cgroup of the process and its parents, SIZE_MAX if there is none
+    static size_t getCgroupLimit();
+
+    // procCgroup is the content of /proc/self/cgroup and cgroupRoot the mount point of the cgroup file system
+    static size_t getCgroupLimit(const std::string &procCgroup, const std::string &cgroupRoot);
+};
+
+#endif
@@ -0,0 +1,298 @@
+#include "MemoryPlacement.h"
+#include "Debug.h"
+#include "MemoryGovernor.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+// from numaif.h, which is only available with libnuma
+#define MMSEQS_MPOL_PREFERRED 1
+#define MMSEQS_MPOL_INTERLEAVE 3
+#endif
+
+static size_t roundToHugePages(size_t size) {
+    return ((size + MemoryPlacement::HUGE_PAGE_SIZE - 1) / MemoryPlacement::HUGE_PAGE_SIZE) * MemoryPlacement::HUGE_PAGE_SIZE;
+}
+
+#ifdef __linux__
+static const size_t NODE_MASK_WORDS = 16;
+
+static bool bindMemory(char *ptr, size_t size, int node) {
+#ifdef SYS_mbind
+    unsigned long mask[NODE_MASK_WORDS];
+    memset(mask, 0, sizeof(mask));
+    const int nodeCount = std::min(MemoryPlacement::getNodeCount(), (int) (NODE_MASK_WORDS * 8 * sizeof(unsigned long)));
+    int mode;
+    if (node == MemoryPlacement::NODE_INTERLEAVE) {
+        for (int i = 0; i < nodeCount; i++) {
+            mask[i / (8 * sizeof(unsigned long))] |= 1UL << (i % (8 * sizeof(unsigned long)));
+        }
+        mode = MMSEQS_MPOL_INTERLEAVE;
+    } else if (node >= 0 && node < nodeCount) {
+        mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+        mode = MMSEQS_MPOL_PREFERRED;
+    } else {
+        return false;
+    }
+    return syscall(SYS_mbind, ptr, size, mode, mask, NODE_MASK_WORDS * 8 * sizeof(unsigned long), 0) == 0;
+#else
+    (void) ptr; (void) size; (void) node;
+    return false;
+#endif
+}
+#endif
+
+char *MemoryPlacement::allocate(size_t size, int hugePages, int node) {
+    const size_t mapSize = roundToHugePages(std::max(size, (size_t) 1));
+    char *ptr = (char *) MAP_FAILED;
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    if (hugePages == HUGE_PAGES_EXPLICIT) {
+        ptr = (char *) mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        static bool warned = false;
+        if (ptr == MAP_FAILED && warned == false) {
+            Debug(Debug::WARNING) << "Could not allocate " << mapSize << " byte of explicit huge pages. "
+                                  << "Reserve them in /proc/sys/vm/nr_hugepages. Using transparent huge pages instead.\n";
+            warned = true;
+        }
+    }
+#endif
+    if (ptr == MAP_FAILED) {
+        ptr = (char *) mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            return NULL;
+        }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (hugePages != HUGE_PAGES_OFF && madvise(ptr, mapSize, MADV_HUGEPAGE) != 0) {
+            Debug(Debug::WARNING) << "Transparent huge pages are not supported.\n";
+        }
+#endif
+    }
+#ifdef __linux__
+    if (node != NODE_ANY && getNodeCount() > 1 && bindMemory(ptr, mapSize, node) == false) {
+        Debug(Debug::WARNING) << "Could not set NUMA memory policy.\n";
+    }
+#else
+    (void) node;
+#endif
+    MemoryGovernor::reserve(mapSize);
+    return ptr;
+}
+
+void MemoryPlacement::release(char *ptr, size_t size) {
+    if (ptr != NULL) {
+        const size_t mapSize = roundToHugePages(std::max(size, (size_t) 1));
+        munmap(ptr, mapSize);
+        MemoryGovernor::release(mapSize);
+    }
+}
+
+int MemoryPlacement::getNodeCount() {
+    int nodeCount = 1;
+#ifdef __linux__
+    DIR *dir = opendir("/sys/devices/system/node");
+    if (dir == NULL) {
+        return nodeCount;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int node;
+        if (sscanf(entry->d_name, "node%d", &node) == 1) {
+            nodeCount = std::max(nodeCount, node + 1);
+        }
+    }
+    closedir(dir);
+#endif
+    return nodeCount;
+}
+
+int MemoryPlacement::getNodeOfCpu(int cpu) {
+#ifdef __linux__
+    const int nodeCount = getNodeCount();
+    for (int node = 0; node < nodeCount; node++) {
+        std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpu" + std::to_string(cpu);
+        if (access(path.c_str(), F_OK) == 0) {
+            return node;
+        }
+    }
+#else
+    (void) cpu;
+#endif
+    return 0;
+}
+
+std::vector<int> MemoryPlacement::getAllowedCpus() {
+    std::vector<std::pair<int, int> > nodeCpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                nodeCpus.push_back(std::make_pair(getNodeOfCpu(cpu), cpu));
+            }
+        }
+    }
+#endif
+    std::sort(nodeCpus.begin(), nodeCpus.end());
+    std::vector<int> cpus;
+    for (size_t i = 0; i < nodeCpus.size(); i++) {
+        cpus.push_back(nodeCpus[i].second);
+    }
+    return cpus;
+}
+
+bool MemoryPlacement::pinThread(int cpu) {
+    return setAffinity(std::vector<int>(1, cpu));
+}
+
+bool MemoryPlacement::setAffinity(const std::vector<int> &cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpus.size(); i++) {
+        if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE) {
+            CPU_SET(cpus[i], &set);
+        }
+    }
+    return CPU_COUNT(&set) > 0 && sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void) cpus;
+    return false;
+#endif
+}
+
+size_t MemoryPlacement::getHugePageBytes(const void *ptr, size_t size) {
+    size_t hugeBytes = 0;
+#ifdef __linux__
+    FILE *file = fopen("/proc/self/smaps", "r");
+    if (file == NULL) {
+        return 0;
+    }
+    const uintptr_t rangeStart = (uintptr_t) ptr;
+    const uintptr_t rangeEnd = rangeStart + size;
+    uintptr_t mapStart = 0;
+    uintptr_t mapEnd = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        unsigned long start, end;
+        size_t kb;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            mapStart = start;
+            mapEnd = end;
+        } else if (sscanf(line, "AnonHugePages: %zu kB", &kb) == 1
+                   || sscanf(line, "FilePmdMapped: %zu kB", &kb) == 1
+                   || sscanf(line, "Private_Hugetlb: %zu kB", &kb) == 1) {
+            const uintptr_t overlapStart = std::max(mapStart, rangeStart);
+            const uintptr_t overlapEnd = std::min(mapEnd, rangeEnd);
+            if (kb > 0 && overlapStart < overlapEnd) {
+                // smaps only reports the total of each mapping
+                const double fraction = (double) (overlapEnd - overlapStart) / (double) (mapEnd - mapStart);
+                hugeBytes += (size_t) (kb * 1024 * fraction);
+            }
+        }
+    }
+    fclose(file);
+#else
+    (void) ptr; (void) size;
+#endif
+    return std::min(hugeBytes, size);
+}
+
+std::vector<size_t> MemoryPlacement::getPagesPerNode(const void *ptr, size_t size, size_t sampleCount) {
+    std::vector<size_t> pages(getNodeCount(), 0);
+#if defined(__linux__) && defined(SYS_move_pages)
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    const size_t pageCount = size / pageSize;
+    if (pageCount == 0) {
+        return pages;
+    }
+    sampleCount = std::min(sampleCount, pageCount);
+    const char *start = (const char *) (((uintptr_t) ptr + pageSize - 1) & ~(uintptr_t) (pageSize - 1));
+    std::vector<void *> addresses(sampleCount);
+    std::vector<int> status(sampleCount, -1);
+    for (size_t i = 0; i < sampleCount; i++) {
+        addresses[i] = (void *) (start + (i * (pageCount - 1) / std::max(sampleCount - 1, (size_t) 1)) * pageSize);
+    }
+    // without target nodes move_pages only reports the node of each page
+    if (syscall(SYS_move_pages, 0, sampleCount, addresses.data(), NULL, status.data(), 0) != 0) {
+        return pages;
+    }
+    for (size_t i = 0; i < sampleCount; i++) {
+        if (status[i] >= 0 && (size_t) status[i] < pages.size()) {
+            pages[status[i]]++;
+        }
+    }
+#else
+    (void) ptr; (void) size; (void) sampleCount;
+#endif
+    return pages;
+}
+
+#ifdef __linux__
+static int openTlbEvent(unsigned long long result) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // pid 0 and cpu -1 count the calling thread on any cpu
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t readEvent(int fd) {
+    uint64_t value = 0;
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) {
+        return 0;
+    }
+    return value;
+}
+#endif
+
+TlbCounter::TlbCounter() : missFd(-1), loadFd(-1) {
+#ifdef __linux__
+    missFd = openTlbEvent(PERF_COUNT_HW_CACHE_RESULT_MISS);
+    loadFd = openTlbEvent(PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+#endif
+}
+
+TlbCounter::~TlbCounter() {
+    if (missFd >= 0) {
+        close(missFd);
+    }
+    if (loadFd >= 0) {
+        close(loadFd);
+    }
+}
+
+bool TlbCounter::isAvailable() const {
+    return missFd >= 0;
+}
+
+uint64_t TlbCounter::getMisses() const {
+#ifdef __linux__
+    return readEvent(missFd);
+#else
+    return 0;
+#endif
+}
+
+uint64_t TlbCounter::getLoads() const {
+#ifdef __linux__
+    return readEvent(loadFd);
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,68 @@
+#ifndef MMSEQS_MEMORYPLACEMENT_H
+#define MMSEQS_MEMORYPLACEMENT_H
+
+// Places large read-only tables (e.g. the prefilter index) in anonymous memory,
+// optionally backed by huge pages and interleaved over or bound to NUMA nodes.
+// Also provides the counters needed to report the effect of the placement.
+// Outside of Linux huge pages and NUMA placement are not available and all calls fall back to plain memory.
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+class MemoryPlacement {
+public:
+    static const int HUGE_PAGES_OFF = 0;
+    static const int HUGE_PAGES_TRANSPARENT = 1;
+    static const int HUGE_PAGES_EXPLICIT = 2;
+
+    // special nodes for allocate
+    static const int NODE_ANY = -1;
+    static const int NODE_INTERLEAVE = -2;
+
+    static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    // returns NULL if the memory could not be allocated
+    static char *allocate(size_t size, int hugePages, int node);
+
+    static void release(char *ptr, size_t size);
+
+    // highest NUMA node id + 1
+    static int getNodeCount();
+
+    static int getNodeOfCpu(int cpu);
+
+    // cpus the process is allowed to run on, grouped by NUMA node
+    static std::vector<int> getAllowedCpus();
+
+    // binds the calling thread to a cpu
+    static bool pinThread(int cpu);
+
+    // lets the calling thread run on the cpus, e.g. to restore the affinity returned by getAllowedCpus after pinThread
+    static bool setAffinity(const std::vector<int> &cpus);
+
+    // bytes of the range that are backed by huge pages
+    static size_t getHugePageBytes(const void *ptr, size_t size);
+
+    // resident pages per NUMA node of an evenly spaced sample of the pages in the range
+    static std::vector<size_t> getPagesPerNode(const void *ptr, size_t size, size_t sampleCount);
+};
+
+// Counts the data TLB load misses and loads of the calling thread
+class TlbCounter {
+public:
+    TlbCounter();
+    ~TlbCounter();
+
+    // false if perf events are not supported or not permitted (see /proc/sys/kernel/perf_event_paranoid)
+    bool isAvailable() const;
+
+    uint64_t getMisses() const;
+    uint64_t getLoads() const;
+
+private:
+    int missFd;
+    int loadFd;
+};
+
+#endif
@@ -3,6 +3,7 @@
 #include "Util.h"
 #include "DistanceCalculator.h"
 #include "Debug.h"
+#include "MemoryGovernor.h"
 
 #include <iomanip>
 #include <regex.h>
@@ -38,16 +39,25 @@ Parameters::Parameters():
         PARAM_MAX_SEQS(PARAM_MAX_SEQS_ID,"--max-seqs", "Max. results per query", "maximum result sequences per query (this parameter affects the sensitivity)",typeid(int),(void *) &maxResListLen, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_COMMON|MMseqsParameter::COMMAND_EXPERT),
         PARAM_SPLIT(PARAM_SPLIT_ID,"--split", "Split DB", "Splits input sets into N equally distributed chunks. The default value sets the best split automatically. createindex can only be used with split 1.",typeid(int),(void *) &split,  "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
         PARAM_SPLIT_MODE(PARAM_SPLIT_MODE_ID,"--split-mode", "Split mode", "0: split target db; 1: split query db;  2: auto, depending on main memory",typeid(int),(void *) &splitMode,  "^[0-2]{1}$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
-        PARAM_SPLIT_MEMORY_LIMIT(PARAM_SPLIT_MEMORY_LIMIT_ID, "--split-memory-limit", "Split Memory Limit", "Maximum system memory in megabyte that one split may use. Defaults (0) to all available system memory.", typeid(int), (void*) &splitMemoryLimit, "^(0|[1-9]{1}[0-9]*)$", MMseqsParameter::COMMAND_COMMON|MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_SPLIT_MEMORY_LIMIT(PARAM_SPLIT_MEMORY_LIMIT_ID, "--split-memory-limit", "Split Memory Limit", "Maximum system memory in megabyte that one split may use. Defaults (0) to all available system memory within the cgroup memory limit.", typeid(int), (void*) &splitMemoryLimit, "^(0|[1-9]{1}[0-9]*)$", MMseqsParameter::COMMAND_COMMON|MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
         PARAM_DISK_SPACE_LIMIT(PARAM_DISK_SPACE_LIMIT_ID, "--disk-space-limit", "Disk space limit", "Set the maximum disk space (in Mb) to use for reverse profile searches. Defaults (0) to all available disk space in the temp folder.", typeid(int), (void*) &diskSpaceLimit, "^(0|[1-9]{1}[0-9]*)$", MMseqsParameter::COMMAND_COMMON|MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
         PARAM_SPLIT_AMINOACID(PARAM_SPLIT_AMINOACID_ID,"--split-aa", "Split by amino acid","Try to find the best split for the target database by amino acid count instead",typeid(bool), (void *) &splitAA, "$", MMseqsParameter::COMMAND_EXPERT),
         PARAM_SUB_MAT(PARAM_SUB_MAT_ID,"--sub-mat", "Sub Matrix", "amino acid substitution matrix file",typeid(std::string),(void *) &scoringMatrixFile, "", MMseqsParameter::COMMAND_COMMON|MMseqsParameter::COMMAND_EXPERT),
         PARAM_NO_COMP_BIAS_CORR(PARAM_NO_COMP_BIAS_CORR_ID,"--comp-bias-corr", "Compositional bias","correct for locally biased amino acid composition [0,1]",typeid(int), (void *) &compBiasCorrection, "^[0-1]{1}$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_PROFILE|MMseqsParameter::COMMAND_EXPERT),
         PARAM_SPACED_KMER_MODE(PARAM_SPACED_KMER_MODE_ID,"--spaced-kmer-mode", "Spaced Kmer", "0: use consecutive positions a k-mers; 1: use spaced k-mers",typeid(int), (void *) &spacedKmer,  "^[0-1]{1}", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
         PARAM_REMOVE_TMP_FILES(PARAM_REMOVE_TMP_FILES_ID, "--remove-tmp-files", "Remove Temporary Files" , "Delete temporary files", typeid(bool), (void *) &removeTmpFiles, "",MMseqsParameter::COMMAND_EXPERT),
+        PARAM_COMPRESSED(PARAM_COMPRESSED_ID, "--compressed", "Compressed", "Write compressed result databases (zlib per entry), they are decompressed transparently when read [0,1]", typeid(int), (void *) &compressed, "^[0-1]{1}$", MMseqsParameter::COMMAND_MISC|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_BINARY_RESULTS(PARAM_BINARY_RESULTS_ID, "--binary-results", "Binary results", "Write results as binary records instead of text, readable by align, clust, result2profile, convertalis and result2text [0,1]", typeid(int), (void *) &binaryResults, "^[0-1]{1}$", MMseqsParameter::COMMAND_MISC|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_SHARD_DIRS(PARAM_SHARD_DIRS_ID, "--shard-dirs", "Shard directories", "Write the output database as one shard per thread, distributed over these comma separated directories (e.g. on different disks), instead of merging them into one data file", typeid(std::string), (void *) &shardDirs, "", MMseqsParameter::COMMAND_MISC|MMseqsParameter::COMMAND_EXPERT),
         PARAM_INCLUDE_IDENTITY(PARAM_INCLUDE_IDENTITY_ID,"--add-self-matches", "Include identical Seq. Id.","artificially add entries of queries with themselves (for clustering)",typeid(bool), (void *) &includeIdentity, "", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
         PARAM_RES_LIST_OFFSET(PARAM_RES_LIST_OFFSET_ID,"--offset-result", "Offset result","Offset result list",typeid(int), (void *) &resListOffset, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
         PARAM_PRELOAD_MODE(PARAM_PRELOAD_MODE_ID, "--db-load-mode", "Preload mode", "Database preload mode 0: auto, 1: fread, 2: mmap, 3: mmap+touch", typeid(int), (void*) &preloadMode, "[0-3]{1}", MMseqsParameter::COMMAND_MISC|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_HUGE_PAGES(PARAM_HUGE_PAGES_ID, "--huge-pages", "Huge pages", "Back the prefilter index with huge pages 0: off, 1: transparent, 2: explicit (reserved in /proc/sys/vm/nr_hugepages)", typeid(int), (void*) &hugePages, "^[0-2]{1}$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_NUMA_MODE(PARAM_NUMA_MODE_ID, "--numa-mode", "NUMA mode", "NUMA placement of the prefilter index 0: first touch, 1: interleave over all nodes, 2: replicate per node and pin threads", typeid(int), (void*) &numaMode, "^[0-2]{1}$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_QUERY_BATCH_SIZE(PARAM_QUERY_BATCH_SIZE_ID, "--query-batch-size", "Query batch size", "Experimental, slower than no batching so far: number of queries per thread whose k-mer lists are looked up in one pass over the prefilter index (1: no batching). Only for sequence queries", typeid(int), (void*) &queryBatchSize, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_SPARSE_INDEX(PARAM_SPARSE_INDEX_ID, "--sparse-index", "Sparse index", "Store only a subset of the target k-mers in the prefilter index, queries still use all k-mers 0: all k-mers, 1: minimizers, 2: open syncmers. Only for sequence databases", typeid(int), (void*) &sparseIndex, "^[0-2]{1}$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_SPARSE_WINDOW(PARAM_SPARSE_WINDOW_ID, "--sparse-window", "Sparse index window", "Minimizers: the smallest k-mer of each window of w consecutive k-mers is stored. Open syncmers: a k-mer is stored if its smallest (k-w+1)-mer is its first one", typeid(int), (void*) &sparseWindow, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_MAX_KMERS_PER_POS(PARAM_MAX_KMERS_PER_POS_ID, "--max-kmers-per-pos", "Max k-mers per position", "Adaptive k-mer threshold: keep only the N highest scoring similar k-mers and the exact k-mer of each query position (0: fixed threshold)", typeid(int), (void*) &maxKmersPerPos, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
         PARAM_SPACED_KMER_PATTERN(PARAM_SPACED_KMER_PATTERN_ID, "--spaced-kmer-pattern", "Spaced k-mer pattern", "User-specified spaced k-mer pattern", typeid(std::string), (void *) &spacedKmerPattern, "^1[01]*1$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
 
         // alignment
@@ -66,6 +76,9 @@ Parameters::Parameters():
         PARAM_ALT_ALIGNMENT(PARAM_ALT_ALIGNMENT_ID,"--alt-ali", "Alternative alignments","Show up to this many alternative alignments",typeid(int), (void *) &altAlignment, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN),
         PARAM_GAP_OPEN(PARAM_GAP_OPEN_ID,"--gap-open", "Gap open cost","Gap open cost",typeid(int), (void *) &gapOpen, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
         PARAM_GAP_EXTEND(PARAM_GAP_EXTEND_ID,"--gap-extend", "Gap extension cost","Gap extension cost",typeid(int), (void *) &gapExtend, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_LONG_GAP_OPEN(PARAM_LONG_GAP_OPEN_ID,"--long-gap-open", "Long gap open cost","Open cost of a second affine gap cost for nucleotide alignments, a gap costs the minimum of both gap costs (0: one gap cost)",typeid(int), (void *) &longGapOpen, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_LONG_GAP_EXTEND(PARAM_LONG_GAP_EXTEND_ID,"--long-gap-extend", "Long gap extension cost","Extension cost of the second affine gap cost for nucleotide alignments, a gap costs the minimum of both gap costs (0: one gap cost)",typeid(int), (void *) &longGapExtend, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_BAND_WIDTH(PARAM_BAND_WIDTH_ID,"--band-width", "Band width","Align protein hits of long targets first in a band of this half width around the prefilter diagonal. The band is widened while the alignment reaches its border, before falling back to full Smith-Waterman (0: always full Smith-Waterman)",typeid(int), (void *) &bandWidth, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
 
         // clustering
         PARAM_CLUSTER_MODE(PARAM_CLUSTER_MODE_ID,"--cluster-mode", "Cluster mode", "0: Setcover, 1: connected component, 2: Greedy clustering by sequence length  3: Greedy clustering by sequence length (low mem)",typeid(int), (void *) &clusteringMode, "[0-3]{1}$", MMseqsParameter::COMMAND_CLUST),
@@ -137,6 +150,8 @@ Parameters::Parameters():
         PARAM_STRAND(PARAM_STRAND_ID, "--strand", "Strand selection", "Strand selection only works for DNA/DNA search 0: reverse, 1: forward, 2: both", typeid(int), (void *) &strand, "^[0-2]{1}$", MMseqsParameter::COMMAND_EXPERT),
         // easysearch
         PARAM_GREEDY_BEST_HITS(PARAM_GREEDY_BEST_HITS_ID, "--greedy-best-hits", "Greedy best hits", "Choose the best hits greedily to cover the query.", typeid(bool), (void*)&greedyBestHits, ""),
+        PARAM_STREAM_QUERIES(PARAM_STREAM_QUERIES_ID, "--stream-queries", "Stream queries", "Read the query FASTA/FASTQ in batches and search them without a query database (only single step searches against amino acid targets) [0,1]", typeid(int), (void*)&streamQueries, "^[0-1]{1}$", MMseqsParameter::COMMAND_EXPERT),
+        PARAM_STREAM_BATCH_SIZE(PARAM_STREAM_BATCH_SIZE_ID, "--stream-batch-size", "Stream batch size", "Number of query sequences that are read, searched and written out together when streaming queries", typeid(int), (void*)&streamBatchSize, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_EXPERT),
         // Orfs
         PARAM_ORF_MIN_LENGTH(PARAM_ORF_MIN_LENGTH_ID, "--min-length", "Min codons in orf", "minimum codon number in open reading frames",typeid(int),(void *) &orfMinLength, "^[1-9]{1}[0-9]*$"),
         PARAM_ORF_MAX_LENGTH(PARAM_ORF_MAX_LENGTH_ID, "--max-length", "Max codons in length", "maximum codon number in open reading frames",typeid(int),(void *) &orfMaxLength, "^[1-9]{1}[0-9]*$"),
@@ -150,11 +165,13 @@ Parameters::Parameters():
         // indexdb
         PARAM_INCLUDE_HEADER(PARAM_INCLUDE_HEADER_ID, "--include-headers", "Include Header", "Include the header index into the index", typeid(bool), (void *) &includeHeader, ""),
         PARAM_CHECK_COMPATIBLE(PARAM_CHECK_COMPATIBLE_ID, "--check-compatible", "Check Compatible", "Skip recreating an index if it is compatible with the specified parameters", typeid(bool), (void*) &checkCompatible, "", COMMAND_EXPERT),
+        PARAM_COMPRESS_INDEX(PARAM_COMPRESS_INDEX_ID, "--compress-index", "Compress index", "Store the k-mer index delta/varint compressed to reduce its memory usage", typeid(bool), (void*) &compressIndex, ""),
         // createdb
         PARAM_USE_HEADER(PARAM_USE_HEADER_ID,"--use-fasta-header", "Use fasta header", "use the id parsed from the fasta header as the index key instead of using incrementing numeric identifiers",typeid(bool),(void *) &useHeader, ""),
         PARAM_ID_OFFSET(PARAM_ID_OFFSET_ID, "--id-offset", "Offset of numeric ids", "numeric ids in index file are offset by this value ",typeid(int),(void *) &identifierOffset, "^(0|[1-9]{1}[0-9]*)$"),
         PARAM_DONT_SPLIT_SEQ_BY_LEN(PARAM_DONT_SPLIT_SEQ_BY_LEN_ID,"--dont-split-seq-by-len", "Split Seq. by len", "Dont split sequences by --max-seq-len",typeid(bool),(void *) &splitSeqByLen, ""),
         PARAM_DONT_SHUFFLE(PARAM_DONT_SHUFFLE_ID,"--dont-shuffle", "Do not shuffle input database", "Do not shuffle input database",typeid(bool),(void *) &shuffleDatabase, ""),
+        PARAM_BINARY_INDEX(PARAM_BINARY_INDEX_ID,"--binary-index", "Write binary index", "Also write a binary index (<DB>.index.bin), which is mapped instead of parsing the text index",typeid(bool),(void *) &binaryIndex, ""),
         PARAM_USE_HEADER_FILE(PARAM_USE_HEADER_FILE_ID, "--use-header-file", "Use ffindex header", "use the ffindex header file instead of the body to map the entry keys",typeid(bool),(void *) &useHeaderFile, ""),
         // splitsequence
         PARAM_SEQUENCE_OVERLAP(PARAM_SEQUENCE_OVERLAP_ID, "--sequence-overlap", "Overlap between sequences", "overlap between sequences",typeid(int),(void *) &sequenceOverlap, "^(0|[1-9]{1}[0-9]*)$"),
@@ -248,7 +265,13 @@ Parameters::Parameters():
     align.push_back(PARAM_SCORE_BIAS);
     align.push_back(PARAM_GAP_OPEN);
     align.push_back(PARAM_GAP_EXTEND);
+    align.push_back(PARAM_LONG_GAP_OPEN);
+    align.push_back(PARAM_LONG_GAP_EXTEND);
+    align.push_back(PARAM_BAND_WIDTH);
     align.push_back(PARAM_THREADS);
+    align.push_back(PARAM_COMPRESSED);
+    align.push_back(PARAM_BINARY_RESULTS);
+    align.push_back(PARAM_SHARD_DIRS);
     align.push_back(PARAM_V);
 
     // prefilter
@@ -273,10 +296,19 @@ Parameters::Parameters():
     prefilter.push_back(PARAM_INCLUDE_IDENTITY);
     prefilter.push_back(PARAM_SPACED_KMER_MODE);
     prefilter.push_back(PARAM_PRELOAD_MODE);
+    prefilter.push_back(PARAM_HUGE_PAGES);
+    prefilter.push_back(PARAM_NUMA_MODE);
+    prefilter.push_back(PARAM_QUERY_BATCH_SIZE);
+    prefilter.push_back(PARAM_SPARSE_INDEX);
+    prefilter.push_back(PARAM_SPARSE_WINDOW);
+    prefilter.push_back(PARAM_MAX_KMERS_PER_POS);
     prefilter.push_back(PARAM_PCA);
     prefilter.push_back(PARAM_PCB);
     prefilter.push_back(PARAM_SPACED_KMER_PATTERN);
     prefilter.push_back(PARAM_THREADS);
+    prefilter.push_back(PARAM_COMPRESSED);
+    prefilter.push_back(PARAM_BINARY_RESULTS);
+    prefilter.push_back(PARAM_SHARD_DIRS);
     prefilter.push_back(PARAM_V);
 
     // ungappedprefilter
@@ -294,6 +326,7 @@ Parameters::Parameters():
     clust.push_back(PARAM_MAXITERATIONS);
     clust.push_back(PARAM_SIMILARITYSCORE);
     clust.push_back(PARAM_THREADS);
+    clust.push_back(PARAM_COMPRESSED);
     clust.push_back(PARAM_V);
 
     // onlyverbosity
@@ -530,6 +563,9 @@ Parameters::Parameters():
     indexdb.push_back(PARAM_K_SCORE);
     indexdb.push_back(PARAM_INCLUDE_HEADER);
     indexdb.push_back(PARAM_CHECK_COMPATIBLE);
+    indexdb.push_back(PARAM_COMPRESS_INDEX);
+    indexdb.push_back(PARAM_SPARSE_INDEX);
+    indexdb.push_back(PARAM_SPARSE_WINDOW);
     indexdb.push_back(PARAM_SPLIT);
     indexdb.push_back(PARAM_SPLIT_MEMORY_LIMIT);
     indexdb.push_back(PARAM_THREADS);
@@ -539,7 +575,10 @@ Parameters::Parameters():
     createdb.push_back(PARAM_MAX_SEQ_LEN);
     createdb.push_back(PARAM_DONT_SPLIT_SEQ_BY_LEN);
     createdb.push_back(PARAM_DONT_SHUFFLE);
+    createdb.push_back(PARAM_BINARY_INDEX);
     createdb.push_back(PARAM_ID_OFFSET);
+    createdb.push_back(PARAM_SHARD_DIRS);
+    createdb.push_back(PARAM_THREADS);
     createdb.push_back(PARAM_V);
 
     // convert2fasta
@@ -749,8 +788,20 @@ Parameters::Parameters():
     sortresult.push_back(PARAM_THREADS);
     sortresult.push_back(PARAM_V);
 
+    // searchserver
+    searchserver = combineList(align, prefilter);
+    searchserver = removeParameter(searchserver, PARAM_BINARY_RESULTS);
+
+    // streamsearch
+    streamsearch = combineList(align, prefilter);
+    streamsearch = removeParameter(streamsearch, PARAM_BINARY_RESULTS);
+    streamsearch = combineList(streamsearch, convertalignments);
+    streamsearch.push_back(PARAM_STREAM_BATCH_SIZE);
+
     // WORKFLOWS
     searchworkflow = combineList(align, prefilter);
+    // the workflows pass the results to modules that only read text results, e.g. mergedbs and summarizeresult
+    searchworkflow = removeParameter(searchworkflow, PARAM_BINARY_RESULTS);
     searchworkflow = combineList(searchworkflow, rescorediagonal);
     searchworkflow = combineList(searchworkflow, result2profile);
     searchworkflow = combineList(searchworkflow, extractorfs);
@@ -771,6 +822,8 @@ Parameters::Parameters():
     easysearchworkflow = combineList(easysearchworkflow, summarizeresult);
     easysearchworkflow = combineList(easysearchworkflow, createdb);
     easysearchworkflow.push_back(PARAM_GREEDY_BEST_HITS);
+    easysearchworkflow.push_back(PARAM_STREAM_QUERIES);
+    easysearchworkflow.push_back(PARAM_STREAM_BATCH_SIZE);
 
     // createindex workflow
     createindex = combineList(indexdb, extractorfs);
@@ -779,6 +832,7 @@ Parameters::Parameters():
 
     // linclust workflow
     linclustworkflow = combineList(clust, align);
+    linclustworkflow = removeParameter(linclustworkflow, PARAM_BINARY_RESULTS);
     linclustworkflow = combineList(linclustworkflow, kmermatcher);
     linclustworkflow = combineList(linclustworkflow, rescorediagonal);
     linclustworkflow.push_back(PARAM_REMOVE_TMP_FILES);
@@ -789,6 +843,7 @@ Parameters::Parameters():
 
     // clustering workflow
     clusterworkflow = combineList(prefilter, align);
+    clusterworkflow = removeParameter(clusterworkflow, PARAM_BINARY_RESULTS);
     clusterworkflow = combineList(clusterworkflow, rescorediagonal);
     clusterworkflow = combineList(clusterworkflow, clust);
     clusterworkflow.push_back(PARAM_CASCADED);
@@ -822,6 +877,7 @@ Parameters::Parameters():
     clusterUpdate.push_back(PARAM_RECOVER_DELETED);
 
     mapworkflow = combineList(prefilter, rescorediagonal);
+    mapworkflow = removeParameter(mapworkflow, PARAM_BINARY_RESULTS);
     mapworkflow = combineList(mapworkflow, extractorfs);
     mapworkflow = combineList(mapworkflow, translatenucs);
     mapworkflow.push_back(PARAM_START_SENS);
@@ -832,6 +888,7 @@ Parameters::Parameters():
     enrichworkflow = combineList(searchworkflow, prefilter);
     enrichworkflow = combineList(enrichworkflow, subtractdbs);
     enrichworkflow = combineList(enrichworkflow, align);
+    enrichworkflow = removeParameter(enrichworkflow, PARAM_BINARY_RESULTS);
     enrichworkflow = combineList(enrichworkflow, expandaln);
     enrichworkflow = combineList(enrichworkflow, result2profile);
     enrichworkflow.push_back(PARAM_NUM_ITERATIONS);
@@ -1131,6 +1188,9 @@ void Parameters::parseParameters(int argc, const char* pargv[],
     threads = 1;
 #endif
 
+    // --split-memory-limit bounds all memory the process sizes itself to
+    MemoryGovernor::setUserLimit(static_cast<size_t>(splitMemoryLimit) * 1024 * 1024);
+
 
     const size_t MAX_DB_PARAMETER = 6;
 
@@ -1284,6 +1344,8 @@ void Parameters::setDefaults() {
     strand = 1;
 
     greedyBestHits = false;
+    streamQueries = 0;
+    streamBatchSize = 100000;
 
     threads = 1;
 #ifdef OPENMP
@@ -1312,13 +1374,22 @@ void Parameters::setDefaults() {
     altAlignment = 0;
     gapOpen = 11;
     gapExtend = 1;
+    longGapOpen = 0;
+    longGapExtend = 0;
     addBacktrace = false;
     realign = false;
+    bandWidth = 0;
     clusteringMode = SET_COVER;
     cascaded = true;
     clusterSteps = 3;
     resListOffset = 0;
     preloadMode = 0;
+    hugePages = 0;
+    numaMode = NUMA_MODE_FIRST_TOUCH;
+    queryBatchSize = 1;
+    sparseIndex = 0;
+    sparseWindow = 4;
+    maxKmersPerPos = 0;
     scoreBias = 0.0;
 
     // affinity clustering
@@ -1335,6 +1406,9 @@ void Parameters::setDefaults() {
 
     // Clustering workflow
     removeTmpFiles = false;
+    compressed = 0;
+    binaryResults = 0;
+    shardDirs = "";
 
     // convertprofiledb
     profileMode = PROFILE_MODE_HMM;
@@ -1342,10 +1416,12 @@ void Parameters::setDefaults() {
     // indexdb
     includeHeader = false;
     checkCompatible = false;
+    compressIndex = false;
 
     // createdb
     splitSeqByLen = true;
     shuffleDatabase = true;
+    binaryIndex = false;
 
     // format alignment
     formatAlignmentMode = FORMAT_ALIGNMENT_BLAST_TAB;
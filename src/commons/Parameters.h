@@ -120,6 +120,11 @@ public:
     static const int PRELOAD_MODE_MMAP = 2;
     static const int PRELOAD_MODE_MMAP_TOUCH = 3;
 
+    // numa mode
+    static const int NUMA_MODE_FIRST_TOUCH = 0;
+    static const int NUMA_MODE_INTERLEAVE = 1;
+    static const int NUMA_MODE_REPLICATE = 2;
+
 
     static std::string getSplitModeName(int splitMode) {
         switch (splitMode) {
@@ -217,6 +222,9 @@ public:
 //    int    targetSeqType;                // Target sequence type (PROFILE, AMINOACIDE, NUCLEOTIDE)
     int    threads;                      // Amounts of threads
     bool   removeTmpFiles;               // Do not delete temp files
+    int    compressed;                   // Compress the entries of result databases
+    int    binaryResults;                // Write results as binary records
+    std::string shardDirs;               // Directories for the data shards of result databases
     bool   includeIdentity;              // include identical ids as hit
 
     // PREFILTER
@@ -240,6 +248,12 @@ public:
     bool   splitAA;                      // Split database by amino acid count instead
     size_t resListOffset;                // Offsets result list
     int    preloadMode;                  // Preload mode of database
+    int    hugePages;                    // Back the prefilter index with huge pages
+    int    numaMode;                     // NUMA placement of the prefilter index
+    int    queryBatchSize;               // Queries matched together in one pass over the prefilter index
+    int    sparseIndex;                  // Store only minimizers or syncmers of the targets in the prefilter index
+    int    sparseWindow;                 // Window of the minimizers or syncmers of a sparse index
+    int    maxKmersPerPos;               // Raise the k-mer threshold of query positions with more similar k-mers
     float  scoreBias;			 // Add this bias to the score when computing the alignements
     std::string spacedKmerPattern;             // User-specified kmer pattern
 
@@ -257,8 +271,11 @@ public:
     float  seqIdThr;                     // sequence identity threshold for acceptance
     bool   addBacktrace;                 // store backtrace string (M=Match, D=deletion, I=insertion)
     bool   realign;                      // realign hit with more conservative score
+    int    bandWidth;                    // half width of the band around the prefilter diagonal, 0 for full SW
 	int    gapOpen;                      // gap open
     int    gapExtend;                    // gap extend
+    int    longGapOpen;                  // open cost of the second gap cost of nucleotide alignments
+    int    longGapExtend;                // extension cost of the second gap cost of nucleotide alignments
 
     // workflow
     std::string runner;
@@ -277,6 +294,8 @@ public:
 
     // easysearch
     bool greedyBestHits;
+    int streamQueries;
+    int streamBatchSize;
 
     //CLUSTERING
     int maxIteration;                   // Maximum depth of breadth first search in connected component
@@ -357,11 +376,13 @@ public:
     // indexdb
     bool includeHeader;
     bool checkCompatible;
+    bool compressIndex;
 
     // createdb
     int identifierOffset;
     bool splitSeqByLen;
     bool shuffleDatabase;
+    bool binaryIndex;
 
     // splitsequence
     int sequenceOverlap;
@@ -498,9 +519,18 @@ public:
     PARAMETER(PARAM_NO_COMP_BIAS_CORR)
     PARAMETER(PARAM_SPACED_KMER_MODE)
     PARAMETER(PARAM_REMOVE_TMP_FILES)
+    PARAMETER(PARAM_COMPRESSED)
+    PARAMETER(PARAM_BINARY_RESULTS)
+    PARAMETER(PARAM_SHARD_DIRS)
     PARAMETER(PARAM_INCLUDE_IDENTITY)
     PARAMETER(PARAM_RES_LIST_OFFSET)
     PARAMETER(PARAM_PRELOAD_MODE)
+    PARAMETER(PARAM_HUGE_PAGES)
+    PARAMETER(PARAM_NUMA_MODE)
+    PARAMETER(PARAM_QUERY_BATCH_SIZE)
+    PARAMETER(PARAM_SPARSE_INDEX)
+    PARAMETER(PARAM_SPARSE_WINDOW)
+    PARAMETER(PARAM_MAX_KMERS_PER_POS)
     PARAMETER(PARAM_SPACED_KMER_PATTERN)
     std::vector<MMseqsParameter> prefilter;
     std::vector<MMseqsParameter> ungappedprefilter;
@@ -520,6 +550,9 @@ public:
     PARAMETER(PARAM_ALT_ALIGNMENT)
     PARAMETER(PARAM_GAP_OPEN)
     PARAMETER(PARAM_GAP_EXTEND)
+    PARAMETER(PARAM_LONG_GAP_OPEN)
+    PARAMETER(PARAM_LONG_GAP_EXTEND)
+    PARAMETER(PARAM_BAND_WIDTH)
     std::vector<MMseqsParameter> align;
 
     // clustering
@@ -609,6 +642,8 @@ public:
 
     // easysearch
     PARAMETER(PARAM_GREEDY_BEST_HITS)
+    PARAMETER(PARAM_STREAM_QUERIES)
+    PARAMETER(PARAM_STREAM_BATCH_SIZE)
 
     // extractorfs
     PARAMETER(PARAM_ORF_MIN_LENGTH)
@@ -624,12 +659,14 @@ public:
     // indexdb
     PARAMETER(PARAM_INCLUDE_HEADER)
     PARAMETER(PARAM_CHECK_COMPATIBLE)
+    PARAMETER(PARAM_COMPRESS_INDEX)
 
     // createdb
     PARAMETER(PARAM_USE_HEADER) // also used by extractorfs
     PARAMETER(PARAM_ID_OFFSET)  // same
     PARAMETER(PARAM_DONT_SPLIT_SEQ_BY_LEN)
     PARAMETER(PARAM_DONT_SHUFFLE)
+    PARAMETER(PARAM_BINARY_INDEX)
 
     // convert2fasta
     PARAMETER(PARAM_USE_HEADER_FILE)
@@ -749,6 +786,8 @@ public:
     std::vector<MMseqsParameter> linclustworkflow;
     std::vector<MMseqsParameter> easysearchworkflow;
     std::vector<MMseqsParameter> searchworkflow;
+    std::vector<MMseqsParameter> searchserver;
+    std::vector<MMseqsParameter> streamsearch;
     std::vector<MMseqsParameter> mapworkflow;
     std::vector<MMseqsParameter> easyclusterworkflow;
     std::vector<MMseqsParameter> clusterworkflow;
@@ -180,6 +180,10 @@ public:
     static const int HMM_PROFILE = 2;
     static const int PROFILE_STATE_SEQ = 3;
     static const int PROFILE_STATE_PROFILE = 4;
+    // result databases written with --binary-results, see QueryMatcher::prefilterHitToBinaryBuffer
+    // and Matcher::resultToBinaryBuffer
+    static const int PREFILTER_RES_BINARY = 5;
+    static const int ALIGNMENT_RES_BINARY = 6;
 
     // submat
     BaseMatrix * subMat;
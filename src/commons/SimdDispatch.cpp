@@ -0,0 +1,61 @@
+#include "SimdDispatch.h"
+#ifdef RUNTIME_DISPATCH
+#include "CpuInfo.h"
+#endif
+
+int SimdDispatch::forcedLevel = -1;
+
+#ifdef RUNTIME_DISPATCH
+static int detectLevel() {
+    CpuInfo info;
+    if (info.HW_AVX512F && info.HW_AVX512BW && info.OS_AVX512) {
+        return SimdDispatch::LEVEL_AVX512BW;
+    }
+    if (info.HW_AVX2 && info.OS_AVX) {
+        return SimdDispatch::LEVEL_AVX2;
+    }
+    return SimdDispatch::LEVEL_SSE41;
+}
+#endif
+
+int SimdDispatch::getSupportedLevel() {
+#if defined(RUNTIME_DISPATCH)
+    static const int level = detectLevel();
+    return level;
+#elif defined(AVX512)
+    return LEVEL_AVX512BW;
+#elif defined(AVX2)
+    return LEVEL_AVX2;
+#else
+    return LEVEL_SSE41;
+#endif
+}
+
+int SimdDispatch::getLevel() {
+    const int supported = getSupportedLevel();
+    if (forcedLevel != -1 && forcedLevel < supported) {
+        return forcedLevel;
+    }
+    return supported;
+}
+
+void SimdDispatch::setLevel(int level) {
+    forcedLevel = level;
+}
+
+const char *SimdDispatch::getLevelName(int level) {
+#ifdef NEON
+    (void) level;
+    return "NEON";
+#else
+    switch (level) {
+        case LEVEL_AVX512BW:
+            return "AVX-512BW";
+        case LEVEL_AVX2:
+            return "AVX2";
+        case LEVEL_SSE41:
+        default:
+            return "SSE4.1";
+    }
+#endif
+}
@@ -0,0 +1,60 @@
+#ifndef MMSEQS_SIMDDISPATCH_H
+#define MMSEQS_SIMDDISPATCH_H
+
+#include "simd.h"
+
+// SIMD kernels are compiled once per instruction set into their own namespace (SIMD_NAMESPACE)
+// and export a const table of function pointers.
+// A binary build with -DHAVE_RUNTIME_DISPATCH=1 contains the SSE4.1, AVX2 and AVX-512BW kernels
+// and picks the widest one the CPU and OS support at runtime.
+// Other builds only contain the kernels of the instruction set they were compiled for.
+// Kernels without an AVX-512 version are selected with SIMD_KERNEL_AVX2 and keep using AVX2 there.
+
+// declares a kernel table for every instruction set
+#define SIMD_KERNEL_DECLARE(type, name)              \
+    namespace simd_sse41 { extern const type name; } \
+    namespace simd_avx2 { extern const type name; }  \
+    namespace simd_avx512 { extern const type name; } \
+    namespace simd_neon { extern const type name; }
+
+#ifdef RUNTIME_DISPATCH
+#define SIMD_KERNEL(name) SimdDispatch::select(&simd_sse41::name, &simd_avx2::name, &simd_avx512::name)
+#define SIMD_KERNEL_AVX2(name) SimdDispatch::select(&simd_sse41::name, &simd_avx2::name, &simd_avx2::name)
+#else
+#define SIMD_KERNEL(name) (&SIMD_NAMESPACE::name)
+#define SIMD_KERNEL_AVX2(name) (&SIMD_NAMESPACE::name)
+#endif
+
+class SimdDispatch {
+public:
+    enum Level {
+        LEVEL_SSE41 = 0,
+        LEVEL_AVX2 = 1,
+        LEVEL_AVX512BW = 2
+    };
+
+    // instruction set used by SIMD_KERNEL
+    static int getLevel();
+
+    // widest instruction set that is compiled in and supported by the machine
+    static int getSupportedLevel();
+
+    // restrict kernels to a lower level, used by tests and benchmarks to compare kernels
+    static void setLevel(int level);
+
+    static const char *getLevelName(int level);
+
+    template<typename T>
+    static T *select(T *sse41, T *avx2, T *avx512) {
+        const int level = getLevel();
+        if (level >= LEVEL_AVX512BW) {
+            return avx512;
+        }
+        return (level >= LEVEL_AVX2) ? avx2 : sse41;
+    }
+
+private:
+    static int forcedLevel;
+};
+
+#endif
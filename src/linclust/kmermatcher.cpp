@@ -16,6 +16,7 @@
 #include "FileUtil.h"
 #include "Timer.h"
 #include "tantan.h"
+#include "MemoryGovernor.h"
 
 #include <limits>
 #include <string>
@@ -374,12 +375,7 @@ int kmermatcher(int argc, const char **argv, const Command &command) {
     const size_t KMER_SIZE = par.kmerSize;
     size_t chooseTopKmer = par.kmersPerSequence;
 
-    size_t memoryLimit;
-    if (par.splitMemoryLimit > 0) {
-        memoryLimit = static_cast<size_t>(par.splitMemoryLimit) * 1024;
-    } else {
-        memoryLimit = static_cast<size_t>(Util::getTotalSystemMemory() * 0.9);
-    }
+    const size_t memoryLimit = MemoryGovernor::getAvailable();
     Debug(Debug::INFO) << "\n";
     size_t totalKmers = computeKmerCount(seqDbr, KMER_SIZE, chooseTopKmer);
     size_t totalSizeNeeded = computeMemoryNeededLinearfilter(totalKmers);
@@ -235,6 +235,25 @@ std::vector<struct Command> commands = {
                 "<i:queryDB> <i:targetDB> <i:resultDB> <o:alignmentDB>",
                 CITATION_MMSEQS2},
 
+        {"searchserver",         searchserver,         &par.searchserver,         COMMAND_EXPERT,
+                "Keep the target index resident and answer search requests over a unix domain socket",
+                "Loads the index table, sequence lookup and score matrices of an amino acid target DB once and listens on a unix domain socket. Each request of searchclient runs the prefilter and the Smith-Waterman alignment for a query DB against the resident target and writes an alignment DB. Requests are processed one after another using all threads.",
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:targetDB> <socketPath>",
+                CITATION_MMSEQS2},
+        {"searchclient",         searchclient,         &par.onlyverbosity,        COMMAND_EXPERT,
+                "Search a query DB through the target DB of a running searchserver",
+                "Sends the query DB to a searchserver, which writes the alignment DB. Prefilter and alignment parameters are taken from the server.",
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:queryDB> <o:alignmentDB> <socketPath>",
+                CITATION_MMSEQS2},
+        {"streamsearch",         streamsearch,         &par.streamsearch,         COMMAND_EXPERT,
+                "Search a query FASTA/FASTQ through an amino acid target DB in batches without creating a query DB",
+                "Builds the prefilter index of the target DB once and reads the queries (plain, gzip, bzip2 or stdin) in batches of --stream-batch-size sequences. Each batch is prefiltered, aligned and converted to BLAST-tab like convertalis and appended to the output file before the next batch is read, so memory and temporary disk usage are bounded by the batch size.",
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:queryFastaFile[.gz|.bz2]|stdin> <i:targetDB> <o:alignmentFile> <tmpDir>",
+                CITATION_MMSEQS2},
+
         {"alignall",             alignall,             &par.align,                COMMAND_EXPERT,
                 "Compute all against all Smith-Waterman alignments for a results (e.g. prefilter DB, cluster DB)",
                 "Calculates an all against all Smith-Waterman alignment scores between all sequences in a result. It reports all hits which passed the alignment criteria.",
@@ -345,6 +364,12 @@ std::vector<struct Command> commands = {
                 "Milot Mirdita <milot@mirdita.de>",
                 "<i:subsetFile or DB> <i:resultDB> <o:resultDB>",
                 CITATION_MMSEQS2},
+        {"createbinaryindex",    createbinaryindex,    &par.onlyverbosity,        COMMAND_DB,
+                "Write a binary index for an existing DB",
+                "Writes <i:DB>.index.bin with the entries of the text index sorted by key. DBReader maps it directly instead of parsing and sorting the text index. It is ignored once the text index changes.",
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:DB>",
+                CITATION_MMSEQS2},
         {"result2profile",       result2profile,       &par.result2profile,       COMMAND_DB,
                 "Compute profile and consensus DB from a prefilter, alignment or cluster DB",
                 NULL,
@@ -399,6 +424,12 @@ std::vector<struct Command> commands = {
                 "Clovis Galiez & Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
                 "<i:queryDB> <i:targetDB> <i:resultDB> <o:statsDB>",
                 CITATION_MMSEQS2},
+        {"result2text",          result2text,          &par.onlythreads,          COMMAND_DB,
+                "Convert a binary prefilter or alignment DB into the text format",
+                "Binary results are written by prefilter and align with --binary-results 1. Modules that can not read them directly need the text format.",
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:resultDB> <o:resultDB>",
+                CITATION_MMSEQS2},
         {"offsetalignment",         offsetalignment,         &par.onlythreads,         COMMAND_HIDDEN,
                 "Offset alignemnt by orf start position.",
                 NULL,
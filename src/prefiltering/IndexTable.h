@@ -6,6 +6,13 @@
 //
 // Abstract: Index table stores the list of DB sequences containing a certain k-mer, for each k-mer.
 //
+// The lists can be compressed (see compress()). A compressed list starts with the varint encoded list size,
+// followed by the varint encoded seqId difference to the previous entry and the varint encoded position of every entry.
+// The offsets then point to the first byte of each list in compressedEntries.
+//
+// A sparse index (see setSparseMode()) only stores the minimizers or open syncmers of each sequence.
+// The k-mers are ordered by a hash, so that the selection does not prefer low complexity k-mers.
+//
 
 #include "DBReader.h"
 #include "Sequence.h"
@@ -18,6 +25,7 @@
 
 #include <algorithm>
 #include <new>
+#include <stdint.h>
 
 // IndexEntryLocal is an entry with position and seqId for a kmer
 // structure needs to be packed or it will need 8 bytes instead of 6
@@ -63,10 +71,16 @@ struct __attribute__((__packed__)) IndexEntryLocalTmp {
 
 class IndexTable {
 public:
+    // sparse index mode
+    static const int SPARSE_INDEX_OFF = 0;
+    static const int SPARSE_INDEX_MINIMIZER = 1;
+    static const int SPARSE_INDEX_SYNCMER = 2;
+
     IndexTable(int alphabetSize, int kmerSize, bool externalData)
             : tableSize(MathUtil::ipow<size_t>(alphabetSize, kmerSize)), alphabetSize(alphabetSize),
               kmerSize(kmerSize), externalData(externalData), tableEntriesNum(0), size(0),
-              indexer(new Indexer(alphabetSize, kmerSize)), entries(NULL), offsets(NULL) {
+              indexer(new Indexer(alphabetSize, kmerSize)), entries(NULL), offsets(NULL),
+              compressedEntries(NULL), compressed(false), sparseMode(SPARSE_INDEX_OFF), sparseWindow(1) {
         if (externalData == false) {
             offsets = new(std::nothrow) size_t[tableSize + 1];
             memset(offsets, 0, (tableSize + 1) * sizeof(size_t));
@@ -90,6 +104,10 @@ public:
                 delete[] offsets;
                 offsets = NULL;
             }
+            if (compressedEntries != NULL) {
+                free(compressedEntries);
+                compressedEntries = NULL;
+            }
         }
     }
 
@@ -159,6 +177,7 @@ public:
             seqKmerPosBuffer[countKmer] = kmerIdx;
             countKmer++;
         }
+        countKmer = selectSparseKmers(seqKmerPosBuffer, countKmer);
         if(countKmer > 1){
             std::sort(seqKmerPosBuffer, seqKmerPosBuffer + countKmer);
         }
@@ -184,6 +203,72 @@ public:
         return (entries + offsets[kmer]);
     }
 
+    // prefetch the offsets of a k-mer, so that prefetchDBSeqList does not stall on them
+    inline void prefetchOffset(size_t kmer) {
+        __builtin_prefetch(offsets + kmer);
+    }
+
+    // prefetch the start of the list of DB sequences containing this k-mer
+    inline void prefetchDBSeqList(size_t kmer) {
+        if (compressed) {
+            __builtin_prefetch(compressedEntries + offsets[kmer]);
+        } else {
+            __builtin_prefetch(entries + offsets[kmer]);
+        }
+    }
+
+    // get the compressed list of DB sequences containing this k-mer, decode it with decodeDBSeqList
+    inline const unsigned char *getCompressedDBSeqList(size_t kmer, size_t *matchedListSize) {
+        const unsigned char *data = compressedEntries + offsets[kmer];
+        if (offsets[kmer + 1] == offsets[kmer]) {
+            *matchedListSize = 0;
+            return data;
+        }
+        return decodeVarint(data, matchedListSize);
+    }
+
+    static inline void decodeDBSeqList(const unsigned char *data, size_t listSize, IndexEntryLocal *output) {
+        size_t seqId = 0;
+        for (size_t i = 0; i < listSize; i++) {
+            size_t value;
+            data = decodeVarint(data, &value);
+            seqId += value;
+            data = decodeVarint(data, &value);
+            output[i].seqId = static_cast<unsigned int>(seqId);
+            output[i].position_j = static_cast<unsigned short>(value);
+        }
+    }
+
+    bool isCompressed() {
+        return compressed;
+    }
+
+    // replaces the sorted sequence lists with their compressed version
+    void compress() {
+        size_t compressedSize = 0;
+        #pragma omp parallel for reduction(+:compressedSize) schedule(static, 65536)
+        for (size_t i = 0; i < tableSize; i++) {
+            compressedSize += encodeDBSeqList(entries + offsets[i], offsets[i + 1] - offsets[i], NULL);
+        }
+
+        compressedEntries = (unsigned char *) malloc(compressedSize);
+        Util::checkAllocation(compressedEntries, "Could not allocate compressed entries memory in IndexTable::compress");
+
+        size_t begin = offsets[0];
+        size_t position = 0;
+        for (size_t i = 0; i < tableSize; i++) {
+            const size_t end = offsets[i + 1];
+            offsets[i] = position;
+            position += encodeDBSeqList(entries + begin, end - begin, compressedEntries + position);
+            begin = end;
+        }
+        offsets[tableSize] = position;
+
+        delete[] entries;
+        entries = NULL;
+        compressed = true;
+    }
+
     void sortDBSeqLists() {
         #pragma omp parallel for
         for (size_t i = 0; i < getTableSize(); i++) {
@@ -243,6 +328,22 @@ public:
         this->offsets = entryOffsets;
     }
 
+    // init compressed index table with external data (needed for index readin)
+    void initTableByExternalCompressedData(size_t sequenceCount, size_t tableEntriesNum,
+                                           unsigned char *compressedEntries, size_t *entryOffsets) {
+        this->tableEntriesNum = tableEntriesNum;
+        this->size = sequenceCount;
+
+        this->compressedEntries = compressedEntries;
+        this->offsets = entryOffsets;
+        this->compressed = true;
+    }
+
+    // get pointer to compressed entries array
+    unsigned char *getCompressedEntries() {
+        return compressedEntries;
+    }
+
     void revertPointer() {
         for (size_t i = tableSize; i > 0; i--) {
             offsets[i] = offsets[i - 1];
@@ -364,15 +465,20 @@ public:
                 }
             }
             unsigned int kmerIdx = idxer->int2index(kmer, 0, kmerSize);
-            // if region got masked do not add kmer
-            if (offsets[kmerIdx + 1] - offsets[kmerIdx] == 0)
-                continue;
-
             buffer[kmerPos].kmer = kmerIdx;
             buffer[kmerPos].seqId      = s->getId();
             buffer[kmerPos].position_j = s->getCurrentPosition();
             kmerPos++;
         }
+        // the same k-mers as in addKmerCount have to be selected
+        size_t selectedKmers = selectSparseKmers(buffer, kmerPos);
+        kmerPos = 0;
+        for (size_t pos = 0; pos < selectedKmers; pos++) {
+            // if region got masked do not add kmer
+            if (offsets[buffer[pos].kmer + 1] - offsets[buffer[pos].kmer] == 0)
+                continue;
+            buffer[kmerPos++] = buffer[pos];
+        }
 
         if(kmerPos>1){
             std::sort(buffer, buffer+kmerPos, IndexEntryLocalTmp::comapreByIdAndPos);
@@ -419,10 +525,42 @@ public:
     // returns the size of the entry (int for global) (IndexEntryLocal for local)
     size_t getSizeOfEntry() { return sizeof(IndexEntryLocal); }
 
+    // returns the size of all sequence lists in byte
+    size_t getEntriesSize() {
+        return (compressed == true) ? offsets[tableSize] : tableEntriesNum * sizeof(IndexEntryLocal);
+    }
+
     int getKmerSize() {
         return kmerSize;
     }
 
+    // has to be set before the k-mers are counted, window is explained in selectSparseKmers
+    void setSparseMode(int mode, int window) {
+        sparseMode = mode;
+        sparseWindow = std::max(window, 1);
+    }
+
+    int getSparseMode() {
+        return sparseMode;
+    }
+
+    int getSparseWindow() {
+        return sparseWindow;
+    }
+
+    // expected fraction of the k-mers that a sparse index stores
+    static float getSparseDensity(int mode, int window) {
+        window = std::max(window, 1);
+        switch (mode) {
+            case SPARSE_INDEX_MINIMIZER:
+                return 2.0f / (window + 1);
+            case SPARSE_INDEX_SYNCMER:
+                return 1.0f / window;
+            default:
+                return 1.0f;
+        }
+    }
+
     int getAlphabetSize() {
         return alphabetSize;
     }
@@ -465,7 +603,125 @@ protected:
     IndexEntryLocal *entries;
     size_t *offsets;
 
+    // compressed sequence lists, entries is NULL if the table is compressed
+    unsigned char *compressedEntries;
+    bool compressed;
+
     // sequence lookup
     SequenceLookup *sequenceLookup;
+
+    int sparseMode;
+    int sparseWindow;
+
+    static inline unsigned int kmerOf(unsigned int kmer) {
+        return kmer;
+    }
+
+    static inline unsigned int kmerOf(const IndexEntryLocalTmp &entry) {
+        return entry.kmer;
+    }
+
+    // murmur3 finalizer
+    static inline uint64_t hashKmer(uint64_t kmer) {
+        kmer ^= kmer >> 33;
+        kmer *= 0xff51afd7ed558ccdULL;
+        kmer ^= kmer >> 33;
+        kmer *= 0xc4ceb9fe1a85ec53ULL;
+        kmer ^= kmer >> 33;
+        return kmer;
+    }
+
+    // an open syncmer is a k-mer whose smallest s-mer (s = k - sparseWindow + 1) is its first one
+    inline bool isOpenSyncmer(size_t kmer) {
+        const int sMerSize = std::max(kmerSize - sparseWindow + 1, 1);
+        const size_t sMerRange = MathUtil::ipow<size_t>(alphabetSize, sMerSize);
+        // the first residue is the lowest digit of the k-mer index
+        const uint64_t firstHash = hashKmer(kmer % sMerRange);
+        for (int i = 1; i <= kmerSize - sMerSize; i++) {
+            kmer /= alphabetSize;
+            if (hashKmer(kmer % sMerRange) < firstHash) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // keeps the k-mers of buffer (in sequence order) that a sparse index stores, returns their count
+    template <typename T>
+    size_t selectSparseKmers(T *buffer, size_t kmerCount) {
+        size_t selected = 0;
+        if (sparseMode == SPARSE_INDEX_MINIMIZER) {
+            // each window selects its smallest k-mer, consecutive windows mostly select the same one
+            const size_t window = std::min(static_cast<size_t>(sparseWindow), kmerCount);
+            size_t lastMinimizer = SIZE_MAX;
+            for (size_t i = 0; i + window <= kmerCount && window > 0; i++) {
+                size_t minimizer = i;
+                uint64_t minHash = hashKmer(kmerOf(buffer[i]));
+                for (size_t j = i + 1; j < i + window; j++) {
+                    const uint64_t hash = hashKmer(kmerOf(buffer[j]));
+                    if (hash < minHash) {
+                        minHash = hash;
+                        minimizer = j;
+                    }
+                }
+                // selected <= i, the k-mers of the following windows are not overwritten
+                if (minimizer != lastMinimizer) {
+                    buffer[selected++] = buffer[minimizer];
+                    lastMinimizer = minimizer;
+                }
+            }
+        } else if (sparseMode == SPARSE_INDEX_SYNCMER) {
+            for (size_t i = 0; i < kmerCount; i++) {
+                if (isOpenSyncmer(kmerOf(buffer[i]))) {
+                    buffer[selected++] = buffer[i];
+                }
+            }
+        } else {
+            selected = kmerCount;
+        }
+        return selected;
+    }
+
+    static inline const unsigned char *decodeVarint(const unsigned char *data, size_t *value) {
+        size_t result = *data & 0x7F;
+        unsigned int shift = 7;
+        while (*data & 0x80) {
+            data++;
+            result |= static_cast<size_t>(*data & 0x7F) << shift;
+            shift += 7;
+        }
+        *value = result;
+        return data + 1;
+    }
+
+    // returns the number of bytes, output can be NULL to only compute the size
+    static inline size_t encodeVarint(size_t value, unsigned char *output) {
+        size_t length = 1;
+        while (value >= 0x80) {
+            if (output != NULL) {
+                *output++ = static_cast<unsigned char>(value | 0x80);
+            }
+            value >>= 7;
+            length++;
+        }
+        if (output != NULL) {
+            *output = static_cast<unsigned char>(value);
+        }
+        return length;
+    }
+
+    static size_t encodeDBSeqList(const IndexEntryLocal *input, size_t listSize, unsigned char *output) {
+        if (listSize == 0) {
+            return 0;
+        }
+        size_t length = encodeVarint(listSize, output);
+        unsigned int prevSeqId = 0;
+        for (size_t i = 0; i < listSize; i++) {
+            length += encodeVarint(input[i].seqId - prevSeqId, (output != NULL) ? output + length : NULL);
+            length += encodeVarint(input[i].position_j, (output != NULL) ? output + length : NULL);
+            prevSeqId = input[i].seqId;
+        }
+        return length;
+    }
 };
 #endif
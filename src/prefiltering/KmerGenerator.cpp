@@ -201,13 +201,21 @@ int KmerGenerator::calculateArrayProduct(const short        * __restrict scoreAr
         if(score_i < cutoff1 )
             break;
         const short cutoff2=this->threshold-score_i-possibleRest;
-        for(size_t j = 0; j < array2Size && (counter+1 < (int) MAX_KMER_RESULT_SIZE) && (scoreArray2[j] >= cutoff2); j++){
-            const short score_j       = scoreArray2[j];
-            const unsigned int kmer_j = indexArray2[j];
-            outputScoreArray[counter]=score_i+score_j;
-            outputIndexArray[counter]=kmer_i+(kmer_j*pow);
-            counter++;
+        // scoreArray2 is sorted, find the last element above the cutoff first
+        // so that the product loop has a known trip count and gets vectorized
+        const size_t capacity = MAX_KMER_RESULT_SIZE - 1 - counter;
+        const size_t maxJ = std::min(array2Size, capacity);
+        size_t jEnd = 0;
+        while(jEnd < maxJ && scoreArray2[jEnd] >= cutoff2){
+            jEnd++;
         }
+        short        * __restrict outScore = outputScoreArray + counter;
+        unsigned int * __restrict outIndex = outputIndexArray + counter;
+        for(size_t j = 0; j < jEnd; j++){
+            outScore[j] = score_i + scoreArray2[j];
+            outIndex[j] = kmer_i + (indexArray2[j] * pow);
+        }
+        counter += jEnd;
         if(counter+1 >= (int) MAX_KMER_RESULT_SIZE){
             return counter;
         }
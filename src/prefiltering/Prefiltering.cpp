@@ -6,6 +6,8 @@
 #include "PatternCompiler.h"
 #include "FileUtil.h"
 #include "IndexBuilder.h"
+#include "MemoryGovernor.h"
+#include "MemoryPlacement.h"
 #include "Timer.h"
 
 namespace prefilter {
@@ -33,6 +35,8 @@ Prefiltering::Prefiltering(const std::string &targetDB,
         splitMode(par.splitMode),
         scoringMatrixFile(par.scoringMatrixFile),
         targetSeqType(targetSeqType_),
+        sparseIndex(par.sparseIndex),
+        sparseWindow(par.sparseWindow),
         maxResListLen(par.maxResListLen),
         kmerScore(par.kmerScore),
         sensitivity(par.sensitivity),
@@ -44,10 +48,21 @@ Prefiltering::Prefiltering(const std::string &targetDB,
         aaBiasCorrection(par.compBiasCorrection != 0),
         covThr(par.covThr), covMode(par.covMode), includeIdentical(par.includeIdentity),
         preloadMode(par.preloadMode),
+        hugePages(par.hugePages),
+        numaMode(par.numaMode),
+        queryBatchSize(par.queryBatchSize),
+        maxKmersPerPos(par.maxKmersPerPos),
+        compressed(par.compressed),
+        binaryResults(par.binaryResults),
+        shardDirs(par.shardDirs),
         threads(static_cast<unsigned int>(par.threads)) {
 #ifdef OPENMP
     Debug(Debug::INFO) << "Using " << threads << " threads.\n";
 #endif
+    if (queryBatchSize > 1 && querySeqType != Sequence::AMINO_ACIDS && querySeqType != Sequence::NUCLEOTIDES) {
+        Debug(Debug::WARNING) << "Query batches are only supported for sequence queries. Matching queries one by one.\n";
+        queryBatchSize = 1;
+    }
 
     int indexMasked = maskMode;
     int minKmerThr = INT_MIN;
@@ -99,6 +114,9 @@ Prefiltering::Prefiltering(const std::string &targetDB,
             spacedKmerPattern = PrefilteringIndexReader::getSpacedPattern(tidxdbr);
             minKmerThr = data.kmerThr;
             scoringMatrixFile = PrefilteringIndexReader::getSubstitutionMatrixName(tidxdbr);
+            std::pair<int, int> sparse = PrefilteringIndexReader::getSparseIndex(tidxdbr);
+            sparseIndex = sparse.first;
+            sparseWindow = sparse.second;
         } else {
             Debug(Debug::ERROR) << "Outdated index version. Please recompute it with 'createindex'!\n";
             EXIT(EXIT_FAILURE);
@@ -146,6 +164,10 @@ Prefiltering::Prefiltering(const std::string &targetDB,
     // investigate if it makes sense to mask the profile consensus sequence
     if (targetSeqType == Sequence::HMM_PROFILE || targetSeqType == Sequence::PROFILE_STATE_SEQ) {
         maskMode = 0;
+        if (sparseIndex != IndexTable::SPARSE_INDEX_OFF) {
+            Debug(Debug::WARNING) << "Sparse indices are only supported for sequence databases. Storing all k-mers.\n";
+            sparseIndex = IndexTable::SPARSE_INDEX_OFF;
+        }
     }
 
     takeOnlyBestKmer = (par.exactKmerMatching==1)||
@@ -153,15 +175,20 @@ Prefiltering::Prefiltering(const std::string &targetDB,
                        (targetSeqType == Sequence::NUCLEOTIDES && querySeqType == Sequence::NUCLEOTIDES);
 
     int originalSplits = splits;
-    size_t memoryLimit;
-    if (par.splitMemoryLimit > 0) {
-        memoryLimit = static_cast<size_t>(par.splitMemoryLimit) * 1024;
-    } else {
-        memoryLimit = static_cast<size_t>(Util::getTotalSystemMemory() * 0.9);
+    // the memory already taken by other databases and buffers is not available to the split.
+    // The target database and precomputed index are part of the split estimate, their reservation is counted there
+    size_t memoryLimit = MemoryGovernor::getAvailable() + tdbr->getReservedMemory();
+    if (templateDBIsIndex == true) {
+        memoryLimit += tidxdbr->getReservedMemory();
     }
+    memoryLimit = std::min(memoryLimit, MemoryGovernor::getBudget());
+    const bool compressedIndex = templateDBIsIndex && PrefilteringIndexReader::isCompressedIndex(tidxdbr);
+    const int indexCopies = (numaMode == Parameters::NUMA_MODE_REPLICATE) ? MemoryPlacement::getNodeCount() : 1;
+    int splitThreads = threads;
     setupSplit(*tdbr, alphabetSize - 1, querySeqType,
-               threads, templateDBIsIndex, maxResListLen,
-               memoryLimit, &kmerSize, &splits, &splitMode);
+               &splitThreads, templateDBIsIndex, compressedIndex, IndexTable::getSparseDensity(sparseIndex, sparseWindow), indexCopies,
+               maxResListLen, memoryLimit, &kmerSize, &splits, &splitMode);
+    threads = static_cast<unsigned int>(splitThreads);
 
     if(targetSeqType != Sequence::NUCLEOTIDES){
         const bool isProfileSearch = querySeqType == Sequence::HMM_PROFILE || targetSeqType == Sequence::HMM_PROFILE;
@@ -203,6 +230,8 @@ Prefiltering::Prefiltering(const std::string &targetDB,
 }
 
 Prefiltering::~Prefiltering() {
+    releaseIndexReplicas();
+
     if (indexTable != NULL) {
         delete indexTable;
     }
@@ -254,19 +283,27 @@ void Prefiltering::reopenTargetDb() {
     templateDBIsIndex = false;
 }
 
-void Prefiltering::setupSplit(DBReader<unsigned int>& dbr, const int alphabetSize, const unsigned int querySeqTyp, const int threads,
-                              const bool templateDBIsIndex, const size_t maxResListLen, const size_t memoryLimit,
-                              int *kmerSize, int *split, int *splitMode) {
+void Prefiltering::setupSplit(DBReader<unsigned int>& dbr, const int alphabetSize, const unsigned int querySeqTyp, int *threads,
+                              const bool templateDBIsIndex, const bool compressedIndex, const float indexDensity, const int indexCopies,
+                              const size_t maxResListLen, const size_t memoryLimit, int *kmerSize, int *split, int *splitMode) {
+    const int requestedThreads = *threads;
     size_t neededSize = estimateMemoryConsumption(1,
                                                   dbr.getSize(), dbr.getAminoAcidDBSize(),  maxResListLen, alphabetSize,
                                                   *kmerSize == 0 ? // if auto detect kmerSize
                                                   IndexTable::computeKmerSize(dbr.getAminoAcidDBSize()) : *kmerSize, querySeqTyp,
-                                                  threads);
+                                                  *threads, compressedIndex, indexDensity, indexCopies);
     if (neededSize > 0.9 * memoryLimit) {
         // memory is not enough to compute everything at once
         //TODO add PROFILE_STATE (just 6-mers)
         std::pair<int, int> splitSettings = Prefiltering::optimizeSplit(memoryLimit, &dbr,
-                                                                        alphabetSize, *kmerSize, querySeqTyp, threads);
+                                                                        alphabetSize, *kmerSize, querySeqTyp, *threads,
+                                                                        compressedIndex, indexDensity, indexCopies);
+        // the buffers of the threads do not shrink with the split, but fewer threads might fit
+        while (splitSettings.second == -1 && *threads > 1) {
+            (*threads)--;
+            splitSettings = Prefiltering::optimizeSplit(memoryLimit, &dbr, alphabetSize, *kmerSize, querySeqTyp, *threads,
+                                                        compressedIndex, indexDensity, indexCopies);
+        }
         if (splitSettings.second == -1) {
             Debug(Debug::ERROR) << "Can not fit databased into " << memoryLimit
                                 << " byte. Please use a computer with more main memory.\n";
@@ -312,7 +349,19 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& dbr, const int alphabetSiz
     Debug(Debug::INFO) << "Use kmer size " << *kmerSize << " and split "
                        << *split << " using " << Parameters::getSplitModeName(*splitMode) << " split mode.\n";
     neededSize = estimateMemoryConsumption((*splitMode == Parameters::TARGET_DB_SPLIT) ? *split : 1, dbr.getSize(),
-                                           dbr.getAminoAcidDBSize(), maxResListLen, alphabetSize, *kmerSize, querySeqTyp, threads);
+                                           dbr.getAminoAcidDBSize(), maxResListLen, alphabetSize, *kmerSize, querySeqTyp, *threads,
+                                           compressedIndex, indexDensity, indexCopies);
+    // a given split might not fit with the buffers of all threads
+    while (neededSize > 0.9 * memoryLimit && *threads > 1) {
+        (*threads)--;
+        neededSize = estimateMemoryConsumption((*splitMode == Parameters::TARGET_DB_SPLIT) ? *split : 1, dbr.getSize(),
+                                               dbr.getAminoAcidDBSize(), maxResListLen, alphabetSize, *kmerSize, querySeqTyp, *threads,
+                                               compressedIndex, indexDensity, indexCopies);
+    }
+    if (*threads < requestedThreads) {
+        Debug(Debug::WARNING) << "Using " << *threads << " instead of " << requestedThreads
+                              << " threads to fit into " << memoryLimit << " byte of memory.\n";
+    }
     Debug(Debug::INFO) << "Needed memory (" << neededSize << " byte) of total memory (" << memoryLimit
                        << " byte)\n";
     if (neededSize > 0.9 * memoryLimit) {
@@ -327,7 +376,8 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& dbr, const int alphabetSiz
 void Prefiltering::mergeOutput(const std::string &outDB, const std::string &outDBIndex,
                                const std::vector<std::pair<std::string, std::string>> &filenames) {
     Timer timer;
-    if (filenames.size() < 2) {
+    // the splits are text, binary results have to be rewritten
+    if (filenames.size() < 2 && binaryResults == false) {
         std::rename(filenames[0].first.c_str(), outDB.c_str());
         std::rename(filenames[0].second.c_str(), outDBIndex.c_str());
         Debug(Debug::INFO) << "No merging needed.\n";
@@ -359,7 +409,10 @@ void Prefiltering::mergeOutput(const std::string &outDB, const std::string &outD
     // sort merged entries by evalue
     DBReader<unsigned int> dbr(out.first.c_str(), out.second.c_str());
     dbr.open(DBReader<unsigned int>::LINEAR_ACCCESS);
-    DBWriter dbw(outDB.c_str(), outDBIndex.c_str(), threads);
+    DBWriter dbw(outDB.c_str(), outDBIndex.c_str(), threads,
+                 (shardDirs.empty() ? DBWriter::SHARED_FILE_MODE : DBWriter::SHARDED_MODE)
+                 | (compressed ? DBWriter::COMPRESSED_MODE : DBWriter::ASCII_MODE));
+    dbw.setShardDirectories(shardDirs);
     dbw.open(1024 * 1024 * 1024);
 #pragma omp parallel
     {
@@ -380,7 +433,8 @@ void Prefiltering::mergeOutput(const std::string &outDB, const std::string &outD
                 std::sort(hits.begin(), hits.end(), hit_t::compareHitsByPValueAndId);
             }
             for(size_t hit_id = 0; hit_id < hits.size(); hit_id++){
-                int len = QueryMatcher::prefilterHitToBuffer(buffer, hits[hit_id]);
+                size_t len = binaryResults ? QueryMatcher::prefilterHitToBinaryBuffer(buffer, hits[hit_id])
+                                           : QueryMatcher::prefilterHitToBuffer(buffer, hits[hit_id]);
                 result.append(buffer, len);
             }
             dbw.writeData(result.c_str(), result.size(), dbKey, thread_idx);
@@ -388,7 +442,7 @@ void Prefiltering::mergeOutput(const std::string &outDB, const std::string &outD
         }
     }
     Debug(Debug::INFO) << out.first << " " << out.second << "\n";
-    dbw.close();
+    dbw.close(binaryResults ? Sequence::PREFILTER_RES_BINARY : -1);
     dbr.close();
     int error = remove(out.first.c_str());
     if(error != 0){
@@ -455,6 +509,7 @@ void Prefiltering::getIndexTable(int /*split*/, size_t dbFrom, size_t dbSize) {
         int adjustAlphabetSize = (targetSeqType == Sequence::NUCLEOTIDES || targetSeqType == Sequence::AMINO_ACIDS)
                            ? alphabetSize -1 : alphabetSize;
         indexTable = new IndexTable(adjustAlphabetSize, kmerSize, false);
+        indexTable->setSparseMode(sparseIndex, sparseWindow);
         SequenceLookup **maskedLookup   = maskMode == 1 ? &sequenceLookup : NULL;
         SequenceLookup **unmaskedLookup = maskMode == 0 ? &sequenceLookup : NULL;
 
@@ -470,6 +525,7 @@ void Prefiltering::getIndexTable(int /*split*/, size_t dbFrom, size_t dbSize) {
         tdbr->remapData();
         Debug(Debug::INFO) << "Time for index table init: " << timer.lap() << "\n";
     }
+    placeIndexTable();
 
     // init the substitution matrices
     switch (querySeqType) {
@@ -497,6 +553,87 @@ void Prefiltering::getIndexTable(int /*split*/, size_t dbFrom, size_t dbSize) {
     }
 }
 
+void Prefiltering::placeIndexTable() {
+    if (hugePages == MemoryPlacement::HUGE_PAGES_OFF && numaMode == Parameters::NUMA_MODE_FIRST_TOUCH) {
+        return;
+    }
+
+    Timer timer;
+    const int replicaCount = (numaMode == Parameters::NUMA_MODE_REPLICATE) ? MemoryPlacement::getNodeCount() : 1;
+    for (int i = 0; i < replicaCount; i++) {
+        int node = MemoryPlacement::NODE_ANY;
+        if (numaMode == Parameters::NUMA_MODE_INTERLEAVE) {
+            node = MemoryPlacement::NODE_INTERLEAVE;
+        } else if (numaMode == Parameters::NUMA_MODE_REPLICATE) {
+            node = i;
+        }
+
+        IndexTable *table = new IndexTable(indexTable->getAlphabetSize(), indexTable->getKmerSize(), true);
+        size_t *offsets = (size_t *) placeCopy((const char *) indexTable->getOffsets(),
+                                               (indexTable->getTableSize() + 1) * sizeof(size_t), node);
+        if (indexTable->isCompressed()) {
+            unsigned char *entries = (unsigned char *) placeCopy((const char *) indexTable->getCompressedEntries(),
+                                                                 indexTable->getEntriesSize(), node);
+            table->initTableByExternalCompressedData(indexTable->getSize(), indexTable->getTableEntriesNum(), entries, offsets);
+        } else {
+            IndexEntryLocal *entries = (IndexEntryLocal *) placeCopy((const char *) indexTable->getEntries(),
+                                                                     indexTable->getEntriesSize(), node);
+            table->initTableByExternalData(indexTable->getSize(), indexTable->getTableEntriesNum(), entries, offsets);
+        }
+        indexReplicas.push_back(table);
+
+        if (sequenceLookup != NULL) {
+            const size_t sequenceCount = sequenceLookup->getSequenceCount();
+            SequenceLookup *lookup = new SequenceLookup(sequenceCount);
+            char *data = placeCopy(sequenceLookup->getData(), sequenceLookup->getDataSize() + 1, node);
+            size_t *seqOffsets = (size_t *) placeCopy((const char *) sequenceLookup->getOffsets(),
+                                                      (sequenceCount + 1) * sizeof(size_t), node);
+            lookup->initLookupByExternalData(data, sequenceLookup->getDataSize(), seqOffsets);
+            lookupReplicas.push_back(lookup);
+        }
+    }
+
+    // the first copy takes the place of the original tables
+    delete indexTable;
+    indexTable = indexReplicas[0];
+    if (sequenceLookup != NULL) {
+        delete sequenceLookup;
+        sequenceLookup = lookupReplicas[0];
+    }
+    Debug(Debug::INFO) << "Placed " << replicaCount << " index table copies in: " << timer.lap() << "\n";
+}
+
+char *Prefiltering::placeCopy(const char *data, size_t size, int node) {
+    char *copy = MemoryPlacement::allocate(size, hugePages, node);
+    if (copy == NULL) {
+        Debug(Debug::ERROR) << "Could not allocate " << size << " byte for the index table copy.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    memcpy(copy, data, size);
+    placedMemory.push_back(std::make_pair(copy, size));
+    return copy;
+}
+
+void Prefiltering::releaseIndexReplicas() {
+    if (indexReplicas.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < indexReplicas.size(); i++) {
+        delete indexReplicas[i];
+    }
+    for (size_t i = 0; i < lookupReplicas.size(); i++) {
+        delete lookupReplicas[i];
+    }
+    for (size_t i = 0; i < placedMemory.size(); i++) {
+        MemoryPlacement::release(placedMemory[i].first, placedMemory[i].second);
+    }
+    indexReplicas.clear();
+    lookupReplicas.clear();
+    placedMemory.clear();
+    indexTable = NULL;
+    sequenceLookup = NULL;
+}
+
 bool Prefiltering::isSameQTDB(const std::string &queryDB) {
     //  check if when qdb and tdb have the same name an index extension exists
     std::string check(targetDB);
@@ -537,8 +674,14 @@ void Prefiltering::runMpiSplits(const std::string &queryDB, const std::string &q
     splitCount = splitCntPerProc[MMseqsMPI::rank];
     delete[] splitCntPerProc;
 
+    // the master merges the target splits of all ranks as text
+    const bool binaryMergedResults = binaryResults;
+    if (splitMode == Parameters::TARGET_DB_SPLIT) {
+        binaryResults = false;
+    }
     std::pair<std::string, std::string> result = Util::createTmpFileNames(resultDB, resultDBIndex, MMseqsMPI::rank);
     int hasResult = runSplits(queryDB, queryDBIndex, result.first, result.second, fromSplit, splitCount) == true ? 1 : 0;
+    binaryResults = binaryMergedResults;
 
     int *results = NULL;
     if (MMseqsMPI::isMaster()) {
@@ -653,6 +796,8 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
             return false;
         }
 
+        releaseIndexReplicas();
+
         if (indexTable != NULL) {
             delete indexTable;
             indexTable = NULL;
@@ -711,7 +856,17 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
         localThreads = querySize;
     }
 
-    DBWriter tmpDbw(resultDB.c_str(), resultDBIndex.c_str(), localThreads);
+    // target splits are merged by concatenating their raw text entries, only the merged result is compressed or binary
+    const bool compressSplit = compressed && (splitCount == 1 || splitMode != Parameters::TARGET_DB_SPLIT);
+    const bool binarySplit = binaryResults && (splitCount == 1 || splitMode != Parameters::TARGET_DB_SPLIT);
+    // target splits are read by mergeOutput as raw data files, so only other splits are written as shards
+    const bool shardSplit = shardDirs.empty() == false && (splitCount == 1 || splitMode != Parameters::TARGET_DB_SPLIT);
+    DBWriter tmpDbw(resultDB.c_str(), resultDBIndex.c_str(), localThreads,
+                    (shardSplit ? DBWriter::SHARDED_MODE : DBWriter::SHARED_FILE_MODE)
+                    | (compressSplit ? DBWriter::COMPRESSED_MODE : DBWriter::ASCII_MODE));
+    if (shardSplit) {
+        tmpDbw.setShardDirectories(shardDirs);
+    }
     tmpDbw.open();
 
     // init all thread-specific data structures
@@ -733,15 +888,39 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
     Debug(Debug::INFO) << "Target db start  " << (dbFrom + 1) << " to " << dbFrom + dbSize << "\n";
     EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), ungappedSubMat);
 
+    // threads are spread evenly over the nodes and use the index copy of their node.
+    // cpus is also the affinity of the process, the threads get it back once they are done
+    std::vector<int> cpus;
+    if (indexReplicas.size() > 1) {
+        cpus = MemoryPlacement::getAllowedCpus();
+    }
+    size_t tlbUnavailable = 0;
+    uint64_t tlbMisses = 0;
+    uint64_t tlbLoads = 0;
+
 #pragma omp parallel num_threads(localThreads)
     {
         unsigned int thread_idx = 0;
 #ifdef OPENMP
         thread_idx = static_cast<unsigned int>(omp_get_thread_num());
 #endif
+        IndexTable *localIndexTable = indexTable;
+        SequenceLookup *localSequenceLookup = sequenceLookup;
+        if (cpus.empty() == false) {
+            const int cpu = cpus[(thread_idx * cpus.size() / localThreads) % cpus.size()];
+            if (MemoryPlacement::pinThread(cpu)) {
+                const size_t node = static_cast<size_t>(MemoryPlacement::getNodeOfCpu(cpu));
+                localIndexTable = indexReplicas[node % indexReplicas.size()];
+                if (lookupReplicas.empty() == false) {
+                    localSequenceLookup = lookupReplicas[node % lookupReplicas.size()];
+                }
+            }
+        }
+        TlbCounter tlbCounter;
+
         Sequence seq(maxSeqLen, querySeqType, kmerSubMat, kmerSize, spacedKmer, aaBiasCorrection, true, spacedKmerPattern);
 
-        QueryMatcher matcher(indexTable, sequenceLookup, kmerSubMat,  ungappedSubMat,
+        QueryMatcher matcher(localIndexTable, localSequenceLookup, kmerSubMat,  ungappedSubMat,
                              evaluer, tdbr->getSeqLens() + dbFrom, kmerThr, kmerMatchProb,
                              kmerSize, dbSize, maxSeqLen, seq.getEffectiveKmerSize(),
                              maxResults, aaBiasCorrection, diagonalScoring, minDiagScoreThr, takeOnlyBestKmer);
@@ -751,42 +930,79 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
         } else {
             matcher.setSubstitutionMatrix(_3merSubMatrix, _2merSubMatrix);
         }
+        matcher.setMaxKmersPerPosition(maxKmersPerPos);
 
-#pragma omp for schedule(dynamic, 10) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow)
-        for (size_t id = queryFrom; id < queryFrom + querySize; id++) {
-            Debug::printProgress(id);
-            // get query sequence
-            char *seqData = qdbr->getData(id);
-            unsigned int qKey = qdbr->getDbKey(id);
-            seq.mapSequence(id, qKey, seqData);
-            // only the corresponding split should include the id (hack for the hack)
-            size_t targetSeqId = UINT_MAX;
-            if (id >= dbFrom && id < (dbFrom + dbSize) && (sameQTDB || includeIdentical)) {
-                targetSeqId = tdbr->getId(seq.getDbKey());
-                if (targetSeqId != UINT_MAX) {
-                    targetSeqId = targetSeqId - dbFrom;
-                }
+        // seq matches single queries, query batches use queryBatchSize sequences
+        std::vector<Sequence *> batchSeqs(1, &seq);
+        for (int i = 1; i < queryBatchSize; i++) {
+            batchSeqs.push_back(new Sequence(maxSeqLen, querySeqType, kmerSubMat, kmerSize, spacedKmer, aaBiasCorrection, true, spacedKmerPattern));
+        }
+        const size_t batchCount = (querySize + queryBatchSize - 1) / queryBatchSize;
+        const size_t chunkSize = (queryBatchSize == 1) ? 10 : 1;
+
+#pragma omp for schedule(dynamic, chunkSize) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow)
+        for (size_t batch = 0; batch < batchCount; batch++) {
+            const size_t batchFrom = queryFrom + batch * queryBatchSize;
+            const size_t batchSize = std::min(static_cast<size_t>(queryBatchSize), queryFrom + querySize - batchFrom);
+            for (size_t i = 0; i < batchSize; i++) {
+                // get query sequence
+                char *seqData = qdbr->getData(batchFrom + i);
+                unsigned int qKey = qdbr->getDbKey(batchFrom + i);
+                batchSeqs[i]->mapSequence(batchFrom + i, qKey, seqData);
             }
-            // calculate prefiltering results
-            std::pair<hit_t *, size_t> prefResults = matcher.matchQuery(&seq, targetSeqId);
-            size_t resultSize = prefResults.second;
-            // write
-            writePrefilterOutput(qdbr, &tmpDbw, thread_idx, id, prefResults, dbFrom, resListOffset, maxResults);
-
-            // update statistics counters
-            if (resultSize != 0) {
-                notEmpty[id - queryFrom] = 1;
+            if (queryBatchSize > 1) {
+                matcher.prepareBatch(batchSeqs.data(), batchSize);
             }
 
-            kmersPerPos += (size_t) matcher.getStatistics()->kmersPerPos;
-            dbMatches += matcher.getStatistics()->dbMatches;
-            doubleMatches += matcher.getStatistics()->doubleMatches;
-            querySeqLenSum += seq.L;
-            diagonalOverflow += matcher.getStatistics()->diagonalOverflow;
-            resSize += resultSize;
-            realResSize += std::min(resultSize, maxResults);
-            reslens[thread_idx]->emplace_back(resultSize);
+            for (size_t i = 0; i < batchSize; i++) {
+                const size_t id = batchFrom + i;
+                Debug::printProgress(id);
+                Sequence *querySeq = batchSeqs[i];
+                // only the corresponding split should include the id (hack for the hack)
+                size_t targetSeqId = UINT_MAX;
+                if (id >= dbFrom && id < (dbFrom + dbSize) && (sameQTDB || includeIdentical)) {
+                    targetSeqId = tdbr->getId(querySeq->getDbKey());
+                    if (targetSeqId != UINT_MAX) {
+                        targetSeqId = targetSeqId - dbFrom;
+                    }
+                }
+                // calculate prefiltering results
+                std::pair<hit_t *, size_t> prefResults = (queryBatchSize > 1) ? matcher.matchBatchQuery(i, targetSeqId)
+                                                                              : matcher.matchQuery(querySeq, targetSeqId);
+                size_t resultSize = prefResults.second;
+                // write
+                writePrefilterOutput(qdbr, &tmpDbw, thread_idx, id, prefResults, dbFrom, resListOffset, maxResults, binarySplit);
+
+                // update statistics counters
+                if (resultSize != 0) {
+                    notEmpty[id - queryFrom] = 1;
+                }
+
+                kmersPerPos += (size_t) matcher.getStatistics()->kmersPerPos;
+                dbMatches += matcher.getStatistics()->dbMatches;
+                doubleMatches += matcher.getStatistics()->doubleMatches;
+                querySeqLenSum += querySeq->L;
+                diagonalOverflow += matcher.getStatistics()->diagonalOverflow;
+                resSize += resultSize;
+                realResSize += std::min(resultSize, maxResults);
+                reslens[thread_idx]->emplace_back(resultSize);
+            }
         } // step end
+        for (size_t i = 1; i < batchSeqs.size(); i++) {
+            delete batchSeqs[i];
+        }
+
+        if (tlbCounter.isAvailable()) {
+            __sync_fetch_and_add(&tlbMisses, tlbCounter.getMisses());
+            __sync_fetch_and_add(&tlbLoads, tlbCounter.getLoads());
+        } else {
+            __sync_fetch_and_add(&tlbUnavailable, 1);
+        }
+
+        // the OpenMP threads are reused by later parallel regions
+        if (cpus.empty() == false) {
+            MemoryPlacement::setAffinity(cpus);
+        }
     }
 
     if (Debug::debugLevel >= Debug::INFO) {
@@ -804,9 +1020,10 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
         }
 
         printStatistics(stats, reslens, localThreads, empty, maxResults);
+        printPlacementStatistics(tlbUnavailable == 0, tlbMisses, tlbLoads, querySeqLenSum);
     }
     Debug(Debug::INFO) << "\nTime for prefiltering scores calculation: " << timer.lap() << "\n";
-    tmpDbw.close(); // sorts the index
+    tmpDbw.close(binarySplit ? Sequence::PREFILTER_RES_BINARY : -1); // sorts the index
 
     // sort by ids
     // needed to speed up merge later one
@@ -838,7 +1055,7 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
 // write prefiltering to ffindex database
 void Prefiltering::writePrefilterOutput(DBReader<unsigned int> *qdbr, DBWriter *dbWriter, unsigned int thread_idx, size_t id,
                                         const std::pair<hit_t *, size_t> &prefResults, size_t seqIdOffset,
-                                        size_t resultOffsetPos, size_t maxResults) {
+                                        size_t resultOffsetPos, size_t maxResults, bool binary) {
     // write prefiltering results to a string
     size_t l = 0;
     hit_t *resultVector = prefResults.first + resultOffsetPos;
@@ -863,7 +1080,8 @@ void Prefiltering::writePrefilterOutput(DBReader<unsigned int> *qdbr, DBWriter *
 
 
         res->seqId = tdbr->getDbKey(targetSeqId);
-        int len = QueryMatcher::prefilterHitToBuffer(buffer, *res);
+        size_t len = binary ? QueryMatcher::prefilterHitToBinaryBuffer(buffer, *res)
+                            : QueryMatcher::prefilterHitToBuffer(buffer, *res);
         // TODO: error handling for len
         prefResultsOutString.append(buffer, len);
         l++;
@@ -901,6 +1119,37 @@ void Prefiltering::printStatistics(const statistics_t &stats, std::list<int> **r
     Debug(Debug::INFO) << empty << " sequences with 0 size result lists.\n";
 }
 
+void Prefiltering::printPlacementStatistics(bool tlbAvailable, uint64_t tlbMisses, uint64_t tlbLoads, size_t querySeqLenSum) {
+    if (tlbAvailable) {
+        Debug(Debug::INFO) << tlbMisses << " dTLB load misses of " << tlbLoads << " loads ("
+                           << (100.0 * tlbMisses) / std::max(tlbLoads, (uint64_t) 1) << "%), "
+                           << static_cast<double>(tlbMisses) / std::max(querySeqLenSum, (size_t) 1) << " per query residue.\n";
+    } else {
+        Debug(Debug::INFO) << "dTLB load misses not available (perf events are not permitted).\n";
+    }
+
+    if (indexTable == NULL) {
+        return;
+    }
+    const size_t entriesSize = indexTable->getEntriesSize();
+    const std::vector<IndexTable *> tables = indexReplicas.empty() ? std::vector<IndexTable *>(1, indexTable) : indexReplicas;
+    const int nodeCount = MemoryPlacement::getNodeCount();
+    for (size_t i = 0; i < tables.size(); i++) {
+        const char *entries = tables[i]->isCompressed() ? (const char *) tables[i]->getCompressedEntries()
+                                                        : (const char *) tables[i]->getEntries();
+        Debug(Debug::INFO) << "Index table copy " << i << ": " << MemoryPlacement::getHugePageBytes(entries, entriesSize)
+                           << " of " << entriesSize << " byte in huge pages";
+        if (nodeCount > 1) {
+            std::vector<size_t> pages = MemoryPlacement::getPagesPerNode(entries, entriesSize, 4096);
+            Debug(Debug::INFO) << ", sampled pages per NUMA node:";
+            for (size_t node = 0; node < pages.size(); node++) {
+                Debug(Debug::INFO) << " " << pages[node];
+            }
+        }
+        Debug(Debug::INFO) << "\n";
+    }
+}
+
 BaseMatrix *Prefiltering::getSubstitutionMatrix(const std::string &scoringMatrixFile, size_t alphabetSize, float bitFactor, bool profileState) {
     Debug(Debug::INFO) << "Substitution matrices...\n";
     BaseMatrix *subMat;
@@ -1029,10 +1278,13 @@ int Prefiltering::getKmerThreshold(const float sensitivity, const bool isProfile
 size_t Prefiltering::estimateMemoryConsumption(int split, size_t dbSize, size_t resSize,
                                                size_t maxHitsPerQuery,
                                                int alphabetSize, int kmerSize, unsigned int querySeqType,
-                                               int threads) {
-    // for each residue in the database we need 7 byte
+                                               int threads, bool compressedIndex, float indexDensity, int indexCopies) {
+    // for each residue in the database we need 7 byte (1 byte sequence lookup and 6 byte index entry)
+    // a compressed index needs about 5 instead of 6 byte per index entry
+    // a sparse index only stores indexDensity of the entries
     size_t dbSizeSplit = (dbSize) / split;
-    size_t residueSize = (resSize / split * 7);
+    const double entrySize = ((compressedIndex) ? 5.0 : 6.0) * indexDensity;
+    size_t residueSize = static_cast<size_t>((resSize / split) * (1.0 + entrySize));
     // 21^7 * pointer size is needed for the index
     size_t indexTableSize = static_cast<size_t>(pow(alphabetSize, kmerSize)) * sizeof(size_t *);
     // memory needed for the threads
@@ -1053,7 +1305,8 @@ size_t Prefiltering::estimateMemoryConsumption(int split, size_t dbSize, size_t
     }
     // some memory needed to keep the index, ....
     size_t background = dbSize * 22;
-    return residueSize + indexTableSize + threadSize + background + extendedMatrix;
+    // each NUMA node replica holds a copy of the sequence lookup and the index table
+    return indexCopies * (residueSize + indexTableSize) + threadSize + background + extendedMatrix;
 }
 
 size_t Prefiltering::estimateHDDMemoryConsumption(size_t dbSize, size_t maxResListLen) {
@@ -1063,14 +1316,16 @@ size_t Prefiltering::estimateHDDMemoryConsumption(size_t dbSize, size_t maxResLi
 }
 
 std::pair<int, int> Prefiltering::optimizeSplit(size_t totalMemoryInByte, DBReader<unsigned int> *tdbr,
-                                                int alphabetSize, int externalKmerSize, unsigned int querySeqType, unsigned int threads) {
+                                                int alphabetSize, int externalKmerSize, unsigned int querySeqType, unsigned int threads,
+                                                bool compressedIndex, float indexDensity, int indexCopies) {
     for (int optSplit = 1; optSplit < 100; optSplit++) {
         for (int optKmerSize = 6; optKmerSize <= 7; optKmerSize++) {
             if (optKmerSize == externalKmerSize || externalKmerSize == 0) { // 0: set k-mer based on aa size in database
                 size_t aaUpperBoundForKmerSize = IndexTable::getUpperBoundAACountForKmerSize(optKmerSize);
                 if ((tdbr->getAminoAcidDBSize() / optSplit) < aaUpperBoundForKmerSize) {
                     size_t neededSize = estimateMemoryConsumption(optSplit, tdbr->getSize(), tdbr->getAminoAcidDBSize(),
-                                                                  0, alphabetSize, optKmerSize, querySeqType, threads);
+                                                                  0, alphabetSize, optKmerSize, querySeqType, threads,
+                                                                  compressedIndex, indexDensity, indexCopies);
                     if (neededSize < 0.9 * totalMemoryInByte) {
                         return std::make_pair(optKmerSize, optSplit);
                     }
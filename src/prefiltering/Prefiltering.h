@@ -44,9 +44,11 @@ public:
     // get substitution matrix
     static BaseMatrix *getSubstitutionMatrix(const std::string &scoringMatrixFile, size_t alphabetSize, float bitFactor, bool profileState);
 
-    static void setupSplit(DBReader<unsigned int>& dbr, const int alphabetSize, const unsigned int querySeqType, const int threads,
-                           const bool templateDBIsIndex, const size_t maxResListLen, const size_t memoryLimit,
-                           int *kmerSize, int *split, int *splitMode);
+    // reduces threads if the buffers of all threads do not fit into memoryLimit with any split
+    // indexCopies is the number of index tables held in memory at once (one per NUMA node with NUMA_MODE_REPLICATE)
+    static void setupSplit(DBReader<unsigned int>& dbr, const int alphabetSize, const unsigned int querySeqType, int *threads,
+                           const bool templateDBIsIndex, const bool compressedIndex, const float indexDensity, const int indexCopies,
+                           const size_t maxResListLen, const size_t memoryLimit, int *kmerSize, int *split, int *splitMode);
 
     static int getKmerThreshold(const float sensitivity, const bool isProfile, const int kmerScore, const int kmerSize);
 
@@ -78,6 +80,9 @@ private:
     std::string scoringMatrixFile;
     int targetSeqType;
     bool takeOnlyBestKmer;
+    // sparse index mode and window, see IndexTable::setSparseMode
+    int sparseIndex;
+    int sparseWindow;
 
 
     const size_t maxResListLen;
@@ -93,20 +98,39 @@ private:
     const int covMode;
     const bool includeIdentical;
     int preloadMode;
-    const unsigned int threads;
+    const int hugePages;
+    const int numaMode;
+    // queries matched together in one pass over the index table
+    int queryBatchSize;
+    // adaptive k-mer threshold, see QueryMatcher::setMaxKmersPerPosition
+    const int maxKmersPerPos;
+    // write the prefilter DB with DBWriter::COMPRESSED_MODE
+    const bool compressed;
+    // write Sequence::PREFILTER_RES_BINARY records, not const since MPI ranks write text in target split mode
+    bool binaryResults;
+    // write the prefilter DB with DBWriter::SHARDED_MODE into these directories if not empty
+    const std::string shardDirs;
+    unsigned int threads;
+
+    // copies of indexTable and sequenceLookup placed according to hugePages and numaMode
+    // one copy per NUMA node in NUMA_MODE_REPLICATE
+    std::vector<IndexTable *> indexReplicas;
+    std::vector<SequenceLookup *> lookupReplicas;
+    std::vector<std::pair<char *, size_t> > placedMemory;
 
     bool runSplit(DBReader<unsigned int> *qdbr, const std::string &resultDB, const std::string &resultDBIndex,
                   size_t split, size_t splitCount, bool sameQTDB);
 
     // compute kmer size and split size for index table
     static std::pair<int, int> optimizeSplit(size_t totalMemoryInByte, DBReader<unsigned int> *tdbr, int alphabetSize, int kmerSize,
-                                             unsigned int querySeqType, unsigned int threads);
+                                             unsigned int querySeqType, unsigned int threads, bool compressedIndex,
+                                             float indexDensity, int indexCopies);
 
     // estimates memory consumption while runtime
     static size_t estimateMemoryConsumption(int split, size_t dbSize, size_t resSize,
                                             size_t maxHitsPerQuery,
                                             int alphabetSize, int kmerSize, unsigned int querySeqType,
-                                            int threads);
+                                            int threads, bool compressedIndex, float indexDensity, int indexCopies);
 
     static size_t estimateHDDMemoryConsumption(size_t dbSize, size_t maxResListLen);
 
@@ -116,6 +140,13 @@ private:
     // needed for index lookup
     void getIndexTable(int split, size_t dbFrom, size_t dbSize);
 
+    // replaces indexTable and sequenceLookup with copies in huge page backed or NUMA placed memory
+    void placeIndexTable();
+
+    char *placeCopy(const char *data, size_t size, int node);
+
+    void releaseIndexReplicas();
+
     /*
      * Set the k-mer similarity threshold that regulates the length of k-mer lists for each k-mer in the query sequence.
      * As a result, the prefilter always has roughly the same speed for different k-mer and alphabet sizes.
@@ -125,11 +156,13 @@ private:
     // write prefiltering to ffindex database
     void writePrefilterOutput(DBReader<unsigned int> *qdbr, DBWriter *dbWriter, unsigned int thread_idx, size_t id,
                               const std::pair<hit_t *, size_t> &prefResults, size_t seqIdOffset,
-                              size_t resultOffsetPos, size_t maxResults);
+                              size_t resultOffsetPos, size_t maxResults, bool binary);
 
     void printStatistics(const statistics_t &stats, std::list<int> **reslens,
                          unsigned int resLensSize, size_t empty, size_t maxResults);
 
+    void printPlacementStatistics(bool tlbAvailable, uint64_t tlbMisses, uint64_t tlbLoads, size_t querySeqLenSum);
+
     void mergeOutput(const std::string &outDb, const std::string &outDBIndex,
                      const std::vector<std::pair<std::string, std::string>> &filenames);
 
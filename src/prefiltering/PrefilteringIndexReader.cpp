@@ -27,6 +27,8 @@ unsigned int PrefilteringIndexReader::HDR2INDEX = 17;
 unsigned int PrefilteringIndexReader::HDR2DATA = 18;
 unsigned int PrefilteringIndexReader::GENERATOR = 19;
 unsigned int PrefilteringIndexReader::SPACEDPATTERN = 20;
+unsigned int PrefilteringIndexReader::COMPRESSEDENTRIES = 21;
+unsigned int PrefilteringIndexReader::SPARSEINDEX = 22;
 
 extern const char* version;
 
@@ -50,7 +52,8 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB, DBReader
                                               BaseMatrix *subMat, int maxSeqLen,
                                               bool hasSpacedKmer, const std::string &spacedKmerPattern,
                                               bool compBiasCorrection, int alphabetSize, int kmerSize,
-                                              int maskMode, int kmerThr) {
+                                              int maskMode, int kmerThr, bool compressEntries,
+                                              int sparseIndex, int sparseWindow) {
     DBWriter writer(outDB.c_str(), std::string(outDB).append(".index").c_str(), 1, DBWriter::BINARY_MODE);
     writer.open();
 
@@ -98,6 +101,17 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB, DBReader
                              ? alphabetSize -1: alphabetSize;
 
     IndexTable *indexTable = new IndexTable(adjustAlphabetSize, kmerSize, false);
+    if (sparseIndex != IndexTable::SPARSE_INDEX_OFF) {
+        if (seqType == Sequence::HMM_PROFILE || seqType == Sequence::PROFILE_STATE_SEQ) {
+            Debug(Debug::WARNING) << "Sparse indices are only supported for sequence databases. Storing all k-mers.\n";
+        } else {
+            indexTable->setSparseMode(sparseIndex, sparseWindow);
+            Debug(Debug::INFO) << "Write SPARSEINDEX (" << SPARSEINDEX << ")\n";
+            int sparse[] = {sparseIndex, indexTable->getSparseWindow()};
+            writer.writeData((char *) &sparse, sizeof(sparse), SPARSEINDEX, 0);
+            writer.alignToPageSize();
+        }
+    }
     SequenceLookup *maskedLookup = NULL;
     SequenceLookup *unmaskedLookup = NULL;
     IndexBuilder::fillDatabase(indexTable,
@@ -116,13 +130,22 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB, DBReader
     }
 
     // save the entries
-    Debug(Debug::INFO) << "Write ENTRIES (" << ENTRIES << ")\n";
-    char *entries = (char *) indexTable->getEntries();
-    size_t entriesSize = indexTable->getTableEntriesNum() * indexTable->getSizeOfEntry();
-    writer.writeData(entries, entriesSize, ENTRIES, 0);
+    if (compressEntries) {
+        indexTable->compress();
+        Debug(Debug::INFO) << "Write COMPRESSEDENTRIES (" << COMPRESSEDENTRIES << ")\n";
+        Debug(Debug::INFO) << "Compressed entries from " << indexTable->getTableEntriesNum() * indexTable->getSizeOfEntry()
+                           << " to " << indexTable->getEntriesSize() << " byte\n";
+        char *entries = (char *) indexTable->getCompressedEntries();
+        writer.writeData(entries, indexTable->getEntriesSize(), COMPRESSEDENTRIES, 0);
+    } else {
+        Debug(Debug::INFO) << "Write ENTRIES (" << ENTRIES << ")\n";
+        char *entries = (char *) indexTable->getEntries();
+        writer.writeData(entries, indexTable->getEntriesSize(), ENTRIES, 0);
+    }
     writer.alignToPageSize();
 
     // save the size
+    // offsets of a compressed table point to bytes instead of entries
     Debug(Debug::INFO) << "Write ENTRIESOFFSETS (" << ENTRIESOFFSETS << ")\n";
     char *offsets = (char*)indexTable->getOffsets();
     size_t offsetsSize = (indexTable->getTableSize() + 1) * sizeof(size_t);
@@ -354,7 +377,8 @@ IndexTable *PrefilteringIndexReader::generateIndexTable(DBReader<unsigned int> *
     size_t sequenceCountId = dbr->getId(SEQCOUNT);
     size_t sequenceCount = *((size_t *)dbr->getData(sequenceCountId));
 
-    size_t entriesDataId = dbr->getId(ENTRIES);
+    const bool compressed = isCompressedIndex(dbr);
+    size_t entriesDataId = dbr->getId(compressed ? COMPRESSEDENTRIES : ENTRIES);
     char *entriesData = dbr->getData(entriesDataId);
 
     size_t entriesOffsetsDataId = dbr->getId(ENTRIESOFFSETS);
@@ -367,10 +391,29 @@ IndexTable *PrefilteringIndexReader::generateIndexTable(DBReader<unsigned int> *
         dbr->touchData(entriesOffsetsDataId);
     }
 
-    retTable->initTableByExternalData(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
+    std::pair<int, int> sparse = getSparseIndex(dbr);
+    retTable->setSparseMode(sparse.first, sparse.second);
+    if (compressed) {
+        retTable->initTableByExternalCompressedData(sequenceCount, entriesNum, (unsigned char*) entriesData, (size_t *)entriesOffsetsData);
+    } else {
+        retTable->initTableByExternalData(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
+    }
     return retTable;
 }
 
+bool PrefilteringIndexReader::isCompressedIndex(DBReader<unsigned int> *dbr) {
+    return dbr->getId(COMPRESSEDENTRIES) != UINT_MAX;
+}
+
+std::pair<int, int> PrefilteringIndexReader::getSparseIndex(DBReader<unsigned int> *dbr) {
+    size_t id = dbr->getId(SPARSEINDEX);
+    if (id == UINT_MAX) {
+        return std::make_pair(IndexTable::SPARSE_INDEX_OFF, 1);
+    }
+    int *sparse = (int *) dbr->getData(id);
+    return std::make_pair(sparse[0], sparse[1]);
+}
+
 void PrefilteringIndexReader::printMeta(int *metadata_tmp) {
     Debug(Debug::INFO) << "MaxSeqLength: " << metadata_tmp[0] << "\n";
     Debug(Debug::INFO) << "KmerSize:     " << metadata_tmp[1] << "\n";
@@ -394,6 +437,12 @@ void PrefilteringIndexReader::printSummary(DBReader<unsigned int> *dbr) {
 
     int *meta = (int *)dbr->getDataByDBKey(META);
     printMeta(meta);
+    Debug(Debug::INFO) << "Compressed:   " << (isCompressedIndex(dbr) ? 1 : 0) << "\n";
+    std::pair<int, int> sparse = getSparseIndex(dbr);
+    Debug(Debug::INFO) << "SparseIndex:  " << sparse.first << "\n";
+    if (sparse.first != IndexTable::SPARSE_INDEX_OFF) {
+        Debug(Debug::INFO) << "SparseWindow: " << sparse.second << "\n";
+    }
 
     Debug(Debug::INFO) << "ScoreMatrix:  " << dbr->getDataByDBKey(SCOREMATRIXNAME) << "\n";
 }
@@ -44,6 +44,8 @@ public:
     static unsigned int HDR2DATA;
     static unsigned int GENERATOR;
     static unsigned int SPACEDPATTERN;
+    static unsigned int COMPRESSEDENTRIES;
+    static unsigned int SPARSEINDEX;
 
     static bool checkIfIndexFile(DBReader<unsigned int> *reader);
     static std::string indexName(const std::string &outDB, bool hasSpacedKmer, int kmerSize);
@@ -51,7 +53,8 @@ public:
     static void createIndexFile(const std::string &outDb, DBReader<unsigned int> *dbr, DBReader<unsigned int> *hdbr1,
                                 DBReader<unsigned int> *hdbr2, BaseMatrix *subMat, int maxSeqLen,
                                 bool spacedKmer, const std::string &spacedKmerPattern,
-                                bool compBiasCorrection, int alphabetSize, int kmerSize, int maskMode, int kmerThr);
+                                bool compBiasCorrection, int alphabetSize, int kmerSize, int maskMode, int kmerThr,
+                                bool compressEntries, int sparseIndex, int sparseWindow);
 
     static DBReader<unsigned int> *openNewHeaderReader(DBReader<unsigned int>*dbr, unsigned int headerIdx, unsigned int dataIdx, bool touch);
 
@@ -63,6 +66,11 @@ public:
 
     static IndexTable *generateIndexTable(DBReader<unsigned int> *dbr, bool touch);
 
+    static bool isCompressedIndex(DBReader<unsigned int> *dbr);
+
+    // sparse index mode and window, SPARSE_INDEX_OFF for indices that store all k-mers
+    static std::pair<int, int> getSparseIndex(DBReader<unsigned int> *dbr);
+
     static void printSummary(DBReader<unsigned int> *dbr);
 
     static PrefilteringIndexData getMetadata(DBReader<unsigned int> *dbr);
@@ -3,10 +3,13 @@
 //
 #include <new>
 #include <iomanip>
+#include <algorithm>
+#include <functional>
 
 #include "SubstitutionMatrix.h"
 #include "QueryMatcher.h"
 #include "Util.h"
+#include "MemoryGovernor.h"
 
 #define FE_1(WHAT, X) WHAT(X)
 #define FE_2(WHAT, X, ...) WHAT(X)FE_1(WHAT, __VA_ARGS__)
@@ -42,6 +45,9 @@ QueryMatcher::QueryMatcher(IndexTable *indexTable, SequenceLookup *sequenceLooku
     this->kmerGenerator = new KmerGenerator(kmerSize, indexTable->getAlphabetSize(), kmerThr);
     this->aaBiasCorrection = aaBiasCorrection;
     this->takeOnlyBestKmer = takeOnlyBestKmer;
+    this->prefetchDistance = PREFETCH_DISTANCE;
+    this->maxKmersPerPosition = 0;
+    this->batchSeqs = NULL;
 
     this->stats = new statistics_t();
     // assure that the whole database can be matched (extreme case)
@@ -88,9 +94,16 @@ QueryMatcher::QueryMatcher(IndexTable *indexTable, SequenceLookup *sequenceLooku
         }
     }
     compositionBias = new float[maxSeqLen];
+
+    // the bins of the diagonal matcher hold about twice the database hits
+    reservedMemory = maxHitsPerQuery * sizeof(hit_t) + maxDbMatches * sizeof(IndexEntryLocal)
+                     + counterResultSize * sizeof(CounterResult) + 2 * maxDbMatches * sizeof(CounterResult)
+                     + ((diagonalScoring == false) ? dbSize * sizeof(float) : 0);
+    MemoryGovernor::reserve(reservedMemory);
 }
 
 QueryMatcher::~QueryMatcher(){
+    MemoryGovernor::release(reservedMemory);
     deleteDiagonalMatcher(activeCounter);
     free(resList);
     delete [] scoreSizes;
@@ -124,12 +137,7 @@ size_t QueryMatcher::evaluateBins(IndexEntryLocal **hitsByIndex,
     return localResultSize;
 }
 
-std::pair<hit_t *, size_t> QueryMatcher::matchQuery (Sequence * querySeq, unsigned int identityId){
-    querySeq->resetCurrPos();
-//    std::cout << "Id: " << querySeq->getId() << std::endl;
-    memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
-
-    // bias correction
+void QueryMatcher::computeCompositionBias(Sequence *querySeq) {
     if(aaBiasCorrection == true){
         if(querySeq->getSeqType() == Sequence::AMINO_ACIDS) {
             SubstitutionMatrix::calcLocalAaBiasCorrection(kmerSubMat, querySeq->int_sequence, querySeq->L, compositionBias);
@@ -139,8 +147,21 @@ std::pair<hit_t *, size_t> QueryMatcher::matchQuery (Sequence * querySeq, unsign
     } else {
         memset(compositionBias, 0, sizeof(float) * querySeq->L);
     }
+}
+
+std::pair<hit_t *, size_t> QueryMatcher::matchQuery (Sequence * querySeq, unsigned int identityId){
+    querySeq->resetCurrPos();
+//    std::cout << "Id: " << querySeq->getId() << std::endl;
+    memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
+
+    // bias correction
+    computeCompositionBias(querySeq);
 
     size_t resultSize = match(querySeq, compositionBias);
+    return scoreHits(querySeq, identityId, resultSize);
+}
+
+std::pair<hit_t *, size_t> QueryMatcher::scoreHits(Sequence *querySeq, unsigned int identityId, size_t resultSize) {
     std::pair<hit_t *, size_t > queryResult;
     if(diagonalScoring == true) {
         // write diagonal scores in count value
@@ -199,7 +220,64 @@ std::pair<hit_t *, size_t> QueryMatcher::matchQuery (Sequence * querySeq, unsign
     return queryResult;
 }
 
-size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
+bool QueryMatcher::addSimilarKmers(Sequence *seq, float *compositionBias, Indexer &idx, int xIndex,
+                                   std::vector<unsigned int> &kmers) {
+    const int * kmer = seq->nextKmer();
+    const unsigned char * pos = seq->getAAPosInSpacedPattern();
+    const unsigned short current_i = seq->getCurrentPosition();
+
+    float biasCorrection = 0;
+    int xCount = 0;
+    for (int i = 0; i < kmerSize; i++){
+        xCount += (kmer[i] == xIndex);
+        biasCorrection += compositionBias[current_i + static_cast<short>(pos[i])];
+    }
+    if(xCount > 0){
+        return false;
+    }
+    // round bias to next higher or lower value
+    short bias = static_cast<short>((biasCorrection < 0.0) ? biasCorrection - 0.5: biasCorrection + 0.5);
+    short kmerMatchScore = std::max(kmerThr - bias, 0);
+
+    // adjust kmer threshold based on composition bias
+    kmerGenerator->setThreshold(kmerMatchScore);
+
+    if(takeOnlyBestKmer){
+        kmers.push_back(idx.int2index(kmer));
+    }else{
+        ScoreMatrix kmerList = kmerGenerator->generateKmerList(kmer);
+        if (maxKmersPerPosition > 0 && kmerList.elementSize > maxKmersPerPosition) {
+            // keep the maxKmersPerPosition highest scoring k-mers of the list. K-mers tied with the lowest kept
+            // score are taken in list order until the cap is reached, the exact k-mer is always kept.
+            // The list only holds the k-mers KmerGenerator could store, at most MAX_KMER_RESULT_SIZE of those
+            // scoring at least the threshold, so the cap is applied to these and not to all similar k-mers
+            kmerScoreBuffer.assign(kmerList.score, kmerList.score + kmerList.elementSize);
+            std::nth_element(kmerScoreBuffer.begin(), kmerScoreBuffer.begin() + (maxKmersPerPosition - 1),
+                             kmerScoreBuffer.end(), std::greater<short>());
+            const short capScore = kmerScoreBuffer[maxKmersPerPosition - 1];
+            size_t tiesLeft = maxKmersPerPosition;
+            for (size_t i = 0; i < kmerList.elementSize; i++) {
+                tiesLeft -= (kmerList.score[i] > capScore);
+            }
+            const unsigned int exactKmer = idx.int2index(kmer);
+            for (size_t i = 0; i < kmerList.elementSize; i++) {
+                if (kmerList.score[i] > capScore) {
+                    kmers.push_back(kmerList.index[i]);
+                } else if (kmerList.score[i] == capScore && tiesLeft > 0) {
+                    kmers.push_back(kmerList.index[i]);
+                    tiesLeft--;
+                } else if (kmerList.index[i] == exactKmer) {
+                    kmers.push_back(kmerList.index[i]);
+                }
+            }
+        } else {
+            kmers.insert(kmers.end(), kmerList.index, kmerList.index + kmerList.elementSize);
+        }
+    }
+    return true;
+}
+
+size_t QueryMatcher::match(Sequence *seq, float *compositionBias, const BatchQuery *batchQuery) {
     // go through the query sequence
     size_t kmerListLen = 0;
     size_t numMatches = 0;
@@ -213,99 +291,121 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
     unsigned short indexTo = 0;
     Indexer idx(indexTable->getAlphabetSize(), kmerSize);
     const int xIndex = kmerSubMat->aa2int[(int)'X'];
+    const bool compressedIndex = indexTable->isCompressed();
+    // the lists of a batch are already looked up
+    const bool prefetch = (prefetchDistance > 0 && batchQuery == NULL);
+    size_t batchPosition = (batchQuery != NULL) ? batchQuery->positionFrom : 0;
+
+    // The k-mer lists are matched in a pipeline to hide the memory latency of the index table:
+    // the similar k-mers of PREFETCH_POSITIONS query positions are generated first, then each list is matched
+    // while the list prefetchDistance k-mers ahead and the offsets 2 * prefetchDistance k-mers ahead are prefetched.
+    unsigned short kmerPosition[PREFETCH_POSITIONS];
+    size_t kmerStart[PREFETCH_POSITIONS + 1];
+    bool hasX[PREFETCH_POSITIONS];
+    while ((batchQuery != NULL) ? batchPosition < batchQuery->positionTo : seq->hasNextKmer()) {
+        unsigned int positions = 0;
+        positionKmers.clear();
+        if (batchQuery != NULL) {
+            // kmerStart refers to batchLists
+            while (positions < PREFETCH_POSITIONS && batchPosition < batchQuery->positionTo) {
+                kmerStart[positions] = batchPositions[batchPosition].kmerFrom;
+                hasX[positions] = batchPositions[batchPosition].hasX;
+                kmerPosition[positions] = batchPositions[batchPosition].position;
+                positions++;
+                batchPosition++;
+            }
+            kmerStart[positions] = batchPositions[batchPosition].kmerFrom;
+        } else {
+            while (positions < PREFETCH_POSITIONS && seq->hasNextKmer()) {
+                kmerStart[positions] = positionKmers.size();
+                hasX[positions] = (addSimilarKmers(seq, compositionBias, idx, xIndex, positionKmers) == false);
+                kmerPosition[positions] = seq->getCurrentPosition();
+                positions++;
+            }
+            kmerStart[positions] = positionKmers.size();
+        }
 
-    while(seq->hasNextKmer()){
-        const int * kmer = seq->nextKmer();
-        const unsigned char * pos = seq->getAAPosInSpacedPattern();
-        const unsigned short current_i = seq->getCurrentPosition();
-
-        float biasCorrection = 0;
-        int xCount = 0;
-        for (int i = 0; i < kmerSize; i++){
-            xCount += (kmer[i] == xIndex);
-            biasCorrection += compositionBias[current_i + static_cast<short>(pos[i])];
+        const size_t kmerCount = positionKmers.size();
+        const unsigned int * index = positionKmers.data();
+        if (prefetch) {
+            for (size_t i = 0; i < std::min(kmerCount, (size_t) 2 * prefetchDistance); i++) {
+                indexTable->prefetchOffset(index[i]);
+            }
+            for (size_t i = 0; i < std::min(kmerCount, (size_t) prefetchDistance); i++) {
+                indexTable->prefetchDBSeqList(index[i]);
+            }
         }
-        if(xCount > 0){
-            indexTo = current_i;
+
+        for (unsigned int p = 0; p < positions; p++) {
+            const unsigned short current_i = kmerPosition[p];
             indexPointer[current_i] = sequenceHits;
-            continue;
-        }
-        // round bias to next higher or lower value
-        short bias = static_cast<short>((biasCorrection < 0.0) ? biasCorrection - 0.5: biasCorrection + 0.5);
-        short kmerMatchScore = std::max(kmerThr - bias, 0);
-
-        // adjust kmer threshold based on composition bias
-        kmerGenerator->setThreshold(kmerMatchScore);
-
-        const unsigned int * index;
-        unsigned int exactKmer;
-        size_t kmerElementSize;
-        if(takeOnlyBestKmer){
-            kmerElementSize = 1;
-            exactKmer = idx.int2index(kmer);
-            index = &exactKmer;
-        }else{
-            ScoreMatrix kmerList = kmerGenerator->generateKmerList(kmer);
-            kmerElementSize = kmerList.elementSize;
-            index = kmerList.index;
-        }
-        //std::cout << kmer << std::endl;
-        indexPointer[current_i] = sequenceHits;
-        // match the index table
-
-        //idx.printKmer(kmerList.index[0], kmerSize, m->int2aa);
-        //std::cout  << "\t" << kmerMatchScore << std::endl;
-        kmerListLen += kmerElementSize;
-
-        for (unsigned int kmerPos = 0; kmerPos < kmerElementSize; kmerPos++) {
-            // generate k-mer list
-//                        idx.printKmer(index[kmerPos], kmerSize, m->int2aa);
-//                        std::cout << std::endl;
-
-            const IndexEntryLocal *entries = indexTable->getDBSeqList(index[kmerPos], &seqListSize);
-
-            /////DEBUG
-           /* 
-            idx.printKmer(index[kmerPos], kmerSize, m->int2aa);
-            std::cout << "\t" << current_i << "\t"<< index[kmerPos] << std::endl;
-            for(size_t i = 0; i < seqListSize; i++){
-                char diag = entries[i].position_j - current_i;
-                std::cout << "(" << entries[i].seqId << " " << (int) diag << ")\t";
+            if (hasX[p]) {
+                indexTo = current_i;
+                continue;
             }
-            std::cout << std::endl;
-            */
-            /////DEBUG
-            // detected overflow while matching
-            if ((sequenceHits + seqListSize) >= lastSequenceHit) {
-                stats->diagonalOverflow = true;
-                // last pointer
-                indexPointer[current_i + 1] = sequenceHits;
-//                std::cout << "Overflow in i=" << indexStart << std::endl;
-                const size_t hitCount = evaluateBins(indexPointer,
-                                                     foundDiagonals + overflowHitCount,
-                                                     counterResultSize - overflowHitCount,
-                                                     indexStart, current_i, (diagonalScoring == false));
-                if(overflowHitCount != 0){ //merge lists
-                    // hitCount is max. dbSize so there can be no overflow in mergeElemens
-                    overflowHitCount = mergeElements(diagonalScoring, foundDiagonals, overflowHitCount +  hitCount);
+            // match the index table
+            kmerListLen += kmerStart[p + 1] - kmerStart[p];
+            for (size_t kmerPos = kmerStart[p]; kmerPos < kmerStart[p + 1]; kmerPos++) {
+                if (prefetch && kmerPos + 2 * prefetchDistance < kmerCount) {
+                    indexTable->prefetchOffset(index[kmerPos + 2 * prefetchDistance]);
+                }
+                if (prefetch && kmerPos + prefetchDistance < kmerCount) {
+                    indexTable->prefetchDBSeqList(index[kmerPos + prefetchDistance]);
+                }
+
+                const IndexEntryLocal *entries = NULL;
+                const unsigned char *compressedEntries = NULL;
+                if (batchQuery != NULL) {
+                    const BatchList &list = batchLists[kmerPos];
+                    seqListSize = list.size;
+                    if (list.entries != NULL) {
+                        entries = list.entries;
+                    } else if (list.compressedEntries != NULL) {
+                        compressedEntries = list.compressedEntries;
+                    } else {
+                        entries = batchEntries.data() + list.from;
+                    }
+                } else if (compressedIndex) {
+                    compressedEntries = indexTable->getCompressedDBSeqList(index[kmerPos], &seqListSize);
                 } else {
-                    overflowHitCount = hitCount;
+                    entries = indexTable->getDBSeqList(index[kmerPos], &seqListSize);
                 }
-                // reset pointer position
-                sequenceHits = databaseHits;
-                indexPointer[current_i] = databaseHits;
-                indexStart = current_i;
-                overflowNumMatches += numMatches;
-                numMatches = 0;
-                if((sequenceHits + seqListSize) >= lastSequenceHit){
-                    goto outer;
+
+                // detected overflow while matching
+                if ((sequenceHits + seqListSize) >= lastSequenceHit) {
+                    stats->diagonalOverflow = true;
+                    // last pointer
+                    indexPointer[current_i + 1] = sequenceHits;
+                    const size_t hitCount = evaluateBins(indexPointer,
+                                                         foundDiagonals + overflowHitCount,
+                                                         counterResultSize - overflowHitCount,
+                                                         indexStart, current_i, (diagonalScoring == false));
+                    if(overflowHitCount != 0){ //merge lists
+                        // hitCount is max. dbSize so there can be no overflow in mergeElemens
+                        overflowHitCount = mergeElements(diagonalScoring, foundDiagonals, overflowHitCount +  hitCount);
+                    } else {
+                        overflowHitCount = hitCount;
+                    }
+                    // reset pointer position
+                    sequenceHits = databaseHits;
+                    indexPointer[current_i] = databaseHits;
+                    indexStart = current_i;
+                    overflowNumMatches += numMatches;
+                    numMatches = 0;
+                    if((sequenceHits + seqListSize) >= lastSequenceHit){
+                        goto outer;
+                    }
+                };
+                if (compressedEntries != NULL) {
+                    IndexTable::decodeDBSeqList(compressedEntries, seqListSize, sequenceHits);
+                } else {
+                    memcpy(sequenceHits, entries, sizeof(IndexEntryLocal) * seqListSize);
                 }
-            };
-            memcpy(sequenceHits, entries, sizeof(IndexEntryLocal) * seqListSize);
-            sequenceHits += seqListSize;
-            numMatches += seqListSize;
+                sequenceHits += seqListSize;
+                numMatches += seqListSize;
+            }
+            indexTo = current_i;
         }
-        indexTo = current_i;
     }
     outer:
     indexPointer[indexTo + 1] = databaseHits + numMatches;
@@ -327,6 +427,122 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
     return hitCount;
 }
 
+// stable LSD radix sort of the k-mer references by k-mer, ties keep their generation order
+static void sortBatchKmers(std::vector<BatchKmer> &kmers, std::vector<BatchKmer> &buffer, size_t tableSize) {
+    // at most 13 bits per pass, so that the counts stay in the L1/L2 cache
+    const unsigned int MAX_RADIX_BITS = 13;
+    unsigned int keyBits = 0;
+    while (keyBits < 32 && ((tableSize - 1) >> keyBits) != 0) {
+        keyBits++;
+    }
+    const unsigned int passes = (keyBits + MAX_RADIX_BITS - 1) / MAX_RADIX_BITS;
+    if (passes == 0) {
+        return;
+    }
+    const unsigned int radixBits = (keyBits + passes - 1) / passes;
+    const size_t buckets = static_cast<size_t>(1) << radixBits;
+    std::vector<size_t> counts(buckets);
+    buffer.resize(kmers.size());
+    for (unsigned int pass = 0; pass < passes; pass++) {
+        const unsigned int shift = pass * radixBits;
+        std::fill(counts.begin(), counts.end(), 0);
+        for (size_t i = 0; i < kmers.size(); i++) {
+            counts[(kmers[i].kmer >> shift) & (buckets - 1)]++;
+        }
+        size_t sum = 0;
+        for (size_t i = 0; i < buckets; i++) {
+            const size_t count = counts[i];
+            counts[i] = sum;
+            sum += count;
+        }
+        for (size_t i = 0; i < kmers.size(); i++) {
+            buffer[counts[(kmers[i].kmer >> shift) & (buckets - 1)]++] = kmers[i];
+        }
+        kmers.swap(buffer);
+    }
+}
+
+void QueryMatcher::prepareBatch(Sequence **querySeqs, size_t querySeqCount) {
+    batchSeqs = querySeqs;
+    batchKmers.clear();
+    batchPositions.clear();
+    batchQueries.clear();
+    batchEntries.clear();
+    Indexer idx(indexTable->getAlphabetSize(), kmerSize);
+    const int xIndex = kmerSubMat->aa2int[(int)'X'];
+
+    // generate the similar k-mers of all queries, the id of a k-mer is its position in the generation order
+    for (size_t i = 0; i < querySeqCount; i++) {
+        Sequence *querySeq = querySeqs[i];
+        querySeq->resetCurrPos();
+        computeCompositionBias(querySeq);
+        BatchQuery query;
+        query.positionFrom = batchPositions.size();
+        while (querySeq->hasNextKmer()) {
+            BatchPosition position;
+            positionKmers.clear();
+            position.hasX = (addSimilarKmers(querySeq, compositionBias, idx, xIndex, positionKmers) == false);
+            position.position = querySeq->getCurrentPosition();
+            position.kmerFrom = batchKmers.size();
+            for (size_t j = 0; j < positionKmers.size(); j++) {
+                BatchKmer kmer;
+                kmer.kmer = positionKmers[j];
+                kmer.id = batchKmers.size();
+                batchKmers.push_back(kmer);
+            }
+            batchPositions.push_back(position);
+        }
+        query.positionTo = batchPositions.size();
+        batchQueries.push_back(query);
+    }
+    const size_t kmerCount = batchKmers.size();
+    BatchPosition end;
+    end.position = 0;
+    end.hasX = false;
+    end.kmerFrom = kmerCount;
+    batchPositions.push_back(end);
+
+    // all queries that use the same k-mer list are now next to each other
+    sortBatchKmers(batchKmers, batchKmerBuffer, indexTable->getTableSize());
+
+    // look up each k-mer list once, in the order of the index table
+    const bool compressedIndex = indexTable->isCompressed();
+    batchLists.resize(kmerCount);
+    BatchList list;
+    list.entries = NULL;
+    list.compressedEntries = NULL;
+    list.from = 0;
+    list.size = 0;
+    for (size_t i = 0; i < kmerCount; i++) {
+        if (i == 0 || batchKmers[i].kmer != batchKmers[i - 1].kmer) {
+            list.entries = NULL;
+            list.compressedEntries = NULL;
+            list.from = batchEntries.size();
+            if (compressedIndex) {
+                const unsigned char *data = indexTable->getCompressedDBSeqList(batchKmers[i].kmer, &list.size);
+                const bool shared = (i + 1 < kmerCount && batchKmers[i + 1].kmer == batchKmers[i].kmer);
+                if (shared && list.from + list.size <= MAX_BATCH_ENTRIES) {
+                    batchEntries.resize(list.from + list.size);
+                    IndexTable::decodeDBSeqList(data, list.size, batchEntries.data() + list.from);
+                } else {
+                    list.compressedEntries = data;
+                }
+            } else {
+                list.entries = indexTable->getDBSeqList(batchKmers[i].kmer, &list.size);
+            }
+        }
+        batchLists[batchKmers[i].id] = list;
+    }
+}
+
+std::pair<hit_t *, size_t> QueryMatcher::matchBatchQuery(size_t batchId, unsigned int identityId) {
+    Sequence *querySeq = batchSeqs[batchId];
+    memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
+    computeCompositionBias(querySeq);
+    size_t resultSize = match(querySeq, compositionBias, &batchQueries[batchId]);
+    return scoreHits(querySeq, identityId, resultSize);
+}
+
 size_t QueryMatcher::getDoubleDiagonalMatches(){
     size_t retValue = 0;
     for(size_t i = 1; i < SCORE_RANGE; i++){
@@ -6,6 +6,8 @@
 #define MMSEQS_QUERYTEMPLATEMATCHEREXACTMATCH_H
 
 #include <cstdlib>
+#include <cstring>
+#include <vector>
 #include "itoa.h"
 #include "EvalueComputation.h"
 #include "CacheFriendlyOperations.h"
@@ -71,6 +73,12 @@ struct hit_t {
 
 
 
+// reference to a similar k-mer of a query in a batch, id is its position in the generation order
+struct BatchKmer {
+    unsigned int kmer;
+    unsigned int id;
+};
+
 class QueryMatcher {
 public:
     QueryMatcher(IndexTable *indexTable, SequenceLookup *sequenceLookup,
@@ -102,13 +110,37 @@ public:
         this->kmerGenerator->setDivideStrategy(three, two );
     }
 
+    // Query batch mode (experimental): the k-mer lists needed by a batch of queries are looked up once per batch in k-mer order.
+    // prepareBatch decodes compressed lists shared by several k-mers into a buffer of the batch,
+    // matchBatchQuery then matches the queries one by one against them.
+    // The query sequences must not be changed until the last query of the batch is matched.
+    void prepareBatch(Sequence **querySeqs, size_t querySeqCount);
+
+    // returns the result of the batchId-th query of the prepared batch, same as matchQuery
+    std::pair<hit_t *, size_t> matchBatchQuery(size_t batchId, unsigned int identityId);
+
     // get statistics
     const statistics_t * getStatistics(){
         return stats;
     }
 
+    // distance (in k-mer lists) between prefetching a list and matching it, 0 disables prefetching
+    void setPrefetchDistance(unsigned int distance) {
+        prefetchDistance = distance;
+    }
+
+    // adaptive k-mer threshold: a query position keeps its maxKmers highest scoring similar k-mers
+    // (ties broken in generation order) and its exact k-mer, 0 keeps all k-mers above the threshold
+    void setMaxKmersPerPosition(size_t maxKmers) {
+        maxKmersPerPosition = maxKmers;
+    }
+
     const static size_t SCORE_RANGE = 256;
 
+    // number of query positions whose k-mer lists are generated before their lists are matched
+    const static unsigned int PREFETCH_POSITIONS = 8;
+    const static unsigned int PREFETCH_DISTANCE = 16;
+
     static unsigned int computeScoreThreshold(unsigned int * scoreSizes, size_t maxHitsPerQuery) {
         size_t foundHits = 0;
         size_t scoreThr = 0;
@@ -175,6 +207,19 @@ public:
         return tmpBuff - basePos;
     }
 
+    // binary prefilter results are a sequence of hit_t records, see Sequence::PREFILTER_RES_BINARY
+    static size_t prefilterHitToBinaryBuffer(char *buff1, const hit_t &h) {
+        memcpy(buff1, &h, sizeof(hit_t));
+        return sizeof(hit_t);
+    }
+
+    // records are not aligned within an entry
+    static hit_t parseBinaryPrefilterHit(const char *data) {
+        hit_t result;
+        memcpy(&result, data, sizeof(hit_t));
+        return result;
+    }
+
 protected:
 
     // keeps stats for run
@@ -234,6 +279,43 @@ protected:
     // evaluated bins
     CounterResult * foundDiagonals;
 
+    // similar k-mers of the query positions that are currently prefetched
+    std::vector<unsigned int> positionKmers;
+    unsigned int prefetchDistance;
+
+    size_t maxKmersPerPosition;
+    // scores of a similar k-mer list that exceeds maxKmersPerPosition
+    std::vector<short> kmerScoreBuffer;
+
+    struct BatchPosition {
+        unsigned short position;
+        bool hasX;
+        // first k-mer in generation order
+        size_t kmerFrom;
+    };
+    struct BatchQuery {
+        size_t positionFrom;
+        size_t positionTo;
+    };
+    // k-mer list of a similar k-mer, in the index table if entries or compressedEntries is set, otherwise in batchEntries
+    struct BatchList {
+        const IndexEntryLocal *entries;
+        const unsigned char *compressedEntries;
+        size_t from;
+        size_t size;
+    };
+    // at most this many entries of compressed k-mer lists are decoded per batch, the others are decoded while matching
+    static const size_t MAX_BATCH_ENTRIES = 1 << 20;
+    Sequence **batchSeqs;
+    std::vector<BatchKmer> batchKmers;
+    std::vector<BatchKmer> batchKmerBuffer;
+    // in generation order
+    std::vector<BatchList> batchLists;
+    std::vector<BatchPosition> batchPositions;
+    std::vector<BatchQuery> batchQueries;
+    // compressed k-mer lists used by more than one k-mer of the batch, decoded once
+    std::vector<IndexEntryLocal> batchEntries;
+
     // last data pointer (for overflow check)
     IndexEntryLocal * lastSequenceHit;
 
@@ -256,8 +338,17 @@ protected:
     //pointer to seqLens
     float *seqLens;
 
-    // match sequence against the IndexTable
-    size_t match(Sequence *seq, float *pDouble);
+    // match sequence against the IndexTable, or against the lists of the prepared batch if batchQuery is set
+    size_t match(Sequence *seq, float *pDouble, const BatchQuery *batchQuery = NULL);
+
+    // appends the k-mers similar to the next k-mer of seq to kmers, returns false if the k-mer contains X
+    bool addSimilarKmers(Sequence *seq, float *compositionBias, Indexer &idx, int xIndex, std::vector<unsigned int> &kmers);
+
+    // writes the local amino acid bias correction of the query to compositionBias
+    void computeCompositionBias(Sequence *querySeq);
+
+    // scores the hits found by match and extracts the result
+    std::pair<hit_t *, size_t> scoreHits(Sequence *querySeq, unsigned int identityId, size_t resultSize);
 
     // extract result from databaseHits
     std::pair<hit_t *, size_t> getResult(CounterResult * results,
@@ -278,6 +369,9 @@ protected:
     // size of max diagonalMatcher result objects
     size_t counterResultSize;
 
+    // byte of the buffers registered with MemoryGovernor
+    size_t reservedMemory;
+
     void initDiagonalMatcher(size_t dbsize, unsigned int maxDbMatches);
 
     void deleteDiagonalMatcher(unsigned int activeCounter);
@@ -9,6 +9,8 @@
 #include "simd.h"
 #include "CacheFriendlyOperations.h"
 #include "SequenceLookup.h"
+#include "SimdDispatch.h"
+
 class UngappedAlignment {
 
 public:
@@ -33,9 +35,23 @@ public:
         return bias;
     }
 
+    const static unsigned int PROFILESIZE = 32;
+
+    // instruction set specific part of the diagonal scoring (UngappedAlignmentKernel.cpp)
+    struct kernel_t {
+        // number of db sequences scored in parallel
+        unsigned int lanes;
+        // scores the diagonal of lanes db sequences in parallel
+        // dbSeq is interleaved (see mapSequences), the max score of each sequence is written to scores
+        void (*diagonalScoring)(const char *profile, const char bias, const unsigned int seqLen,
+                                const unsigned char *dbSeq, unsigned int *scores);
+    };
+
 private:
     const static unsigned int DIAGONALCOUNT = 0xFFFF + 1;
-    const static unsigned int PROFILESIZE = 32;
+
+    // kernel for the instruction set selected at construction
+    const kernel_t *kernel;
 
     unsigned int *score_arr;
     unsigned char *vectorSequence;
@@ -61,10 +77,6 @@ private:
                                     const unsigned int seqLen,
                                     const unsigned char *dbSeq);
 
-    // scores the diagonal of  16/32 db sequences in parallel
-    simd_int vectorDiagonalScoring(const char *profile,
-                                         const char bias, const unsigned int seqLen, const unsigned char *dbSeq);
-
     std::pair<unsigned char *, unsigned int> mapSequences(std::pair<unsigned char *, unsigned int> * seqs, unsigned int seqCount);
 
     // calles vectorDiagonalScoring or scalarDiagonalScoring depending on the hitSize
@@ -73,14 +85,8 @@ private:
                                     const short diagonal, CounterResult **hits, const unsigned int hitSize,
                                     const short bias);
 
-#ifdef AVX2
-    __m256i Shuffle(const __m256i &value, const __m256i &shuffle);
-#endif
-
     unsigned short distanceFromDiagonal(const unsigned short diagonal);
 
-    void extractScores(unsigned int *score_arr, simd_int score);
-
     short createProfile(Sequence *seq, float *biasCorrection, short **subMat, int alphabetSize);
 
     unsigned int diagonalLength(const short diagonal, const unsigned int len, const unsigned int second);
@@ -96,5 +102,6 @@ private:
 
 };
 
+SIMD_KERNEL_DECLARE(UngappedAlignment::kernel_t, ungappedAlignmentKernel)
 
 #endif //MMSEQS_DIAGONALMATCHER_H
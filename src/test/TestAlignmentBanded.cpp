@@ -0,0 +1,120 @@
+// Aligns queries against long targets, which contain a copy of the query with substitutions and indels,
+// with the banded forward pass around the diagonal of the start of the copy and with the full striped forward pass.
+// Checks that both find the same alignment, also if the band has to be widened and for diagonals beyond 16 bit.
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Matcher.h"
+#include "Sequence.h"
+#include "SubstitutionMatrix.h"
+#include "Timer.h"
+#include "Parameters.h"
+
+const char* binary_name = "test_alignmentbanded";
+
+static const int maxSeqLen = 50000;
+
+std::string randomSequence(size_t len) {
+    const char *aa = "ACDEFGHIKLMNPQRSTVWY";
+    std::string seq;
+    for (size_t i = 0; i < len; i++) {
+        seq.push_back(aa[rand() % 20]);
+    }
+    return seq;
+}
+
+// substitutions, short insertions and deletions and a long insertion in the middle
+std::string mutate(const std::string &seq) {
+    std::string out;
+    for (size_t i = 0; i < seq.size(); i++) {
+        if (i == seq.size() / 2) {
+            out.append(randomSequence(30));
+        }
+        const int r = rand() % 100;
+        if (r < 20) {
+            out.push_back("ACDEFGHIKLMNPQRSTVWY"[rand() % 20]);
+        } else if (r < 21) {
+            out.append(randomSequence(1 + rand() % 4));
+            out.push_back(seq[i]);
+        } else if (r < 22) {
+            i += rand() % 4;
+        } else {
+            out.push_back(seq[i]);
+        }
+    }
+    return out;
+}
+
+int main (int, const char**) {
+    SubstitutionMatrix subMat("blosum62.out", 2.0, 0.0);
+    EvalueComputation evaluer(100000000, &subMat, 11, 1);
+    Matcher full(Sequence::AMINO_ACIDS, maxSeqLen, &subMat, &evaluer, true, 11, 1);
+    Matcher banded(Sequence::AMINO_ACIDS, maxSeqLen, &subMat, &evaluer, true, 11, 1);
+    banded.setBandWidth(16);
+    Sequence query(maxSeqLen, Sequence::AMINO_ACIDS, &subMat, 6, true, false);
+    Sequence target(maxSeqLen, Sequence::AMINO_ACIDS, &subMat, 6, true, false);
+
+    struct Case {
+        std::string query;
+        std::string target;
+        // stored like the diagonal of a prefilter hit
+        unsigned short diagonal;
+    };
+    std::vector<Case> cases;
+    srand(1);
+    const size_t queryLengths[] = {50, 300, 1000};
+    const size_t targetLengths[] = {3000, 35000, 45000};
+    // offset of the diagonal passed to the banded pass from the diagonal of the copy
+    const int diagonalShifts[] = {0, 3, -5};
+    for (size_t q = 0; q < sizeof(queryLengths) / sizeof(queryLengths[0]); q++) {
+        for (size_t t = 0; t < sizeof(targetLengths) / sizeof(targetLengths[0]); t++) {
+            for (size_t s = 0; s < sizeof(diagonalShifts) / sizeof(diagonalShifts[0]); s++) {
+                Case c;
+                c.query = randomSequence(queryLengths[q]);
+                // the copy is at the end of the target, diagonals of long targets do not fit into 16 bit
+                const size_t offset = targetLengths[t] - queryLengths[q] - 200;
+                c.target = randomSequence(offset) + mutate(c.query) + randomSequence(200);
+                c.diagonal = static_cast<unsigned short>(-static_cast<int>(offset) + diagonalShifts[s]);
+                cases.push_back(c);
+            }
+        }
+    }
+
+    std::vector<Matcher::result_t> expected;
+    Timer timer;
+    for (size_t i = 0; i < cases.size(); i++) {
+        query.mapSequence(0, 0, cases[i].query.c_str());
+        target.mapSequence(1, 1, cases[i].target.c_str());
+        full.initQuery(&query);
+        expected.push_back(full.getSWResult(&target, INT_MAX, 0, 0.0, 10000, Matcher::SCORE_COV_SEQID, 0, false));
+    }
+    std::cout << "Full Smith-Waterman: " << timer.lap() << "\n";
+
+    std::vector<Matcher::result_t> results;
+    timer.reset();
+    for (size_t i = 0; i < cases.size(); i++) {
+        query.mapSequence(0, 0, cases[i].query.c_str());
+        target.mapSequence(1, 1, cases[i].target.c_str());
+        banded.initQuery(&query);
+        results.push_back(banded.getSWResult(&target, cases[i].diagonal, 0, 0.0, 10000, Matcher::SCORE_COV_SEQID, 0, false));
+    }
+    std::cout << "Banded: " << timer.lap() << "\n";
+
+    int failed = 0;
+    for (size_t i = 0; i < cases.size(); i++) {
+        const Matcher::result_t &r = results[i];
+        const Matcher::result_t &e = expected[i];
+        if (r.score != e.score || r.qStartPos != e.qStartPos || r.qEndPos != e.qEndPos
+            || r.dbStartPos != e.dbStartPos || r.dbEndPos != e.dbEndPos || r.backtrace != e.backtrace) {
+            std::cout << "Query length " << r.qLen << " target length " << r.dbLen << ": "
+                      << r.score << " " << r.qStartPos << "-" << r.qEndPos << " " << r.dbStartPos << "-" << r.dbEndPos
+                      << " expected " << e.score << " " << e.qStartPos << "-" << e.qEndPos << " "
+                      << e.dbStartPos << "-" << e.dbEndPos << "\n";
+            failed++;
+        }
+    }
+    std::cout << "Compared " << cases.size() << " alignments, " << failed << " differ\n";
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
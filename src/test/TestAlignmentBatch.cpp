@@ -0,0 +1,147 @@
+// Aligns short queries against batches of targets with the inter-sequence kernel
+// and checks score and end positions against the striped kernel. Without composition bias correction the
+// suboptimal end is checked against the column maxima of a scalar Smith-Waterman.
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "StripedSmithWaterman.h"
+#include "Sequence.h"
+#include "SubstitutionMatrix.h"
+#include "Parameters.h"
+
+const char* binary_name = "test_alignmentbatch";
+
+std::string randomSequence(size_t len) {
+    const char *aa = "ACDEFGHIKLMNPQRSTVWYX";
+    std::string seq;
+    for (size_t i = 0; i < len; i++) {
+        seq.push_back(aa[rand() % 21]);
+    }
+    return seq;
+}
+
+std::string mutate(const std::string &seq) {
+    std::string out = seq;
+    for (size_t i = 0; i < out.size(); i++) {
+        if (rand() % 4 == 0) {
+            out[i] = "ACDEFGHIKLMNPQRSTVWY"[rand() % 20];
+        }
+    }
+    return out;
+}
+
+// suboptimal end as defined by maskLen of SmithWaterman::ssw_align
+SmithWaterman::alignment_end scalarSuboptimal(const Sequence &query, const Sequence &target, const int8_t *mat,
+                                              int alphabetSize, int gapOpen, int gapExtend, int32_t bestRef, int32_t maskLen) {
+    std::vector<int> H(query.L + 1, 0);
+    std::vector<int> E(query.L + 1, 0);
+    std::vector<int> maxColumn(target.L, 0);
+    for (int i = 0; i < target.L; i++) {
+        int diagonal = 0;
+        int F = 0;
+        for (int j = 0; j < query.L; j++) {
+            const int h = std::max(std::max(diagonal + mat[query.int_sequence[j] * alphabetSize + target.int_sequence[i]], 0),
+                                   std::max(E[j + 1], F));
+            maxColumn[i] = std::max(maxColumn[i], h);
+            diagonal = H[j + 1];
+            H[j + 1] = h;
+            E[j + 1] = std::max(E[j + 1] - gapExtend, h - gapOpen);
+            F = std::max(F - gapExtend, h - gapOpen);
+        }
+    }
+    SmithWaterman::alignment_end second = { 0, 0, 0 };
+    for (int i = 0; i < target.L; i++) {
+        if ((i < bestRef - maskLen || i > bestRef + maskLen) && maxColumn[i] > second.score) {
+            second.score = static_cast<uint16_t>(maxColumn[i]);
+            second.ref = i;
+        }
+    }
+    return second;
+}
+
+int main (int, const char**) {
+    SubstitutionMatrix subMat("blosum62.out", 2.0, 0.0);
+    int8_t *tinySubMat = new int8_t[subMat.alphabetSize * subMat.alphabetSize];
+    for (int i = 0; i < subMat.alphabetSize; i++) {
+        for (int j = 0; j < subMat.alphabetSize; j++) {
+            tinySubMat[i * subMat.alphabetSize + j] = (int8_t) subMat.subMatrix[i][j];
+        }
+    }
+    EvalueComputation evaluer(100000, &subMat, 11, 1);
+    Sequence query(10000, Sequence::AMINO_ACIDS, &subMat, 6, true, false);
+    const unsigned int batchSize = SmithWaterman(1, subMat.alphabetSize, false).getBatchSize();
+    std::vector<Sequence *> targets;
+    for (unsigned int i = 0; i < batchSize; i++) {
+        targets.push_back(new Sequence(10000, Sequence::AMINO_ACIDS, &subMat, 6, true, false));
+    }
+    std::vector<SmithWaterman::alignment_end> ends(2 * batchSize);
+
+    srand(1);
+    const size_t queryLengths[] = {1, 12, 40, 100, 250};
+    size_t compared = 0;
+    int failed = 0;
+    for (size_t run = 0; run < 2; run++) {
+        const bool biasCorrection = (run == 0);
+        SmithWaterman aligner(10000, subMat.alphabetSize, biasCorrection);
+        for (size_t q = 0; q < sizeof(queryLengths) / sizeof(queryLengths[0]); q++) {
+            const std::string querySeq = randomSequence(queryLengths[q]);
+            query.mapSequence(0, 0, querySeq.c_str());
+            aligner.ssw_init(&query, tinySubMat, &subMat, subMat.alphabetSize, 2);
+            for (size_t round = 0; round < 4; round++) {
+                // fill only part of the lanes in the last round
+                const unsigned int count = (round == 3) ? batchSize / 2 + 1 : batchSize;
+                for (unsigned int i = 0; i < count; i++) {
+                    std::string targetSeq;
+                    if (rand() % 2 == 0) {
+                        targetSeq = randomSequence(1 + rand() % 300);
+                    } else {
+                        targetSeq = randomSequence(rand() % 20) + mutate(querySeq) + randomSequence(rand() % 20);
+                    }
+                    targets[i]->mapSequence(i, i, targetSeq.c_str());
+                    aligner.ssw_batch_add(targets[i]->int_sequence, targets[i]->L);
+                }
+                const int32_t maskLen = query.L / 2;
+                if (aligner.ssw_batch_align(11, 1, maskLen, ends.data()) == false) {
+                    std::cout << "Query of length " << query.L << " could not be aligned in batches\n";
+                    failed++;
+                    continue;
+                }
+                for (unsigned int i = 0; i < count; i++) {
+                    s_align aln = aligner.ssw_align(targets[i]->int_sequence, targets[i]->L, 11, 1, 0, 10000, &evaluer, 0, 0.0, maskLen);
+                    const SmithWaterman::alignment_end *forward = &ends[2 * i];
+                    if (aln.score1 != forward[0].score || aln.dbEndPos1 != forward[0].ref || aln.qEndPos1 != forward[0].read) {
+                        std::cout << "Query length " << query.L << " target " << i << ": "
+                                  << forward[0].score << " " << forward[0].read << " " << forward[0].ref << " expected "
+                                  << aln.score1 << " " << aln.qEndPos1 << " " << aln.dbEndPos1 << "\n";
+                        failed++;
+                    }
+                    s_align batchAln = aligner.ssw_align(targets[i]->int_sequence, targets[i]->L, 11, 1, 0, 10000, &evaluer, 0, 0.0, maskLen, forward);
+                    if (biasCorrection == false && maskLen >= 15) {
+                        SmithWaterman::alignment_end second = scalarSuboptimal(query, *targets[i], tinySubMat, subMat.alphabetSize,
+                                                                               11, 1, forward[0].ref, maskLen);
+                        if (second.score != batchAln.score2 || second.ref != batchAln.ref_end2) {
+                            std::cout << "Query length " << query.L << " target " << i << ": suboptimal "
+                                      << batchAln.score2 << " " << batchAln.ref_end2 << " expected "
+                                      << second.score << " " << second.ref << "\n";
+                            failed++;
+                        }
+                    } else if (maskLen < 15 && (batchAln.score2 != 0 || batchAln.ref_end2 != -1)) {
+                        std::cout << "Query length " << query.L << " target " << i << ": suboptimal without maskLen\n";
+                        failed++;
+                    }
+                    compared++;
+                }
+            }
+        }
+    }
+    std::cout << "Batch size " << batchSize << ", compared " << compared << " alignments, " << failed << " differ\n";
+
+    for (unsigned int i = 0; i < batchSize; i++) {
+        delete targets[i];
+    }
+    delete [] tinySubMat;
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+// Writes random alignment results and prefilter hits once as text and once as binary records,
+// compares what is parsed back from both and prints the size and the time to parse both.
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "Matcher.h"
+#include "QueryMatcher.h"
+#include "Timer.h"
+
+const char* binary_name = "test_alignmentbinaryresults";
+
+static const size_t entries = 20000;
+
+static Matcher::result_t randomResult(unsigned int key) {
+    const char states[3] = { 'M', 'I', 'D' };
+    std::string backtrace;
+    size_t length = 20 + rand() % 300;
+    for (size_t i = 0; i < length; i++) {
+        backtrace.push_back((rand() % 4 == 0) ? states[rand() % 3] : 'M');
+    }
+    int qStart = rand() % 100;
+    int dbStart = rand() % 100;
+    unsigned int qLen = qStart + length + rand() % 100;
+    unsigned int dbLen = dbStart + length + rand() % 100;
+    // the text format zero pads identities below 0.1 inexactly
+    float seqId = (100 + rand() % 901) / 1000.0f;
+    double eval = pow(10.0, -(rand() % 100)) * (1 + rand() % 9);
+    return Matcher::result_t(key, rand() % 2000, 0, 0, seqId, eval, 0, qStart, qStart + length - 1, qLen,
+                             dbStart, dbStart + length - 1, dbLen, backtrace);
+}
+
+static bool sameResult(const Matcher::result_t &a, const Matcher::result_t &b) {
+    // text records print the sequence identity with three and the e-value with four significant digits
+    return a.dbKey == b.dbKey && a.score == b.score && fabs(a.seqId - b.seqId) < 0.0011f
+           && fabs(a.eval - b.eval) <= fabs(a.eval) * 0.001 && a.qcov == b.qcov && a.dbcov == b.dbcov
+           && a.alnLength == b.alnLength && a.qStartPos == b.qStartPos && a.qEndPos == b.qEndPos
+           && a.qLen == b.qLen && a.dbStartPos == b.dbStartPos && a.dbEndPos == b.dbEndPos
+           && a.dbLen == b.dbLen && a.backtrace == b.backtrace;
+}
+
+int main (int, const char**) {
+    srand(1);
+    std::string text;
+    std::string binary;
+    std::vector<Matcher::result_t> results;
+    char buffer[4096];
+    for (size_t i = 0; i < entries; i++) {
+        Matcher::result_t res = randomResult(i);
+        results.push_back(res);
+        const bool addBacktrace = (i % 2 == 0);
+        text.append(buffer, Matcher::resultToBuffer(buffer, res, addBacktrace));
+        binary.append(buffer, Matcher::resultToBinaryBuffer(buffer, res, addBacktrace));
+    }
+    std::cout << "Alignment results as text: " << text.size() << " byte, binary: " << binary.size() << " byte\n";
+
+    int failed = 0;
+    if (Matcher::countBinaryRecords(binary.c_str(), binary.size()) != entries) {
+        std::cout << "Wrong number of binary records\n";
+        failed++;
+    }
+
+    std::vector<Matcher::result_t> fromText;
+    std::vector<Matcher::result_t> fromBinary;
+    Timer timer;
+    Matcher::readAlignmentResults(fromText, (char *) text.c_str(), text.size(), false);
+    std::cout << "Time to parse text: " << timer.lap() << "\n";
+    timer.reset();
+    Matcher::readAlignmentResults(fromBinary, (char *) binary.c_str(), binary.size(), true);
+    std::cout << "Time to parse binary: " << timer.lap() << "\n";
+
+    if (fromText.size() != entries || fromBinary.size() != entries) {
+        std::cout << "Wrong number of parsed results\n";
+        failed++;
+    }
+    for (size_t i = 0; failed == 0 && i < entries; i++) {
+        if (i % 2 != 0) {
+            results[i].backtrace.clear();
+        }
+        results[i].qcov = fromText[i].qcov;
+        results[i].dbcov = fromText[i].dbcov;
+        results[i].alnLength = fromText[i].alnLength;
+        if (sameResult(fromText[i], fromBinary[i]) == false || sameResult(results[i], fromBinary[i]) == false
+            || results[i].seqId != fromBinary[i].seqId || results[i].eval != fromBinary[i].eval) {
+            std::cout << "Alignment result " << i << " differs\n";
+            failed++;
+        }
+    }
+
+    std::string hitText;
+    std::string hitBinary;
+    std::vector<hit_t> hits;
+    for (size_t i = 0; i < entries; i++) {
+        hit_t hit;
+        hit.seqId = i;
+        hit.pScore = rand() % 256;
+        hit.diagonal = rand() % 65536;
+        hit.prefScore = hit.pScore;
+        hits.push_back(hit);
+        hitText.append(buffer, QueryMatcher::prefilterHitToBuffer(buffer, hit));
+        hitBinary.append(buffer, QueryMatcher::prefilterHitToBinaryBuffer(buffer, hit));
+    }
+    std::cout << "Prefilter hits as text: " << hitText.size() << " byte, binary: " << hitBinary.size() << " byte\n";
+    std::vector<hit_t> hitsFromText = QueryMatcher::parsePrefilterHits((char *) hitText.c_str());
+    for (size_t i = 0; failed == 0 && i < entries; i++) {
+        hit_t hit = QueryMatcher::parseBinaryPrefilterHit(hitBinary.c_str() + i * sizeof(hit_t));
+        if (i >= hitsFromText.size() || hit.seqId != hits[i].seqId || hit.pScore != hits[i].pScore
+            || hit.diagonal != hits[i].diagonal || hit.prefScore != hits[i].prefScore
+            || hit.seqId != hitsFromText[i].seqId || hit.pScore != hitsFromText[i].pScore
+            || hit.diagonal != hitsFromText[i].diagonal) {
+            std::cout << "Prefilter hit " << i << " differs\n";
+            failed++;
+        }
+    }
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -11,6 +11,8 @@
 #include <cstring>
 #include <vector>
 #include <iostream>
+#include <cfloat>
+#include <climits>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -22,11 +24,38 @@
 #include "ExtendedSubstitutionMatrix.h"
 #include "SubstitutionMatrix.h"
 #include "StripedSmithWaterman.h"
+#include "Matcher.h"
+#include "FileUtil.h"
+#include "Timer.h"
 
 const char* binary_name = "test_alignmentperformance";
 
 #define MAX_FILENAME_LIST_FILES 4096
 
+#ifdef __GLIBC__
+// counts the allocations of the process, glibc exports its allocator under these names
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+static size_t allocations = 0;
+
+extern "C" void *malloc(size_t size) {
+    __sync_fetch_and_add(&allocations, 1);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size) {
+    __sync_fetch_and_add(&allocations, 1);
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+    __sync_fetch_and_add(&allocations, 1);
+    return __libc_realloc(ptr, size);
+}
+#endif
+
 KSEQ_INIT(int, read)
 
 
@@ -51,6 +80,113 @@ std::vector<std::string> readData(std::string fasta_filename){
     fclose(fasta_file);
     return retVec;
 }
+
+std::string randomSequence(size_t len) {
+    const char *aa = "ACDEFGHIKLMNPQRSTVWY";
+    std::string seq;
+    for (size_t i = 0; i < len; i++) {
+        seq.push_back(aa[rand() % 20]);
+    }
+    return seq;
+}
+
+// substitutions and short insertions and deletions
+std::string mutate(const std::string &seq) {
+    std::string out;
+    for (size_t i = 0; i < seq.size(); i++) {
+        const int r = rand() % 100;
+        if (r < 30) {
+            out.push_back("ACDEFGHIKLMNPQRSTVWY"[rand() % 20]);
+        } else if (r < 32) {
+            out.append(randomSequence(1 + rand() % 4));
+            out.push_back(seq[i]);
+        } else if (r < 34) {
+            i += rand() % 4;
+        } else {
+            out.push_back(seq[i]);
+        }
+    }
+    return out;
+}
+
+// Counts the allocations of aligning and writing a pair with backtrace, once with results that own their backtrace
+// and once with result views into the backtraces of the query. The second pass over the same pairs should not allocate.
+int allocationBenchmark(SubstitutionMatrix &subMat) {
+    const int maxSeqLen = 10000;
+    EvalueComputation evaluer(100000000, &subMat, 11, 1);
+    Matcher matcher(Sequence::AMINO_ACIDS, maxSeqLen, &subMat, &evaluer, true, 11, 1);
+    Sequence query(maxSeqLen, Sequence::AMINO_ACIDS, &subMat, 6, true, false);
+    Sequence target(maxSeqLen, Sequence::AMINO_ACIDS, &subMat, 6, true, false);
+
+    srand(1);
+    std::vector<std::string> queries;
+    std::vector<std::vector<std::string> > targets;
+    for (size_t i = 0; i < 50; i++) {
+        queries.push_back(randomSequence(100 + rand() % 700));
+        targets.push_back(std::vector<std::string>());
+        for (size_t j = 0; j < 10; j++) {
+            targets.back().push_back((j % 2 == 0) ? mutate(queries.back()) : randomSequence(100 + rand() % 700));
+        }
+    }
+    const size_t pairs = queries.size() * targets[0].size();
+
+    std::vector<Matcher::result_t> results;
+    std::vector<Matcher::result_view_t> views;
+    results.reserve(targets[0].size());
+    views.reserve(targets[0].size());
+    std::string backtraces;
+    char buffer[1024+32768];
+    size_t written = 0;
+    for (int view = 0; view < 2; view++) {
+        // the first pass grows the buffers
+        for (int pass = 0; pass < 2; pass++) {
+#ifdef __GLIBC__
+            const size_t allocationsBefore = allocations;
+#endif
+            Timer timer;
+            for (size_t i = 0; i < queries.size(); i++) {
+                query.mapSequence(i, i, queries[i].c_str());
+                matcher.initQuery(&query);
+                results.clear();
+                views.clear();
+                backtraces.clear();
+                for (size_t j = 0; j < targets[i].size(); j++) {
+                    target.mapSequence(j, j, targets[i][j].c_str());
+                    if (view == 1) {
+                        views.push_back(matcher.getSWResultView(&target, INT_MAX, 0, 0.0, FLT_MAX, Matcher::SCORE_COV_SEQID,
+                                                                0, false, backtraces));
+                    } else {
+                        results.push_back(matcher.getSWResult(&target, INT_MAX, 0, 0.0, FLT_MAX, Matcher::SCORE_COV_SEQID,
+                                                              0, false));
+                    }
+                }
+                for (size_t j = 0; j < results.size(); j++) {
+                    written += Matcher::resultToBuffer(buffer, results[j], true);
+                }
+                for (size_t j = 0; j < views.size(); j++) {
+                    written += Matcher::resultToBuffer(buffer, views[j], backtraces, true);
+                }
+            }
+            if (pass == 0) {
+                continue;
+            }
+            std::cout << ((view == 1) ? "getSWResultView" : "getSWResult") << ": " << pairs << " pairs in " << timer.lap();
+#ifdef __GLIBC__
+            const size_t pairAllocations = allocations - allocationsBefore;
+            std::cout << ", " << (static_cast<double>(pairAllocations) / pairs) << " allocations per pair\n";
+            if (view == 1 && pairAllocations > 0) {
+                std::cout << "Result views allocated " << pairAllocations << " times\n";
+                return 1;
+            }
+#else
+            std::cout << ", allocations are only counted with glibc\n";
+#endif
+        }
+    }
+    std::cout << written << " byte of results\n";
+    return 0;
+}
+
 int main (int argc, const char * argv[])
 {
 
@@ -58,6 +194,15 @@ int main (int argc, const char * argv[])
 
     Parameters& par = Parameters::getInstance();
     SubstitutionMatrix subMat(par.scoringMatrixFile.c_str(), 2.0, 0);
+    if (allocationBenchmark(subMat) != 0) {
+        return EXIT_FAILURE;
+    }
+    // cell throughput on the sequences of a FASTA file
+    const std::string fastaFile = (argc > 1) ? argv[1] : "/Users/mad/Documents/databases/rfam/Rfam.fasta";
+    if (FileUtil::fileExists(fastaFile.c_str()) == false) {
+        std::cout << "Skipping the cell benchmark, " << fastaFile << " does not exist\n";
+        return EXIT_SUCCESS;
+    }
     std::cout << "Subustitution matrix:\n";
     SubstitutionMatrix::print(subMat.subMatrix,subMat.int2aa,subMat.alphabetSize);
     std::cout << "\n";
@@ -85,7 +230,7 @@ int main (int argc, const char * argv[])
     int gap_extend = 1;
     int mode = 0;
     size_t cells = 0;
-    std::vector<std::string> sequences = readData("/Users/mad/Documents/databases/rfam/Rfam.fasta");
+    std::vector<std::string> sequences = readData(fastaFile);
     for(size_t seq_i = 0; seq_i < sequences.size(); seq_i++){
         query->mapSequence(1,1,sequences[seq_i].c_str());
         aligner.ssw_init(query, tinySubMat, &subMat, subMat.alphabetSize, 2);
@@ -0,0 +1,326 @@
+// Extends random nucleotide pairs with the ksw2 kernels of every instruction set that is available on this machine.
+// The single gap cost kernel has to agree with ksw_extz2_sse, the two gap cost kernel with its SSE4.1 version,
+// and both have to find the maximum of a plain dynamic programming without band and Z-drop.
+// BandedNucleotideAligner has to widen its band for a path that reaches the band border and find the same
+// alignment as without band, also with two gap costs.
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "BandedNucleotideAligner.h"
+#include "EvalueComputation.h"
+#include "NucleotideMatrix.h"
+#include "Sequence.h"
+#include "SimdDispatch.h"
+
+const char* binary_name = "test_bandednucleotidekernel";
+
+static const int8_t MATCH = 2;
+static const int8_t MISMATCH = -3;
+static const int8_t ALPHABET_SIZE = 5;
+// gap costs of the two gap cost kernel, the ones of minimap2
+static const int8_t GAP_OPEN = 4;
+static const int8_t GAP_EXTEND = 2;
+static const int8_t LONG_GAP_OPEN = 24;
+static const int8_t LONG_GAP_EXTEND = 1;
+
+struct extension_t {
+    int max;
+    int maxQ;
+    int maxT;
+    int mqe;
+    int mte;
+    int score;
+    int zdropped;
+    std::vector<uint32_t> cigar;
+
+    bool operator==(const extension_t &other) const {
+        return max == other.max && maxQ == other.maxQ && maxT == other.maxT && mqe == other.mqe && mte == other.mte
+               && score == other.score && zdropped == other.zdropped && cigar == other.cigar;
+    }
+};
+
+struct config_t {
+    int w;
+    int zdrop;
+    int flag;
+};
+
+std::vector<uint8_t> randomSequence(size_t len) {
+    std::vector<uint8_t> seq;
+    for (size_t i = 0; i < len; i++) {
+        // N is the wildcard
+        seq.push_back((rand() % 50 == 0) ? 4 : rand() % 4);
+    }
+    return seq;
+}
+
+// substitutions and short and long indels, so that the band border and the second gap cost matter
+std::vector<uint8_t> mutate(const std::vector<uint8_t> &seq) {
+    std::vector<uint8_t> out;
+    for (size_t i = 0; i < seq.size(); i++) {
+        const int event = rand() % 100;
+        if (event < 10) {
+            out.push_back(rand() % 4);
+        } else if (event < 12) {
+            continue;
+        } else if (event < 14) {
+            out.push_back(seq[i]);
+            out.push_back(rand() % 4);
+        } else if (event == 14) {
+            std::vector<uint8_t> insertion = randomSequence(5 + rand() % 30);
+            out.insert(out.end(), insertion.begin(), insertion.end());
+        } else if (event == 15) {
+            i += 5 + rand() % 30;
+        } else {
+            out.push_back(seq[i]);
+        }
+    }
+    return out;
+}
+
+extension_t toExtension(ksw_extz_t &ez) {
+    extension_t ext;
+    ext.max = ez.max;
+    ext.maxQ = ez.max_q;
+    ext.maxT = ez.max_t;
+    ext.mqe = ez.mqe;
+    ext.mte = ez.mte;
+    ext.score = ez.score;
+    ext.zdropped = ez.zdropped;
+    ext.cigar.assign(ez.cigar, ez.cigar + ez.n_cigar);
+    free(ez.cigar);
+    return ext;
+}
+
+extension_t extendReferenceGaps(const std::vector<uint8_t> &q, const std::vector<uint8_t> &t, const int8_t *mat,
+                                const config_t &config, int8_t gapOpen, int8_t gapExtend) {
+    ksw_extz_t ez;
+    memset(&ez, 0, sizeof(ksw_extz_t));
+    ksw_extz2_sse(0, q.size(), q.data(), t.size(), t.data(), ALPHABET_SIZE, mat, gapOpen, gapExtend, config.w,
+                  config.zdrop, config.flag, &ez);
+    return toExtension(ez);
+}
+
+extension_t extendReference(const std::vector<uint8_t> &q, const std::vector<uint8_t> &t, const int8_t *mat,
+                            const config_t &config) {
+    return extendReferenceGaps(q, t, mat, config, 5, 1);
+}
+
+extension_t extendKernel(const BandedNucleotideAligner::kernel_t *kernel, const std::vector<uint8_t> &q,
+                         const std::vector<uint8_t> &t, const int8_t *mat, const config_t &config, bool twoGapCosts) {
+    ksw_extz_t ez;
+    memset(&ez, 0, sizeof(ksw_extz_t));
+    if (twoGapCosts) {
+        kernel->extd2(0, q.size(), q.data(), t.size(), t.data(), ALPHABET_SIZE, mat, GAP_OPEN, GAP_EXTEND,
+                      LONG_GAP_OPEN, LONG_GAP_EXTEND, config.w, config.zdrop, config.flag, &ez);
+    } else {
+        kernel->extz2(0, q.size(), q.data(), t.size(), t.data(), ALPHABET_SIZE, mat, 5, 1, config.w, config.zdrop, config.flag, &ez);
+    }
+    return toExtension(ez);
+}
+
+// maximum of the alignments starting at the first residue of both sequences, a gap of length l costs
+// min(q + l * e, q2 + l * e2) and the wildcard scores wildcardScore
+int extensionMaximum(const std::vector<uint8_t> &q, const std::vector<uint8_t> &t, const int8_t *mat,
+                     int q1, int e1, int q2, int e2, int wildcardScore) {
+    const int NEG = -1000000;
+    const int qLen = q.size();
+    const int tLen = t.size();
+    // row -1 and column -1 are the gaps from the start
+    std::vector<std::vector<int> > H(tLen + 1, std::vector<int>(qLen + 1, NEG));
+    std::vector<std::vector<int> > E1(tLen + 1, std::vector<int>(qLen + 1, NEG));
+    std::vector<std::vector<int> > E2(tLen + 1, std::vector<int>(qLen + 1, NEG));
+    std::vector<std::vector<int> > F1(tLen + 1, std::vector<int>(qLen + 1, NEG));
+    std::vector<std::vector<int> > F2(tLen + 1, std::vector<int>(qLen + 1, NEG));
+    H[0][0] = 0;
+    for (int i = 1; i <= tLen; i++) {
+        H[i][0] = -std::min(q1 + i * e1, q2 + i * e2);
+    }
+    for (int j = 1; j <= qLen; j++) {
+        H[0][j] = -std::min(q1 + j * e1, q2 + j * e2);
+    }
+    int best = 0;
+    for (int i = 1; i <= tLen; i++) {
+        for (int j = 1; j <= qLen; j++) {
+            E1[i][j] = std::max(H[i - 1][j] - q1 - e1, E1[i - 1][j] - e1);
+            E2[i][j] = std::max(H[i - 1][j] - q2 - e2, E2[i - 1][j] - e2);
+            F1[i][j] = std::max(H[i][j - 1] - q1 - e1, F1[i][j - 1] - e1);
+            F2[i][j] = std::max(H[i][j - 1] - q2 - e2, F2[i][j - 1] - e2);
+            const bool wildcard = t[i - 1] == ALPHABET_SIZE - 1 || q[j - 1] == ALPHABET_SIZE - 1;
+            H[i][j] = H[i - 1][j - 1] + (wildcard ? wildcardScore : mat[t[i - 1] * ALPHABET_SIZE + q[j - 1]]);
+            H[i][j] = std::max(std::max(H[i][j], std::max(E1[i][j], E2[i][j])), std::max(F1[i][j], F2[i][j]));
+            best = std::max(best, H[i][j]);
+        }
+    }
+    return best;
+}
+
+std::string randomNucleotides(size_t len) {
+    std::string seq;
+    for (size_t i = 0; i < len; i++) {
+        seq.push_back("ACGT"[rand() % 4]);
+    }
+    return seq;
+}
+
+std::vector<uint8_t> toNumeric(const Sequence &seq) {
+    return std::vector<uint8_t>(seq.int_sequence, seq.int_sequence + seq.L);
+}
+
+// The target misses short pieces of the query, so that the alignment path drifts away from the diagonal. It reaches
+// the border of the initial band before the last deletion, which is only reachable with a wider band. Each deletion is
+// short enough for the Z-drop. Returns the number of failed checks.
+int alignWithBandWidening() {
+    NucleotideMatrix subMat("nucleotide.out", 1.0, 0.0);
+    EvalueComputation evaluer(100000, &subMat, 5, 2);
+    int8_t mat[ALPHABET_SIZE * ALPHABET_SIZE];
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+        for (int j = 0; j < ALPHABET_SIZE; j++) {
+            mat[i * ALPHABET_SIZE + j] = subMat.subMatrix[i][j];
+        }
+    }
+
+    const int deletionLength = 9;
+    const int deletions = BandedNucleotideAligner::BAND_MIN_WIDTH / deletionLength + 1;
+    std::string query = randomNucleotides(300);
+    std::string target = query;
+    for (int i = 0; i < deletions; i++) {
+        const std::string shared = randomNucleotides(40);
+        query += randomNucleotides(deletionLength) + shared;
+        target += shared;
+    }
+    // one long deletion, which is cheaper with the second gap cost
+    const std::string shared = randomNucleotides(300);
+    const std::string longGapQuery = query + randomNucleotides(30) + shared;
+    const std::string longGapTarget = target + shared;
+
+    Sequence qSeq(longGapQuery.size(), Sequence::NUCLEOTIDES, &subMat, 0, false, false);
+    Sequence tSeq(longGapQuery.size(), Sequence::NUCLEOTIDES, &subMat, 0, false, false);
+    qSeq.mapSequence(0, 0, query.c_str());
+    tSeq.mapSequence(1, 1, target.c_str());
+    std::vector<uint8_t> q = toNumeric(qSeq);
+    std::vector<uint8_t> t = toNumeric(tSeq);
+
+    int failed = 0;
+    BandedNucleotideAligner aligner(&subMat, longGapQuery.size(), 5, 2);
+    aligner.initQuery(&qSeq);
+    s_align result = aligner.align(&tSeq, 0, &evaluer);
+    std::vector<uint32_t> cigar(result.cigar, result.cigar + result.cigarLen);
+    config_t initialBand = { BandedNucleotideAligner::BAND_MIN_WIDTH, BandedNucleotideAligner::ZDROP, KSW_EZ_EXTZ_ONLY };
+    config_t noBand = { -1, BandedNucleotideAligner::ZDROP, KSW_EZ_EXTZ_ONLY };
+    extension_t banded = extendReferenceGaps(q, t, mat, initialBand, 5, 2);
+    extension_t expected = extendReferenceGaps(q, t, mat, noBand, 5, 2);
+    if (banded.max >= expected.max) {
+        std::cout << "The initial band already contains the best alignment\n";
+        failed++;
+    }
+    if (result.qStartPos1 != 0 || result.dbStartPos1 != 0 || result.score1 != expected.max
+        || result.qEndPos1 != expected.maxQ || result.dbEndPos1 != expected.maxT || cigar != expected.cigar) {
+        std::cout << "Band widening found " << result.score1 << " " << result.qStartPos1 << "-" << result.qEndPos1
+                  << " " << result.dbStartPos1 << "-" << result.dbEndPos1 << " expected " << expected.max
+                  << " 0-" << expected.maxQ << " 0-" << expected.maxT << "\n";
+        failed++;
+    }
+
+    qSeq.mapSequence(0, 0, longGapQuery.c_str());
+    tSeq.mapSequence(1, 1, longGapTarget.c_str());
+    q = toNumeric(qSeq);
+    t = toNumeric(tSeq);
+    BandedNucleotideAligner dualAligner(&subMat, longGapQuery.size(), 5, 2, LONG_GAP_OPEN, LONG_GAP_EXTEND);
+    dualAligner.initQuery(&qSeq);
+    s_align dualResult = dualAligner.align(&tSeq, 0, &evaluer);
+    const int singleMax = extensionMaximum(q, t, mat, 5, 2, 5, 2, 0);
+    const int dualMax = extensionMaximum(q, t, mat, 5, 2, LONG_GAP_OPEN, LONG_GAP_EXTEND, 0);
+    if (dualResult.score1 != dualMax || dualMax <= singleMax) {
+        std::cout << "Two gap costs found " << dualResult.score1 << " expected " << dualMax
+                  << ", one gap cost " << singleMax << "\n";
+        failed++;
+    }
+    return failed;
+}
+
+int main (int, const char**) {
+    // match and mismatch scores, the wildcard scores 0 with extz2
+    int8_t mat[ALPHABET_SIZE * ALPHABET_SIZE];
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+        for (int j = 0; j < ALPHABET_SIZE; j++) {
+            mat[i * ALPHABET_SIZE + j] = (i == ALPHABET_SIZE - 1 || j == ALPHABET_SIZE - 1) ? 0 : (i == j ? MATCH : MISMATCH);
+        }
+    }
+
+    srand(1);
+    std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t> > > pairs;
+    const size_t lengths[] = {1, 15, 16, 17, 33, 64, 100, 257, 600};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        for (int rep = 0; rep < 3; rep++) {
+            std::vector<uint8_t> query = randomSequence(lengths[i]);
+            pairs.push_back(std::make_pair(query, mutate(query)));
+        }
+        pairs.push_back(std::make_pair(randomSequence(lengths[i]), randomSequence(lengths[i] + rand() % 20)));
+    }
+
+    std::vector<config_t> configs;
+    const int widths[] = {-1, 16, 21, 64};
+    const int flags[] = {KSW_EZ_SCORE_ONLY | KSW_EZ_EXTZ_ONLY, KSW_EZ_EXTZ_ONLY, KSW_EZ_EXTZ_ONLY | KSW_EZ_RIGHT, 0};
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        for (size_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+            config_t config = { widths[w], 40, flags[f] };
+            configs.push_back(config);
+            config.zdrop = -1;
+            configs.push_back(config);
+        }
+    }
+
+    int failed = 0;
+    const int supported = SimdDispatch::getSupportedLevel();
+    std::vector<extension_t> twoGapReference;
+    for (int level = SimdDispatch::LEVEL_SSE41; level <= supported; level++) {
+        SimdDispatch::setLevel(level);
+        const BandedNucleotideAligner::kernel_t *kernel = SIMD_KERNEL_AVX2(bandedNucleotideAlignerKernel);
+        size_t compared = 0;
+        for (size_t i = 0; i < pairs.size(); i++) {
+            const std::vector<uint8_t> &q = pairs[i].first;
+            const std::vector<uint8_t> &t = pairs[i].second;
+            for (size_t c = 0; c < configs.size(); c++) {
+                extension_t expected = extendReference(q, t, mat, configs[c]);
+                extension_t single = extendKernel(kernel, q, t, mat, configs[c], false);
+                if ((single == expected) == false) {
+                    std::cout << "Level " << SimdDispatch::getLevelName(level) << " differs from ksw_extz2_sse for pair "
+                              << i << " band " << configs[c].w << " flag " << configs[c].flag << ": " << single.max
+                              << " " << single.maxQ << " " << single.maxT << " expected " << expected.max
+                              << " " << expected.maxQ << " " << expected.maxT << "\n";
+                    failed++;
+                }
+                extension_t dual = extendKernel(kernel, q, t, mat, configs[c], true);
+                if (level == SimdDispatch::LEVEL_SSE41) {
+                    twoGapReference.push_back(dual);
+                } else if ((dual == twoGapReference[compared]) == false) {
+                    std::cout << "Level " << SimdDispatch::getLevelName(level) << " differs in the two gap cost extension for pair "
+                              << i << " band " << configs[c].w << " flag " << configs[c].flag << ": " << dual.max
+                              << " expected " << twoGapReference[compared].max << "\n";
+                    failed++;
+                }
+                compared++;
+
+                if (configs[c].w < 0 && configs[c].zdrop < 0) {
+                    const int singleMax = extensionMaximum(q, t, mat, 5, 1, 5, 1, 0);
+                    // extd2 scores the wildcard with the long gap extension if the matrix gives it 0
+                    const int dualMax = extensionMaximum(q, t, mat, GAP_OPEN, GAP_EXTEND, LONG_GAP_OPEN, LONG_GAP_EXTEND,
+                                                         -LONG_GAP_EXTEND);
+                    if (single.max != singleMax || dual.max != dualMax) {
+                        std::cout << "Level " << SimdDispatch::getLevelName(level) << " misses the maximum of pair " << i
+                                  << ": " << single.max << " " << dual.max << " expected " << singleMax << " " << dualMax << "\n";
+                        failed++;
+                    }
+                }
+            }
+        }
+        std::cout << "Level " << SimdDispatch::getLevelName(level) << " compared on " << compared << " extensions\n";
+        failed += alignWithBandWidening();
+    }
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
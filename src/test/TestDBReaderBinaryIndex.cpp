@@ -0,0 +1,159 @@
+// Writes a database with and without a binary index, compares what DBReader reads from both
+// and the time to open them. Rewriting the text index has to make the binary index unused,
+// even if its size and modification time stay the same.
+#include <iostream>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "FileUtil.h"
+#include "Timer.h"
+
+const char* binary_name = "test_dbreaderbinaryindex";
+
+static const size_t entries = 1000000;
+
+static void writeDatabase(const char *dataFile, const char *indexFile, bool binaryIndex) {
+    DBWriter writer(dataFile, indexFile, 2);
+    writer.open();
+    srand(1);
+    for (size_t i = 0; i < entries; i++) {
+        // keys are not written in order, so the text index has to be sorted when it is read
+        unsigned int key = (i * 7919) % entries;
+        std::string data(1 + rand() % 20, 'A' + key % 26);
+        data.push_back('\n');
+        writer.writeData(data.c_str(), data.length(), key, i % 2);
+    }
+    writer.close(Sequence::AMINO_ACIDS, binaryIndex);
+}
+
+// the merged index is sorted by key, reversing its lines gives SORT_BY_LINE a different order than SORT_BY_ID
+static void reverseIndex(const char *indexFile) {
+    std::vector<std::string> lines;
+    std::ifstream in(indexFile);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    in.close();
+    std::ofstream out(indexFile);
+    for (size_t i = lines.size(); i > 0; i--) {
+        out << lines[i - 1] << "\n";
+    }
+}
+
+static bool compare(DBReader<unsigned int> &text, DBReader<unsigned int> &binary) {
+    if (text.getSize() != binary.getSize() || text.getAminoAcidDBSize() != binary.getAminoAcidDBSize()
+        || text.getLastKey() != binary.getLastKey() || text.getDbtype() != binary.getDbtype()) {
+        return false;
+    }
+    for (size_t i = 0; i < text.getSize(); i++) {
+        if (text.getDbKey(i) != binary.getDbKey(i) || text.getSeqLens(i) != binary.getSeqLens(i)
+            || strcmp(text.getData(i), binary.getData(i)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main (int, const char**) {
+    writeDatabase("test_dbreaderbinaryindex_text", "test_dbreaderbinaryindex_text.index", false);
+    writeDatabase("test_dbreaderbinaryindex_db", "test_dbreaderbinaryindex_db.index", true);
+    if (FileUtil::fileExists("test_dbreaderbinaryindex_text.index.bin")
+        || FileUtil::fileExists("test_dbreaderbinaryindex_db.index.bin") == false) {
+        std::cout << "Binary index was not written as requested\n";
+        return EXIT_FAILURE;
+    }
+    reverseIndex("test_dbreaderbinaryindex_text.index");
+    reverseIndex("test_dbreaderbinaryindex_db.index");
+    {
+        // the reversed text index made the binary index stale, it is written again from the text index
+        DBReader<unsigned int> reader("test_dbreaderbinaryindex_db", "test_dbreaderbinaryindex_db.index");
+        reader.open(DBReader<unsigned int>::NOSORT);
+        DBWriter::writeBinaryIndex("test_dbreaderbinaryindex_db.index", reader.getSize(), reader.getIndex(),
+                                   reader.getSeqLens(), reader.getDbtype());
+        reader.close();
+    }
+
+    int failed = 0;
+    const int modes[5] = { DBReader<unsigned int>::NOSORT, DBReader<unsigned int>::SORT_BY_LENGTH,
+                           DBReader<unsigned int>::LINEAR_ACCCESS, DBReader<unsigned int>::SORT_BY_LINE,
+                           DBReader<unsigned int>::HARDNOSORT };
+    for (size_t i = 0; i < 5; i++) {
+        Timer timer;
+        DBReader<unsigned int> text("test_dbreaderbinaryindex_text", "test_dbreaderbinaryindex_text.index");
+        text.open(modes[i]);
+        std::string textTime = timer.lap();
+        timer.reset();
+        DBReader<unsigned int> binary("test_dbreaderbinaryindex_db", "test_dbreaderbinaryindex_db.index");
+        binary.open(modes[i]);
+        std::cout << "Mode " << modes[i] << ": text index " << textTime << ", binary index " << timer.lap() << "\n";
+        if (compare(text, binary) == false) {
+            std::cout << "Entries differ in mode " << modes[i] << "\n";
+            failed++;
+        }
+        binary.close();
+        text.close();
+    }
+
+    // swapping the keys of the first two lines keeps size and modification time of the text index
+    {
+        struct stat sb;
+        stat("test_dbreaderbinaryindex_db.index", &sb);
+        std::vector<std::string> lines;
+        std::ifstream in("test_dbreaderbinaryindex_db.index");
+        std::string line;
+        while (std::getline(in, line)) {
+            lines.push_back(line);
+        }
+        in.close();
+        const size_t firstKeyEnd = lines[0].find('\t');
+        const std::string firstKey = lines[0].substr(0, firstKeyEnd);
+        lines[0].replace(0, firstKeyEnd, lines[1].substr(0, lines[1].find('\t')));
+        lines[1].replace(0, lines[1].find('\t'), firstKey);
+        std::ofstream out("test_dbreaderbinaryindex_db.index");
+        for (size_t i = 0; i < lines.size(); i++) {
+            out << lines[i] << "\n";
+        }
+        out.close();
+        struct timespec times[2] = { sb.st_atim, sb.st_mtim };
+        utimensat(AT_FDCWD, "test_dbreaderbinaryindex_db.index", times, 0);
+
+        DBReader<unsigned int> swapped("test_dbreaderbinaryindex_db", "test_dbreaderbinaryindex_db.index");
+        swapped.open(DBReader<unsigned int>::NOSORT);
+        const size_t id = swapped.getId(strtoul(firstKey.c_str(), NULL, 10));
+        const size_t offset = strtoull(lines[1].c_str() + lines[1].find('\t') + 1, NULL, 10);
+        if (id == UINT_MAX || swapped.getIndex()[id].offset != offset) {
+            std::cout << "Binary index of a text index with the same size and modification time was used\n";
+            failed++;
+        }
+        swapped.close();
+    }
+
+    // the text index changes, so the binary index must not be used anymore
+    DBReader<unsigned int> stale("test_dbreaderbinaryindex_db", "test_dbreaderbinaryindex_db.index");
+    stale.open(DBReader<unsigned int>::NOSORT);
+    FILE *indexFile = fopen("test_dbreaderbinaryindex_db.index", "w");
+    for (size_t i = 0; i < stale.getSize() / 2; i++) {
+        fprintf(indexFile, "%u\t%zu\t%zu\n", stale.getDbKey(i), stale.getIndex()[i].offset, stale.getSeqLens(i));
+    }
+    fclose(indexFile);
+    stale.close();
+    stale.open(DBReader<unsigned int>::NOSORT);
+    if (stale.getSize() != entries / 2) {
+        std::cout << "Stale binary index was used\n";
+        failed++;
+    }
+    stale.close();
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
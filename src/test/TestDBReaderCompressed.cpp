@@ -0,0 +1,107 @@
+// Writes the same result-like entries to a plain and a compressed database with two threads,
+// compares what DBReader reads from both, also with more threads than when the databases were opened,
+// and prints the size of both data files.
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "FileUtil.h"
+#include "Timer.h"
+#include "Util.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+const char* binary_name = "test_dbreadercompressed";
+
+static const size_t entries = 100000;
+
+static std::string resultLine(unsigned int key) {
+    return SSTR(key) + "\t" + SSTR(rand() % 200) + "\t" + SSTR((rand() % 1000) / 1000.0) + "\t"
+           + SSTR(rand() % 100) + "\t" + SSTR(rand() % 500) + "\n";
+}
+
+static void writeDatabase(const char *dataFile, const char *indexFile, size_t mode) {
+    DBWriter writer(dataFile, indexFile, 2, mode);
+    writer.open();
+    srand(1);
+    for (size_t i = 0; i < entries; i++) {
+        unsigned int thread = i % 2;
+        unsigned int lines = rand() % 20;
+        if (i % 3 == 0) {
+            // entries assembled in pieces
+            writer.writeStart(thread);
+            for (unsigned int j = 0; j < lines; j++) {
+                std::string line = resultLine(j);
+                writer.writeAdd(line.c_str(), line.length(), thread);
+            }
+            writer.writeEnd(i, thread);
+        } else {
+            // empty entries are written for every query without hits
+            std::string data;
+            for (unsigned int j = 0; j < lines; j++) {
+                data.append(resultLine(j));
+            }
+            writer.writeData(data.c_str(), data.length(), i, thread);
+        }
+    }
+    writer.close();
+}
+
+int main (int, const char**) {
+    writeDatabase("test_dbreadercompressed_plain", "test_dbreadercompressed_plain.index", DBWriter::ASCII_MODE);
+    writeDatabase("test_dbreadercompressed_db", "test_dbreadercompressed_db.index", DBWriter::COMPRESSED_MODE);
+
+#ifdef OPENMP
+    const int threads = omp_get_max_threads() + 3;
+    omp_set_num_threads(1);
+#endif
+    DBReader<unsigned int> plain("test_dbreadercompressed_plain", "test_dbreadercompressed_plain.index");
+    plain.open(DBReader<unsigned int>::NOSORT);
+    DBReader<unsigned int> compressed("test_dbreadercompressed_db", "test_dbreadercompressed_db.index");
+    compressed.open(DBReader<unsigned int>::NOSORT);
+    std::cout << "Plain: " << FileUtil::getFileSize("test_dbreadercompressed_plain") << " byte, compressed: "
+              << FileUtil::getFileSize("test_dbreadercompressed_db") << " byte\n";
+
+    int failed = 0;
+    if (plain.isCompressed() || compressed.isCompressed() == false || plain.getSize() != compressed.getSize()) {
+        std::cout << "Compressed database was not detected\n";
+        failed++;
+    }
+
+    Timer timer;
+    for (size_t i = 0; failed == 0 && i < plain.getSize(); i++) {
+        const unsigned int key = plain.getDbKey(i);
+        if (key != compressed.getDbKey(i) || plain.getSeqLens(i) != compressed.getSeqLens(i)
+            || strcmp(plain.getData(i), compressed.getData(i)) != 0
+            || strcmp(plain.getDataByDBKey(key), compressed.getDataByDBKey(key)) != 0) {
+            std::cout << "Entry " << key << " differs\n";
+            failed++;
+        }
+    }
+    std::cout << "Time to compare: " << timer.lap() << "\n";
+
+#ifdef OPENMP
+    // each thread decompresses into its own buffer, created by its first entry
+    size_t parallelFailed = 0;
+#pragma omp parallel for num_threads(threads) schedule(dynamic, 100) reduction(+:parallelFailed)
+    for (size_t i = 0; i < plain.getSize(); i++) {
+        if (strcmp(plain.getData(i), compressed.getData(i)) != 0) {
+            parallelFailed++;
+        }
+    }
+    if (parallelFailed != 0) {
+        std::cout << parallelFailed << " entries differ with " << threads << " threads\n";
+        failed++;
+    }
+    std::cout << "Time to compare with " << threads << " threads: " << timer.lap() << "\n";
+#endif
+
+    compressed.close();
+    plain.close();
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
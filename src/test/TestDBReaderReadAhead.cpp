@@ -0,0 +1,60 @@
+// Scans a database in LINEAR_ACCCESS mode with a read ahead window much smaller than the data file,
+// once in order and once with all threads, and checks the entries and the read ahead counters.
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Timer.h"
+#include "Util.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+const char* binary_name = "test_dbreaderreadahead";
+
+static const size_t entries = 50000;
+
+static std::string entryData(unsigned int key) {
+    std::string data = SSTR(key) + "\t";
+    data.append(100 + key % 700, 'A' + key % 26);
+    data.push_back('\n');
+    return data;
+}
+
+int main (int, const char**) {
+    DBWriter writer("test_dbreaderreadahead_db", "test_dbreaderreadahead_db.index", 1);
+    writer.open();
+    for (size_t i = 0; i < entries; i++) {
+        std::string data = entryData(i);
+        writer.writeData(data.c_str(), data.length(), i, 0);
+    }
+    writer.close();
+
+    int failed = 0;
+    for (size_t run = 0; run < 2; run++) {
+        DBReader<unsigned int> reader("test_dbreaderreadahead_db", "test_dbreaderreadahead_db.index");
+        reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+        reader.setReadAhead(1024 * 1024);
+        Timer timer;
+#pragma omp parallel for schedule(dynamic, 100) reduction(+:failed) if(run == 1)
+        for (size_t i = 0; i < reader.getSize(); i++) {
+            std::string data = entryData(reader.getDbKey(i));
+            if (strcmp(reader.getData(i), data.c_str()) != 0) {
+                failed++;
+            }
+        }
+        std::cout << "Read ahead " << reader.getReadAheadBytes() << " of " << reader.getDataSize() << " byte with "
+                  << reader.getReadAheadStalls() << " stalls in " << timer.lap() << "\n";
+        if (reader.getReadAheadBytes() != reader.getDataSize() || (run == 0 && reader.getReadAheadStalls() != 0)) {
+            std::cout << "Unexpected read ahead counters\n";
+            failed++;
+        }
+        reader.close();
+    }
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,127 @@
+// Writes sharded databases with three threads into two shard directories, plain and compressed, reads them
+// mapped and with fread, and merges two sharded databases with disjoint keys without copying their shards.
+// Shards of a replaced or deleted database are removed.
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "FileUtil.h"
+#include "Timer.h"
+#include "Util.h"
+
+const char* binary_name = "test_dbshards";
+
+static const size_t entries = 30000;
+
+static std::string entryData(unsigned int key) {
+    std::string data = SSTR(key) + "\t";
+    data.append(10 + key % 2000, 'A' + key % 26);
+    data.push_back('\n');
+    return data;
+}
+
+static void writeDatabase(const std::string &name, size_t from, size_t to, size_t mode, unsigned int threads = 3) {
+    DBWriter writer(name.c_str(), (name + ".index").c_str(), threads, DBWriter::SHARDED_MODE | mode);
+    writer.setShardDirectories("test_dbshards_dir0,test_dbshards_dir1");
+    writer.open();
+    for (size_t key = from; key < to; key++) {
+        std::string data = entryData(key);
+        writer.writeData(data.c_str(), data.length(), key, key % threads);
+    }
+    Timer timer;
+    writer.close();
+    std::cout << name << " written in " << timer.lap() << "\n";
+}
+
+static int compareDatabase(const std::string &name, size_t from, size_t to, size_t shardCount, int dataMode) {
+    int failed = 0;
+    std::vector<ShardManifest::Shard> shards;
+    if (ShardManifest::read(name.c_str(), shards) == false || shards.size() != shardCount) {
+        std::cout << name << " is not a manifest of " << shardCount << " shards\n";
+        return 1;
+    }
+    for (size_t i = 0; i < shards.size(); i++) {
+        if (shards[i].offset % ShardManifest::ALIGNMENT != 0 || FileUtil::getFileSize(shards[i].path) != shards[i].size) {
+            std::cout << "Shard " << shards[i].path << " of " << name << " does not match the manifest\n";
+            failed++;
+        }
+    }
+
+    DBReader<unsigned int> reader(name.c_str(), (name + ".index").c_str(), dataMode);
+    reader.open(DBReader<unsigned int>::NOSORT);
+    if (reader.getSize() != to - from) {
+        std::cout << name << " has " << reader.getSize() << " entries\n";
+        failed++;
+    }
+    for (size_t i = 0; failed == 0 && i < reader.getSize(); i++) {
+        const unsigned int key = from + i;
+        std::string data = entryData(key);
+        if (reader.getDbKey(i) != key || strcmp(reader.getData(i), data.c_str()) != 0
+            || strcmp(reader.getDataByDBKey(key), data.c_str()) != 0) {
+            std::cout << "Entry " << key << " of " << name << " differs\n";
+            failed++;
+        }
+    }
+    reader.close();
+    return failed;
+}
+
+static int countShards(const std::vector<ShardManifest::Shard> &shards, size_t expected) {
+    size_t count = 0;
+    for (size_t i = 0; i < shards.size(); i++) {
+        count += FileUtil::fileExists(shards[i].path.c_str());
+    }
+    if (count != expected) {
+        std::cout << count << " of " << shards.size() << " shards exist instead of " << expected << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main (int, const char**) {
+    FileUtil::makeDir("test_dbshards_dir0");
+    FileUtil::makeDir("test_dbshards_dir1");
+
+    int failed = 0;
+    writeDatabase("test_dbshards_db", 0, entries, DBWriter::ASCII_MODE);
+    failed += compareDatabase("test_dbshards_db", 0, entries, 3, DBReader<unsigned int>::USE_DATA | DBReader<unsigned int>::USE_INDEX);
+    failed += compareDatabase("test_dbshards_db", 0, entries, 3, DBReader<unsigned int>::USE_DATA | DBReader<unsigned int>::USE_FREAD);
+
+    writeDatabase("test_dbshards_compressed", 0, entries, DBWriter::COMPRESSED_MODE);
+    failed += compareDatabase("test_dbshards_compressed", 0, entries, 3, DBReader<unsigned int>::USE_DATA | DBReader<unsigned int>::USE_INDEX);
+
+    // the splits keep their shards, the merged manifest lists all of them
+    writeDatabase("test_dbshards_split0", 0, entries / 2, DBWriter::ASCII_MODE);
+    writeDatabase("test_dbshards_split1", entries / 2, entries, DBWriter::ASCII_MODE);
+    std::vector<std::pair<std::string, std::string> > splits;
+    splits.push_back(std::make_pair("test_dbshards_split0", "test_dbshards_split0.index"));
+    splits.push_back(std::make_pair("test_dbshards_split1", "test_dbshards_split1.index"));
+    DBWriter::mergeResults("test_dbshards_merged", "test_dbshards_merged.index", splits);
+    failed += compareDatabase("test_dbshards_merged", 0, entries, 6, DBReader<unsigned int>::USE_DATA | DBReader<unsigned int>::USE_INDEX);
+    if (FileUtil::fileExists("test_dbshards_split0")) {
+        std::cout << "Manifest of the first split was not removed\n";
+        failed++;
+    }
+
+    // shards that a new manifest, a plain database or deleting the database replaces are removed
+    std::vector<ShardManifest::Shard> previousShards;
+    ShardManifest::read("test_dbshards_db", previousShards);
+    writeDatabase("test_dbshards_db", 0, entries, DBWriter::ASCII_MODE, 2);
+    failed += compareDatabase("test_dbshards_db", 0, entries, 2, DBReader<unsigned int>::USE_DATA | DBReader<unsigned int>::USE_INDEX);
+    failed += countShards(previousShards, 2);
+    ShardManifest::read("test_dbshards_db", previousShards);
+    DBWriter plain("test_dbshards_db", "test_dbshards_db.index", 1, DBWriter::ASCII_MODE);
+    plain.open();
+    plain.writeData("A\n", 2, 0, 0);
+    plain.close();
+    failed += countShards(previousShards, 0);
+    ShardManifest::read("test_dbshards_merged", previousShards);
+    FileUtil::deleteFile("test_dbshards_merged");
+    failed += countShards(previousShards, 0);
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
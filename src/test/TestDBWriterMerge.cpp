@@ -0,0 +1,92 @@
+// Writes the same entries with one, two and four threads, in key order and in reverse key order per thread,
+// and checks the merged databases. The thread data files of the two thread database are larger than
+// Concat::PARALLEL_CHUNK_SIZE. The shared file databases are written in blocks smaller than some entries.
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Timer.h"
+#include "Util.h"
+
+const char* binary_name = "test_dbwritermerge";
+
+static const size_t entries = 20000;
+
+static std::string entryData(unsigned int key) {
+    std::string data = SSTR(key) + "\t";
+    data.append(1000 + key % 5000, 'A' + key % 26);
+    data.push_back('\n');
+    return data;
+}
+
+static void writeDatabase(const std::string &name, unsigned int threads, bool reverse, size_t mode,
+                          size_t bufferSize = 64 * 1024 * 1024) {
+    DBWriter writer(name.c_str(), (name + ".index").c_str(), threads, mode);
+    writer.open(bufferSize);
+    for (size_t i = 0; i < entries; i++) {
+        unsigned int key = reverse ? entries - i - 1 : i;
+        std::string data = entryData(key);
+        writer.writeData(data.c_str(), data.length(), key, (key / 7) % threads);
+    }
+    Timer timer;
+    writer.close();
+    std::cout << name << " merged in " << timer.lap() << "\n";
+}
+
+static int compareDatabase(const std::string &name) {
+    DBReader<unsigned int> reader(name.c_str(), (name + ".index").c_str());
+    reader.open(DBReader<unsigned int>::HARDNOSORT);
+    int failed = 0;
+    if (reader.getSize() != entries) {
+        std::cout << name << " has " << reader.getSize() << " entries\n";
+        failed++;
+    }
+    for (size_t i = 0; failed == 0 && i < reader.getSize(); i++) {
+        std::string data = entryData(reader.getDbKey(i));
+        if (reader.getSeqLens(i) != data.length() + 1 || strcmp(reader.getData(i), data.c_str()) != 0) {
+            std::cout << "Entry " << reader.getDbKey(i) << " of " << name << " differs\n";
+            failed++;
+        }
+        // the index has to be sorted without DBReader sorting it
+        if (i > 0 && reader.getDbKey(i) <= reader.getDbKey(i - 1)) {
+            std::cout << "Index of " << name << " is not sorted at " << i << "\n";
+            failed++;
+        }
+    }
+    reader.close();
+    return failed;
+}
+
+int main (int, const char**) {
+    int failed = 0;
+    writeDatabase("test_dbwritermerge_single", 1, false, DBWriter::ASCII_MODE);
+    failed += compareDatabase("test_dbwritermerge_single");
+    writeDatabase("test_dbwritermerge_db", 2, false, DBWriter::ASCII_MODE);
+    failed += compareDatabase("test_dbwritermerge_db");
+    writeDatabase("test_dbwritermerge_reverse", 4, true, DBWriter::ASCII_MODE);
+    failed += compareDatabase("test_dbwritermerge_reverse");
+    writeDatabase("test_dbwritermerge_shared", 4, false, DBWriter::SHARED_FILE_MODE, 4096);
+    failed += compareDatabase("test_dbwritermerge_shared");
+    writeDatabase("test_dbwritermerge_shared_reverse", 3, true, DBWriter::SHARED_FILE_MODE, 64 * 1024);
+    failed += compareDatabase("test_dbwritermerge_shared_reverse");
+    writeDatabase("test_dbwritermerge_shared_compressed", 4, false,
+                  DBWriter::SHARED_FILE_MODE | DBWriter::COMPRESSED_MODE, 64 * 1024);
+    failed += compareDatabase("test_dbwritermerge_shared_compressed");
+
+    writeDatabase("test_dbwritermerge_lexicographic", 4, false, DBWriter::LEXICOGRAPHIC_MODE);
+    DBReader<std::string> reader("test_dbwritermerge_lexicographic", "test_dbwritermerge_lexicographic.index");
+    reader.open(DBReader<std::string>::HARDNOSORT);
+    for (size_t i = 0; failed == 0 && i < reader.getSize(); i++) {
+        std::string data = entryData(strtoul(reader.getDbKey(i).c_str(), NULL, 10));
+        if (strcmp(reader.getData(i), data.c_str()) != 0 || (i > 0 && reader.getDbKey(i) <= reader.getDbKey(i - 1))) {
+            std::cout << "Entry " << reader.getDbKey(i) << " of the lexicographic database differs\n";
+            failed++;
+        }
+    }
+    reader.close();
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,77 @@
+// Builds an index table from random sequences, compresses it
+// and checks that every decoded k-mer list matches the uncompressed one.
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "DBWriter.h"
+#include "IndexTable.h"
+#include "IndexBuilder.h"
+#include "SubstitutionMatrix.h"
+#include "Parameters.h"
+
+const char* binary_name = "test_indextablecompression";
+
+int main (int, const char**) {
+    SubstitutionMatrix subMat("blosum62.out", 8.0, -0.2f);
+
+    const char *aa = "ACDEFGHIKLMNPQRSTVWY";
+    DBWriter writer("test_indextablecompression_db", "test_indextablecompression_db.index", 1);
+    writer.open();
+    srand(1);
+    for (unsigned int i = 0; i < 5000; i++) {
+        std::string seq;
+        size_t len = 20 + rand() % 500;
+        for (size_t j = 0; j < len; j++) {
+            seq.push_back(aa[rand() % 20]);
+        }
+        seq.push_back('\n');
+        writer.writeData(seq.c_str(), seq.length(), i * 3, 0);
+    }
+    writer.close();
+
+    DBReader<unsigned int> dbr("test_indextablecompression_db", "test_indextablecompression_db.index");
+    dbr.open(DBReader<unsigned int>::NOSORT);
+
+    const int kmerSize = 4;
+    Sequence seq(1000, Sequence::AMINO_ACIDS, &subMat, kmerSize, false, false);
+    IndexTable table(subMat.alphabetSize - 1, kmerSize, false);
+    SequenceLookup *lookup = NULL;
+    IndexBuilder::fillDatabase(&table, NULL, &lookup, subMat, &seq, &dbr, 0, dbr.getSize(), 0);
+    delete lookup;
+
+    std::vector<size_t> offsets(table.getOffsets(), table.getOffsets() + table.getTableSize() + 1);
+    std::vector<IndexEntryLocal> entries(table.getEntries(), table.getEntries() + table.getTableEntriesNum());
+    const size_t uncompressedSize = table.getEntriesSize();
+
+    table.compress();
+
+    int failed = 0;
+    std::vector<IndexEntryLocal> decoded;
+    for (size_t kmer = 0; kmer < table.getTableSize(); kmer++) {
+        size_t listSize;
+        const unsigned char *data = table.getCompressedDBSeqList(kmer, &listSize);
+        if (listSize != offsets[kmer + 1] - offsets[kmer]) {
+            std::cout << "List size of k-mer " << kmer << " is " << listSize
+                      << " expected " << offsets[kmer + 1] - offsets[kmer] << "\n";
+            failed++;
+            continue;
+        }
+        decoded.resize(listSize);
+        IndexTable::decodeDBSeqList(data, listSize, decoded.data());
+        for (size_t i = 0; i < listSize; i++) {
+            const IndexEntryLocal &expected = entries[offsets[kmer] + i];
+            if (decoded[i].seqId != expected.seqId || decoded[i].position_j != expected.position_j) {
+                std::cout << "Entry " << i << " of k-mer " << kmer << " differs\n";
+                failed++;
+                break;
+            }
+        }
+    }
+    std::cout << "Entries: " << table.getTableEntriesNum() << ", " << uncompressedSize << " byte uncompressed, "
+              << table.getEntriesSize() << " byte compressed, " << failed << " lists differ\n";
+
+    dbr.close();
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
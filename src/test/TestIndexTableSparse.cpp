@@ -0,0 +1,87 @@
+// Builds an index table from random sequences with all k-mers, minimizers and open syncmers
+// and checks that the sparse tables only contain entries of the full table at about the expected density.
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "DBWriter.h"
+#include "IndexTable.h"
+#include "IndexBuilder.h"
+#include "SubstitutionMatrix.h"
+#include "Parameters.h"
+
+const char* binary_name = "test_indextablesparse";
+
+static IndexTable *buildTable(SubstitutionMatrix &subMat, DBReader<unsigned int> &dbr, int kmerSize, int mode, int window) {
+    Sequence seq(1000, Sequence::AMINO_ACIDS, &subMat, kmerSize, false, false);
+    IndexTable *table = new IndexTable(subMat.alphabetSize - 1, kmerSize, false);
+    table->setSparseMode(mode, window);
+    SequenceLookup *lookup = NULL;
+    IndexBuilder::fillDatabase(table, NULL, &lookup, subMat, &seq, &dbr, 0, dbr.getSize(), 0);
+    delete lookup;
+    return table;
+}
+
+// a sequence can contain a k-mer more than once, the sparse table might then store another position
+static bool compareEntries(IndexEntryLocal first, IndexEntryLocal second) {
+    return first.seqId < second.seqId;
+}
+
+int main (int, const char**) {
+    SubstitutionMatrix subMat("blosum62.out", 8.0, -0.2f);
+
+    const char *aa = "ACDEFGHIKLMNPQRSTVWY";
+    DBWriter writer("test_indextablesparse_db", "test_indextablesparse_db.index", 1);
+    writer.open();
+    srand(1);
+    for (unsigned int i = 0; i < 2000; i++) {
+        std::string seq;
+        size_t len = 20 + rand() % 500;
+        for (size_t j = 0; j < len; j++) {
+            seq.push_back(aa[rand() % 20]);
+        }
+        seq.push_back('\n');
+        writer.writeData(seq.c_str(), seq.length(), i, 0);
+    }
+    writer.close();
+
+    DBReader<unsigned int> dbr("test_indextablesparse_db", "test_indextablesparse_db.index");
+    dbr.open(DBReader<unsigned int>::NOSORT);
+
+    const int kmerSize = 5;
+    IndexTable *full = buildTable(subMat, dbr, kmerSize, IndexTable::SPARSE_INDEX_OFF, 1);
+
+    int failed = 0;
+    const int modes[2] = { IndexTable::SPARSE_INDEX_MINIMIZER, IndexTable::SPARSE_INDEX_SYNCMER };
+    const int windows[2] = { 5, 3 };
+    for (size_t m = 0; m < 2; m++) {
+        IndexTable *sparse = buildTable(subMat, dbr, kmerSize, modes[m], windows[m]);
+        size_t missing = 0;
+        for (size_t kmer = 0; kmer < full->getTableSize(); kmer++) {
+            size_t fullSize, sparseSize;
+            IndexEntryLocal *fullList = full->getDBSeqList(kmer, &fullSize);
+            IndexEntryLocal *sparseList = sparse->getDBSeqList(kmer, &sparseSize);
+            for (size_t i = 0; i < sparseSize; i++) {
+                if (std::binary_search(fullList, fullList + fullSize, sparseList[i], compareEntries) == false) {
+                    missing++;
+                }
+            }
+        }
+        const double density = static_cast<double>(sparse->getTableEntriesNum()) / full->getTableEntriesNum();
+        const double expected = IndexTable::getSparseDensity(modes[m], windows[m]);
+        std::cout << "Mode " << modes[m] << " window " << windows[m] << ": " << sparse->getTableEntriesNum()
+                  << " of " << full->getTableEntriesNum() << " entries (density " << density
+                  << ", expected " << expected << "), " << missing << " not in the full table\n";
+        if (missing > 0 || std::fabs(density - expected) > 0.25 * expected) {
+            failed++;
+        }
+        delete sparse;
+    }
+
+    delete full;
+    dbr.close();
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+// Writes the same FASTA file plain and as BGZF with blocks much smaller than the entries,
+// reads both through KSeqFactory inside a parallel region and compares the entries.
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "KSeqWrapper.h"
+#include "Timer.h"
+#include "Util.h"
+
+const char* binary_name = "test_kseqbgzf";
+
+static const size_t entries = 20000;
+static const size_t blockSize = 4000;
+
+#ifdef HAVE_ZLIB
+static void writeUInt16(std::string &out, unsigned int value) {
+    out.push_back(value & 0xff);
+    out.push_back((value >> 8) & 0xff);
+}
+
+static void writeUInt32(std::string &out, unsigned int value) {
+    writeUInt16(out, value & 0xffff);
+    writeUInt16(out, value >> 16);
+}
+
+static void appendBlock(std::string &out, const char *data, size_t length) {
+    z_stream strm;
+    memset(&strm, 0, sizeof(z_stream));
+    deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    std::string compressed(deflateBound(&strm, length), '\0');
+    strm.next_in = (Bytef *) data;
+    strm.avail_in = length;
+    strm.next_out = (Bytef *) &compressed[0];
+    strm.avail_out = compressed.size();
+    deflate(&strm, Z_FINISH);
+    compressed.resize(strm.total_out);
+    deflateEnd(&strm);
+
+    const char header[12] = { 31, (char) 139, 8, 4, 0, 0, 0, 0, 0, (char) 255, 6, 0 };
+    out.append(header, sizeof(header));
+    out.append("BC");
+    writeUInt16(out, 2);
+    writeUInt16(out, 18 + compressed.size() + 8 - 1);
+    out.append(compressed);
+    writeUInt32(out, crc32(crc32(0L, Z_NULL, 0), (const Bytef *) data, length));
+    writeUInt32(out, length);
+}
+#endif
+
+int main (int, const char**) {
+#ifdef HAVE_ZLIB
+    std::string fasta;
+    for (size_t i = 0; i < entries; i++) {
+        fasta.append(">entry" + SSTR(i) + " comment " + SSTR(i % 13) + "\n");
+        fasta.append(50 + i % 3000, 'A' + i % 20);
+        fasta.push_back('\n');
+    }
+    std::string bgzf;
+    for (size_t i = 0; i < fasta.size(); i += blockSize) {
+        appendBlock(bgzf, fasta.c_str() + i, std::min(blockSize, fasta.size() - i));
+    }
+    // end of file marker
+    appendBlock(bgzf, NULL, 0);
+
+    FILE *plainFile = fopen("test_kseqbgzf_plain.fasta", "w");
+    fwrite(fasta.c_str(), sizeof(char), fasta.size(), plainFile);
+    fclose(plainFile);
+    FILE *bgzfFile = fopen("test_kseqbgzf_db.fasta.gz", "w");
+    fwrite(bgzf.c_str(), sizeof(char), bgzf.size(), bgzfFile);
+    fclose(bgzfFile);
+
+    if (KSeqBgzf::isBgzf("test_kseqbgzf_db.fasta.gz") == false) {
+        std::cout << "BGZF file was not detected\n";
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    size_t count = 0;
+    Timer timer;
+#pragma omp parallel
+    {
+#pragma omp single
+        {
+            KSeqWrapper *plain = KSeqFactory("test_kseqbgzf_plain.fasta");
+            KSeqWrapper *blocked = KSeqFactory("test_kseqbgzf_db.fasta.gz");
+            while (plain->ReadEntry()) {
+                if (blocked->ReadEntry() == false
+                    || strcmp(plain->entry.name.s, blocked->entry.name.s) != 0
+                    || strcmp(plain->entry.comment.s, blocked->entry.comment.s) != 0
+                    || strcmp(plain->entry.sequence.s, blocked->entry.sequence.s) != 0) {
+                    std::cout << "Entry " << count << " differs\n";
+                    failed++;
+                    break;
+                }
+                count++;
+            }
+            if (failed == 0 && blocked->ReadEntry()) {
+                std::cout << "BGZF file has more entries\n";
+                failed++;
+            }
+            delete plain;
+            delete blocked;
+        }
+    }
+    const size_t blocks = (fasta.size() + blockSize - 1) / blockSize;
+    std::cout << "Read " << count << " entries from " << blocks << " blocks in " << timer.lap() << "\n";
+    if (count != entries) {
+        failed++;
+    }
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+#else
+    std::cout << "MMseqs was not compiled with zlib support\n";
+    return EXIT_SUCCESS;
+#endif
+}
@@ -0,0 +1,75 @@
+// Reads the memory limits of cgroup v1 and v2 hierarchies laid out in a local directory,
+// including limits of parent cgroups and unlimited ("max") cgroups, and checks that
+// reservations are taken from the budget.
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "MemoryGovernor.h"
+#include "FileUtil.h"
+#include "Util.h"
+
+const char* binary_name = "test_memorygovernor";
+
+static void writeLimit(const std::string &dir, const std::string &fileName, const std::string &value) {
+    std::string path;
+    std::vector<std::string> parts = Util::split(dir, "/");
+    for (size_t i = 0; i < parts.size(); i++) {
+        path += (i == 0 ? "" : "/") + parts[i];
+        FileUtil::makeDir(path.c_str());
+    }
+    std::ofstream file((dir + "/" + fileName).c_str());
+    file << value << "\n";
+}
+
+static int check(const std::string &name, size_t value, size_t expected) {
+    if (value != expected) {
+        std::cout << name << ": " << value << " instead of " << expected << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main (int, const char**) {
+    int failed = 0;
+
+    // cgroup v2: the parent limits the child, the mount point is the root of the hierarchy
+    writeLimit("test_memorygovernor_v2", "memory.max", "max");
+    writeLimit("test_memorygovernor_v2/user/job", "memory.max", "max");
+    writeLimit("test_memorygovernor_v2/user", "memory.max", "4000000000");
+    failed += check("v2", MemoryGovernor::getCgroupLimit("0::/user/job\n", "test_memorygovernor_v2"), 4000000000ull);
+    failed += check("v2 trailing slash", MemoryGovernor::getCgroupLimit("0::/user/job/\n", "test_memorygovernor_v2"), 4000000000ull);
+    writeLimit("test_memorygovernor_v2/user/job", "memory.max", "1000000000");
+    failed += check("v2 child", MemoryGovernor::getCgroupLimit("0::/user/job\n", "test_memorygovernor_v2"), 1000000000ull);
+    // inside of a container the own cgroup is mounted at the root
+    writeLimit("test_memorygovernor_v2", "memory.max", "500000000");
+    failed += check("v2 root", MemoryGovernor::getCgroupLimit("0::/\n", "test_memorygovernor_v2"), 500000000ull);
+
+    // cgroup v1: only the hierarchy with the memory controller counts
+    writeLimit("test_memorygovernor_v1/memory/slurm/job", "memory.limit_in_bytes", "2000000000");
+    writeLimit("test_memorygovernor_v1/cpu/slurm/job", "memory.limit_in_bytes", "1000");
+    const std::string v1 = "12:cpu,cpuacct:/slurm/job\n"
+                           "11:blkio:/slurm/job\n"
+                           "4:memory:/slurm/job\n";
+    failed += check("v1", MemoryGovernor::getCgroupLimit(v1, "test_memorygovernor_v1"), 2000000000ull);
+    failed += check("v1 without memory", MemoryGovernor::getCgroupLimit("12:cpu,cpuacct:/slurm/job\n", "test_memorygovernor_v1"), SIZE_MAX);
+    failed += check("no cgroup", MemoryGovernor::getCgroupLimit("0::/none\n", "test_memorygovernor_none"), SIZE_MAX);
+
+    // reservations are taken from the budget
+    MemoryGovernor::setUserLimit(100 * 1024 * 1024);
+    const size_t budget = MemoryGovernor::getBudget();
+    failed += check("budget", budget <= 100 * 1024 * 1024, true);
+    MemoryGovernor::reserve(budget / 4);
+    failed += check("available", MemoryGovernor::getAvailable(), budget - budget / 4);
+    MemoryGovernor::reserve(budget);
+    failed += check("exhausted", MemoryGovernor::getAvailable(), 0);
+    MemoryGovernor::release(budget);
+    MemoryGovernor::release(budget / 4);
+    failed += check("released", MemoryGovernor::getReserved(), 0);
+    std::cout << "Budget " << budget << " byte, cgroup limit " << MemoryGovernor::getCgroupLimit() << " byte\n";
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
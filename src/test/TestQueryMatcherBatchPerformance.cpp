@@ -0,0 +1,133 @@
+// Matches overlapping reads against an index table that does not fit into the cache,
+// once one by one and once in query batches, plain and compressed, and compares the time and the hits.
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "DBWriter.h"
+#include "IndexTable.h"
+#include "IndexBuilder.h"
+#include "QueryMatcher.h"
+#include "SubstitutionMatrix.h"
+#include "ExtendedSubstitutionMatrix.h"
+#include "Parameters.h"
+#include "Timer.h"
+
+const char* binary_name = "test_querymatcherbatchperformance";
+
+static const char *aa = "ACDEFGHIKLMNPQRSTVWY";
+
+static std::string randomSequence(size_t len) {
+    std::string seq;
+    for (size_t j = 0; j < len; j++) {
+        seq.push_back(aa[rand() % 20]);
+    }
+    return seq;
+}
+
+int main (int, const char**) {
+    SubstitutionMatrix subMat("blosum62.out", 8.0, -0.2f);
+    SubstitutionMatrix ungappedSubMat("blosum62.out", 2.0, -0.2f);
+
+    const size_t dbSize = 100000;
+    DBWriter writer("test_querymatcherbatch_db", "test_querymatcherbatch_db.index", 1);
+    writer.open();
+    srand(1);
+    for (unsigned int i = 0; i < dbSize; i++) {
+        std::string seq = randomSequence(20 + rand() % 500);
+        seq.push_back('\n');
+        writer.writeData(seq.c_str(), seq.length(), i, 0);
+    }
+    writer.close();
+
+    DBReader<unsigned int> dbr("test_querymatcherbatch_db", "test_querymatcherbatch_db.index");
+    dbr.open(DBReader<unsigned int>::NOSORT);
+
+    const int kmerSize = 6;
+    const short kmerThr = 110;
+    Sequence seq(1000, Sequence::AMINO_ACIDS, &subMat, kmerSize, false, false);
+    IndexTable table(subMat.alphabetSize - 1, kmerSize, false);
+    SequenceLookup *lookup = NULL;
+    IndexBuilder::fillDatabase(&table, NULL, &lookup, subMat, &seq, &dbr, 0, dbr.getSize(), 0);
+    std::cout << "Index entries: " << table.getTableEntriesNum() << " (" << table.getEntriesSize() << " byte)\n";
+
+    // do not add X
+    subMat.alphabetSize = subMat.alphabetSize - 1;
+    ScoreMatrix *twoMer = ExtendedSubstitutionMatrix::calcScoreMatrix(subMat, 2);
+    ScoreMatrix *threeMer = ExtendedSubstitutionMatrix::calcScoreMatrix(subMat, 3);
+    subMat.alphabetSize = subMat.alphabetSize + 1;
+    EvalueComputation evaluer(dbr.getAminoAcidDBSize(), &ungappedSubMat);
+
+    // reads with 10x coverage of a few database sequences, so that the queries of a batch share k-mers
+    std::vector<std::string> queries;
+    for (size_t i = 0; queries.size() < 2000; i++) {
+        std::string target(dbr.getData(i));
+        for (size_t pos = 0; pos + 150 < target.length() && queries.size() < 2000; pos += 15) {
+            queries.push_back(target.substr(pos, 150));
+        }
+    }
+
+    // alternate between both settings so that neither profits from a warm cache
+    const size_t batchSize = 64;
+    std::vector<Sequence *> batchSeqs;
+    for (size_t i = 0; i < batchSize; i++) {
+        batchSeqs.push_back(new Sequence(1000, Sequence::AMINO_ACIDS, &subMat, kmerSize, false, false));
+    }
+    // the first four runs use the plain index table, the last four the compressed one
+    std::vector<std::vector<unsigned int> > hits[8];
+    const size_t batchSizes[4] = { 1, batchSize, 1, batchSize };
+    for (size_t run = 0; run < 8; run++) {
+        if (run == 4) {
+            table.compress();
+            std::cout << "Compressed index\n";
+        }
+        QueryMatcher matcher(&table, lookup, &subMat, &ungappedSubMat, evaluer, dbr.getSeqLens(), kmerThr, 1.0,
+                             kmerSize, dbSize, 1000, seq.getEffectiveKmerSize(), 150, false, true, 0, false);
+        matcher.setSubstitutionMatrix(threeMer, twoMer);
+        size_t dbMatches = 0;
+        Timer timer;
+        for (size_t from = 0; from < queries.size(); from += batchSizes[run % 4]) {
+            const size_t count = std::min(batchSizes[run % 4], queries.size() - from);
+            for (size_t i = 0; i < count; i++) {
+                batchSeqs[i]->mapSequence(from + i, from + i, queries[from + i].c_str());
+            }
+            if (count > 1) {
+                matcher.prepareBatch(batchSeqs.data(), count);
+            }
+            for (size_t i = 0; i < count; i++) {
+                std::pair<hit_t *, size_t> result = (count > 1) ? matcher.matchBatchQuery(i, UINT_MAX)
+                                                                : matcher.matchQuery(batchSeqs[i], UINT_MAX);
+                dbMatches += matcher.getStatistics()->dbMatches;
+                std::vector<unsigned int> ids;
+                for (size_t j = 0; j < result.second; j++) {
+                    ids.push_back(result.first[j].seqId);
+                }
+                hits[run].push_back(ids);
+            }
+        }
+        std::cout << "Query batch size " << batchSizes[run % 4] << ": " << timer.lap() << " for "
+                  << dbMatches << " k-mer matches\n";
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < queries.size(); i++) {
+        for (size_t run = 1; run < 8; run++) {
+            if (hits[0][i] != hits[run][i]) {
+                std::cout << "Hits of query " << i << " differ in run " << run << "\n";
+                failed++;
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < batchSeqs.size(); i++) {
+        delete batchSeqs[i];
+    }
+    ScoreMatrix::cleanup(twoMer);
+    ScoreMatrix::cleanup(threeMer);
+    delete lookup;
+    dbr.close();
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,106 @@
+// Matches random queries against an index table that does not fit into the cache,
+// once without and once with prefetching of the k-mer lists, and compares the time and the hits.
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "DBWriter.h"
+#include "IndexTable.h"
+#include "IndexBuilder.h"
+#include "QueryMatcher.h"
+#include "SubstitutionMatrix.h"
+#include "ExtendedSubstitutionMatrix.h"
+#include "Parameters.h"
+#include "Timer.h"
+
+const char* binary_name = "test_querymatcherprefetchperformance";
+
+static const char *aa = "ACDEFGHIKLMNPQRSTVWY";
+
+static std::string randomSequence(size_t len) {
+    std::string seq;
+    for (size_t j = 0; j < len; j++) {
+        seq.push_back(aa[rand() % 20]);
+    }
+    return seq;
+}
+
+int main (int, const char**) {
+    SubstitutionMatrix subMat("blosum62.out", 8.0, -0.2f);
+    SubstitutionMatrix ungappedSubMat("blosum62.out", 2.0, -0.2f);
+
+    const size_t dbSize = 100000;
+    DBWriter writer("test_querymatcherprefetch_db", "test_querymatcherprefetch_db.index", 1);
+    writer.open();
+    srand(1);
+    for (unsigned int i = 0; i < dbSize; i++) {
+        std::string seq = randomSequence(20 + rand() % 500);
+        seq.push_back('\n');
+        writer.writeData(seq.c_str(), seq.length(), i, 0);
+    }
+    writer.close();
+
+    DBReader<unsigned int> dbr("test_querymatcherprefetch_db", "test_querymatcherprefetch_db.index");
+    dbr.open(DBReader<unsigned int>::NOSORT);
+
+    const int kmerSize = 6;
+    const short kmerThr = 110;
+    Sequence seq(1000, Sequence::AMINO_ACIDS, &subMat, kmerSize, false, false);
+    IndexTable table(subMat.alphabetSize - 1, kmerSize, false);
+    SequenceLookup *lookup = NULL;
+    IndexBuilder::fillDatabase(&table, NULL, &lookup, subMat, &seq, &dbr, 0, dbr.getSize(), 0);
+    std::cout << "Index entries: " << table.getTableEntriesNum() << " (" << table.getEntriesSize() << " byte)\n";
+
+    // do not add X
+    subMat.alphabetSize = subMat.alphabetSize - 1;
+    ScoreMatrix *twoMer = ExtendedSubstitutionMatrix::calcScoreMatrix(subMat, 2);
+    ScoreMatrix *threeMer = ExtendedSubstitutionMatrix::calcScoreMatrix(subMat, 3);
+    subMat.alphabetSize = subMat.alphabetSize + 1;
+    EvalueComputation evaluer(dbr.getAminoAcidDBSize(), &ungappedSubMat);
+
+    std::vector<std::string> queries;
+    for (size_t i = 0; i < 200; i++) {
+        queries.push_back(randomSequence(300));
+    }
+
+    // alternate between both settings so that neither profits from a warm cache
+    std::vector<std::vector<unsigned int> > hits[4];
+    const unsigned int distances[4] = { 0, QueryMatcher::PREFETCH_DISTANCE, 0, QueryMatcher::PREFETCH_DISTANCE };
+    for (size_t run = 0; run < 4; run++) {
+        QueryMatcher matcher(&table, lookup, &subMat, &ungappedSubMat, evaluer, dbr.getSeqLens(), kmerThr, 1.0,
+                             kmerSize, dbSize, 1000, seq.getEffectiveKmerSize(), 300, false, true, 0, false);
+        matcher.setSubstitutionMatrix(threeMer, twoMer);
+        matcher.setPrefetchDistance(distances[run]);
+        size_t dbMatches = 0;
+        double kmersPerPos = 0;
+        Timer timer;
+        for (size_t i = 0; i < queries.size(); i++) {
+            seq.mapSequence(i, i, queries[i].c_str());
+            std::pair<hit_t *, size_t> result = matcher.matchQuery(&seq, UINT_MAX);
+            dbMatches += matcher.getStatistics()->dbMatches;
+            kmersPerPos += matcher.getStatistics()->kmersPerPos;
+            std::vector<unsigned int> ids;
+            for (size_t j = 0; j < result.second; j++) {
+                ids.push_back(result.first[j].seqId);
+            }
+            hits[run].push_back(ids);
+        }
+        std::cout << "Prefetch distance " << distances[run] << ": " << timer.lap() << " for "
+                  << dbMatches << " k-mer matches (" << kmersPerPos / queries.size() << " k-mers per position)\n";
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < queries.size(); i++) {
+        if (hits[0][i] != hits[1][i] || hits[0][i] != hits[2][i] || hits[0][i] != hits[3][i]) {
+            std::cout << "Hits of query " << i << " differ\n";
+            failed++;
+        }
+    }
+
+    ScoreMatrix::cleanup(twoMer);
+    ScoreMatrix::cleanup(threeMer);
+    delete lookup;
+    dbr.close();
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,130 @@
+// Starts a searchserver on a small random amino acid database and round-trips requests with searchclient:
+// a search of the first target sequences, an invalid query database and a request that kills the worker
+// have to be answered, and the server has to answer the next search with the same result.
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Command.h"
+#include "CommandDeclarations.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "FileUtil.h"
+#include "Parameters.h"
+#include "Util.h"
+
+const char* binary_name = "test_searchserver";
+
+static const size_t targets = 500;
+static const size_t queries = 10;
+
+static void writeDatabase(const std::string &name, size_t count) {
+    const char residues[] = "ACDEFGHIKLMNPQRSTVWY";
+    srand(1);
+    DBWriter writer(name.c_str(), (name + ".index").c_str(), 1, DBWriter::ASCII_MODE);
+    writer.open();
+    for (size_t key = 0; key < count; key++) {
+        std::string seq;
+        const size_t length = 100 + rand() % 200;
+        for (size_t i = 0; i < length; i++) {
+            seq.push_back(residues[rand() % 20]);
+        }
+        seq.push_back('\n');
+        writer.writeData(seq.c_str(), seq.length(), key, 0);
+    }
+    writer.close();
+    DBWriter::writeDbtypeFile(name.c_str(), Sequence::AMINO_ACIDS);
+}
+
+static int search(Parameters &par, const std::string &queryDB, const std::string &alnDB, const std::string &socket) {
+    Command command = {"searchclient", searchclient, &par.onlyverbosity, COMMAND_EXPERT, "", "", "", "", 0};
+    const char *argv[] = {queryDB.c_str(), alnDB.c_str(), socket.c_str()};
+    return searchclient(3, argv, command);
+}
+
+// every query has to find itself as the best hit
+static int checkResult(const std::string &alnDB) {
+    if (FileUtil::fileExists(alnDB.c_str()) == false) {
+        std::cout << alnDB << " does not exist\n";
+        return 1;
+    }
+    int failed = 0;
+    DBReader<unsigned int> reader(alnDB.c_str(), (alnDB + ".index").c_str());
+    reader.open(DBReader<unsigned int>::NOSORT);
+    if (reader.getSize() != queries) {
+        std::cout << alnDB << " has " << reader.getSize() << " entries\n";
+        failed++;
+    }
+    for (size_t id = 0; id < reader.getSize(); id++) {
+        const unsigned int key = reader.getDbKey(id);
+        const char *data = reader.getData(id);
+        if (data[0] == '\0' || static_cast<unsigned int>(strtoul(data, NULL, 10)) != key) {
+            std::cout << "Query " << key << " of " << alnDB << " does not find itself\n";
+            failed++;
+        }
+    }
+    reader.close();
+    return failed;
+}
+
+int main (int, const char**) {
+    Parameters& par = Parameters::getInstance();
+    writeDatabase("test_searchserver_target", targets);
+    writeDatabase("test_searchserver_query", queries);
+    const std::string socket = "test_searchserver.sock";
+    // left over from a previous run
+    unlink(socket.c_str());
+
+    // the server has to run in a process that did not use OpenMP yet
+    pid_t server = fork();
+    if (server == 0) {
+        Command command = {"searchserver", searchserver, &par.searchserver, COMMAND_EXPERT, "", "", "", "", 0};
+        const char *argv[] = {"test_searchserver_target", socket.c_str(), "--threads", "2"};
+        _exit(searchserver(4, argv, command));
+    }
+    for (size_t i = 0; i < 100 && FileUtil::fileExists(socket.c_str()) == false; i++) {
+        usleep(100000);
+    }
+
+    int failed = 0;
+    if (search(par, "test_searchserver_query", "test_searchserver_aln", socket) != EXIT_SUCCESS) {
+        std::cout << "Search failed\n";
+        failed++;
+    } else {
+        failed += checkResult("test_searchserver_aln");
+    }
+
+    if (search(par, "test_searchserver_missing", "test_searchserver_aln_missing", socket) == EXIT_SUCCESS) {
+        std::cout << "Search of a missing query database succeeded\n";
+        failed++;
+    }
+
+    // the worker exits because the output index can not be written
+    FileUtil::makeDir("test_searchserver_aln_dir.index");
+    if (search(par, "test_searchserver_query", "test_searchserver_aln_dir", socket) == EXIT_SUCCESS) {
+        std::cout << "Search into an unwritable database succeeded\n";
+        failed++;
+    }
+
+    if (search(par, "test_searchserver_query", "test_searchserver_aln_restart", socket) != EXIT_SUCCESS) {
+        std::cout << "Search after the worker died failed\n";
+        failed++;
+    } else {
+        failed += checkResult("test_searchserver_aln_restart");
+    }
+
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    unlink(socket.c_str());
+
+    if (failed == 0) {
+        std::cout << "All requests answered\n";
+        return EXIT_SUCCESS;
+    }
+    std::cout << failed << " checks failed\n";
+    return EXIT_FAILURE;
+}
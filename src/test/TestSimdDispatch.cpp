@@ -0,0 +1,116 @@
+// Aligns random sequences with every SIMD kernel that is available on this machine
+// and checks that all kernels agree with the SSE4.1 kernel.
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "StripedSmithWaterman.h"
+#include "SimdDispatch.h"
+#include "Sequence.h"
+#include "SubstitutionMatrix.h"
+#include "Parameters.h"
+
+const char* binary_name = "test_simddispatch";
+
+struct alignment_result_t {
+    int ungapped;
+    uint16_t score;
+    int32_t qStart;
+    int32_t qEnd;
+    int32_t dbStart;
+    int32_t dbEnd;
+};
+
+std::string randomSequence(size_t len) {
+    const char *aa = "ACDEFGHIKLMNPQRSTVWY";
+    std::string seq;
+    for (size_t i = 0; i < len; i++) {
+        seq.push_back(aa[rand() % 20]);
+    }
+    return seq;
+}
+
+// target shares a mutated copy of the query, so that long queries overflow the 8 bit kernel
+std::string mutate(const std::string &seq) {
+    std::string out = seq;
+    for (size_t i = 0; i < out.size(); i++) {
+        if (rand() % 5 == 0) {
+            out[i] = "ACDEFGHIKLMNPQRSTVWY"[rand() % 20];
+        }
+    }
+    return out;
+}
+
+std::vector<alignment_result_t> alignAll(SubstitutionMatrix &subMat, int8_t *tinySubMat,
+                                         const std::vector<std::pair<std::string, std::string> > &pairs) {
+    std::vector<alignment_result_t> results;
+    Sequence query(10000, Sequence::AMINO_ACIDS, &subMat, 6, true, false);
+    Sequence target(10000, Sequence::AMINO_ACIDS, &subMat, 6, true, false);
+    SmithWaterman aligner(10000, subMat.alphabetSize, true);
+    EvalueComputation evaluer(100000, &subMat, 11, 1);
+    for (size_t i = 0; i < pairs.size(); i++) {
+        query.mapSequence(0, 0, pairs[i].first.c_str());
+        target.mapSequence(1, 1, pairs[i].second.c_str());
+        aligner.ssw_init(&query, tinySubMat, &subMat, subMat.alphabetSize, 2);
+        alignment_result_t res;
+        res.ungapped = aligner.ungapped_alignment(target.int_sequence, target.L);
+        s_align aln = aligner.ssw_align(target.int_sequence, target.L, 11, 1, 2, 10000, &evaluer, 0, 0.0, query.L / 2);
+        res.score = aln.score1;
+        res.qStart = aln.qStartPos1;
+        res.qEnd = aln.qEndPos1;
+        res.dbStart = aln.dbStartPos1;
+        res.dbEnd = aln.dbEndPos1;
+        results.push_back(res);
+    }
+    return results;
+}
+
+int main (int, const char**) {
+    SubstitutionMatrix subMat("blosum62.out", 2.0, 0.0);
+    int8_t *tinySubMat = new int8_t[subMat.alphabetSize * subMat.alphabetSize];
+    for (int i = 0; i < subMat.alphabetSize; i++) {
+        for (int j = 0; j < subMat.alphabetSize; j++) {
+            tinySubMat[i * subMat.alphabetSize + j] = (int8_t) subMat.subMatrix[i][j];
+        }
+    }
+
+    srand(1);
+    std::vector<std::pair<std::string, std::string> > pairs;
+    const size_t lengths[] = {1, 7, 16, 31, 33, 64, 100, 257, 1000, 3000};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        std::string query = randomSequence(lengths[i]);
+        pairs.push_back(std::make_pair(query, randomSequence(lengths[i] + rand() % 50)));
+        pairs.push_back(std::make_pair(query, randomSequence(10) + mutate(query) + randomSequence(10)));
+    }
+
+    const int supported = SimdDispatch::getSupportedLevel();
+    SimdDispatch::setLevel(SimdDispatch::LEVEL_SSE41);
+    std::vector<alignment_result_t> reference = alignAll(subMat, tinySubMat, pairs);
+    std::cout << "Reference level " << SimdDispatch::getLevelName(SimdDispatch::getLevel()) << "\n";
+
+    int failed = 0;
+    for (int level = SimdDispatch::LEVEL_SSE41 + 1; level <= supported; level++) {
+        SimdDispatch::setLevel(level);
+        std::vector<alignment_result_t> results = alignAll(subMat, tinySubMat, pairs);
+        for (size_t i = 0; i < results.size(); i++) {
+            const alignment_result_t &a = reference[i];
+            const alignment_result_t &b = results[i];
+            if (a.ungapped != b.ungapped || a.score != b.score || a.qStart != b.qStart || a.qEnd != b.qEnd
+                || a.dbStart != b.dbStart || a.dbEnd != b.dbEnd) {
+                std::cout << "Level " << SimdDispatch::getLevelName(level) << " differs for pair " << i << ": "
+                          << b.score << " " << b.qStart << "-" << b.qEnd << " " << b.dbStart << "-" << b.dbEnd
+                          << " expected "
+                          << a.score << " " << a.qStart << "-" << a.qEnd << " " << a.dbStart << "-" << a.dbEnd << "\n";
+                failed++;
+            }
+        }
+        std::cout << "Level " << SimdDispatch::getLevelName(level) << " compared on " << results.size() << " pairs\n";
+    }
+    for (size_t i = 0; i < reference.size(); i++) {
+        std::cout << reference[i].ungapped << " " << reference[i].score << " " << reference[i].qStart << "-" << reference[i].qEnd
+                  << " " << reference[i].dbStart << "-" << reference[i].dbEnd << "\n";
+    }
+    delete [] tinySubMat;
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
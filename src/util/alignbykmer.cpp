@@ -9,6 +9,7 @@
 #include "NucleotideMatrix.h"
 #include "ReducedMatrix.h"
 #include "ExtendedSubstitutionMatrix.h"
+#include "MemoryGovernor.h"
 
 #include <string>
 #include <vector>
@@ -133,7 +134,7 @@ int alignbykmer(int argc, const char **argv, const Command &command) {
     };
 
 
-    size_t totalMemory = Util::getTotalSystemMemory();
+    size_t totalMemory = MemoryGovernor::getAvailable();
     size_t flushSize = 100000000;
     if (totalMemory > dbr_res.getDataSize()) {
         flushSize = dbr_res.getSize();
@@ -82,10 +82,7 @@ qcov        Fraction of query sequence covered by alignment
 tcov        Fraction of target sequence covered by alignment
  */
 
-int convertalignments(int argc, const char **argv, const Command &command) {
-    Parameters &par = Parameters::getInstance();
-    par.parseParameters(argc, argv, command, 4);
-
+int doConvertAlignments(Parameters &par) {
     const bool sameDB = par.db1.compare(par.db2) == 0 ? true : false;
     const int format = par.formatAlignmentMode;
     const bool touch = (par.preloadMode != Parameters::PRELOAD_MODE_MMAP);
@@ -126,7 +123,13 @@ int convertalignments(int argc, const char **argv, const Command &command) {
 
     Debug(Debug::INFO) << "Alignment database: " << par.db3 << "\n";
     DBReader<unsigned int> alnDbr(par.db3.c_str(), par.db3Index.c_str());
+    alnDbr.setBinaryResultsReadable(true);
     alnDbr.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    if (alnDbr.getDbtype() == Sequence::PREFILTER_RES_BINARY) {
+        Debug(Debug::ERROR) << "Binary prefilter results can not be converted, use an alignment result database.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const bool binary = alnDbr.getDbtype() == Sequence::ALIGNMENT_RES_BINARY;
 
 #ifdef OPENMP
     unsigned int totalThreads = par.threads;
@@ -184,9 +187,17 @@ int convertalignments(int argc, const char **argv, const Command &command) {
             std::string queryId = Util::parseFastaHeader(qHeader);
 
             char *data = alnDbr.getData(i);
-            while (*data != '\0') {
-                Matcher::result_t res = Matcher::parseAlignmentRecord(data, true);
-                data = Util::skipLine(data);
+            const char *dataEnd = data + alnDbr.getSeqLens(i) - 1;
+            while (binary ? (data < dataEnd) : (*data != '\0')) {
+                Matcher::result_t res;
+                if (binary) {
+                    res = Matcher::parseBinaryAlignmentRecord(data, true);
+                    Matcher::result_record_t record;
+                    data = (char *) Matcher::readBinaryRecord(data, record);
+                } else {
+                    res = Matcher::parseAlignmentRecord(data, true);
+                    data = Util::skipLine(data);
+                }
 
                 if (res.backtrace.size() == 0 && needbacktrace == true) {
                     Debug(Debug::ERROR) << "Backtrace cigar is missing in the alignment result. Please recompute the alignment with the -a flag.\n"
@@ -423,3 +434,9 @@ int convertalignments(int argc, const char **argv, const Command &command) {
 
     return EXIT_SUCCESS;
 }
+
+int convertalignments(int argc, const char **argv, const Command &command) {
+    Parameters &par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, 4);
+    return doConvertAlignments(par);
+}
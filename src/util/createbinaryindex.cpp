@@ -0,0 +1,22 @@
+#include "Parameters.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Debug.h"
+#include "Util.h"
+#include "Timer.h"
+
+int createbinaryindex(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, 1);
+
+    Timer timer;
+    DBReader<unsigned int> reader(par.db1.c_str(), par.db1Index.c_str(), DBReader<unsigned int>::USE_INDEX);
+    // NOSORT sorts the entries by id, which the binary index requires
+    reader.open(DBReader<unsigned int>::NOSORT);
+    DBWriter::writeBinaryIndex(par.db1Index.c_str(), reader.getSize(), reader.getIndex(), reader.getSeqLens(), reader.getDbtype());
+    Debug(Debug::INFO) << "Wrote binary index of " << reader.getSize() << " entries to "
+                       << DBReader<unsigned int>::getBinaryIndexFileName(par.db1Index.c_str()) << "\n";
+    reader.close();
+    Debug(Debug::INFO) << "Time for creating binary index: " << timer.lap() << "\n";
+    return EXIT_SUCCESS;
+}
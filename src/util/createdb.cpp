@@ -7,7 +7,9 @@
 
 #include <cstdio>
 
+#include <algorithm>
 #include <map>
+#include <vector>
 #include <fstream>
 #include <unistd.h>
 #include <math.h>
@@ -21,6 +23,169 @@
 #include "Util.h"
 #include "KSeqWrapper.h"
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// input entries of one batch, the next batch is read while the entries of this one are written by the tasks
+struct FastaBatch {
+    std::string headers;
+    std::string sequences;
+    // start of each entry in headers and sequences, the last element is the end of the last entry
+    std::vector<size_t> headerOffsets;
+    std::vector<size_t> sequenceOffsets;
+    // number of the first database entry of each input entry, an input entry is written as splitCounts entries
+    std::vector<size_t> firstEntries;
+    std::vector<size_t> splitCounts;
+
+    void clear() {
+        headers.clear();
+        sequences.clear();
+        headerOffsets.assign(1, 0);
+        sequenceOffsets.assign(1, 0);
+        firstEntries.clear();
+        splitCounts.clear();
+    }
+
+    size_t size() const {
+        return firstEntries.size();
+    }
+};
+
+static const size_t BATCH_MAX_ENTRIES = 65536;
+static const size_t BATCH_MAX_RESIDUES = 32 * 1024 * 1024;
+static const size_t ENTRIES_PER_TASK = 1024;
+
+// only the first entries of every hundred are tested for nucleotide sequences
+static const size_t NUCL_SAMPLE_STEP = 100;
+static const size_t NUCL_SAMPLES = 100;
+
+// returns false if the input is exhausted
+static bool readBatch(KSeqWrapper *kseq, FastaBatch &batch, size_t &entries, const Parameters &par) {
+    batch.clear();
+    while (batch.size() < BATCH_MAX_ENTRIES && batch.sequences.size() < BATCH_MAX_RESIDUES) {
+        if (kseq->ReadEntry() == false) {
+            return false;
+        }
+        Debug::printProgress(entries);
+        const KSeqWrapper::KSeqEntry &e = kseq->entry;
+        if (e.name.l == 0) {
+            Debug(Debug::ERROR) << "Fasta entry: " << entries << " is invalid.\n";
+            EXIT(EXIT_FAILURE);
+        }
+
+        batch.headers.append(e.name.s, e.name.l);
+        if (e.comment.l > 0) {
+            batch.headers.append(" ", 1);
+            batch.headers.append(e.comment.s, e.comment.l);
+        }
+        batch.headerOffsets.push_back(batch.headers.size());
+        batch.sequences.append(e.sequence.s, e.sequence.l);
+        batch.sequenceOffsets.push_back(batch.sequences.size());
+
+        size_t splitCnt = 1;
+        if (par.splitSeqByLen == true) {
+            splitCnt = (size_t) ceilf(static_cast<float>(e.sequence.l) / static_cast<float>(par.maxSeqLen));
+        }
+        batch.firstEntries.push_back(entries);
+        batch.splitCounts.push_back(splitCnt);
+        entries += splitCnt;
+    }
+    return true;
+}
+
+static void writeEntries(const FastaBatch &batch, size_t begin, size_t end, const Parameters &par,
+                         DBWriter &seqWriter, DBWriter &hdrWriter, size_t &isNuclCnt) {
+    unsigned int thread_idx = 0;
+#ifdef OPENMP
+    thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+    std::string header;
+    header.reserve(1024);
+    std::string splitHeader;
+    splitHeader.reserve(1024);
+    std::string splitId;
+    splitId.reserve(1024);
+    for (size_t i = begin; i < end; i++) {
+        header.assign(batch.headers, batch.headerOffsets[i], batch.headerOffsets[i + 1] - batch.headerOffsets[i]);
+        const char *sequence = batch.sequences.data() + batch.sequenceOffsets[i];
+        const size_t length = batch.sequenceOffsets[i + 1] - batch.sequenceOffsets[i];
+        const size_t splitCnt = batch.splitCounts[i];
+
+        std::string headerId = Util::parseFastaHeader(header);
+        if (headerId == "") {
+            // An identifier is necessary for these two cases, so we should just give up
+            Debug(Debug::WARNING) << "Could not extract identifier from entry " << batch.firstEntries[i] << ".\n";
+
+        }
+        for (size_t split = 0; split < splitCnt; split++) {
+            splitId.append(headerId);
+            if (splitCnt > 1) {
+                splitId.append("_");
+                splitId.append(SSTR(split));
+            }
+
+            // keys only depend on the position in the input, not on the thread writing the entry
+            const size_t entry = batch.firstEntries[i] + split;
+            unsigned int id = par.identifierOffset + entry;
+
+            // For split entries replace the found identifier by identifier_splitNumber
+            // Also add another hint that it was split to the end of the header
+            splitHeader.append(header);
+            if (par.splitSeqByLen == true && splitCnt > 1) {
+                if (headerId != "") {
+                    size_t pos = splitHeader.find(headerId);
+                    if (pos != std::string::npos) {
+                        splitHeader.erase(pos, headerId.length());
+                        splitHeader.insert(pos, splitId);
+                    }
+                }
+                splitHeader.append(" Split=");
+                splitHeader.append(SSTR(split));
+            }
+
+            // space is needed for later parsing
+            splitHeader.append(" ", 1);
+            splitHeader.append("\n");
+
+            // Finally write down the entry
+            hdrWriter.writeData(splitHeader.c_str(), splitHeader.length(), id, thread_idx);
+            splitHeader.clear();
+            splitId.clear();
+
+            // check for the first 10 sequences if they are nucleotide sequences
+            if ((entry % NUCL_SAMPLE_STEP) == 0 && entry / NUCL_SAMPLE_STEP < NUCL_SAMPLES) {
+                size_t cnt = 0;
+                for (size_t pos = 0; pos < length; pos++) {
+                    switch (toupper(sequence[pos])) {
+                        case 'T':
+                        case 'A':
+                        case 'G':
+                        case 'C':
+                        case 'N': cnt++;
+                            break;
+                    }
+                }
+                float nuclDNAFraction = static_cast<float>(cnt) / static_cast<float>(length);
+                if (nuclDNAFraction > 0.9) {
+                    __sync_fetch_and_add(&isNuclCnt, 1);
+                }
+            }
+
+            char newLine = '\n';
+            seqWriter.writeStart(thread_idx);
+            if (par.splitSeqByLen) {
+                size_t len = std::min(par.maxSeqLen, length - split * par.maxSeqLen);
+                seqWriter.writeAdd(sequence + split * par.maxSeqLen, len, thread_idx);
+            } else {
+                seqWriter.writeAdd(sequence, length, thread_idx);
+            }
+            seqWriter.writeAdd(&newLine, 1, thread_idx);
+            seqWriter.writeEnd(id, thread_idx, true);
+        }
+    }
+}
+
 int createdb(int argn, const char **argv, const Command& command) {
     Parameters &par = Parameters::getInstance();
     par.parseParameters(argn, argv, command, 2, true, Parameters::PARSE_VARIADIC);
@@ -60,144 +225,62 @@ int createdb(int argn, const char **argv, const Command& command) {
         }
     }
 
-    DBWriter out_writer(data_filename.c_str(), index_filename.c_str());
-    DBWriter out_hdr_writer(data_filename_hdr.c_str(), index_filename_hdr.c_str());
+    // all threads write into one data file, the entries are found through the index sorted by key
+    // a shuffled database is written again below, only the final databases are written as shards
+    const bool sharded = par.shardDirs.empty() == false;
+    const size_t writerMode = (sharded && par.shuffleDatabase == false) ? DBWriter::SHARDED_MODE : DBWriter::SHARED_FILE_MODE;
+    DBWriter out_writer(data_filename.c_str(), index_filename.c_str(), par.threads, writerMode);
+    DBWriter out_hdr_writer(data_filename_hdr.c_str(), index_filename_hdr.c_str(), par.threads, writerMode);
+    out_writer.setShardDirectories(par.shardDirs);
+    out_hdr_writer.setShardDirectories(par.shardDirs);
     out_writer.open();
     out_hdr_writer.open();
 
-    unsigned int entries_num = 0;
-    size_t count = 0;
-    size_t sampleCount = 0;
-
-    const size_t testForNucSequence = 100;
+    size_t entries_num = 0;
     size_t isNuclCnt = 0;
 
     // keep number of entries in each file
-    unsigned int numEntriesInCurrFile = 0;
     unsigned int * fileToNumEntries =  new unsigned int[filenames.size()];
-    for (size_t i = 0; i < filenames.size(); i++) {
-        numEntriesInCurrFile = 0;
-        std::string splitHeader;
-        splitHeader.reserve(1024);
-        std::string header;
-        header.reserve(1024);
-        std::string splitId;
-        splitId.reserve(1024);
-        KSeqWrapper *kseq = KSeqFactory(filenames[i].c_str());
-        while (kseq->ReadEntry()) {
-            Debug::printProgress(count);
-            const KSeqWrapper::KSeqEntry &e = kseq->entry;
-            if (e.name.l == 0) {
-                Debug(Debug::ERROR) << "Fasta entry: " << entries_num << " is invalid.\n";
-                EXIT(EXIT_FAILURE);
-            }
-
-            size_t splitCnt = 1;
-            if (par.splitSeqByLen == true) {
-                splitCnt = (size_t) ceilf(static_cast<float>(e.sequence.l) / static_cast<float>(par.maxSeqLen));
-            }
-
-            // header
-            header.append(e.name.s, e.name.l);
-            if (e.comment.l > 0) {
-                header.append(" ", 1);
-                header.append(e.comment.s,e.comment.l);
-            }
-
-            std::string headerId = Util::parseFastaHeader(header);
-            if (headerId == "") {
-                // An identifier is necessary for these two cases, so we should just give up
-                Debug(Debug::WARNING) << "Could not extract identifier from entry " << entries_num << ".\n";
-
-            }
-            for (size_t split = 0; split < splitCnt; split++) {
-                splitId.append(headerId);
-                if (splitCnt > 1) {
-                    splitId.append("_");
-                    splitId.append(SSTR(split));
-                }
-
-                unsigned int id = par.identifierOffset + entries_num;
-
-
-                // For split entries replace the found identifier by identifier_splitNumber
-                // Also add another hint that it was split to the end of the header
-                splitHeader.append(header);
-                if (par.splitSeqByLen == true && splitCnt > 1) {
-                    if (headerId != "") {
-                        size_t pos = splitHeader.find(headerId);
-                        if (pos != std::string::npos) {
-                            splitHeader.erase(pos, headerId.length());
-                            splitHeader.insert(pos, splitId);
-                        }
+    // the input is read (and BGZF input decompressed by tasks) in one thread, while the tasks of the
+    // previous batch parse the headers and write the entries
+    FastaBatch batches[2];
+    size_t current = 0;
+#pragma omp parallel
+    {
+#pragma omp single
+        {
+            for (size_t i = 0; i < filenames.size(); i++) {
+                const size_t firstEntryOfFile = entries_num;
+                KSeqWrapper *kseq = KSeqFactory(filenames[i].c_str());
+                bool hasMore = true;
+                while (hasMore) {
+                    FastaBatch *batch = &batches[current];
+                    hasMore = readBatch(kseq, *batch, entries_num, par);
+                    // the tasks of the previous batch have to finish before its buffer is read into again
+#pragma omp taskwait
+                    for (size_t begin = 0; begin < batch->size(); begin += ENTRIES_PER_TASK) {
+                        const size_t end = std::min(begin + ENTRIES_PER_TASK, batch->size());
+#pragma omp task firstprivate(batch, begin, end)
+                        writeEntries(*batch, begin, end, par, out_writer, out_hdr_writer, isNuclCnt);
                     }
-                    splitHeader.append(" Split=");
-                    splitHeader.append(SSTR(split));
+                    current ^= 1;
                 }
-
-                // space is needed for later parsing
-                splitHeader.append(" ", 1);
-                splitHeader.append("\n");
-
-                // Finally write down the entry
-                out_hdr_writer.writeData(splitHeader.c_str(), splitHeader.length(), id);
-                splitHeader.clear();
-                splitId.clear();
-
-                // check for the first 10 sequences if they are nucleotide sequences
-                if((count % 100) == 0){
-                    if(sampleCount < testForNucSequence){
-                        size_t cnt=0;
-                        for(size_t i = 0; i < e.sequence.l; i++){
-                            switch(toupper(e.sequence.s[i]))
-                            {
-                                case 'T':
-                                case 'A':
-                                case 'G':
-                                case 'C':
-                                case 'N': cnt++;
-                                    break;
-                            }
-                        }
-                        float nuclDNAFraction = static_cast<float>(cnt)/static_cast<float>(e.sequence.l);
-                        if(nuclDNAFraction > 0.9){
-                            isNuclCnt += true;
-                        }
-                    }
-                    sampleCount++;
-                }
-
-                if (par.splitSeqByLen) {
-                    size_t len = std::min(par.maxSeqLen, e.sequence.l - split * par.maxSeqLen);
-                    out_writer.writeStart(0);
-                    out_writer.writeAdd(e.sequence.s + split * par.maxSeqLen, len, 0);
-                    char newLine = '\n';
-                    out_writer.writeAdd(&newLine, 1, 0);
-                    out_writer.writeEnd(id, 0, true);
-                } else {
-                    out_writer.writeStart(0);
-                    out_writer.writeAdd(e.sequence.s, e.sequence.l, 0);
-                    char newLine = '\n';
-                    out_writer.writeAdd(&newLine, 1, 0);
-                    out_writer.writeEnd(id, 0, true);
-                }
-
-                entries_num++;
-                numEntriesInCurrFile++;
-                count++;
+                fileToNumEntries[i] = entries_num - firstEntryOfFile;
+                delete kseq;
             }
-            header.clear();
         }
-        fileToNumEntries[i] = numEntriesInCurrFile;
-        delete kseq;
     }
 
+    const size_t testForNucSequence = NUCL_SAMPLES;
+    const size_t sampleCount = (entries_num + NUCL_SAMPLE_STEP - 1) / NUCL_SAMPLE_STEP;
     int dbType = Sequence::AMINO_ACIDS;
     if (isNuclCnt == sampleCount || isNuclCnt == testForNucSequence) {
         dbType = Sequence::NUCLEOTIDES;
     }
-    out_hdr_writer.close();
-    out_writer.close(dbType);
+    // the shuffled database replaces the index, so there is no need for a binary index yet
+    const bool binaryIndex = par.binaryIndex && par.shuffleDatabase == false;
+    out_hdr_writer.close(-1, binaryIndex);
+    out_writer.close(dbType, binaryIndex);
 
     // shuffle data
     if(par.shuffleDatabase == true){
@@ -235,17 +318,22 @@ int createdb(int argn, const char **argv, const Command& command) {
             std::swap(lengthHeader[n_new], lengthHeader[n]);
             std::swap(keyToFileAfterShuf[n_new], keyToFileAfterShuf[n]);
         }
-        DBWriter out_writer_shuffled(data_filename.c_str(), index_filename.c_str());
+        // the entries are distributed over one shard per thread
+        const unsigned int shuffledThreads = sharded ? par.threads : 1;
+        const size_t shuffledMode = sharded ? DBWriter::SHARDED_MODE : DBWriter::ASCII_MODE;
+        DBWriter out_writer_shuffled(data_filename.c_str(), index_filename.c_str(), shuffledThreads, shuffledMode);
+        out_writer_shuffled.setShardDirectories(par.shardDirs);
         out_writer_shuffled.open();
         for (unsigned int n = 0; n < readerSequence.getSize(); n++) {
             unsigned int id = par.identifierOffset + n;
             const char * data = readerSequence.getData() + indexSequence[n].offset;
-            out_writer_shuffled.writeData(data, lengthSequence[n]-1, id);
+            out_writer_shuffled.writeData(data, lengthSequence[n]-1, id, n % shuffledThreads);
         }
         readerSequence.close();
-        out_writer_shuffled.close(dbType);
+        out_writer_shuffled.close(dbType, par.binaryIndex);
 
-        DBWriter out_hdr_writer_shuffled(data_filename_hdr.c_str(), index_filename_hdr.c_str());
+        DBWriter out_hdr_writer_shuffled(data_filename_hdr.c_str(), index_filename_hdr.c_str(), shuffledThreads, shuffledMode);
+        out_hdr_writer_shuffled.setShardDirectories(par.shardDirs);
         out_hdr_writer_shuffled.open();
         readerHeader.readMmapedDataInMemory();
         char lookupBuffer[32768];
@@ -262,9 +350,9 @@ int createdb(int argn, const char **argv, const Command& command) {
             tmpBuff = Itoa::u32toa_sse2(keyToFileAfterShuf[n], lookupBuffer);
             *(tmpBuff-1) = '\n';
             fwrite(lookupBuffer, sizeof(char), tmpBuff-lookupBuffer, lookupFile);
-            out_hdr_writer_shuffled.writeData(data, lengthHeader[n]-1, id);
+            out_hdr_writer_shuffled.writeData(data, lengthHeader[n]-1, id, n % shuffledThreads);
         }
-        out_hdr_writer_shuffled.close();
+        out_hdr_writer_shuffled.close(-1, par.binaryIndex);
         readerHeader.close();
         fclose(lookupFile);
         delete[] keyToFileAfterShuf;
@@ -4,6 +4,7 @@
 #include "PrefilteringIndexReader.h"
 #include "Prefiltering.h"
 #include "Parameters.h"
+#include "MemoryGovernor.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -37,6 +38,13 @@ bool isIndexCompatible(DBReader<unsigned int>& index, const Parameters& par, con
         return false;
     if (par.spacedKmerPattern != PrefilteringIndexReader::getSpacedPattern(&index))
         return false;
+    if (par.compressIndex != PrefilteringIndexReader::isCompressedIndex(&index))
+        return false;
+    // profile indices are never sparse
+    const int sparseIndex = (dbtype == Sequence::HMM_PROFILE || dbtype == Sequence::PROFILE_STATE_SEQ) ? IndexTable::SPARSE_INDEX_OFF : par.sparseIndex;
+    std::pair<int, int> sparse = PrefilteringIndexReader::getSparseIndex(&index);
+    if (sparse.first != sparseIndex || (sparseIndex != IndexTable::SPARSE_INDEX_OFF && sparse.second != std::max(par.sparseWindow, 1)))
+        return false;
     if (meta.headers2 == 1 && par.includeHeader && (par.db1 != par.db2))
         return true;
     return true;
@@ -62,13 +70,11 @@ int indexdb(int argc, const char **argv, const Command &command) {
     int split = 1;
     int splitMode = Parameters::TARGET_DB_SPLIT;
 
-    size_t memoryLimit;
-    if (par.splitMemoryLimit > 0) {
-        memoryLimit = static_cast<size_t>(par.splitMemoryLimit) * 1024;
-    } else {
-        memoryLimit = static_cast<size_t>(Util::getTotalSystemMemory() * 0.9);
-    }
-    Prefiltering::setupSplit(dbr, subMat->alphabetSize, dbr.getDbtype(), par.threads, false, par.maxResListLen, memoryLimit, &par.kmerSize, &split, &splitMode);
+    const size_t memoryLimit = MemoryGovernor::getAvailable();
+    // the prefilter picks its own thread count
+    int searchThreads = par.threads;
+    Prefiltering::setupSplit(dbr, subMat->alphabetSize, dbr.getDbtype(), &searchThreads, false, par.compressIndex,
+                             IndexTable::getSparseDensity(par.sparseIndex, par.sparseWindow), 1, par.maxResListLen, memoryLimit, &par.kmerSize, &split, &splitMode);
 
     bool kScoreSet = false;
     for (size_t i = 0; i < par.indexdb.size(); i++) {
@@ -116,7 +122,8 @@ int indexdb(int argc, const char **argv, const Command &command) {
 
     PrefilteringIndexReader::createIndexFile(indexDB, &dbr, hdbr1, hdbr2, subMat, par.maxSeqLen,
                                              par.spacedKmer, par.spacedKmerPattern, par.compBiasCorrection,
-                                             subMat->alphabetSize, par.kmerSize, par.maskMode, par.kmerScore);
+                                             subMat->alphabetSize, par.kmerSize, par.maskMode, par.kmerScore,
+                                             par.compressIndex, par.sparseIndex, par.sparseWindow);
 
     if (hdbr2 != NULL) {
         hdbr2->close();
@@ -119,7 +119,16 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
     }
 
     // + 1 for query
-    size_t maxSetSize = resultReader.maxCount('\n') + 1;
+    const bool binary = resultReader.getDbtype() == Sequence::ALIGNMENT_RES_BINARY;
+    size_t maxSetSize = 0;
+    if (binary) {
+        for (size_t id = 0; id < resultReader.getSize(); id++) {
+            maxSetSize = std::max(maxSetSize, Matcher::countBinaryRecords(resultReader.getData(id), resultReader.getSeqLens(id) - 1));
+        }
+    } else {
+        maxSetSize = resultReader.maxCount('\n');
+    }
+    maxSetSize += 1;
 
     // adjust score of each match state by -0.2 to trim alignment
     SubstitutionMatrix subMat(par.scoringMatrixFile.c_str(), 2.0f, -0.2f);
@@ -184,22 +193,35 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
             }
 
             char *results = resultReader.getData(id);
+            const char *resultsEnd = results + resultReader.getSeqLens(id) - 1;
             std::vector<Matcher::result_t> alnResults;
             std::vector<Sequence *> seqSet;
-            while (*results != '\0') {
-                char dbKey[255 + 1];
-                Util::parseKey(results, dbKey);
-                const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
+            while (binary ? (results < resultsEnd) : (*results != '\0')) {
+                unsigned int key;
+                char *nextResult;
+                bool hasBacktrace;
+                if (binary) {
+                    Matcher::result_record_t record;
+                    nextResult = (char *) Matcher::readBinaryRecord(results, record);
+                    key = record.dbKey;
+                    hasBacktrace = record.backtraceLength > 0;
+                } else {
+                    char dbKey[255 + 1];
+                    Util::parseKey(results, dbKey);
+                    key = (unsigned int) strtoul(dbKey, NULL, 10);
+                    nextResult = Util::skipLine(results);
+                    char *entry[255];
+                    hasBacktrace = Util::getWordsOfLine(results, entry, 255) > Matcher::ALN_RES_WITH_OUT_BT_COL_CNT;
+                }
                 // in the same database case, we have the query repeated
                 if ((key == queryKey && sameDatabase == true)) {
-                    results = Util::skipLine(results);
+                    results = nextResult;
                     continue;
                 }
 
-                char *entry[255];
-                const size_t columns = Util::getWordsOfLine(results, entry, 255);
-                if (columns > Matcher::ALN_RES_WITH_OUT_BT_COL_CNT) {
-                    Matcher::result_t res = Matcher::parseAlignmentRecord(results);
+                if (hasBacktrace) {
+                    Matcher::result_t res = binary ? Matcher::parseBinaryAlignmentRecord(results)
+                                                   : Matcher::parseAlignmentRecord(results);
                     alnResults.push_back(res);
                 }
 
@@ -225,7 +247,7 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
                 }
 
                 seqSet.push_back(edgeSequence);
-                results = Util::skipLine(results);
+                results = nextResult;
             }
 
             // Recompute if not all the backtraces are present
@@ -381,7 +403,13 @@ int result2profile(int argc, const char **argv, const Command &command) {
     par.parseParameters(argc, argv, command, 4);
 
     DBReader<unsigned int> resultReader(par.db3.c_str(), par.db3Index.c_str());
+    resultReader.setBinaryResultsReadable(true);
     resultReader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    resultReader.setReadAhead(DBReader<unsigned int>::DEFAULT_READ_AHEAD);
+    if (resultReader.getDbtype() == Sequence::PREFILTER_RES_BINARY) {
+        Debug(Debug::ERROR) << "Binary prefilter results do not contain alignments, use an alignment result database.\n";
+        EXIT(EXIT_FAILURE);
+    }
 
 #ifdef HAVE_MPI
     size_t dbFrom = 0;
@@ -0,0 +1,72 @@
+#include "Parameters.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Debug.h"
+#include "Util.h"
+#include "Matcher.h"
+#include "QueryMatcher.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+int result2text(int argc, const char **argv, const Command &command) {
+    Parameters &par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, 2);
+
+    DBReader<unsigned int> resultReader(par.db1.c_str(), par.db1Index.c_str());
+    resultReader.setBinaryResultsReadable(true);
+    resultReader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    const int dbType = resultReader.getDbtype();
+    if (DBReader<unsigned int>::isBinaryResult(dbType) == false) {
+        Debug(Debug::ERROR) << par.db1 << " does not contain binary results.\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    DBWriter resultWriter(par.db2.c_str(), par.db2Index.c_str(), par.threads);
+    resultWriter.open();
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+
+        std::string result;
+        std::vector<char> buffer(1024);
+#pragma omp for schedule(dynamic, 100)
+        for (size_t id = 0; id < resultReader.getSize(); ++id) {
+            Debug::printProgress(id);
+
+            char *data = resultReader.getData(id);
+            const char *end = data + resultReader.getSeqLens(id) - 1;
+            while (data < end) {
+                size_t len;
+                if (dbType == Sequence::PREFILTER_RES_BINARY) {
+                    hit_t hit = QueryMatcher::parseBinaryPrefilterHit(data);
+                    len = QueryMatcher::prefilterHitToBuffer(buffer.data(), hit);
+                    data += sizeof(hit_t);
+                } else {
+                    Matcher::result_record_t record;
+                    Matcher::readBinaryRecord(data, record);
+                    buffer.resize(std::max(buffer.size(), (size_t) (1024 + record.backtraceLength)));
+                    // the backtrace is already compressed
+                    Matcher::result_t res = Matcher::parseBinaryAlignmentRecord(data, true);
+                    len = Matcher::resultToBuffer(buffer.data(), res, record.backtraceLength > 0, false);
+                    data += sizeof(Matcher::result_record_t) + record.backtraceLength;
+                }
+                result.append(buffer.data(), len);
+            }
+            resultWriter.writeData(result.c_str(), result.length(), resultReader.getDbKey(id), thread_idx);
+            result.clear();
+        }
+    }
+    Debug(Debug::INFO) << "\n";
+    resultWriter.close();
+    resultReader.close();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,353 @@
+// searchserver keeps the prefilter index table, the sequence lookup and the score matrices of a target
+// database resident and answers search requests (prefilter + align) from searchclient over a unix domain socket.
+// A request is a single line "<queryDB>\t<alignmentDB>\n" with absolute paths,
+// the server answers with "OK <time>\n" or "ERROR <message>\n".
+// Requests are processed one after another, each one uses all threads of the server.
+// The searches run in a worker process that keeps Prefiltering and Alignment between requests. Both exit on
+// invalid input, so every query database is validated first. If the worker still dies during a request,
+// the server answers with an error and starts a new worker.
+#include "Command.h"
+#include "Debug.h"
+#include "Util.h"
+#include "FileUtil.h"
+#include "Parameters.h"
+#include "DBReader.h"
+#include "Prefiltering.h"
+#include "Alignment.h"
+#include "Timer.h"
+
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const size_t MAX_REQUEST_LENGTH = 2 * PATH_MAX + 2;
+
+static bool setSocketAddress(const std::string &path, struct sockaddr_un *address) {
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    if (path.length() >= sizeof(address->sun_path)) {
+        Debug(Debug::ERROR) << "Socket path " << path << " is longer than " << sizeof(address->sun_path) - 1 << " characters.\n";
+        return false;
+    }
+    strncpy(address->sun_path, path.c_str(), sizeof(address->sun_path) - 1);
+    return true;
+}
+
+static bool writeLine(int fd, const std::string &line) {
+    size_t written = 0;
+    while (written < line.length()) {
+        ssize_t ret = write(fd, line.c_str() + written, line.length() - written);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return false;
+        }
+        written += ret;
+    }
+    return true;
+}
+
+static bool readLine(int fd, std::string &line) {
+    line.clear();
+    char c;
+    while (line.length() < MAX_REQUEST_LENGTH) {
+        ssize_t ret = read(fd, &c, 1);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return false;
+        }
+        if (c == '\n') {
+            return true;
+        }
+        line.push_back(c);
+    }
+    return false;
+}
+
+static std::string absolutePath(const std::string &path) {
+    char resolved[PATH_MAX];
+    if (realpath(path.c_str(), resolved) != NULL) {
+        return resolved;
+    }
+    // the output database does not exist yet, resolve its directory instead
+    std::string dir = FileUtil::dirName(path);
+    if (realpath(dir.c_str(), resolved) == NULL) {
+        return path;
+    }
+    return std::string(resolved) + "/" + FileUtil::baseName(path);
+}
+
+// empty if the query database can be searched, otherwise the reason why not
+static std::string validateQueryDB(const std::string &queryDB, size_t maxSeqLen) {
+    const std::string queryDBIndex = queryDB + ".index";
+    if (FileUtil::fileExists(queryDB.c_str()) == false || FileUtil::fileExists(queryDBIndex.c_str()) == false) {
+        return "Query database " + queryDB + " does not exist";
+    }
+    const int queryDbType = DBReader<unsigned int>::parseDbType(queryDB.c_str());
+    if (queryDbType != Sequence::AMINO_ACIDS) {
+        return "Query database " + queryDB + " has to be of type " + DBReader<unsigned int>::getDbTypeName(Sequence::AMINO_ACIDS);
+    }
+
+    DBReader<unsigned int> reader(queryDB.c_str(), queryDBIndex.c_str());
+    reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    std::string error;
+    for (size_t id = 0; id < reader.getSize() && error.empty(); id++) {
+        // read like Sequence::mapSequence, which neither checks the length nor the characters
+        const char *seq = reader.getData(id);
+        size_t length = 0;
+        while (seq[length] != '\0' && seq[length] != '\n') {
+            if (isgraph(static_cast<unsigned char>(seq[length])) == false) {
+                error = "Query " + SSTR(reader.getDbKey(id)) + " in " + queryDB + " contains invalid characters";
+                break;
+            }
+            length++;
+        }
+        if (error.empty() && length > maxSeqLen) {
+            error = "Query " + SSTR(reader.getDbKey(id)) + " in " + queryDB + " is longer than --max-seq-len";
+        }
+    }
+    reader.close();
+    return error;
+}
+
+static std::string processRequest(Prefiltering &pref, Alignment &aln, Parameters &par, const std::string &targetDB,
+                                  const std::string &request) {
+    size_t pos = request.find('\t');
+    if (pos == std::string::npos) {
+        return "ERROR Malformed request";
+    }
+    const std::string queryDB = request.substr(0, pos);
+    const std::string alnDB = request.substr(pos + 1);
+    const std::string queryDBIndex = queryDB + ".index";
+    const std::string error = validateQueryDB(queryDB, par.maxSeqLen);
+    if (error.empty() == false) {
+        return "ERROR " + error;
+    }
+    const std::string outDir = FileUtil::dirName(alnDB);
+    if (FileUtil::directoryExists(outDir.c_str()) == false) {
+        return "ERROR Output directory " + outDir + " does not exist";
+    }
+    if (access(outDir.c_str(), W_OK) != 0) {
+        return "ERROR Output directory " + outDir + " is not writable";
+    }
+
+    Timer timer;
+    Debug(Debug::INFO) << "Search " << queryDB << " against " << targetDB << "\n";
+    const std::string prefDB = alnDB + "_pref";
+    const std::string prefDBIndex = prefDB + ".index";
+    pref.runAllSplits(queryDB, queryDBIndex, prefDB, prefDBIndex);
+
+    aln.setQuery(queryDB, queryDBIndex, prefDB, prefDBIndex, alnDB, alnDB + ".index");
+    aln.run(par.maxAccept, par.maxRejected);
+    FileUtil::deleteFile(prefDB);
+    FileUtil::deleteFile(prefDBIndex);
+
+    std::ostringstream reply;
+    reply << "OK " << timer.lap();
+    return reply.str();
+}
+
+// answers the requests read from fd until the server closes it
+static void runWorker(int fd, Parameters &par, const std::string &targetDB, int targetDbType) {
+    Timer timer;
+    Debug(Debug::INFO) << "Initialising data structures...\n";
+    Prefiltering pref(targetDB, targetDB + ".index", Sequence::AMINO_ACIDS, targetDbType, par);
+    // the prefilter keeps the target pages resident, the alignment does not need to touch them again
+    par.preloadMode = Parameters::PRELOAD_MODE_MMAP;
+    Alignment aln(targetDB, targetDB + ".index", Sequence::AMINO_ACIDS, par);
+    Debug(Debug::INFO) << "Time for init: " << timer.lap() << "\n";
+    if (writeLine(fd, "READY\n") == false) {
+        return;
+    }
+
+    std::string request;
+    while (readLine(fd, request) == true) {
+        if (writeLine(fd, processRequest(pref, aln, par, targetDB, request) + "\n") == false) {
+            return;
+        }
+    }
+}
+
+// forks a worker and waits until it is ready, returns false if it could not be started
+static bool startWorker(int serverFd, Parameters &par, const std::string &targetDB, int targetDbType,
+                        pid_t &worker, int &workerFd) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        Debug(Debug::ERROR) << "Could not create socket: " << strerror(errno) << "\n";
+        return false;
+    }
+    worker = fork();
+    if (worker < 0) {
+        Debug(Debug::ERROR) << "Could not start worker: " << strerror(errno) << "\n";
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (worker == 0) {
+        close(serverFd);
+        close(fds[0]);
+        runWorker(fds[1], par, targetDB, targetDbType);
+        close(fds[1]);
+        EXIT(EXIT_SUCCESS);
+    }
+    close(fds[1]);
+    workerFd = fds[0];
+
+    std::string line;
+    if (readLine(workerFd, line) == false || line != "READY") {
+        Debug(Debug::ERROR) << "Worker failed to initialise.\n";
+        close(workerFd);
+        waitpid(worker, NULL, 0);
+        return false;
+    }
+    return true;
+}
+
+int searchserver(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, 2, true, 0, MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_ALIGN);
+
+    // requests use absolute paths, so the target has to be absolute to detect query == target
+    const std::string targetDB = absolutePath(par.db1);
+    const std::string socketPath = par.db2;
+
+    // search prepares nucleotide targets (both strands, split sequences) and swaps profile targets to queries,
+    // the server only runs prefilter and align and would report other hits than search
+    const int targetDbType = DBReader<unsigned int>::parseDbType(targetDB.c_str());
+    if (targetDbType != Sequence::AMINO_ACIDS) {
+        Debug(Debug::ERROR) << "The target database has to be an amino acid sequence database. "
+                            << "Nucleotide and profile targets have to be searched with search.\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    struct sockaddr_un address;
+    if (setSocketAddress(socketPath, &address) == false) {
+        EXIT(EXIT_FAILURE);
+    }
+
+    struct stat st;
+    if (lstat(socketPath.c_str(), &st) == 0) {
+        if (S_ISSOCK(st.st_mode) == false) {
+            Debug(Debug::ERROR) << socketPath << " exists and is not a socket.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        // left over from a previous server
+        unlink(socketPath.c_str());
+    }
+
+    int serverFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (serverFd < 0) {
+        Debug(Debug::ERROR) << "Could not create socket: " << strerror(errno) << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (bind(serverFd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(serverFd, 16) != 0) {
+        Debug(Debug::ERROR) << "Could not listen on " << socketPath << ": " << strerror(errno) << "\n";
+        close(serverFd);
+        EXIT(EXIT_FAILURE);
+    }
+    // a client or worker that went away must not terminate the server
+    signal(SIGPIPE, SIG_IGN);
+
+    // the whole index table has to be resident, so it can only be split over queries
+    par.splitMode = Parameters::QUERY_DB_SPLIT;
+    // this process must not use OpenMP, libgomp does not support it in the forked worker afterwards
+    pid_t worker;
+    int workerFd;
+    if (startWorker(serverFd, par, targetDB, targetDbType, worker, workerFd) == false) {
+        close(serverFd);
+        unlink(socketPath.c_str());
+        EXIT(EXIT_FAILURE);
+    }
+
+    Debug(Debug::INFO) << "Listening on " << socketPath << "\n";
+    bool workerRunning = true;
+    while (workerRunning) {
+        int clientFd = accept(serverFd, NULL, NULL);
+        if (clientFd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Debug(Debug::ERROR) << "Could not accept connection: " << strerror(errno) << "\n";
+            break;
+        }
+
+        std::string request;
+        std::string reply;
+        bool workerDied = false;
+        if (readLine(clientFd, request) == false) {
+            reply = "ERROR Could not read request";
+        } else if (writeLine(workerFd, request + "\n") == false || readLine(workerFd, reply) == false) {
+            reply = "ERROR Search failed on the server, see its log";
+            workerDied = true;
+        }
+        if (reply.compare(0, 5, "ERROR") == 0) {
+            Debug(Debug::WARNING) << reply.substr(6) << "\n";
+        }
+        writeLine(clientFd, reply + "\n");
+        close(clientFd);
+
+        if (workerDied) {
+            close(workerFd);
+            waitpid(worker, NULL, 0);
+            Debug(Debug::WARNING) << "Worker died, restarting it.\n";
+            workerRunning = startWorker(serverFd, par, targetDB, targetDbType, worker, workerFd);
+        }
+    }
+
+    if (workerRunning) {
+        close(workerFd);
+        waitpid(worker, NULL, 0);
+    }
+    close(serverFd);
+    unlink(socketPath.c_str());
+    return EXIT_FAILURE;
+}
+
+int searchclient(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, 3);
+
+    struct sockaddr_un address;
+    if (setSocketAddress(par.db3, &address) == false) {
+        return EXIT_FAILURE;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+        Debug(Debug::ERROR) << "Could not connect to search server at " << par.db3 << ": " << strerror(errno) << "\n";
+        if (fd >= 0) {
+            close(fd);
+        }
+        return EXIT_FAILURE;
+    }
+
+    // the server might run in a different working directory
+    const std::string request = absolutePath(par.db1) + "\t" + absolutePath(par.db2) + "\n";
+    std::string reply;
+    if (writeLine(fd, request) == false || readLine(fd, reply) == false) {
+        Debug(Debug::ERROR) << "Connection to search server at " << par.db3 << " failed.\n";
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    if (reply.compare(0, 3, "OK ") != 0) {
+        Debug(Debug::ERROR) << (reply.compare(0, 6, "ERROR ") == 0 ? reply.substr(6) : reply) << "\n";
+        return EXIT_FAILURE;
+    }
+    Debug(Debug::INFO) << "Time for search: " << reply.substr(3) << "\n";
+    return EXIT_SUCCESS;
+}
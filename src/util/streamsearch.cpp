@@ -0,0 +1,232 @@
+// streamsearch searches the sequences of a FASTA/FASTQ file (plain, gzip, bzip2 or stdin) through a target
+// database without creating a query database first. The prefilter index of the target is built once,
+// the queries are read in batches of --stream-batch-size sequences. Each batch is written to a small query
+// database in the tmp folder, prefiltered, aligned, converted like convertalis and appended to the output file
+// before the next batch is read. Memory and temporary disk usage only depend on the batch size.
+#include "Command.h"
+#include "Debug.h"
+#include "Util.h"
+#include "FileUtil.h"
+#include "Parameters.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "KSeqWrapper.h"
+#include "Prefiltering.h"
+#include "Alignment.h"
+#include "Timer.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+int doConvertAlignments(Parameters &par);
+
+static bool isNucleotideSequence(const char *seq, size_t length) {
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        switch (toupper(seq[i])) {
+            case 'T':
+            case 'A':
+            case 'G':
+            case 'C':
+            case 'N':
+                count++;
+                break;
+        }
+    }
+    return static_cast<float>(count) / static_cast<float>(length) > 0.9;
+}
+
+static size_t writeQueryBatch(KSeqWrapper *kseq, size_t batchSize, size_t firstEntry, size_t maxSeqLen,
+                              const std::string &queryDB, int querySeqType) {
+    DBWriter seqWriter(queryDB.c_str(), (queryDB + ".index").c_str());
+    DBWriter hdrWriter((queryDB + "_h").c_str(), (queryDB + "_h.index").c_str());
+    seqWriter.open();
+    hdrWriter.open();
+
+    std::string header;
+    header.reserve(1024);
+    size_t count = 0;
+    size_t nuclCount = 0;
+    while (count < batchSize && kseq->ReadEntry()) {
+        const KSeqWrapper::KSeqEntry &e = kseq->entry;
+        if (e.name.l == 0) {
+            Debug(Debug::ERROR) << "Fasta entry: " << firstEntry + count << " is invalid.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        if (e.sequence.l > maxSeqLen) {
+            Debug(Debug::ERROR) << "Fasta entry: " << firstEntry + count << " is longer than --max-seq-len. "
+                                << "Long queries have to be split with createdb and searched with search.\n";
+            EXIT(EXIT_FAILURE);
+        }
+
+        // same header and sequence entries as createdb
+        header.append(e.name.s, e.name.l);
+        if (e.comment.l > 0) {
+            header.append(" ", 1);
+            header.append(e.comment.s, e.comment.l);
+        }
+        header.append(" \n");
+        hdrWriter.writeData(header.c_str(), header.length(), count);
+        header.clear();
+
+        seqWriter.writeStart(0);
+        seqWriter.writeAdd(e.sequence.s, e.sequence.l, 0);
+        char newLine = '\n';
+        seqWriter.writeAdd(&newLine, 1, 0);
+        seqWriter.writeEnd(count, 0, true);
+        nuclCount += isNucleotideSequence(e.sequence.s, e.sequence.l);
+        count++;
+    }
+
+    // the queries have to be amino acids, a translated search would silently compare the wrong alphabets
+    const int batchSeqType = (count > 0 && nuclCount == count) ? Sequence::NUCLEOTIDES : Sequence::AMINO_ACIDS;
+    if (count > 0 && batchSeqType != querySeqType) {
+        Debug(Debug::ERROR) << "Queries " << firstEntry << " to " << firstEntry + count - 1 << " are "
+                            << DBReader<unsigned int>::getDbTypeName(batchSeqType) << " sequences, but the target requires "
+                            << DBReader<unsigned int>::getDbTypeName(querySeqType) << " queries. "
+                            << "Translated searches have to use createdb and search.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    hdrWriter.close();
+    seqWriter.close(querySeqType);
+    return count;
+}
+
+static void appendFile(const std::string &fileName, FILE *out) {
+    FILE *in = FileUtil::openFileOrDie(fileName.c_str(), "r", true);
+    char buffer[64 * 1024];
+    size_t read;
+    while ((read = fread(buffer, sizeof(char), sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, sizeof(char), read, out) != read) {
+            Debug(Debug::ERROR) << "Could not write results to output file.\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+    fclose(in);
+    // results are visible to readers of the output as soon as the batch is done
+    fflush(out);
+}
+
+static void deleteDatabase(const std::string &name) {
+    const std::string files[4] = { name, name + ".index", name + ".dbtype", name + ".index.bin" };
+    for (size_t i = 0; i < 4; i++) {
+        if (FileUtil::fileExists(files[i].c_str())) {
+            FileUtil::deleteFile(files[i]);
+        }
+    }
+}
+
+int streamsearch(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, 4, true, 0, MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_ALIGN);
+
+    const std::string queryFile = par.db1;
+    const std::string targetDB = par.db2;
+    const std::string outFile = par.db3;
+    const std::string tmpDir = par.db4;
+
+    if (KSeqWrapper::isStdin(queryFile.c_str()) == false && FileUtil::fileExists(queryFile.c_str()) == false) {
+        Debug(Debug::ERROR) << "File " << queryFile << " does not exist.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (FileUtil::directoryExists(tmpDir.c_str()) == false && FileUtil::makeDir(tmpDir.c_str()) == false) {
+        Debug(Debug::ERROR) << "Could not create tmp folder " << tmpDir << ".\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    // search prepares nucleotide targets (both strands, split sequences) and swaps profile targets to queries,
+    // streaming does not, it would report other hits than search
+    const int targetDbType = DBReader<unsigned int>::parseDbType(targetDB.c_str());
+    if (targetDbType != Sequence::AMINO_ACIDS) {
+        Debug(Debug::ERROR) << "The target database has to be an amino acid sequence database. "
+                            << "Nucleotide and profile targets have to be searched with search.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const int querySeqType = Sequence::AMINO_ACIDS;
+
+    bool needBacktrace = false;
+    {
+        bool needSequenceDB = false;
+        Parameters::getOutputFormat(par.outfmt, needSequenceDB, needBacktrace);
+    }
+    if (needBacktrace) {
+        Debug(Debug::INFO) << "Alignment backtraces will be computed, since they were requested by output format.\n";
+        par.addBacktrace = true;
+    }
+    if (par.dbOut) {
+        Debug(Debug::WARNING) << "Streamed results are always written as a text file.\n";
+        par.dbOut = false;
+    }
+
+    Timer timer;
+    Debug(Debug::INFO) << "Initialising data structures...\n";
+    // the whole index table has to be resident, so it can only be split over queries
+    par.splitMode = Parameters::QUERY_DB_SPLIT;
+    Prefiltering pref(targetDB, targetDB + ".index", querySeqType, targetDbType, par);
+    // the prefilter keeps the target pages resident, the alignment does not need to touch them again
+    par.preloadMode = Parameters::PRELOAD_MODE_MMAP;
+    Debug(Debug::INFO) << "Time for init: " << timer.lap() << "\n";
+
+    const std::string queryDB = tmpDir + "/query";
+    const std::string prefDB = tmpDir + "/pref";
+    const std::string alnDB = tmpDir + "/aln";
+    const std::string alisFile = tmpDir + "/alis";
+
+    FILE *out = FileUtil::openFileOrDie(outFile.c_str(), "w", false);
+    KSeqWrapper *kseq = KSeqFactory(queryFile.c_str());
+    size_t totalQueries = 0;
+    size_t batch = 0;
+    while (true) {
+        timer.reset();
+        const size_t count = writeQueryBatch(kseq, par.streamBatchSize, totalQueries, par.maxSeqLen, queryDB, querySeqType);
+        if (count == 0) {
+            break;
+        }
+        Debug(Debug::INFO) << "Search batch " << batch << " with " << count << " queries\n";
+
+        pref.runAllSplits(queryDB, queryDB + ".index", prefDB, prefDB + ".index");
+        {
+            Alignment aln(queryDB, queryDB + ".index", targetDB, targetDB + ".index",
+                          prefDB, prefDB + ".index", alnDB, alnDB + ".index", par);
+            aln.run(par.maxAccept, par.maxRejected);
+        }
+
+        par.db1 = queryDB;
+        par.db1Index = queryDB + ".index";
+        par.hdr1 = queryDB + "_h";
+        par.hdr1Index = queryDB + "_h.index";
+        par.db2 = targetDB;
+        par.db2Index = targetDB + ".index";
+        par.db3 = alnDB;
+        par.db3Index = alnDB + ".index";
+        par.db4 = alisFile;
+        par.db4Index = alisFile + ".index";
+        doConvertAlignments(par);
+        appendFile(alisFile, out);
+
+        totalQueries += count;
+        batch++;
+        Debug(Debug::INFO) << "Time for batch " << batch - 1 << ": " << timer.lap() << "\n";
+        if (count < static_cast<size_t>(par.streamBatchSize)) {
+            break;
+        }
+    }
+    delete kseq;
+    if (fclose(out) != 0) {
+        Debug(Debug::ERROR) << "Could not close output file " << outFile << ".\n";
+        EXIT(EXIT_FAILURE);
+    }
+    Debug(Debug::INFO) << "Searched " << totalQueries << " queries in " << batch << " batches\n";
+
+    deleteDatabase(queryDB);
+    deleteDatabase(queryDB + "_h");
+    deleteDatabase(prefDB);
+    deleteDatabase(alnDB);
+    if (FileUtil::fileExists(alisFile.c_str())) {
+        FileUtil::deleteFile(alisFile);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -9,6 +9,7 @@
 #include "AlignmentSymmetry.h"
 #include "PrefilteringIndexReader.h"
 #include "IndexReader.h"
+#include "MemoryGovernor.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -45,6 +46,7 @@ int doswap(Parameters& par, bool isGeneralMode) {
         Debug(Debug::INFO) << "Result database: " << parResultDbStr << "\n";
         DBReader<unsigned int> resultReader(parResultDb, parResultDbIndex);
         resultReader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+        resultReader.setReadAhead(DBReader<unsigned int>::DEFAULT_READ_AHEAD);
         //search for the maxTargetId (value of first column) in parallel
 #pragma omp parallel
         {
@@ -85,6 +87,7 @@ int doswap(Parameters& par, bool isGeneralMode) {
     Debug(Debug::INFO) << "Result database: " << parResultDbStr << "\n";
     DBReader<unsigned int> resultDbr(parResultDb, parResultDbIndex);
     resultDbr.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    resultDbr.setReadAhead(DBReader<unsigned int>::DEFAULT_READ_AHEAD);
 
     const size_t resultSize = resultDbr.getSize();
     Debug(Debug::INFO) << "Computing offsets.\n";
@@ -113,12 +116,7 @@ int doswap(Parameters& par, bool isGeneralMode) {
         }
     }
 
-    size_t memoryLimit;
-    if (par.splitMemoryLimit > 0) {
-        memoryLimit = static_cast<size_t>(par.splitMemoryLimit) * 1024;
-    } else {
-        memoryLimit = static_cast<size_t>(Util::getTotalSystemMemory() * 0.9);
-    }
+    const size_t memoryLimit = MemoryGovernor::getAvailable();
     // compute splits
     std::vector<std::pair<unsigned int, size_t > > splits;
     std::vector<std::pair<std::string , std::string > > splitFileNames;
@@ -5,6 +5,7 @@
 #include "Util.h"
 #include "Debug.h"
 #include "Parameters.h"
+#include "DBReader.h"
 
 #include "easysearch.sh.h"
 
@@ -58,6 +59,20 @@ int easysearch(int argc, const char **argv, const Command &command) {
         par.addBacktrace = true;
     }
 
+    if (par.streamQueries && (par.greedyBestHits || par.numIterations > 1 || par.sensSteps > 1)) {
+        Debug(Debug::WARNING) << "Queries can only be streamed through a single search step. "
+                                 "They will be converted to a database first.\n";
+        par.streamQueries = 0;
+    }
+    // streamsearch only runs prefilter and align, the nucleotide and profile target searches need more steps.
+    // A FASTA target is checked by easysearch.sh once its database is created
+    if (par.streamQueries && FileUtil::fileExists((par.db2 + ".dbtype").c_str())
+        && DBReader<unsigned int>::parseDbType(par.db2.c_str()) != Sequence::AMINO_ACIDS) {
+        Debug(Debug::WARNING) << "Queries can only be streamed against amino acid targets. "
+                                 "They will be converted to a database first.\n";
+        par.streamQueries = 0;
+    }
+
     if (FileUtil::directoryExists(par.db4.c_str()) == false) {
         Debug(Debug::INFO) << "Tmp " << par.db4 << " folder does not exist or is not a directory.\n";
         if (FileUtil::makeDir(par.db4.c_str()) == false) {
@@ -84,6 +99,7 @@ int easysearch(int argc, const char **argv, const Command &command) {
     cmd.addVariable("REMOVE_TMP", par.removeTmpFiles ? "TRUE" : NULL);
     cmd.addVariable("GREEDY_BEST_HITS", par.greedyBestHits ? "TRUE" : NULL);
     cmd.addVariable("LEAVE_INPUT", par.dbOut ? "TRUE" : NULL);
+    cmd.addVariable("STREAM_QUERIES", par.streamQueries ? "TRUE" : NULL);
 
     cmd.addVariable("RUNNER", par.runner.c_str());
 
@@ -91,6 +107,7 @@ int easysearch(int argc, const char **argv, const Command &command) {
     cmd.addVariable("SEARCH_PAR", par.createParameterString(par.searchworkflow).c_str());
     cmd.addVariable("CONVERT_PAR", par.createParameterString(par.convertalignments).c_str());
     cmd.addVariable("SUMMARIZE_PAR", par.createParameterString(par.summarizeresult).c_str());
+    cmd.addVariable("STREAMSEARCH_PAR", par.createParameterString(par.streamsearch).c_str());
 
     FileUtil::writeFile(tmpDir + "/easysearch.sh", easysearch_sh, easysearch_sh_len);
     std::string program(tmpDir + "/easysearch.sh");